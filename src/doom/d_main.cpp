@@ -73,6 +73,7 @@
 #include "i_timer.h"
 #include "i_video.h"
 
+#include "g_benchmark.h"
 #include "g_game.h"
 
 #include "hu_stuff.h"
@@ -154,6 +155,7 @@ extern "C"
 	extern int32_t		vertical_fov_degrees;
 	extern int32_t		stats_style;
 	extern doombool		rendersplitvisualise;
+	extern atomicval_t	renderthreadCPUmelter;
 
 	doombool refreshstatusbar = true;
 
@@ -605,6 +607,10 @@ void D_RunFrame()
 	int32_t prev_render_post_scaling = render_post_scaling;
 
 	uint64_t start = I_GetTimeUS();
+	if( M_ProfileTraceDumpPending() )
+	{
+		jobs->FlushAll();
+	}
 	M_ProfileNewFrame();
 	M_PROFILE_PUSH( __FUNCTION__, __FILE__, __LINE__ );
 
@@ -615,6 +621,7 @@ void D_RunFrame()
 	I_StartTic();
 
 	jobs->SetMaxJobs( num_render_contexts - 1 );
+	jobs->SetAllowParking( I_AtomicLoad( &renderthreadCPUmelter ) == 0 );
 	jobs->NewProfileFrame();
 
 	if (wipe)
@@ -662,6 +669,11 @@ void D_RunFrame()
 	I_FinishUpdate( NULL );
 
 	frametime = I_GetTimeUS() - start;
+
+	if( benchmarking )
+	{
+		G_BenchmarkFrame( frametime_withoutpresent );
+	}
 }
 
 //
@@ -1551,6 +1563,43 @@ static void LoadIwadDeh(void)
     }
 }
 
+// Adds a demo lump file from the command line, returning the lump
+// name to play it back with.
+static void D_AddDemoFile(const char* demoarg, char* lumpname, size_t lumpnamesize)
+{
+    char file[256];
+    char *uc_filename = strdup(demoarg);
+    M_ForceUppercase(uc_filename);
+
+    // With Vanilla you have to specify the file without extension,
+    // but make that optional.
+    if (M_StringEndsWith(uc_filename, ".LMP"))
+    {
+        M_StringCopy(file, demoarg, sizeof(file));
+    }
+    else
+    {
+        DEH_snprintf(file, sizeof(file), "%s.lmp", demoarg);
+    }
+
+    free(uc_filename);
+
+    if (D_AddFile(file))
+    {
+        M_StringCopy(lumpname, lumpinfo[numlumps - 1]->name, lumpnamesize);
+    }
+    else
+    {
+        // If file failed to load, still continue trying to play
+        // the demo in the same way as Vanilla Doom.  This makes
+        // tricks like "-playdemo demo1" possible.
+
+        M_StringCopy(lumpname, demoarg, lumpnamesize);
+    }
+
+    I_TerminalPrintf( Log_Startup, "Playing demo %s.\n", file );
+}
+
 static void G_CheckDemoStatusAtExit (void)
 {
     G_CheckDemoStatus();
@@ -1636,6 +1685,7 @@ DOOM_C_API void D_DoomMain (void)
 
 	M_ProfileInit();
 	M_ProfileThreadInit( "Main" );
+	G_BenchmarkInit();
 
     I_AtExit(D_Endoom, false);
 
@@ -1968,37 +2018,19 @@ DOOM_C_API void D_DoomMain (void)
 
     if (p)
     {
-        char *uc_filename = strdup(myargv[p + 1]);
-        M_ForceUppercase(uc_filename);
-
-        // With Vanilla you have to specify the file without extension,
-        // but make that optional.
-        if (M_StringEndsWith(uc_filename, ".LMP"))
-        {
-            M_StringCopy(file, myargv[p + 1], sizeof(file));
-        }
-        else
-        {
-            DEH_snprintf(file, sizeof(file), "%s.lmp", myargv[p+1]);
-        }
-
-        free(uc_filename);
+        D_AddDemoFile(myargv[p + 1], demolumpname, sizeof(demolumpname));
 
-        if (D_AddFile(file))
+        // Benchmarks can queue up any number of demos after -timedemo
+        if (benchmarking && M_CheckParm("-timedemo") == p)
         {
-            M_StringCopy(demolumpname, lumpinfo[numlumps - 1]->name,
-                         sizeof(demolumpname));
-        }
-        else
-        {
-            // If file failed to load, still continue trying to play
-            // the demo in the same way as Vanilla Doom.  This makes
-            // tricks like "-playdemo demo1" possible.
+            char extralumpname[9];
 
-            M_StringCopy(demolumpname, myargv[p + 1], sizeof(demolumpname));
+            for (int32_t extra = p + 2; extra < myargc && myargv[extra][0] != '-'; ++extra)
+            {
+                D_AddDemoFile(myargv[extra], extralumpname, sizeof(extralumpname));
+                G_BenchmarkAddDemo(extralumpname);
+            }
         }
-
-        I_TerminalPrintf( Log_Startup, "Playing demo %s.\n", file );
     }
 
     I_AtExit(G_CheckDemoStatusAtExit, true);
@@ -2037,6 +2069,7 @@ DOOM_C_API void D_DoomMain (void)
 	if( M_ParmExists( "-skyvoid" ) ) voidcleartype = Void_Sky;
 
 	rendersplitvisualise  = M_ParmExists( "-rendersplitvisualise" );
+	verifyinstancedata = M_ParmExists( "-verifyinstancedata" );
 
 	maxrendercontexts = M_MIN( (int32_t)I_ThreadGetHardwareCount(), JobSystem::MaxJobs );
 	p = M_CheckParmWithArgs( "-numrendercontexts", 1 );
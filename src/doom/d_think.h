@@ -288,6 +288,10 @@ DOOM_C_API struct thinker_s
 	actionf_t			function;
 	struct thinker_s*	prev;
 	struct thinker_s*	next;
+
+	// Where it lives in its type's registry, -1 if it never made it in
+	// to one. Removed thinkers hold on to it until the slot is recycled.
+	int32_t				registryslot;
 };
 
 #endif
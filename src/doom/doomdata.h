@@ -245,6 +245,24 @@ typedef PACKED_STRUCT (
 	uint8_t		side;
 }) mapseg_zdoom_t;
 
+// GL segs don't store their second vertex, it's the first vertex of
+// the next seg in the subsector. Minisegs have an invalid linedef.
+typedef PACKED_STRUCT (
+{
+	uint32_t	v1;
+	uint32_t	partner;
+	uint16_t	linedef;
+	uint8_t		side;
+}) mapseg_zdoom_gl_t;
+
+typedef PACKED_STRUCT (
+{
+	uint32_t	v1;
+	uint32_t	partner;
+	uint32_t	linedef;
+	uint8_t		side;
+}) mapseg_zdoom_gl2_t;
+
 // BSP node structure.
 
 // Indicate a leaf.
@@ -281,6 +299,17 @@ typedef PACKED_STRUCT (
 
 typedef mapnode_deepbsp_t mapnode_zdoom_t;
 
+typedef PACKED_STRUCT (
+{
+	// Fixed point partition line
+	int32_t		x;
+	int32_t		y;
+	int32_t		dx;
+	int32_t		dy;
+	int16_t		bbox[2][4];
+	int32_t		children[2];
+}) mapnode_zdoom_gl3_t;
+
 
 
 // Thing definition, position, orientation and type,
@@ -0,0 +1,410 @@
+//
+// Copyright(C) 2020-2022 Ethan Watson
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION: Timedemo benchmarking. Records per-frame timings
+//              for a queue of demos and writes them out as JSON
+//              or CSV for comparing builds.
+//
+
+#include "g_benchmark.h"
+
+#include "doomstat.h"
+
+#include "d_loop.h"
+
+#include "i_log.h"
+#include "i_system.h"
+#include "i_thread.h"
+#include "i_timer.h"
+
+#include "m_argv.h"
+#include "m_container.h"
+#include "m_misc.h"
+
+#include "r_main.h"
+#include "r_state.h"
+
+#include <algorithm>
+#include <cmath>
+
+extern "C"
+{
+	doombool				benchmarking = false;
+
+	extern int32_t			num_render_contexts;
+	extern int32_t			renderloadbalancing;
+	extern doombool			rendersharedbsp;
+	extern doombool			rendertiling;
+	extern int32_t			rendertilecolumns;
+	extern int32_t			rendertilerows;
+	extern int32_t			render_width;
+	extern int32_t			render_height;
+	extern int32_t			dynamic_resolution_scaling;
+}
+
+constexpr int32_t MaxBenchmarkContexts = JobSystem::MaxJobs + 1;
+
+typedef struct benchframe_s
+{
+	int32_t					demo;
+	uint64_t				gametic;
+	uint64_t				frametime;
+	uint64_t				rendertime;
+	uint64_t				tictime;
+	int32_t					numtics;
+	size_t					firstcontext;
+	int32_t					numcontexts;
+} benchframe_t;
+
+typedef struct benchdemo_s
+{
+	DoomString				name;
+	uint64_t				starttic;
+	uint64_t				endtic;
+	uint64_t				starttime;
+	uint64_t				endtime;
+	size_t					firstframe;
+	size_t					numframes;
+} benchdemo_t;
+
+typedef struct benchstats_s
+{
+	double_t				mean;
+	uint64_t				min;
+	uint64_t				p50;
+	uint64_t				p95;
+	uint64_t				p99;
+	uint64_t				max;
+} benchstats_t;
+
+static const char*					benchfilename = nullptr;
+static std::vector< DoomString >	benchqueue;
+static size_t						benchnextdemo = 0;
+
+static std::vector< benchdemo_t >	benchdemos;
+static std::vector< benchframe_t >	benchframes;
+static std::vector< uint64_t >		benchcontexttimes;
+static benchdemo_t*					benchcurrdemo = nullptr;
+
+static uint64_t						benchtictime = 0;
+static int32_t						benchnumtics = 0;
+
+static benchstats_t G_BenchmarkStats( std::span< benchframe_t > frames, uint64_t benchframe_t::*member )
+{
+	benchstats_t stats = {};
+	if( frames.empty() ) return stats;
+
+	std::vector< uint64_t > values;
+	values.reserve( frames.size() );
+	for( const benchframe_t& frame : frames )
+	{
+		values.push_back( frame.*member );
+	}
+	std::sort( values.begin(), values.end() );
+
+	// Nearest rank, so every percentile is a time that was actually measured
+	auto percentile = [ &values ]( double_t percent ) -> uint64_t
+	{
+		size_t rank = (size_t)std::ceil( percent * 0.01 * values.size() );
+		return values[ M_MAX( rank, (size_t)1 ) - 1 ];
+	};
+
+	uint64_t total = 0;
+	for( uint64_t value : values ) total += value;
+
+	stats.mean	= (double_t)total / values.size();
+	stats.min	= values.front();
+	stats.p50	= percentile( 50.0 );
+	stats.p95	= percentile( 95.0 );
+	stats.p99	= percentile( 99.0 );
+	stats.max	= values.back();
+
+	return stats;
+}
+
+// Demo names come from the command line, so they can hold anything.
+static DoomString G_BenchmarkEscapeJSON( const char* str )
+{
+	DoomString output;
+	for( const char* curr = str; *curr; ++curr )
+	{
+		unsigned char c = (unsigned char)*curr;
+		switch( c )
+		{
+		case '"':	output += "\\\"";	break;
+		case '\\':	output += "\\\\";	break;
+		case '\b':	output += "\\b";	break;
+		case '\f':	output += "\\f";	break;
+		case '\n':	output += "\\n";	break;
+		case '\r':	output += "\\r";	break;
+		case '\t':	output += "\\t";	break;
+		default:
+			if( c < 0x20 )
+			{
+				char escaped[ 8 ];
+				M_snprintf( escaped, sizeof( escaped ), "\\u%04x", c );
+				output += escaped;
+			}
+			else
+			{
+				output += (char)c;
+			}
+			break;
+		}
+	}
+	return output;
+}
+
+static DoomString G_BenchmarkEscapeCSV( const char* str )
+{
+	if( strpbrk( str, ",\"\r\n" ) == nullptr )
+	{
+		return str;
+	}
+
+	DoomString output = "\"";
+	for( const char* curr = str; *curr; ++curr )
+	{
+		if( *curr == '"' ) output += '"';
+		output += *curr;
+	}
+	output += '"';
+	return output;
+}
+
+static void G_BenchmarkWriteStatsJSON( FILE* file, const char* name, const benchstats_t& stats, const char* separator )
+{
+	fprintf( file, "\"%s\": { \"mean\": %.1f, \"min\": %llu, \"p50\": %llu, \"p95\": %llu, \"p99\": %llu, \"max\": %llu }%s"
+				, name, stats.mean
+				, (unsigned long long)stats.min, (unsigned long long)stats.p50, (unsigned long long)stats.p95
+				, (unsigned long long)stats.p99, (unsigned long long)stats.max, separator );
+}
+
+static void G_BenchmarkWriteSummaryJSON( FILE* file, std::span< benchframe_t > frames )
+{
+	fprintf( file, "{ \"frames\": %d, ", (int32_t)frames.size() );
+	G_BenchmarkWriteStatsJSON( file, "frame_us", G_BenchmarkStats( frames, &benchframe_t::frametime ), ", " );
+	G_BenchmarkWriteStatsJSON( file, "render_us", G_BenchmarkStats( frames, &benchframe_t::rendertime ), ", " );
+	G_BenchmarkWriteStatsJSON( file, "tic_us", G_BenchmarkStats( frames, &benchframe_t::tictime ), " }" );
+}
+
+static void G_BenchmarkWriteJSON( FILE* file )
+{
+	fprintf( file, "{\n" );
+	fprintf( file, "\t\"version\": \"%s\",\n", PACKAGE_STRING );
+	fprintf( file, "\t\"config\": { \"hardware_threads\": %d, \"render_contexts\": %d, \"load_balancing\": %d, \"shared_bsp\": %s"
+				", \"tiling\": %s, \"tile_columns\": %d, \"tile_rows\": %d, \"render_width\": %d, \"render_height\": %d"
+				", \"frame_width\": %d, \"frame_height\": %d, \"dynamic_resolution_scaling\": %d },\n"
+				, (int32_t)I_ThreadGetHardwareCount(), num_render_contexts, renderloadbalancing
+				, rendersharedbsp ? "true" : "false", rendertiling ? "true" : "false", rendertilecolumns, rendertilerows
+				, render_width, render_height, drs_current->frame_width, drs_current->frame_height, dynamic_resolution_scaling );
+
+	fprintf( file, "\t\"summary\": " );
+	G_BenchmarkWriteSummaryJSON( file, std::span( benchframes ) );
+	fprintf( file, ",\n" );
+
+	fprintf( file, "\t\"demos\": [" );
+	for( benchdemo_t& demo : benchdemos )
+	{
+		uint64_t gametics = demo.endtic - demo.starttic;
+		uint64_t realtime = demo.endtime - demo.starttime;
+		double_t fps = realtime ? ( (double_t)gametics * TICRATE * 1000000.0 ) / realtime : 0.0;
+
+		fprintf( file, "%s\n\t\t{ \"name\": \"%s\", \"gametics\": %llu, \"realtime_us\": %llu, \"fps\": %.3f, \"summary\": "
+					, &demo == &benchdemos.front() ? "" : ","
+					, G_BenchmarkEscapeJSON( demo.name.c_str() ).c_str(), (unsigned long long)gametics, (unsigned long long)realtime, fps );
+		G_BenchmarkWriteSummaryJSON( file, std::span( benchframes ).subspan( demo.firstframe, demo.numframes ) );
+		fprintf( file, " }" );
+	}
+	fprintf( file, "\n\t],\n" );
+
+	fprintf( file, "\t\"frames\": [" );
+	for( benchframe_t& frame : benchframes )
+	{
+		fprintf( file, "%s\n\t\t{ \"demo\": %d, \"gametic\": %llu, \"frame_us\": %llu, \"render_us\": %llu, \"tic_us\": %llu, \"tics\": %d, \"contexts_us\": ["
+					, &frame == &benchframes.front() ? "" : ","
+					, frame.demo, (unsigned long long)frame.gametic, (unsigned long long)frame.frametime
+					, (unsigned long long)frame.rendertime, (unsigned long long)frame.tictime, frame.numtics );
+		for( int32_t context = 0; context < frame.numcontexts; ++context )
+		{
+			fprintf( file, "%s%llu", context ? ", " : " ", (unsigned long long)benchcontexttimes[ frame.firstcontext + context ] );
+		}
+		fprintf( file, " ] }" );
+	}
+	fprintf( file, "\n\t]\n}\n" );
+}
+
+// CSV has one row per frame. Configuration and percentiles go in
+// leading comment lines so the rows stay loadable by any CSV reader.
+static void G_BenchmarkWriteCSV( FILE* file )
+{
+	fprintf( file, "# version=%s\n", PACKAGE_STRING );
+	fprintf( file, "# hardware_threads=%d render_contexts=%d load_balancing=%d shared_bsp=%d tiling=%d tile_columns=%d tile_rows=%d\n"
+				, (int32_t)I_ThreadGetHardwareCount(), num_render_contexts, renderloadbalancing
+				, rendersharedbsp ? 1 : 0, rendertiling ? 1 : 0, rendertilecolumns, rendertilerows );
+	fprintf( file, "# render_width=%d render_height=%d frame_width=%d frame_height=%d dynamic_resolution_scaling=%d\n"
+				, render_width, render_height, drs_current->frame_width, drs_current->frame_height, dynamic_resolution_scaling );
+
+	auto writestats = [ file ]( const char* name, const benchstats_t& stats )
+	{
+		fprintf( file, "# %s mean=%.1f min=%llu p50=%llu p95=%llu p99=%llu max=%llu\n"
+					, name, stats.mean
+					, (unsigned long long)stats.min, (unsigned long long)stats.p50, (unsigned long long)stats.p95
+					, (unsigned long long)stats.p99, (unsigned long long)stats.max );
+	};
+
+	writestats( "frame_us", G_BenchmarkStats( std::span( benchframes ), &benchframe_t::frametime ) );
+	writestats( "render_us", G_BenchmarkStats( std::span( benchframes ), &benchframe_t::rendertime ) );
+	writestats( "tic_us", G_BenchmarkStats( std::span( benchframes ), &benchframe_t::tictime ) );
+
+	int32_t maxcontexts = 0;
+	for( benchframe_t& frame : benchframes )
+	{
+		maxcontexts = M_MAX( maxcontexts, frame.numcontexts );
+	}
+
+	fprintf( file, "demo,gametic,frame_us,render_us,tic_us,tics" );
+	for( int32_t context = 0; context < maxcontexts; ++context )
+	{
+		fprintf( file, ",context%d_us", context );
+	}
+	fprintf( file, "\n" );
+
+	for( benchframe_t& frame : benchframes )
+	{
+		fprintf( file, "%s,%llu,%llu,%llu,%llu,%d"
+					, G_BenchmarkEscapeCSV( benchdemos[ frame.demo ].name.c_str() ).c_str(), (unsigned long long)frame.gametic, (unsigned long long)frame.frametime
+					, (unsigned long long)frame.rendertime, (unsigned long long)frame.tictime, frame.numtics );
+		for( int32_t context = 0; context < maxcontexts; ++context )
+		{
+			if( context < frame.numcontexts )
+			{
+				fprintf( file, ",%llu", (unsigned long long)benchcontexttimes[ frame.firstcontext + context ] );
+			}
+			else
+			{
+				fprintf( file, "," );
+			}
+		}
+		fprintf( file, "\n" );
+	}
+}
+
+static void G_BenchmarkWriteResults( void )
+{
+	if( benchfilename == nullptr ) return;
+
+	G_BenchmarkEndDemo();
+
+	FILE* file = fopen( benchfilename, "wb" );
+	if( file == nullptr )
+	{
+		I_LogAddEntryVar( Log_Warning, "G_BenchmarkWriteResults: Couldn't open %s for writing", benchfilename );
+		return;
+	}
+
+	if( M_StringEndsWith( benchfilename, ".csv" ) || M_StringEndsWith( benchfilename, ".CSV" ) )
+	{
+		G_BenchmarkWriteCSV( file );
+	}
+	else
+	{
+		G_BenchmarkWriteJSON( file );
+	}
+
+	fclose( file );
+
+	benchstats_t frame = G_BenchmarkStats( std::span( benchframes ), &benchframe_t::frametime );
+	I_LogAddEntryVar( Log_Normal, "Benchmark: %d frames over %d demos, frame p50 %lluus p95 %lluus p99 %lluus, written to %s"
+						, (int32_t)benchframes.size(), (int32_t)benchdemos.size()
+						, (unsigned long long)frame.p50, (unsigned long long)frame.p95, (unsigned long long)frame.p99
+						, benchfilename );
+
+	benchfilename = nullptr;
+}
+
+void G_BenchmarkInit( void )
+{
+	//!
+	// @arg <file>
+	// @category demo
+	//
+	// Used with -timedemo. Plays every demo listed after -timedemo in
+	// turn with a hidden window and no sound, then writes per-frame
+	// timings to file as JSON, or as CSV if file ends in .csv.
+	//
+	int32_t p = M_CheckParmWithArgs( "-benchmark", 1 );
+	if( p )
+	{
+		benchmarking = true;
+		benchfilename = myargv[ p + 1 ];
+		I_AtExit( &G_BenchmarkWriteResults, true );
+	}
+}
+
+void G_BenchmarkAddDemo( const char* lumpname )
+{
+	benchqueue.push_back( lumpname );
+}
+
+const char* G_BenchmarkNextDemo( void )
+{
+	if( benchnextdemo >= benchqueue.size() ) return nullptr;
+	return benchqueue[ benchnextdemo++ ].c_str();
+}
+
+void G_BenchmarkBeginDemo( const char* lumpname )
+{
+	G_BenchmarkEndDemo();
+
+	benchdemos.push_back( { lumpname, gametic, gametic, I_GetTimeUS(), 0, benchframes.size(), 0 } );
+	benchcurrdemo = &benchdemos.back();
+
+	benchtictime = 0;
+	benchnumtics = 0;
+}
+
+void G_BenchmarkEndDemo( void )
+{
+	if( benchcurrdemo == nullptr ) return;
+
+	benchcurrdemo->endtic = gametic;
+	benchcurrdemo->endtime = I_GetTimeUS();
+	benchcurrdemo->numframes = benchframes.size() - benchcurrdemo->firstframe;
+	benchcurrdemo = nullptr;
+}
+
+void G_BenchmarkTic( uint64_t tictime )
+{
+	benchtictime += tictime;
+	++benchnumtics;
+}
+
+void G_BenchmarkFrame( uint64_t frametime )
+{
+	uint64_t contexttimes[ MaxBenchmarkContexts ];
+	int32_t numcontexts = 0;
+	uint64_t rendertime = R_GetFrameTimings( contexttimes, MaxBenchmarkContexts, &numcontexts );
+
+	// Frames that didn't render a 3D view (wipes, intermissions) would
+	// only add noise to the renderer numbers
+	if( benchcurrdemo != nullptr && rendertime != 0 )
+	{
+		benchframes.push_back( { (int32_t)( benchcurrdemo - benchdemos.data() ), gametic, frametime, rendertime
+								, benchtictime, benchnumtics, benchcontexttimes.size(), numcontexts } );
+		benchcontexttimes.insert( benchcontexttimes.end(), contexttimes, contexttimes + numcontexts );
+	}
+
+	benchtictime = 0;
+	benchnumtics = 0;
+}
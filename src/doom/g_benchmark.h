@@ -0,0 +1,41 @@
+//
+// Copyright(C) 2020-2022 Ethan Watson
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION: Timedemo benchmarking. Records per-frame timings
+//              for a queue of demos and writes them out as JSON
+//              or CSV for comparing builds.
+//
+
+#ifndef __G_BENCHMARK_H__
+#define __G_BENCHMARK_H__
+
+#include "doomtype.h"
+
+DOOM_C_API extern doombool benchmarking;
+
+// Checks for -benchmark, called at startup before video and sound init
+DOOM_C_API void G_BenchmarkInit( void );
+
+// Queues a demo lump to be played in order by the timedemo
+DOOM_C_API void G_BenchmarkAddDemo( const char* lumpname );
+
+// Returns the next queued demo, or NULL when the queue is exhausted
+DOOM_C_API const char* G_BenchmarkNextDemo( void );
+
+DOOM_C_API void G_BenchmarkBeginDemo( const char* lumpname );
+DOOM_C_API void G_BenchmarkEndDemo( void );
+
+DOOM_C_API void G_BenchmarkTic( uint64_t tictime );
+DOOM_C_API void G_BenchmarkFrame( uint64_t frametime );
+
+#endif // __G_BENCHMARK_H__
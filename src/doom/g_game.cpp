@@ -53,6 +53,8 @@
 #include "d_main.h"
 #include "d_gamesim.h"
 
+#include "g_benchmark.h"
+
 #include "wi_stuff.h"
 #include "hu_stuff.h"
 #include "st_stuff.h"
@@ -1221,7 +1223,16 @@ void G_Ticker (void)
     switch (gamestate) 
     { 
 	case GS_LEVEL:
-		P_Ticker ();
+		if( benchmarking )
+		{
+			uint64_t ticstart = I_GetTimeUS();
+			P_Ticker ();
+			G_BenchmarkTic( I_GetTimeUS() - ticstart );
+		}
+		else
+		{
+			P_Ticker ();
+		}
 		ST_Ticker ();
 		AM_Ticker ();
 		HU_Ticker ();
@@ -2474,6 +2485,11 @@ void G_DoPlayDemo (void)
     G_InitNew (skill, mapinfo, GF_None, random_seed); 
     starttime = I_GetTimeTicks(); 
 
+	if( timingdemo && benchmarking )
+	{
+		G_BenchmarkBeginDemo( defdemoname );
+	}
+
     usergame = false; 
     demoplayback = true; 
 } 
@@ -2512,8 +2528,16 @@ void G_TimeDemo (char* name)
 doombool G_CheckDemoStatus (void) 
 { 
 	uint64_t             endtime; 
-	 
-	if (timingdemo) 
+	const char*          nextdemo = NULL;
+
+	if( timingdemo && benchmarking )
+	{
+		// Results are written out by the exit handler
+		G_BenchmarkEndDemo();
+		nextdemo = G_BenchmarkNextDemo();
+		timingdemo = nextdemo != NULL;
+	}
+	else if (timingdemo) 
 	{ 
 		float fps;
 		int realtics;
@@ -2543,7 +2567,9 @@ doombool G_CheckDemoStatus (void)
 		nomonsters = false;
 		consoleplayer = 0;
 
-		if (singledemo) 
+		if( nextdemo )
+			G_DeferedPlayDemo( nextdemo );
+		else if (singledemo || benchmarking) 
 			I_Quit (); 
 		else 
 			D_AdvanceDemo (); 
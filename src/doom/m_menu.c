@@ -3496,7 +3496,7 @@ void M_DashboardOptionsWindow( const char* itemname, void* data )
 				{
 					if( igSelectable_Bool( sound_resample_quality_strings[ index ], index == sound_resample_type, ImGuiSelectableFlags_None, zerosize ) )
 					{
-						//I_ChangeSoundQuality( index, S_sfx, NUMSFX );
+						I_ChangeSoundQuality( index, NULL, 0 );
 					}
 				}
 				igEndCombo();
@@ -3504,7 +3504,7 @@ void M_DashboardOptionsWindow( const char* itemname, void* data )
 			if( igIsItemHovered( ImGuiHoveredFlags_None ) )
 			{
 				igBeginTooltip();
-				igText( "This can take a while the first time you select any option." );
+				igText( "The first time you select any option, the current quality\nkeeps playing until the new one is ready." );
 				igEndTooltip();
 			}
 			igPopID();
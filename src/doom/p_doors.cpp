@@ -638,6 +638,8 @@ void T_SlidingDoor (slidedoor_t*	door)
 		// IF DOOR IS DONE OPENING...
 		sides[door->line->sidenum[0]].midtexture = 0;
 		sides[door->line->sidenum[1]].midtexture = 0;
+		P_DirtySide( &sides[door->line->sidenum[0]] );
+		P_DirtySide( &sides[door->line->sidenum[1]] );
 		door->line->flags &= ML_BLOCKING^0xff;
 					
 		if (door->type == sdt_openOnly)
@@ -661,6 +663,8 @@ void T_SlidingDoor (slidedoor_t*	door)
 		sides[door->line->sidenum[1]].midtexture =
 		    slideFrames[door->whichDoorIndex].
 		    backFrames[door->frame];
+		P_DirtySide( &sides[door->line->sidenum[0]] );
+		P_DirtySide( &sides[door->line->sidenum[1]] );
 	    }
 	}
 	break;
@@ -705,6 +709,8 @@ void T_SlidingDoor (slidedoor_t*	door)
 		sides[door->line->sidenum[1]].midtexture =
 		    slideFrames[door->whichDoorIndex].
 		    backFrames[door->frame];
+		P_DirtySide( &sides[door->line->sidenum[0]] );
+		P_DirtySide( &sides[door->line->sidenum[1]] );
 	    }
 	}
 	break;
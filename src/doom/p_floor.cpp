@@ -55,6 +55,8 @@ DOOM_C_API result_e T_MovePlane( sector_t* sector, fixed_t speed, fixed_t dest,
 
 	sector->snapfloor = sector->snapceiling = false;
 	sector->lastactivetic = gametic;
+	P_DirtySector( sector );
+	P_SightSectorMoved( sector );
 
 	if( fix.moveplane_escapes_reality ) // fix_moveplane_escapes_reality
 	{
@@ -261,6 +263,7 @@ DOOM_C_API void T_MoveFloor(floormove_t* floor)
 			  case donutRaise:
 			floor->sector->special = floor->newspecial;
 			floor->sector->floorpic = floor->texture;
+			P_DirtySector( floor->sector );
 			  default:
 			break;
 			}
@@ -272,6 +275,7 @@ DOOM_C_API void T_MoveFloor(floormove_t* floor)
 			  case lowerAndChange:
 			floor->sector->special = floor->newspecial;
 			floor->sector->floorpic = floor->texture;
+			P_DirtySector( floor->sector );
 			  default:
 			break;
 			}
@@ -387,6 +391,7 @@ DOOM_C_API int EV_DoFloor( line_t* line, floor_e floortype )
 	    floor->speed = FLOORSPEED;
 	    floor->floordestheight = floor->sector->floorheight + 24 * FRACUNIT;
 	    sec->floorpic = line->frontsector->floorpic;
+	    P_DirtySector( sec );
 	    sec->special = line->frontsector->special;
 	    break;
 
@@ -228,6 +228,7 @@ DOOM_C_API void T_MoveCeilingGeneric( ceiling_t* ceiling )
 			if( ceiling->newtexture >= 0 )
 			{
 				ceiling->sector->ceilingpic = ceiling->newtexture;
+				P_DirtySector( ceiling->sector );
 			}
 			P_RemoveActiveCeilingGeneric( ceiling );
 		}
@@ -400,6 +401,7 @@ DOOM_C_API int32_t EV_DoCeilingGeneric( line_t* line, mobj_t* activator )
 				sourcesector.ceilingpic = ( type == sct_copytexture || type == sct_copyboth )
 										? setfrom.ceilingpic
 										: sourcesector.ceilingpic;
+				P_DirtySector( &sourcesector );
 			}
 		};
 
@@ -485,6 +487,7 @@ DOOM_C_API void T_VerticalDoorGeneric( vldoor_t* door )
 			{
 				sector.lightlevel = level;
 				sector.lastactivetic = gametic;
+				P_DirtySector( &sector );
 			}
 		}
 	};
@@ -797,6 +800,7 @@ DOOM_C_API void T_MoveFloorGeneric(floormove_t* floor)
 		if( floor->texture >= 0 )
 		{
 			floor->sector->floorpic = floor->texture;
+			P_DirtySector( floor->sector );
 		}
 
 		P_RemoveThinker( &floor->thinker );
@@ -1054,6 +1058,7 @@ DOOM_C_API int32_t EV_DoFloorGeneric( line_t* line, mobj_t* activator )
 				sourcesector.floorpic = ( type == sct_copytexture || type == sct_copyboth )
 										? setfrom.floorpic
 										: sourcesector.floorpic;
+				P_DirtySector( &sourcesector );
 			}
 		};
 
@@ -1172,6 +1177,7 @@ DOOM_C_API int32_t EV_DoLightSetGeneric( line_t* line, mobj_t* activator )
 			++createdcount;
 			lightsetfuncs[ line->action->param1 ]( sector, lightval );
 			sector.lastactivetic = gametic;
+			P_DirtySector( &sector );
 		}
 	}
 	return createdcount;
@@ -1330,6 +1336,7 @@ DOOM_C_API int32_t EV_DoVanillaPlatformRaiseGeneric( line_t* line, mobj_t* activ
 		{
 		case stt_nexthighestneighborfloor:
 			sector.floorpic = line->frontside->sector->floorpic;
+			P_DirtySector( &sector );
 			sector.special = 0;
 			plat->type = raiseToNearestAndChange;
 			plat->high = P_FindNextHighestFloorSurrounding( &sector );
@@ -1344,6 +1351,7 @@ DOOM_C_API int32_t EV_DoVanillaPlatformRaiseGeneric( line_t* line, mobj_t* activ
 			break;
 		case stt_nosearch:
 			sector.floorpic = line->frontside->sector->floorpic;
+			P_DirtySector( &sector );
 			plat->type = raiseAndChange;
 			plat->high = sector.floorheight;
 			break;
@@ -1732,6 +1740,7 @@ DOOM_C_API int32_t EV_DoSectorTintGeneric( line_t* line, mobj_t* activator )
 			if( sector.tag == line->tag )
 			{
 				sector.colormap = colormap;
+				P_DirtySector( &sector );
 				++applied;
 			}
 		}
@@ -1784,6 +1793,7 @@ INLINE void T_ScrollCeilingTexture( scroller_t* scroller )
 		sector->ceiloffsetx += scroller->scrollx;
 		sector->ceiloffsety += scroller->scrolly;
 		sector->lastactivetic = gametic;
+		P_DirtySector( sector );
 	}
 }
 
@@ -1794,6 +1804,7 @@ INLINE void T_ScrollFloorTexture( scroller_t* scroller )
 		sector->flooroffsetx += scroller->scrollx;
 		sector->flooroffsety += scroller->scrolly;
 		sector->lastactivetic = gametic;
+		P_DirtySector( sector );
 	}
 }
 
@@ -1818,11 +1829,13 @@ INLINE void T_ScrollWallTexture( scroller_t* scroller )
 
 		line->frontside->textureoffset += scrollx;
 		line->frontside->rowoffset += scrolly;
+		P_DirtySide( line->frontside );
 
 		if( scroller->BothSides() && line->backside )
 		{
 			line->backside->textureoffset += scrollx;
 			line->backside->rowoffset += scrolly;
+			P_DirtySide( line->backside );
 		}
 	}
 }
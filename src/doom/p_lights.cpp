@@ -55,6 +55,7 @@ void T_FireFlicker (fireflicker_t* flick)
     flick->count = 4;
 
 	flick->sector->lastactivetic = gametic;
+	P_DirtySector( flick->sector );
 }
 
 
@@ -105,6 +106,7 @@ void T_LightFlash (lightflash_t* flash)
     }
 
 	flash->sector->lastactivetic = gametic;
+	P_DirtySector( flash->sector );
 }
 
 
@@ -164,6 +166,7 @@ void T_StrobeFlash (strobe_t*		flash)
 	}
 
 	flash->sector->lastactivetic = gametic;
+	P_DirtySector( flash->sector );
 }
 
 
@@ -248,6 +251,7 @@ void EV_TurnTagLightsOff(line_t* line)
 			}
 			sector->lightlevel = min;
 			sector->lastactivetic = gametic;
+			P_DirtySector( sector );
 		}
     }
 }
@@ -292,6 +296,7 @@ EV_LightTurnOn
 			}
 			sector-> lightlevel = bright;
 			sector->lastactivetic = gametic;
+			P_DirtySector( sector );
 		}
 	}
 }
@@ -327,6 +332,7 @@ void T_Glow(glow_t*	g)
     }
 
 	g->sector->lastactivetic = gametic;
+	P_DirtySector( g->sector );
 }
 
 
@@ -83,6 +83,16 @@ DOOM_C_API void P_InitThinkers (void);
 DOOM_C_API void P_AddThinker (thinker_t* thinker);
 DOOM_C_API void P_RemoveThinker (thinker_t* thinker);
 
+// Anything that changes what the renderer sees of a sector or side
+// needs to mark it, otherwise the instance data won't pick it up
+DOOM_C_API void P_DirtySector( sector_t* sector );
+DOOM_C_API void P_DirtySide( side_t* side );
+DOOM_C_API void P_DirtyAnimatedInstances( void );
+DOOM_C_API void P_DirtyAllInstances( void );
+
+// Checks the incremental instance update against a full rebuild every tic
+DOOM_C_API extern doombool verifyinstancedata;
+
 
 //
 // P_PSPR
@@ -263,6 +273,9 @@ DOOM_C_API doombool			P_TryMove (mobj_t* thing, fixed_t x, fixed_t y);
 DOOM_C_API doombool			P_TeleportMove (mobj_t* thing, fixed_t x, fixed_t y);
 DOOM_C_API void				P_SlideMove (mobj_t* mo);
 DOOM_C_API doombool			P_CheckSight (mobj_t* t1, mobj_t* t2);
+DOOM_C_API void				P_SightNewTic( void );
+DOOM_C_API void				P_SightBatchTic( thinker_t* first );
+DOOM_C_API void				P_SightSectorMoved( sector_t* sector );
 DOOM_C_API void				P_UseLines (player_t* player);
 
 DOOM_C_API doombool			P_ChangeSector (sector_t* sector, doombool crunch);
@@ -305,6 +318,81 @@ DOOM_C_API void P_KillMobj( mobj_t* source, mobj_t* target );
 //
 #include "p_spec.h"
 
+#if defined( __cplusplus )
+#include <span>
+#include <vector>
+
+//
+// Thinker registries
+// Every live thinker of one kind in a flat array, so passes that only
+// care about that kind don't need to walk and cast the entire thinker
+// list. A thinker keeps its slot until it is removed, at which point
+// the slot is nulled out. Last tic's sector lists can still point at a
+// removed mobj, so slots only go back up for reuse two Recycle() calls
+// later. Slot order has nothing to do with thinker order, so anything
+// demos depend on still needs to walk thinkercap.
+//
+template< typename _ty >
+class ThinkerRegistry
+{
+public:
+	void Add( _ty* thinker )
+	{
+		thinker_t* th = (thinker_t*)thinker;
+		if( freeslots.empty() )
+		{
+			th->registryslot = (int32_t)slots.size();
+			slots.push_back( thinker );
+		}
+		else
+		{
+			th->registryslot = freeslots.back();
+			freeslots.pop_back();
+			slots[ th->registryslot ] = thinker;
+		}
+		++count;
+	}
+
+	void Remove( _ty* thinker )
+	{
+		thinker_t* th = (thinker_t*)thinker;
+		slots[ th->registryslot ] = nullptr;
+		retiring.push_back( th->registryslot );
+		--count;
+	}
+
+	void Recycle()
+	{
+		freeslots.insert( freeslots.end(), retired.begin(), retired.end() );
+		retired.swap( retiring );
+		retiring.clear();
+	}
+
+	void Clear()
+	{
+		slots.clear();
+		freeslots.clear();
+		retiring.clear();
+		retired.clear();
+		count = 0;
+	}
+
+	// Removed thinkers leave null holes behind
+	INLINE std::span< _ty* > Slots()		{ return slots; }
+	INLINE int32_t Count() const			{ return count; }
+	INLINE int32_t Capacity() const			{ return (int32_t)slots.size(); }
+
+private:
+	std::vector< _ty* >			slots;
+	std::vector< int32_t >		freeslots;
+	std::vector< int32_t >		retiring;
+	std::vector< int32_t >		retired;
+	int32_t						count = 0;
+};
+
+extern ThinkerRegistry< mobj_t >		mobjthinkers;
+#endif // defined( __cplusplus )
+
 
 
 #endif	// __P_LOCAL__
@@ -24,6 +24,7 @@
 
 #include <stdlib.h>
 
+#include <vector>
 
 #include "m_bbox.h"
 
@@ -1203,6 +1204,44 @@ DOOM_C_API doombool P_MobjOverlapsSector( sector_t* sector, mobj_t* mobj, fixed_
 	return P_BBoxOverlapsSector( sector, bbox );
 }
 
+// Sectors already tested while sorting a mobj. Each one is stamped with
+// the generation it was tested in, so starting a new mobj is a counter
+// bump instead of a clear. Sorting happens on every job thread, hence
+// one set per thread.
+class SectorVisits
+{
+public:
+	void Begin()
+	{
+		if( stamps.size() != (size_t)numsectors )
+		{
+			stamps.assign( numsectors, 0 );
+			generation = 0;
+		}
+
+		if( ++generation == 0 )
+		{
+			std::fill( stamps.begin(), stamps.end(), 0 );
+			generation = 1;
+		}
+	}
+
+	// Returns true the first time a sector is seen this generation
+	INLINE bool Visit( sector_t* sector )
+	{
+		uint32_t& stamp = stamps[ sector->index ];
+		bool first = stamp != generation;
+		stamp = generation;
+		return first;
+	}
+
+private:
+	std::vector< uint32_t >		stamps;
+	uint32_t					generation = 0;
+};
+
+static thread_local SectorVisits sortvisits;
+
 #define METHOD 1
 
 #if !METHOD
@@ -1225,26 +1264,25 @@ DOOM_C_API void P_SortMobj( mobj_t* mobj )
 {
 	M_PROFILE_FUNC();
 
-	memset( mobj->tested_sector, 0, sizeof(uint8_t) * numsectors );
+	sortvisits.Begin();
 
 	P_AddToSector( mobj->subsector->sector, mobj );
-	mobj->tested_sector[ mobj->subsector->sector->index ] = true;
+	sortvisits.Visit( mobj->subsector->sector );
 
-	fixed_t radius = mobj->curr.sprite != -1 ? M_MAX( mobj->radius, sprites[ mobj->curr.sprite ].maxradius )
-											: mobj->radius;
+	int32_t sprite = mobj->Render().curr.sprite;
+	fixed_t radius = sprite != -1 ? M_MAX( mobj->radius, sprites[ sprite ].maxradius )
+									: mobj->radius;
 
 	P_BlockLinesIteratorConstHorizontal( mobj->x, mobj->y, radius, [ mobj, radius ]( line_t* line ) -> bool
 	{
-		if( line->frontsector && !mobj->tested_sector[ line->frontsector->index ] )
+		if( line->frontsector && sortvisits.Visit( line->frontsector ) )
 		{
 			P_AddIfOverlaps( line->frontsector, mobj, radius );
-			mobj->tested_sector[ line->frontsector->index ] = true;
 		}
 
-		if( line->backsector && !mobj->tested_sector[ line->backsector->index ] )
+		if( line->backsector && sortvisits.Visit( line->backsector ) )
 		{
 			P_AddIfOverlaps( line->backsector, mobj, radius );
-			mobj->tested_sector[ line->backsector->index ] = true;
 		}
 
 		return true;
@@ -1260,19 +1298,19 @@ static void P_AddToSector( sector_t* thissector, mobj_t* thismobj )
 	*newsecmobj = { thismobj, prevhead };
 }
 
-static void P_AddOverlap( mobj_t* thismobj, sector_t* thissector )
+static void P_AddOverlap( mobjrender_t& render, sector_t* thissector )
 {
-	if( thismobj->numoverlaps < MAX_SECTOR_OVERLAPS )
+	if( render.numoverlaps < MAX_SECTOR_OVERLAPS )
 	{
-		thismobj->overlaps[ thismobj->numoverlaps++ ] = thissector;
+		render.overlaps[ render.numoverlaps++ ] = thissector;
 	}
 }
 
-static void P_AddIfOverlaps( mobj_t* thismobj, sector_t* thissector, fixed_t radius )
+static void P_AddIfOverlaps( mobj_t* thismobj, mobjrender_t& render, sector_t* thissector, fixed_t radius )
 {
 	if( P_MobjOverlapsSector( thissector, thismobj, radius ) )
 	{
-		P_AddOverlap( thismobj, thissector );
+		P_AddOverlap( render, thissector );
 	}
 }
 
@@ -1282,40 +1320,40 @@ DOOM_C_API void P_SortMobj( mobj_t* mobj )
 {
 	M_PROFILE_FUNC();
 
-	if( !mobj->numoverlaps
-		|| FixedToRendFixed( mobj->x ) != mobj->prev.x
-		|| FixedToRendFixed( mobj->y ) != mobj->prev.y
-		|| mobj->sprite != mobj->prev.sprite
-		|| mobj->frame != mobj->prev.frame )
+	mobjrender_t& render = mobj->Render();
+
+	if( !render.numoverlaps
+		|| FixedToRendFixed( mobj->x ) != render.prev.x
+		|| FixedToRendFixed( mobj->y ) != render.prev.y
+		|| mobj->sprite != render.prev.sprite
+		|| mobj->frame != render.prev.frame )
 	{
-		mobj->numoverlaps = 0;
-		memset( mobj->tested_sector, 0, sizeof(uint8_t) * numsectors );
+		render.numoverlaps = 0;
+		sortvisits.Begin();
 
-		P_AddOverlap( mobj, mobj->subsector->sector );
-		mobj->tested_sector[ mobj->subsector->sector->index ] = true;
+		P_AddOverlap( render, mobj->subsector->sector );
+		sortvisits.Visit( mobj->subsector->sector );
 
-		fixed_t radius = mobj->curr.sprite != -1 ? M_MAX( mobj->radius, sprites[ mobj->curr.sprite ].maxradius )
+		fixed_t radius = render.curr.sprite != -1 ? M_MAX( mobj->radius, sprites[ render.curr.sprite ].maxradius )
 												: mobj->radius;
 
-		P_BlockLinesIteratorConstHorizontal( mobj->x, mobj->y, radius, [ mobj, radius ]( line_t* line ) -> bool
+		P_BlockLinesIteratorConstHorizontal( mobj->x, mobj->y, radius, [ mobj, &render, radius ]( line_t* line ) -> bool
 		{
-			if( line->frontsector && !mobj->tested_sector[ line->frontsector->index ] )
+			if( line->frontsector && sortvisits.Visit( line->frontsector ) )
 			{
-				P_AddIfOverlaps( mobj, line->frontsector, radius );
-				mobj->tested_sector[ line->frontsector->index ] = true;
+				P_AddIfOverlaps( mobj, render, line->frontsector, radius );
 			}
 
-			if( line->backsector && !mobj->tested_sector[ line->backsector->index ] )
+			if( line->backsector && sortvisits.Visit( line->backsector ) )
 			{
-				P_AddIfOverlaps( mobj, line->backsector, radius );
-				mobj->tested_sector[ line->backsector->index ] = true;
+				P_AddIfOverlaps( mobj, render, line->backsector, radius );
 			}
 
 			return true;
 		} );
 	}
 
-	for( sector_t* sector : std::span( mobj->overlaps, mobj->numoverlaps ) )
+	for( sector_t* sector : std::span( render.overlaps, render.numoverlaps ) )
 	{
 		P_AddToSector( sector, mobj );
 	}
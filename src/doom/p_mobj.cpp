@@ -505,7 +505,7 @@ DOOM_C_API void P_NightmareRespawn( mobj_t* mobj )
     mo = P_SpawnMobj (x,y,z, mobj->type);
     mo->spawnpoint = mobj->spawnpoint;	
 	mo->hasspawnpoint = true;
-    mo->prev.angle = mo->curr.angle = mo->angle = ANG45 * (mthing->angle/45);
+    mo->Render().prev.angle = mo->Render().curr.angle = mo->angle = ANG45 * (mthing->angle/45);
 
     if (mthing->options & MTF_AMBUSH)
 	mo->flags |= MF_AMBUSH;
@@ -655,25 +655,26 @@ DOOM_C_API mobj_t* P_SpawnMobjEx( const mobjinfo_t* typeinfo, angle_t angle,
 
 	mobj->lumpindex = -1;
 
-	mobj->curr.x = FixedToRendFixed( mobj->x );
-	mobj->curr.y = FixedToRendFixed( mobj->y );
-	mobj->curr.z = FixedToRendFixed( mobj->z );
-	mobj->curr.angle = mobj->angle;
-	mobj->curr.frame = -1;
-	mobj->curr.sprite = SPR_INVALID;
-
-	mobj->prev = mobj->curr;
-
-	mobj->curr.frame = mobj->frame;
-	mobj->curr.sprite = mobj->sprite;
-
 	mobj->thinker.function = P_MobjThinker;
 
-	mobj->tested_sector = (uint8_t*)Z_MallocZero( sizeof( uint8_t ) * numsectors, PU_LEVEL, nullptr );
 	mobj->translation = mobj->info->translation;
 	
+	// Needs to be registered before it has anywhere to keep render data
 	P_AddThinker( &mobj->thinker );
 
+	mobjrender_t& render = mobj->Render();
+	render.curr.x = FixedToRendFixed( mobj->x );
+	render.curr.y = FixedToRendFixed( mobj->y );
+	render.curr.z = FixedToRendFixed( mobj->z );
+	render.curr.angle = mobj->angle;
+	render.curr.frame = -1;
+	render.curr.sprite = SPR_INVALID;
+
+	render.prev = render.curr;
+
+	render.curr.frame = mobj->frame;
+	render.curr.sprite = mobj->sprite;
+
 	return mobj;
 }
 
@@ -782,7 +783,7 @@ DOOM_C_API void P_RespawnSpecials (void)
     mo = P_SpawnMobjEx( spawninfo, 0, x, y , z, 0, 0, 0 );
     mo->spawnpoint = *mthing;
 	mo->hasspawnpoint = true;
-    mo->prev.angle = mo->curr.angle = mo->angle = ANG45 * (mthing->angle/45);
+    mo->Render().prev.angle = mo->Render().curr.angle = mo->angle = ANG45 * (mthing->angle/45);
 
     // pull it from the que
     iquetail = (iquetail+1)&(ITEMQUESIZE-1);
@@ -839,7 +840,7 @@ DOOM_C_API void P_SpawnPlayer (mapthing_t* mthing)
 		mobj->translation = R_GetTranslation( gameconf->playertranslations[ 0 ] );
 	}
 
-    mobj->prev.angle = mobj->curr.angle = mobj->angle = ANG45 * (mthing->angle/45);
+    mobj->Render().prev.angle = mobj->Render().curr.angle = mobj->angle = ANG45 * (mthing->angle/45);
     mobj->player = p;
     mobj->health = p->health;
 
@@ -1005,7 +1006,7 @@ DOOM_C_API mobj_t* P_SpawnMapThing (mapthing_t* mthing)
 		totalitems++;
 	}
 		
-    mobj->prev.angle = mobj->curr.angle = mobj->angle = ANG45 * (mthing->angle/45);
+    mobj->Render().prev.angle = mobj->Render().curr.angle = mobj->angle = ANG45 * (mthing->angle/45);
 
     if (mthing->options & MTF_AMBUSH)
 	{
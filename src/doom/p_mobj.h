@@ -252,6 +252,20 @@ DOOM_C_API typedef struct mobjinstance_s
 
 #define MAX_SECTOR_OVERLAPS 32
 
+// Everything only the renderer and the sector sort care about. Kept out
+// of mobj_t so the playsim doesn't drag it through the cache, in an
+// array that parallels the mobj registry and is indexed by registry slot.
+DOOM_C_API typedef struct mobjrender_s
+{
+	mobjinstance_t		curr;
+	mobjinstance_t		prev;
+	uint8_t				rendered[ JOBSYSTEM_MAXJOBS ];
+	struct sector_s*	overlaps[ MAX_SECTOR_OVERLAPS ];
+	int32_t				numoverlaps;
+} mobjrender_t;
+
+DOOM_C_API extern mobjrender_t*		mobjrenders;
+
 // Map Object definition.
 DOOM_C_API typedef struct mobj_s
 {
@@ -329,32 +343,32 @@ DOOM_C_API typedef struct mobj_s
     // Player number last looked for.
     int				lastlook;
 
-    // For nightmare respawn.
-    mapthing_t		spawnpoint;
-	int32_t			lumpindex;
-	doombool		hasspawnpoint;
-
     // Thing being chased/attacked for tracers.
     struct mobj_s*	tracer;	
 
 	int32_t			flags2;
-	int32_t			rnr24flags;
 
 	uint64_t		teleporttic;
 
-	int32_t			resurrection_count;
-	int32_t			successfullineeffect;
+	// Cold data from here on, only touched on spawn, respawn, pickup,
+	// death and save. Everything else should go above this.
 
-	// For rendering purposes
-	mobjinstance_t		curr;
-	mobjinstance_t		prev;
-	uint8_t*			tested_sector;
-	uint8_t				rendered[ JOBSYSTEM_MAXJOBS ];
-	struct sector_s*	overlaps[ MAX_SECTOR_OVERLAPS ];
-	int32_t				numoverlaps;
+	// Only ever read when projecting a sprite that's already in view
 	struct translation_s*	translation;
 
+    // For nightmare respawn.
+    mapthing_t		spawnpoint;
+	int32_t			lumpindex;
+	doombool		hasspawnpoint;
+
+	int32_t			rnr24flags;
+
+	int32_t			resurrection_count;
+	int32_t			successfullineeffect;
+
 #if defined( __cplusplus )
+	INLINE mobjrender_t& Render() const						{ return mobjrenders[ thinker.registryslot ]; }
+
 	INLINE const bool CountItem() const						{ return flags & MF_COUNTITEM; }
 
 	INLINE const bool IsFriendly() const					{ return sim.mbf_mobj_flags && ( flags & MF_MBF_FRIEND ); }
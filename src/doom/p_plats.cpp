@@ -177,6 +177,7 @@ EV_DoPlat
 	  case raiseToNearestAndChange:
 	    plat->speed = PLATSPEED/2;
 	    sec->floorpic = sides[line->sidenum[0]].sector->floorpic;
+	    P_DirtySector( sec );
 	    plat->high = P_FindNextHighestFloor(sec);
 	    plat->wait = 0;
 	    plat->status = up;
@@ -189,6 +190,7 @@ EV_DoPlat
 	  case raiseAndChange:
 	    plat->speed = PLATSPEED/2;
 	    sec->floorpic = sides[line->sidenum[0]].sector->floorpic;
+	    P_DirtySector( sec );
 	    plat->high = sec->floorheight + amount*FRACUNIT;
 	    plat->wait = 0;
 	    plat->status = up;
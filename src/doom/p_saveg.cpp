@@ -377,15 +377,12 @@ static void saveg_read_mobj_t(mobj_t *str)
 
     // fixed_t x;
     str->x = saveg_read32();
-	str->prev.x = str->curr.x = FixedToRendFixed( str->x );
 
     // fixed_t y;
     str->y = saveg_read32();
-	str->prev.y = str->curr.y = FixedToRendFixed( str->y );
 
     // fixed_t z;
     str->z = saveg_read32();
-	str->prev.z = str->curr.z = FixedToRendFixed( str->z );
 
     // struct mobj_s* snext;
     /*str->snext =*/ saveg_readp();
@@ -395,15 +392,12 @@ static void saveg_read_mobj_t(mobj_t *str)
 
     // angle_t angle;
     str->angle = saveg_read32();
-	str->prev.angle = str->curr.angle = str->angle;
 
     // spritenum_t sprite;
     str->sprite = (spritenum_t)saveg_read_enum();
-	str->prev.sprite = str->curr.sprite = str->sprite;
 
     // int frame;
     str->frame = saveg_read32();
-	str->prev.frame = str->curr.frame = str->frame;
 
     // struct mobj_s* bnext;
     /*str->bnext =*/ saveg_readp();
@@ -1740,14 +1734,7 @@ void P_ArchiveLimitRemovingData( void )
 	saveg_write32( SAVETAG_VALIDATE );
 	extrabytes += ( numsectors + 3 ) * sizeof( int32_t );
 
-	int32_t mobjs = 0;
-	for( thinker_t* thinker = thinkercap.next; thinker != &thinkercap; thinker = thinker->next )
-	{
-		if( mobj_t* mobj = thinker_cast< mobj_t >( thinker ) )
-		{
-			++mobjs;
-		}
-	}
+	int32_t mobjs = mobjthinkers.Count();
 
 	saveg_write32( SAVETAG_MOBJEXTENDED );
 	saveg_write32( mobjs * sizeof( int32_t ) );
@@ -2032,6 +2019,17 @@ void P_UnArchiveThinkers (void)
 			mobj->ceilingz = mobj->subsector->sector->ceilingheight;
 			mobj->thinker.function = P_MobjThinker;
 			P_AddThinker (&mobj->thinker);
+
+			{
+				mobjrender_t& render = mobj->Render();
+				render.curr.x = FixedToRendFixed( mobj->x );
+				render.curr.y = FixedToRendFixed( mobj->y );
+				render.curr.z = FixedToRendFixed( mobj->z );
+				render.curr.angle = mobj->angle;
+				render.curr.sprite = mobj->sprite;
+				render.curr.frame = mobj->frame;
+				render.prev = render.curr;
+			}
 			break;
 
 		default:
@@ -40,6 +40,7 @@
 
 #include "m_argv.h"
 #include "m_bbox.h"
+#include "m_config.h"
 #include "m_dashboard.h"
 #include "m_fixed.h"
 #include "m_misc.h"
@@ -51,6 +52,8 @@
 
 #include "s_sound.h"
 
+#include "sha1.h"
+
 #include "w_wad.h"
 
 #include "z_zone.h"
@@ -81,11 +84,15 @@ enum LoadingCode : int32_t
 
 static int32_t loading_code = LoadingCode::RnRVanilla;
 
+#include <algorithm>
 #include <ranges>
 #include <span>
+#include <string>
 #include <type_traits>
 #include <vector>
 
+#include <zlib.h>
+
 struct ReadVal
 {
 	template< typename _ty >
@@ -216,6 +223,109 @@ waddata_t< _to > WadDataConvert( int32_t lumpnum, size_t dataoffset, _functor&&
 	return {};
 }
 
+// Reads the body of a ZDoom extended nodes lump. Compressed lumps are
+// inflated straight in to whatever buffer the parser asks to fill, so
+// the decompressed lump never exists as a whole in memory.
+struct ZNodeStream
+{
+	ZNodeStream( byte* data, size_t length, bool compressed )
+		: _input( data )
+		, _remaining( length )
+		, _compressed( compressed )
+		, _zstream()
+	{
+		if( _compressed )
+		{
+			_zstream.next_in = _input;
+			_zstream.avail_in = (uInt)_remaining;
+			if( inflateInit( &_zstream ) != Z_OK )
+			{
+				I_Error( "ZNodeStream: Couldn't initialise zlib: %s", _zstream.msg ? _zstream.msg : "unknown error" );
+			}
+		}
+	}
+
+	~ZNodeStream()
+	{
+		if( _compressed )
+		{
+			inflateEnd( &_zstream );
+		}
+	}
+
+	void Read( void* output, size_t bytes )
+	{
+		if( !_compressed )
+		{
+			if( bytes > _remaining )
+			{
+				I_Error( "ZNodeStream: Nodes lump is truncated" );
+			}
+			memcpy( output, _input, bytes );
+			_input += bytes;
+			_remaining -= bytes;
+			return;
+		}
+
+		_zstream.next_out = (Bytef*)output;
+		_zstream.avail_out = (uInt)bytes;
+		while( _zstream.avail_out > 0 )
+		{
+			int32_t result = inflate( &_zstream, Z_SYNC_FLUSH );
+			if( result == Z_STREAM_END && _zstream.avail_out > 0 )
+			{
+				I_Error( "ZNodeStream: Compressed nodes lump is truncated" );
+			}
+			else if( result != Z_OK && result != Z_STREAM_END )
+			{
+				I_Error( "ZNodeStream: Error decompressing nodes: %s", _zstream.msg ? _zstream.msg : "unknown error" );
+			}
+		}
+	}
+
+	template< typename _ty >
+	INLINE _ty Consume()
+	{
+		_ty val;
+		Read( &val, sizeof( _ty ) );
+		return ReadVal::AsIs( val );
+	}
+
+	byte*		_input;
+	size_t		_remaining;
+	bool		_compressed;
+	z_stream	_zstream;
+};
+
+template< typename _from, typename _to, typename _functor >
+waddata_t< _to > WadDataConvert( ZNodeStream& stream, int32_t count, _functor&& func )
+{
+	constexpr int32_t BatchSize = 512;
+
+	waddata_t< _to > data;
+
+	data.count = count;
+	data.output = (_to*)Z_Malloc( data.count * sizeof( _to ), PU_LEVEL, 0 );
+	memset( data.output, 0, data.count * sizeof( _to ) );
+
+	_from batch[ BatchSize ];
+	_to* lhs = data.output;
+
+	for( int32_t batchstart = 0; batchstart < count; batchstart += BatchSize )
+	{
+		int32_t batchcount = M_MIN( BatchSize, count - batchstart );
+		stream.Read( batch, sizeof( _from ) * batchcount );
+
+		for( int32_t curr : iota( 0, batchcount ) )
+		{
+			func( batchstart + curr, *lhs, batch[ curr ] );
+			++lhs;
+		}
+	}
+
+	return data;
+}
+
 typedef enum class NodeFormat : int32_t
 {
 	Vanilla,
@@ -256,6 +366,9 @@ struct DoomMapLoader
 	nodeformat_t		_nodeformat;
 	node_t*				_nodes;
 
+	int32_t				_znodelump;
+	int32_t				_znodeglversion;
+
 	int32_t				_numlines;
 	line_t*				_lines;
 
@@ -279,6 +392,10 @@ struct DoomMapLoader
 
 	byte*				_rejectmatrix;
 
+	int32_t				_maplump;
+	sha1_digest_t		_mapchecksum;
+	bool				_mapchecksumvalid;
+
 	mapthing_t			_deathmatchstarts[MAX_DEATHMATCH_STARTS];
 	mapthing_t*			_deathmatch_p;
 	mapthing_t			_playerstarts[MAXPLAYERS];
@@ -296,31 +413,75 @@ struct DoomMapLoader
 	void INLINE DetermineExtendedFormat( int32_t rootlump )
 	{
 		constexpr uint64_t DeepBSPMagic = 0x0000000034644E78ull;
-		constexpr uint32_t ZNodeNormalMagic = 0x444F4E58;
-		constexpr uint32_t ZNodeCompressedMagic = 0x444F4E5A;
+
+		struct znodemagic_t
+		{
+			uint32_t		magic;
+			int32_t			lump;
+			nodeformat_t	format;
+			int32_t			glversion;
+			const char*		description;
+		};
+
+		// GL nodes live in the SSECTORS lump, and the NODES lump is left empty
+		constexpr znodemagic_t ZNodeMagic[] =
+		{
+			{ 0x444F4E58, ML_NODES,		NodeFormat::ZNodeNormal,		0, "Detected uncompressed ZDoom nodes" },		// XNOD
+			{ 0x444F4E5A, ML_NODES,		NodeFormat::ZNodeCompressed,	0, "Detected compressed ZDoom nodes" },			// ZNOD
+			{ 0x4E4C4758, ML_SSECTORS,	NodeFormat::ZNodeNormal,		1, "Detected uncompressed ZDoom GL nodes" },	// XGLN
+			{ 0x4E4C475A, ML_SSECTORS,	NodeFormat::ZNodeCompressed,	1, "Detected compressed ZDoom GL nodes" },		// ZGLN
+			{ 0x324C4758, ML_SSECTORS,	NodeFormat::ZNodeNormal,		2, "Detected uncompressed ZDoom GL2 nodes" },	// XGL2
+			{ 0x324C475A, ML_SSECTORS,	NodeFormat::ZNodeCompressed,	2, "Detected compressed ZDoom GL2 nodes" },		// ZGL2
+			{ 0x334C4758, ML_SSECTORS,	NodeFormat::ZNodeNormal,		3, "Detected uncompressed ZDoom GL3 nodes" },	// XGL3
+			{ 0x334C475A, ML_SSECTORS,	NodeFormat::ZNodeCompressed,	3, "Detected compressed ZDoom GL3 nodes" },		// ZGL3
+		};
 
 		bool IsVanilla = loading_code == RnRVanilla;
 
-		// Note: We're abusing the fact that the nodes lump will get loaded as static
-		// and released after conversion here, so we don't need to free the lump and
-		// thus cause it to be loaded twice.
-		byte* data = (byte*)W_CacheLumpNum( rootlump + ML_NODES, PU_STATIC );
+		_maplump = rootlump;
 
-		if( SDL_SwapLE64( *(uint64_t*)data ) == DeepBSPMagic )
+		auto LumpMagic = []( int32_t lumpnum ) -> uint32_t
 		{
-			_nodeformat = NodeFormat::DeepBSP;
-			I_LogAddEntry( Log_System, "Detected DeepBSP nodes" );
+			if( W_LumpLength( lumpnum ) < (int32_t)sizeof( uint32_t ) ) return 0;
+			uint32_t magic = SDL_SwapLE32( *(uint32_t*)W_CacheLumpNum( lumpnum, PU_STATIC ) );
+			W_ReleaseLumpNum( lumpnum );
+			return magic;
+		};
+
+		uint32_t nodesmagic = LumpMagic( rootlump + ML_NODES );
+		uint32_t ssectorsmagic = LumpMagic( rootlump + ML_SSECTORS );
+
+		const znodemagic_t* znodes = nullptr;
+		for( const znodemagic_t& curr : ZNodeMagic )
+		{
+			if( ( curr.lump == ML_NODES ? nodesmagic : ssectorsmagic ) == curr.magic )
+			{
+				znodes = &curr;
+				break;
+			}
 		}
-		else if( SDL_SwapLE32( *(uint32_t*)data ) == ZNodeNormalMagic )
+
+		_znodelump = -1;
+		_znodeglversion = 0;
+
+		bool isdeepbsp = false;
+		if( W_LumpLength( rootlump + ML_NODES ) >= (int32_t)sizeof( uint64_t ) )
 		{
-			_nodeformat = NodeFormat::ZNodeNormal;
-			I_LogAddEntry( Log_System, "Detected uncompressed ZDoom nodes" );
+			isdeepbsp = SDL_SwapLE64( *(uint64_t*)W_CacheLumpNum( rootlump + ML_NODES, PU_STATIC ) ) == DeepBSPMagic;
+			W_ReleaseLumpNum( rootlump + ML_NODES );
 		}
-		else if( SDL_SwapLE32( *(uint32_t*)data ) == ZNodeCompressedMagic )
+
+		if( isdeepbsp )
 		{
-			_nodeformat = NodeFormat::ZNodeCompressed;
-			I_LogAddEntry( Log_System, "Detected compressed ZDoom nodes" );
-			I_Error( "Compressed ZDoom nodes currently unsupported" );
+			_nodeformat = NodeFormat::DeepBSP;
+			I_LogAddEntry( Log_System, "Detected DeepBSP nodes" );
+		}
+		else if( znodes != nullptr )
+		{
+			_nodeformat = znodes->format;
+			_znodelump = rootlump + znodes->lump;
+			_znodeglversion = znodes->glversion;
+			I_LogAddEntry( Log_System, znodes->description );
 		}
 		else if( !IsVanilla )
 		{
@@ -349,20 +510,303 @@ struct DoomMapLoader
 
 		if( data.count > 0 )
 		{
-			_blockmap			= data.output;
-			_blockmapend		= data.output + data.count;
-			_blockmapbase		= _blockmap;
-			_blockmaplength		= data.count;
+			SetupBlockmap( data.output, data.count );
+		}
+	}
+
+	// Rebuilt blockmaps and REJECT tables are cached on disk, keyed by a
+	// hash of the lumps they're generated from
+	static constexpr uint32_t MapCacheMagic = 0x4D434E52; // RNCM
+	static constexpr uint32_t MapCacheVersion = 1;
+
+	struct mapcacheheader_t
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		int32_t		length;
+	};
+
+	const sha1_digest_t& MapChecksum()
+	{
+		if( !_mapchecksumvalid )
+		{
+			sha1_context_t context;
+			SHA1_Init( &context );
+			for( int32_t lump : { ML_VERTEXES, ML_LINEDEFS, ML_SIDEDEFS, ML_SECTORS } )
+			{
+				int32_t lumpnum = _maplump + lump;
+				int32_t length = W_LumpLength( lumpnum );
+				SHA1_UpdateInt32( &context, length );
+				if( length > 0 )
+				{
+					SHA1_Update( &context, (byte*)W_CacheLumpNum( lumpnum, PU_STATIC ), length );
+					W_ReleaseLumpNum( lumpnum );
+				}
+			}
+			SHA1_Final( _mapchecksum, &context );
+			_mapchecksumvalid = true;
+		}
+
+		return _mapchecksum;
+	}
+
+	std::string MapCachePath( const char* extension, bool createdir )
+	{
+		std::string cachedir = std::string( configdir ) + "mapcache";
+		if( createdir )
+		{
+			M_MakeDirectory( cachedir.c_str() );
+		}
+
+		char checksum[ sizeof( sha1_digest_t ) * 2 + 1 ] = {};
+		for( int32_t index : iota( 0, (int32_t)sizeof( sha1_digest_t ) ) )
+		{
+			M_snprintf( &checksum[ index * 2 ], 3, "%02x", MapChecksum()[ index ] );
+		}
+
+		return cachedir + DIR_SEPARATOR_S + checksum + "." + extension;
+	}
+
+	template< typename _ty >
+	_ty* LoadMapCache( const char* extension, int32_t& length )
+	{
+		std::string path = MapCachePath( extension, false );
+		FILE* file = fopen( path.c_str(), "rb" );
+		if( file == nullptr )
+		{
+			return nullptr;
+		}
+
+		_ty* output = nullptr;
+		mapcacheheader_t header = {};
+		if( fread( &header, sizeof( header ), 1, file ) == 1
+			&& header.magic == MapCacheMagic
+			&& header.version == MapCacheVersion
+			&& header.length > 0 )
+		{
+			output = (_ty*)Z_Malloc( sizeof( _ty ) * header.length, PU_LEVEL, nullptr );
+			if( fread( output, sizeof( _ty ), header.length, file ) == (size_t)header.length )
+			{
+				length = header.length;
+			}
+			else
+			{
+				Z_Free( output );
+				output = nullptr;
+			}
+		}
+
+		fclose( file );
+		return output;
+	}
+
+	template< typename _ty >
+	void SaveMapCache( const char* extension, const _ty* data, int32_t length )
+	{
+		std::string path = MapCachePath( extension, true );
+		FILE* file = fopen( path.c_str(), "wb" );
+		if( file == nullptr )
+		{
+			I_LogAddEntryVar( Log_Warning, "Couldn't write map cache %s", path.c_str() );
+			return;
+		}
 
-			_blockmaporgx		= IntToFixed( *_blockmap++ );
-			_blockmaporgy		= IntToFixed( *_blockmap++ );
-			_blockmapwidth		= *_blockmap++;
-			_blockmapheight		= *_blockmap++;
+		mapcacheheader_t header = { MapCacheMagic, MapCacheVersion, length };
+		fwrite( &header, sizeof( header ), 1, file );
+		fwrite( data, sizeof( _ty ), length, file );
+		fclose( file );
+	}
+
+	void INLINE SetupBlockmap( blockmap_t* data, int32_t length )
+	{
+		_blockmap			= data;
+		_blockmapend		= data + length;
+		_blockmapbase		= data;
+		_blockmaplength		= length;
+
+		_blockmaporgx		= IntToFixed( *_blockmap++ );
+		_blockmaporgy		= IntToFixed( *_blockmap++ );
+		_blockmapwidth		= *_blockmap++;
+		_blockmapheight		= *_blockmap++;
+
+		int32_t linkssize = sizeof(*_blocklinks) * _blockmapwidth * _blockmapheight;
+		_blocklinks = (mobj_t**)Z_Malloc( linkssize, PU_LEVEL, 0 );
+		memset( _blocklinks, 0, linkssize );
+	}
 
-			int32_t linkssize = sizeof(*_blocklinks) * _blockmapwidth * _blockmapheight;
-			_blocklinks = (mobj_t**)Z_Malloc( linkssize, PU_LEVEL, 0 );
-			memset( _blocklinks, 0, linkssize );
+	// The header sizes the block links allocation, so it needs checking
+	// before SetupBlockmap gets anywhere near a cache file
+	bool INLINE CachedBlockmapHeaderValid( const blockmap_t* data, int32_t length )
+	{
+		if( length < 4 || data[ 2 ] <= 0 || data[ 3 ] <= 0 )
+		{
+			return false;
 		}
+
+		return (int64_t)data[ 2 ] * data[ 3 ] + 4 <= length;
+	}
+
+	// Checks every offset and list in a loaded blockmap so that
+	// truncated or mangled lumps get rebuilt instead of crashing
+	bool INLINE BlockmapValid()
+	{
+		if( _blockmapbase == nullptr || _blockmaplength < 4 )
+		{
+			return false;
+		}
+
+		int32_t numblocks = _blockmapwidth * _blockmapheight;
+		if( _blockmapwidth <= 0 || _blockmapheight <= 0 || _blockmaplength < 4 + numblocks )
+		{
+			return false;
+		}
+
+		// Lists can be shared between blocks, no need to walk them twice
+		std::vector< bool > checked( _blockmaplength );
+		for( blockmap_t offset : std::span( _blockmap, numblocks ) )
+		{
+			if( offset < 4 || offset >= _blockmaplength )
+			{
+				return false;
+			}
+
+			if( checked[ offset ] )
+			{
+				continue;
+			}
+			checked[ offset ] = true;
+
+			blockmap_t* entry = _blockmapbase + offset;
+			for( ; entry < _blockmapend && *entry != BLOCKMAP_INVALID; ++entry )
+			{
+				if( *entry < 0 || *entry >= _numlines )
+				{
+					return false;
+				}
+			}
+
+			if( entry == _blockmapend )
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Only adds blocks a line actually passes through, rather than every
+	// block in its bounding box. Rows get a one unit margin either side
+	// to absorb rounding, which only ever costs an extra line check.
+	template< typename _func >
+	void INLINE ForEachLineBlock( const line_t& line, int32_t orgx, int32_t orgy, _func&& func )
+	{
+		int64_t x1 = FixedToInt( line.v1->x ) - orgx;
+		int64_t y1 = FixedToInt( line.v1->y ) - orgy;
+		int64_t x2 = FixedToInt( line.v2->x ) - orgx;
+		int64_t y2 = FixedToInt( line.v2->y ) - orgy;
+		if( x1 > x2 )
+		{
+			std::swap( x1, x2 );
+			std::swap( y1, y2 );
+		}
+
+		int64_t miny = M_MIN( y1, y2 );
+		int64_t maxy = M_MAX( y1, y2 );
+
+		int32_t firstcol = (int32_t)( x1 >> MAPBTOFRAC );
+		int32_t lastcol = (int32_t)( x2 >> MAPBTOFRAC );
+		for( int32_t col : iota( firstcol, lastcol + 1 ) )
+		{
+			int64_t ya = y1;
+			int64_t yb = y2;
+			if( x1 != x2 )
+			{
+				int64_t xa = M_MAX( x1, (int64_t)col << MAPBTOFRAC );
+				int64_t xb = M_MIN( x2, ( (int64_t)( col + 1 ) << MAPBTOFRAC ) );
+				ya = y1 + ( xa - x1 ) * ( y2 - y1 ) / ( x2 - x1 );
+				yb = y1 + ( xb - x1 ) * ( y2 - y1 ) / ( x2 - x1 );
+			}
+
+			int64_t rowmin = M_CLAMP( M_MIN( ya, yb ) - 1, miny, maxy );
+			int64_t rowmax = M_CLAMP( M_MAX( ya, yb ) + 1, miny, maxy );
+			for( int32_t row : iota( (int32_t)( rowmin >> MAPBTOFRAC ), (int32_t)( rowmax >> MAPBTOFRAC ) + 1 ) )
+			{
+				func( row * _blockmapwidth + col );
+			}
+		}
+	}
+
+	void INLINE BuildBlockmap()
+	{
+		int32_t minx = INT_MAX;
+		int32_t miny = INT_MAX;
+		int32_t maxx = INT_MIN;
+		int32_t maxy = INT_MIN;
+
+		for( vertex_t& vert : Vertices() )
+		{
+			minx = M_MIN( minx, FixedToInt( vert.x ) );
+			miny = M_MIN( miny, FixedToInt( vert.y ) );
+			maxx = M_MAX( maxx, FixedToInt( vert.x ) );
+			maxy = M_MAX( maxy, FixedToInt( vert.y ) );
+		}
+
+		minx -= 8;
+		miny -= 8;
+		maxx += 8;
+		maxy += 8;
+
+		_blockmapwidth		= ( ( maxx - minx ) >> MAPBTOFRAC ) + 1;
+		_blockmapheight		= ( ( maxy - miny ) >> MAPBTOFRAC ) + 1;
+		int32_t numblocks	= _blockmapwidth * _blockmapheight;
+
+		// Count first, then fill. Keeps everything in two flat arrays
+		// instead of a vector per block.
+		std::vector< int32_t > blockcounts( numblocks );
+		for( line_t& line : Lines() )
+		{
+			if( line.special != Zokum_NoBlockmap )
+			{
+				ForEachLineBlock( line, minx, miny, [ &blockcounts ]( int32_t block ) { ++blockcounts[ block ]; } );
+			}
+		}
+
+		// Want vanilla style blockmaps? Add a leading 0 to each list
+		int32_t length = 4 + numblocks;
+		for( int32_t count : blockcounts )
+		{
+			length += count + 1;
+		}
+
+		blockmap_t* data = (blockmap_t*)Z_Malloc( sizeof( blockmap_t ) * length, PU_LEVEL, nullptr );
+		data[ 0 ] = minx;
+		data[ 1 ] = miny;
+		data[ 2 ] = _blockmapwidth;
+		data[ 3 ] = _blockmapheight;
+
+		std::vector< int32_t > blockcursor( numblocks );
+		blockmap_t* offsets = data + 4;
+		int32_t offset = 4 + numblocks;
+		for( int32_t block : iota( 0, numblocks ) )
+		{
+			offsets[ block ] = offset;
+			blockcursor[ block ] = offset;
+			offset += blockcounts[ block ];
+			data[ offset++ ] = BLOCKMAP_INVALID;
+		}
+
+		for( int32_t lineindex : iota( 0, _numlines ) )
+		{
+			if( _lines[ lineindex ].special != Zokum_NoBlockmap )
+			{
+				ForEachLineBlock( _lines[ lineindex ], minx, miny, [ data, lineindex, &blockcursor ]( int32_t block )
+				{
+					data[ blockcursor[ block ]++ ] = lineindex;
+				} );
+			}
+		}
+
+		SetupBlockmap( data, length );
 	}
 
 	void INLINE LoadExtendedBlockmap( int32_t lumpnum )
@@ -423,102 +867,49 @@ struct DoomMapLoader
 #endif
 			}
 
-			if( forcerebuild )
+			if( !forcerebuild && !BlockmapValid() )
 			{
-				rend_fixed_t minx = LLONG_MAX;
-				rend_fixed_t miny = LLONG_MAX;
-				rend_fixed_t maxx = -LLONG_MAX;
-				rend_fixed_t maxy = -LLONG_MAX;
+				I_LogAddEntry( Log_System, "Blockmap references invalid data, proceeding with rebuild" );
+				forcerebuild = true;
+			}
 
-				for( vertex_t& vert : Vertices() )
+			if( forcerebuild )
+			{
+				if( _blockmapbase != nullptr )
 				{
-					minx = M_MIN( minx, FixedToRendFixed( vert.x ) );
-					miny = M_MIN( miny, FixedToRendFixed( vert.y ) );
-					maxx = M_MAX( maxx, FixedToRendFixed( vert.x ) );
-					maxy = M_MAX( maxy, FixedToRendFixed( vert.y ) );
+					Z_Free( _blockmapbase );
+					Z_Free( _blocklinks );
 				}
 
-				minx -= IntToRendFixed( 8 );
-				miny -= IntToRendFixed( 8 );
-				maxx += IntToRendFixed( 8 );
-				maxy += IntToRendFixed( 8 );
-
-				blockmap_t width	= RendFixedToInt( ( maxx - minx ) / 128 ) + 1;
-				blockmap_t height	= RendFixedToInt( ( maxy - miny ) / 128 ) + 1;
-				blockmap_t count	= width * height;
-
-				// Want vanilla style blockmaps? Use this
-				//std::vector< std::vector< blockmap_t > > blockindices( count, { 0 } );
-				std::vector< std::vector< blockmap_t > > blockindices( count );
+				int32_t cachedlength = 0;
+				blockmap_t* cached = LoadMapCache< blockmap_t >( "blockmap", cachedlength );
+				if( cached != nullptr && !CachedBlockmapHeaderValid( cached, cachedlength ) )
+				{
+					Z_Free( cached );
+					cached = nullptr;
+				}
 
-				blockmap_t lineindex = 0;
-				for( line_t& line : Lines() )
+				if( cached != nullptr )
 				{
-					if( line.special == Zokum_NoBlockmap )
+					SetupBlockmap( cached, cachedlength );
+					if( BlockmapValid() )
 					{
-						continue;
+						I_LogAddEntry( Log_System, "Using cached blockmap" );
 					}
-
-					blockmap_t v1x = RendFixedToInt( ( FixedToRendFixed( line.v1->x ) - minx ) / 128 );
-					blockmap_t v1y = RendFixedToInt( ( FixedToRendFixed( line.v1->y ) - miny ) / 128 );
-					blockmap_t v2x = RendFixedToInt( ( FixedToRendFixed( line.v2->x ) - minx ) / 128 );
-					blockmap_t v2y = RendFixedToInt( ( FixedToRendFixed( line.v2->y ) - miny ) / 128 );
-					if( v1x > v2x ) std::swap( v1x, v2x );
-					if( v1y > v2y ) std::swap( v1y, v2y );
-
-					for( blockmap_t blockx : iota( v1x, v2x + 1 ) )
+					else
 					{
-						for( blockmap_t blocky : iota( v1y, v2y + 1 ) )
-						{
-							blockmap_t blockindex = blocky * width + blockx;
-							blockindices[ blockindex ].push_back( lineindex );
-						}
+						I_LogAddEntry( Log_System, "Cached blockmap references invalid data, proceeding with rebuild" );
+						Z_Free( _blockmapbase );
+						Z_Free( _blocklinks );
+						cached = nullptr;
 					}
-
-					++lineindex;
 				}
 
-				blockmap_t offset = 4 + count;
-				std::vector< blockmap_t > blockoffsets;
-				blockoffsets.reserve( count );
-
-				for( auto& thisblockindex : blockindices )
+				if( cached == nullptr )
 				{
-					blockoffsets.push_back( offset );
-					thisblockindex.push_back( BLOCKMAP_INVALID );
-					offset += (blockmap_t)thisblockindex.size();
+					BuildBlockmap();
+					SaveMapCache( "blockmap", _blockmapbase, _blockmaplength );
 				}
-
-				_blockmap = (blockmap_t*)Z_Malloc( sizeof( blockmap_t ) * offset, PU_LEVEL, nullptr );
-				_blockmapend = _blockmap + offset;
-				_blockmapbase = _blockmap;
-				_blockmaplength = offset;
-				_blockmaporgx = RendFixedToFixed( minx );
-				_blockmaporgy = RendFixedToFixed( miny );
-				_blockmapwidth = width;
-				_blockmapheight = height;
-
-				*_blockmap++ = RendFixedToInt( minx );
-				*_blockmap++ = RendFixedToInt( miny );
-				*_blockmap++ = width;
-				*_blockmap++ = height;
-
-				blockmap_t* output = _blockmap;
-				auto CopyToBlockmap = [&output]( std::vector< blockmap_t >& entries )
-				{
-					memcpy( output, entries.data(), sizeof( blockmap_t ) * entries.size() );
-					output += entries.size();
-				};
-
-				CopyToBlockmap( blockoffsets );
-				for( auto& thisblockindex : blockindices )
-				{
-					CopyToBlockmap( thisblockindex );
-				}
-
-				int32_t linkssize = sizeof(*_blocklinks) * _blockmapwidth * _blockmapheight;
-				_blocklinks = (mobj_t**)Z_Malloc( linkssize, PU_LEVEL, 0 );
-				memset( _blocklinks, 0, linkssize );
 			}
 			break;
 		}
@@ -777,12 +1168,10 @@ struct DoomMapLoader
 		{
 			LoadSubsectors< mapsubsector_deepbsp_t >( lumpnum );
 		}
-		else if( _nodeformat == NodeFormat::ZNodeNormal )
-		{
-		}
-		else if( _nodeformat == NodeFormat::ZNodeCompressed )
+		else if( _nodeformat == NodeFormat::ZNodeNormal
+			|| _nodeformat == NodeFormat::ZNodeCompressed )
 		{
-			I_Error( "Compressed ZDoom nodes currently unsupported" );
+			// Read along with the nodes
 		}
 		else
 		{
@@ -844,88 +1233,227 @@ struct DoomMapLoader
 		_nodes			= data.output;
 	}
 
-	void INLINE LoadZDoomNodes( byte* lumpdata, size_t datalength )
+	void INLINE SetupZDoomSeg( seg_t& out, int32_t v1, int32_t v2, int32_t linedef, uint8_t side )
 	{
-		// Implemented entirely by referring to https://zdoom.org/wiki/Node#ZDoom_extended_nodes
-		byte* working = lumpdata;
+		out.v1			= &SegVertices()[ v1 ];
+		out.v2			= &SegVertices()[ v2 ];
+		out.linedef		= &Lines()[ linedef ];
 
-		int32_t origverts = Read::Consume< int32_t >( working );
-		int32_t newverts = Read::Consume< int32_t >( working );
+		out.offset		= P_AproxDistance( out.v1->x - out.linedef->v1->x, out.v1->y - out.linedef->v1->y );
+		out.angle		= BSP_PointToAngle( out.v1->x, out.v1->y, out.v2->x, out.v2->y );
 
-		auto verts = WadDataConvert< mapvertex_zdoom_t, vertex_t >( working, newverts * sizeof( mapvertex_zdoom_t ), []( int32_t index, vertex_t& out, const mapvertex_zdoom_t& in )
+		out.sidedef = &Sides()[ out.linedef->sidenum[ side ] ];
+		if( side == 0 )
 		{
-			out.x = in.x;
-			out.y = in.y;
+			out.frontsector = out.linedef->frontsector;
+			out.backsector = out.linedef->backsector;
+		}
+		else
+		{
+			out.frontsector = out.linedef->backsector;
+			out.backsector = out.linedef->frontsector;
+		}
 
-			out.rend.x = FixedToRendFixed( out.x );
-			out.rend.y = FixedToRendFixed( out.y );
-		} );
+		out.rend.offset	= FixedToRendFixed( out.offset );
+	}
 
-		_numsegvertices = origverts + newverts;
-		_segvertices = (vertex_t*)Z_Malloc( _numsegvertices * sizeof( vertex_t ), PU_LEVEL, 0 );
+	// GL segs only store their first vertex and include minisegs along
+	// partition lines. The renderer has no use for minisegs, so they get
+	// dropped here and each subsector is re-indexed to its real segs.
+	// A subsector can be made of nothing but minisegs though, and then
+	// there's no seg for GroupLines to take its sector from. Minisegs
+	// never cross a linedef, so the subsector on the other side of one
+	// is in the same sector. Those get resolved here through the
+	// miniseg partners instead.
+	template< typename _maptype >
+	void INLINE LoadZDoomGLSegs( ZNodeStream& stream, int32_t newsegs )
+	{
+		constexpr auto InvalidLinedef = (decltype( _maptype::linedef ))~0;
+		constexpr auto InvalidPartner = (decltype( _maptype::partner ))~0;
 
-		vertex_t* workingvert = _segvertices;
-		memcpy( workingvert, _vertices, sizeof( vertex_t ) * origverts );
-		workingvert += _numvertices;
-		memcpy( workingvert, verts.output, sizeof( vertex_t ) * newverts );
+		struct glseg_t
+		{
+			int32_t v1;
+			int32_t v2;
+			int32_t linedef;
+			uint8_t side;
+		};
 
-		Read::Advance< mapvertex_zdoom_t >( working, newverts );
+		struct miniseg_t
+		{
+			int32_t subsector;
+			int32_t v1;
+			uint32_t partner;
+		};
 
-		int32_t newsubsectors = Read::Consume< int32_t >( working );
+		std::vector< glseg_t > glsegs;
+		glsegs.reserve( newsegs );
+		std::vector< _maptype > subsectorsegs;
 
-		int32_t currseg = 0;
-		auto subsecs = WadDataConvert< mapsubsector_zdoom_t, subsector_t >( working, newsubsectors * sizeof( mapsubsector_zdoom_t ), [ &currseg ]( int32_t index, subsector_t& out, const mapsubsector_zdoom_t& in )
+		// Indexed by the seg numbers in the file, which is what partners refer to
+		std::vector< int32_t > segsubsector( newsegs, -1 );
+		std::vector< miniseg_t > minisegs;
+		std::vector< sector_t* > subsectorsector( _numsubsectors, nullptr );
+
+		int32_t realsegs = 0;
+		int32_t readsegs = 0;
+
+		for( subsector_t& subsector : SubSectors() )
 		{
-			out.numlines	= Read::AsIs( in.numsegs );
-			out.firstline	= currseg;
-			out.index		= index;
+			if( readsegs + (int32_t)subsector.numlines > newsegs )
+			{
+				I_Error( "LoadZDoomGLSegs: Subsector %d references more segs than the nodes contain", subsector.index );
+			}
 
-			currseg += out.numlines;
-		} );
+			subsectorsegs.resize( subsector.numlines );
+			stream.Read( subsectorsegs.data(), sizeof( _maptype ) * subsector.numlines );
 
-		_numsubsectors = subsecs.count;
-		_subsectors = subsecs.output;
+			int32_t firstline = realsegs;
+			for( int32_t curr : iota( 0, (int32_t)subsector.numlines ) )
+			{
+				const _maptype& in = subsectorsegs[ curr ];
+				const _maptype& next = subsectorsegs[ ( curr + 1 ) % subsector.numlines ];
+
+				segsubsector[ readsegs + curr ] = subsector.index;
+
+				auto linedef = Read::AsIs( in.linedef );
+				if( linedef != InvalidLinedef )
+				{
+					if( (int32_t)linedef >= _numlines )
+					{
+						I_Error( "LoadZDoomGLSegs: Seg %d references invalid linedef %d", readsegs + curr, (int32_t)linedef );
+					}
 
-		Read::Advance< mapsubsector_zdoom_t >( working, newsubsectors );
+					glsegs.push_back( { (int32_t)Read::AsIs( in.v1 ), (int32_t)Read::AsIs( next.v1 ), (int32_t)linedef, Read::AsIs( in.side ) } );
+					++realsegs;
+				}
+				else
+				{
+					minisegs.push_back( { subsector.index, (int32_t)Read::AsIs( in.v1 ), (uint32_t)Read::AsIs( in.partner ) } );
+				}
+			}
+			readsegs += subsector.numlines;
 
-		int32_t newsegs = Read::Consume< int32_t >( working );
-		auto segs = WadDataConvert< mapseg_zdoom_t, seg_t >( working, newsegs * sizeof( mapseg_zdoom_t ), [ this ]( int32_t index, seg_t& out, const mapseg_zdoom_t& in )
+			if( realsegs != firstline )
+			{
+				const glseg_t& first = glsegs[ firstline ];
+				int32_t sidenum = Lines()[ first.linedef ].sidenum[ first.side ];
+				if( sidenum >= 0 )
+				{
+					subsectorsector[ subsector.index ] = Sides()[ sidenum ].sector;
+				}
+			}
+
+			subsector.firstline = firstline;
+			subsector.numlines = realsegs - firstline;
+		}
+
+		if( realsegs == 0 )
 		{
-			out.v1			= &SegVertices()[ Read::AsIs( in.v1 ) ];
-			out.v2			= &SegVertices()[ Read::AsIs( in.v2 ) ];
-			out.linedef		= &Lines()[ Read::AsIs( in.linedef ) ];
+			I_Error( "LoadZDoomGLSegs: Nodes contain no segs attached to linedefs" );
+		}
 
-			out.offset		= P_AproxDistance( out.v1->x - out.linedef->v1->x, out.v1->y - out.linedef->v1->y );
-			out.angle		= BSP_PointToAngle( out.v1->x, out.v1->y, out.v2->x, out.v2->y );
+		// Each pass crosses one more miniseg, so chains of miniseg-only
+		// subsectors resolve from whichever end touches a real one
+		bool resolved = false;
+		while( !resolved )
+		{
+			resolved = true;
+			bool progressed = false;
+			for( const miniseg_t& miniseg : minisegs )
+			{
+				if( subsectorsector[ miniseg.subsector ] != nullptr )
+				{
+					continue;
+				}
 
-			uint8_t side = Read::AsIs( in.side );
-			out.sidedef = &Sides()[ out.linedef->sidenum[ side ] ];
-			if( side == 0 )
+				if( miniseg.partner != InvalidPartner && miniseg.partner < (uint32_t)newsegs )
+				{
+					int32_t partnersubsector = segsubsector[ miniseg.partner ];
+					if( partnersubsector >= 0 && subsectorsector[ partnersubsector ] != nullptr )
+					{
+						subsectorsector[ miniseg.subsector ] = subsectorsector[ partnersubsector ];
+						progressed = true;
+						continue;
+					}
+				}
+				resolved = false;
+			}
+
+			if( !progressed )
 			{
-				out.frontsector = out.linedef->frontsector;
-				out.backsector = out.linedef->backsector;
+				break;
 			}
-			else
+		}
+
+		// Nodes built without partners can still leave some behind. A
+		// real seg starting on the same vertex borders the same space.
+		if( !resolved )
+		{
+			for( const miniseg_t& miniseg : minisegs )
 			{
-				out.frontsector = out.linedef->backsector;
-				out.backsector = out.linedef->frontsector;
+				if( subsectorsector[ miniseg.subsector ] != nullptr )
+				{
+					continue;
+				}
+
+				for( const glseg_t& seg : glsegs )
+				{
+					int32_t sidenum = Lines()[ seg.linedef ].sidenum[ seg.side ];
+					if( ( seg.v1 == miniseg.v1 || seg.v2 == miniseg.v1 ) && sidenum >= 0 )
+					{
+						subsectorsector[ miniseg.subsector ] = Sides()[ sidenum ].sector;
+						break;
+					}
+				}
 			}
-			
-			out.rend.offset	= FixedToRendFixed( out.offset );
-		} );
+		}
 
-		_numsegs = segs.count;
-		_segs = segs.output;
+		// GroupLines takes the sector from the first seg for everything else
+		for( subsector_t& subsector : SubSectors() )
+		{
+			if( subsector.numlines == 0 )
+			{
+				if( subsectorsector[ subsector.index ] == nullptr )
+				{
+					I_Error( "LoadZDoomGLSegs: Couldn't resolve a sector for miniseg-only subsector %d", subsector.index );
+				}
+				subsector.sector = subsectorsector[ subsector.index ];
+			}
+			subsector.firstline = M_MIN( subsector.firstline, realsegs - 1 );
+		}
 
-		Read::Advance< mapseg_zdoom_t >( working, newsegs );
+		_numsegs = realsegs;
+		_segs = (seg_t*)Z_Malloc( _numsegs * sizeof( seg_t ), PU_LEVEL, 0 );
+		memset( _segs, 0, _numsegs * sizeof( seg_t ) );
 
-		int32_t newnodes = Read::Consume< int32_t >( working );
-		auto nodes = WadDataConvert< mapnode_zdoom_t, node_t >( working, newnodes * sizeof( mapnode_zdoom_t ), []( int32_t index, node_t& out, const mapnode_zdoom_t& in )
+		for( int32_t index : iota( 0, realsegs ) )
 		{
-			out.divline.x			= IntToFixed( Read::AsIs( in.x ) );
-			out.divline.y			= IntToFixed( Read::AsIs( in.y ) );
-			out.divline.dx			= IntToFixed( Read::AsIs( in.dx ) );
-			out.divline.dy			= IntToFixed( Read::AsIs( in.dy ) );
+			const glseg_t& in = glsegs[ index ];
+			SetupZDoomSeg( _segs[ index ], in.v1, in.v2, in.linedef, in.side );
+		}
+	}
+
+	template< typename _maptype = mapnode_zdoom_t >
+	void INLINE LoadZDoomNodeList( ZNodeStream& stream )
+	{
+		int32_t newnodes = stream.Consume< int32_t >();
+		auto nodes = WadDataConvert< _maptype, node_t >( stream, newnodes, []( int32_t index, node_t& out, const _maptype& in )
+		{
+			if constexpr( std::is_same_v< _maptype, mapnode_zdoom_gl3_t > )
+			{
+				out.divline.x		= Read::AsIs( in.x );
+				out.divline.y		= Read::AsIs( in.y );
+				out.divline.dx		= Read::AsIs( in.dx );
+				out.divline.dy		= Read::AsIs( in.dy );
+			}
+			else
+			{
+				out.divline.x		= IntToFixed( Read::AsIs( in.x ) );
+				out.divline.y		= IntToFixed( Read::AsIs( in.y ) );
+				out.divline.dx		= IntToFixed( Read::AsIs( in.dx ) );
+				out.divline.dy		= IntToFixed( Read::AsIs( in.dy ) );
+			}
 			for( int32_t child : iota( 0, 2 ) )
 			{
 				out.children[ child ] = Read::AsIs( in.children[ child ] );
@@ -951,46 +1479,102 @@ struct DoomMapLoader
 
 		_numnodes = nodes.count;
 		_nodes = nodes.output;
-
 	}
 
-	void INLINE LoadExtendedNodes( int32_t lumpnum )
+	void INLINE LoadZDoomNodes( ZNodeStream& stream, int32_t glversion )
 	{
-		if( _nodeformat == NodeFormat::DeepBSP )
+		// Implemented entirely by referring to https://zdoom.org/wiki/Node#ZDoom_extended_nodes
+		int32_t origverts = stream.Consume< int32_t >();
+		int32_t newverts = stream.Consume< int32_t >();
+
+		if( origverts > _numvertices )
 		{
-			LoadNodes< mapnode_deepbsp_t >( lumpnum, 8 );
+			I_Error( "LoadZDoomNodes: Nodes reference %d map vertices, but only %d exist", origverts, _numvertices );
 		}
-		else if( _nodeformat == NodeFormat::ZNodeNormal )
+
+		auto verts = WadDataConvert< mapvertex_zdoom_t, vertex_t >( stream, newverts, []( int32_t index, vertex_t& out, const mapvertex_zdoom_t& in )
 		{
-			byte* rawlump = (byte*)W_CacheLumpNum( lumpnum, PU_STATIC );
-			size_t rawlength = W_LumpLength( lumpnum );
+			out.x = Read::AsIs( in.x );
+			out.y = Read::AsIs( in.y );
 
-			// Advancing past the identifier
-			Read::Consume< int32_t >( rawlump );
-			rawlength -= sizeof( int32_t );
+			out.rend.x = FixedToRendFixed( out.x );
+			out.rend.y = FixedToRendFixed( out.y );
+		} );
+
+		_numsegvertices = origverts + newverts;
+		_segvertices = (vertex_t*)Z_Malloc( _numsegvertices * sizeof( vertex_t ), PU_LEVEL, 0 );
 
-			LoadZDoomNodes( rawlump, rawlength );
+		vertex_t* workingvert = _segvertices;
+		memcpy( workingvert, _vertices, sizeof( vertex_t ) * origverts );
+		workingvert += origverts;
+		memcpy( workingvert, verts.output, sizeof( vertex_t ) * newverts );
 
-			W_ReleaseLumpNum( lumpnum );
+		int32_t newsubsectors = stream.Consume< int32_t >();
+
+		int32_t currseg = 0;
+		auto subsecs = WadDataConvert< mapsubsector_zdoom_t, subsector_t >( stream, newsubsectors, [ &currseg ]( int32_t index, subsector_t& out, const mapsubsector_zdoom_t& in )
+		{
+			out.numlines	= Read::AsIs( in.numsegs );
+			out.firstline	= currseg;
+			out.index		= index;
+
+			currseg += out.numlines;
+		} );
+
+		_numsubsectors = subsecs.count;
+		_subsectors = subsecs.output;
+
+		int32_t newsegs = stream.Consume< int32_t >();
+		if( glversion == 0 )
+		{
+			auto segs = WadDataConvert< mapseg_zdoom_t, seg_t >( stream, newsegs, [ this ]( int32_t index, seg_t& out, const mapseg_zdoom_t& in )
+			{
+				SetupZDoomSeg( out, Read::AsIs( in.v1 ), Read::AsIs( in.v2 ), Read::AsIs( in.linedef ), Read::AsIs( in.side ) );
+			} );
+
+			_numsegs = segs.count;
+			_segs = segs.output;
 		}
-		else if( _nodeformat == NodeFormat::ZNodeCompressed )
+		else if( glversion == 1 )
 		{
-			// Need to get zlib and libpng in here
-			I_Error( "Compressed ZDoom nodes currently unsupported" );
+			LoadZDoomGLSegs< mapseg_zdoom_gl_t >( stream, newsegs );
+		}
+		else
+		{
+			LoadZDoomGLSegs< mapseg_zdoom_gl2_t >( stream, newsegs );
+		}
 
-#if 0
-			byte* rawlump = (byte*)W_CacheLumpNum( lumpnum, PU_STATIC );
-			size_t rawlength = W_LumpLength( lumpnum );
+		if( glversion == 3 )
+		{
+			LoadZDoomNodeList< mapnode_zdoom_gl3_t >( stream );
+		}
+		else
+		{
+			LoadZDoomNodeList( stream );
+		}
+	}
+
+	void INLINE LoadExtendedNodes( int32_t lumpnum )
+	{
+		if( _nodeformat == NodeFormat::DeepBSP )
+		{
+			LoadNodes< mapnode_deepbsp_t >( lumpnum, 8 );
+		}
+		else if( _nodeformat == NodeFormat::ZNodeNormal
+			|| _nodeformat == NodeFormat::ZNodeCompressed )
+		{
+			// GL nodes are stored in the subsectors lump instead
+			byte* rawlump = (byte*)W_CacheLumpNum( _znodelump, PU_STATIC );
+			size_t rawlength = W_LumpLength( _znodelump );
 
 			// Advancing past the identifier
 			Read::Consume< int32_t >( rawlump );
 			rawlength -= sizeof( int32_t );
 
-			// Decompress data here
-			//LoadZDoomNodes( rawlump, rawlength );
-#endif
+			ZNodeStream stream( rawlump, rawlength, _nodeformat == NodeFormat::ZNodeCompressed );
+			LoadZDoomNodes( stream, _znodeglversion );
 
-			W_ReleaseLumpNum( lumpnum );
+			W_ReleaseLumpNum( _znodelump );
 		}
 		else
 		{
@@ -1060,12 +1644,10 @@ struct DoomMapLoader
 		{
 			LoadSegs< mapseg_deepbsp_t >( lumpnum );
 		}
-		else if( _nodeformat == NodeFormat::ZNodeNormal )
+		else if( _nodeformat == NodeFormat::ZNodeNormal
+			|| _nodeformat == NodeFormat::ZNodeCompressed )
 		{
-		}
-		else if( _nodeformat == NodeFormat::ZNodeCompressed )
-		{
-			I_Error( "Compressed ZDoom nodes currently unsupported" );
+			// Read along with the nodes
 		}
 		else
 		{
@@ -1078,7 +1660,11 @@ struct DoomMapLoader
 		// look up sector number for each subsector
 		for ( subsector_t& subsector : SubSectors() )
 		{
-			subsector.sector = Segs()[ subsector.firstline ].sidedef->sector;
+			// Miniseg-only GL subsectors were resolved when their segs were loaded
+			if( subsector.numlines > 0 )
+			{
+				subsector.sector = Segs()[ subsector.firstline ].sidedef->sector;
+			}
 		}
 
 		// count number of lines in each sector
@@ -1165,6 +1751,142 @@ struct DoomMapLoader
 
 	}
 
+	// Sight can only pass from one sector to another over a line with
+	// sectors on both sides, since every one-sided line blocks it. Doors
+	// and lifts change the openings at runtime, so heights are ignored and
+	// the only pairs rejected are ones with no such path between them.
+	// That makes this a connectivity table rather than a line of sight
+	// one: any map where every sector is reachable from every other comes
+	// out all zero, which rejects nothing and behaves exactly like the
+	// empty lump it replaced. Only maps with sealed off areas gain here.
+	void INLINE BuildReject()
+	{
+		int32_t numsectors = _numsectors;
+		int32_t rejectlength = (int32_t)( ( (int64_t)numsectors * numsectors + 7 ) / 8 );
+
+		std::vector< int32_t > group( numsectors );
+		for( int32_t sector : iota( 0, numsectors ) )
+		{
+			group[ sector ] = sector;
+		}
+
+		auto FindGroup = [ &group ]( int32_t sector )
+		{
+			while( group[ sector ] != sector )
+			{
+				group[ sector ] = group[ group[ sector ] ];
+				sector = group[ sector ];
+			}
+			return sector;
+		};
+
+		for( line_t& line : Lines() )
+		{
+			if( line.frontsector != nullptr && line.backsector != nullptr )
+			{
+				int32_t front = FindGroup( (int32_t)( line.frontsector - _sectors ) );
+				int32_t back = FindGroup( (int32_t)( line.backsector - _sectors ) );
+				group[ M_MAX( front, back ) ] = M_MIN( front, back );
+			}
+		}
+
+		for( int32_t sector : iota( 0, numsectors ) )
+		{
+			group[ sector ] = FindGroup( sector );
+		}
+
+		_rejectmatrix = (byte*)Z_Malloc( rejectlength, PU_LEVEL, nullptr );
+
+		// Rows don't start on byte boundaries, so jobs get split by bytes
+		constexpr int32_t BytesPerJob = 16384;
+		byte* reject = _rejectmatrix;
+		JobGroup rejectjobs;
+		for( int32_t jobstart = 0; jobstart < rejectlength; jobstart += BytesPerJob )
+		{
+			int32_t jobend = M_MIN( jobstart + BytesPerJob, rejectlength );
+			jobs->AddJob( rejectjobs, [ reject, &group, numsectors, jobstart, jobend ]()
+			{
+				int64_t bit = (int64_t)jobstart * 8;
+				int32_t from = (int32_t)( bit / numsectors );
+				int32_t to = (int32_t)( bit % numsectors );
+				int64_t totalbits = (int64_t)numsectors * numsectors;
+
+				for( int32_t bytenum : iota( jobstart, jobend ) )
+				{
+					byte val = 0;
+					for( int32_t bitnum = 0; bitnum < 8 && bit < totalbits; ++bitnum, ++bit )
+					{
+						if( group[ from ] != group[ to ] )
+						{
+							val |= 1 << bitnum;
+						}
+
+						if( ++to == numsectors )
+						{
+							to = 0;
+							++from;
+						}
+					}
+					reject[ bytenum ] = val;
+				}
+			} );
+		}
+
+		jobs->Flush( rejectjobs );
+	}
+
+	void INLINE LoadExtendedReject( int32_t lumpnum )
+	{
+		int32_t minlength = (int32_t)( ( (int64_t)_numsectors * _numsectors + 7 ) / 8 );
+		int32_t lumplen = W_LumpLength( lumpnum );
+
+		//!
+		// @category mod
+		//
+		// Don't generate a REJECT table for maps that are missing one or
+		// ship an empty one.
+		//
+		if( M_ParmExists( "-nobuildreject" ) )
+		{
+			LoadReject( lumpnum );
+			return;
+		}
+
+		if( lumplen >= minlength )
+		{
+			byte* lumpdata = (byte*)W_CacheLumpNum( lumpnum, PU_STATIC );
+			bool empty = std::all_of( lumpdata, lumpdata + minlength, []( byte val ) { return val == 0; } );
+			W_ReleaseLumpNum( lumpnum );
+
+			if( !empty )
+			{
+				LoadReject( lumpnum );
+				return;
+			}
+
+			I_LogAddEntry( Log_System, "Empty REJECT detected, proceeding with rebuild" );
+		}
+		else
+		{
+			I_LogAddEntry( Log_System, "Missing or truncated REJECT detected, proceeding with rebuild" );
+		}
+
+		int32_t cachedlength = 0;
+		_rejectmatrix = LoadMapCache< byte >( "reject", cachedlength );
+		if( _rejectmatrix != nullptr && cachedlength == minlength )
+		{
+			I_LogAddEntry( Log_System, "Using cached REJECT" );
+			return;
+		}
+		else if( _rejectmatrix != nullptr )
+		{
+			Z_Free( _rejectmatrix );
+		}
+
+		BuildReject();
+		SaveMapCache( "reject", _rejectmatrix, minlength );
+	}
+
 	void INLINE LoadReject( int32_t lumpnum )
 	{
 		// Calculate the size that the REJECT lump *should* be.
@@ -1197,19 +1919,19 @@ struct DoomMapLoader
 			byte* dest = _rejectmatrix + lumplen;
 			int32_t length = minlength - lumplen;
 #ifdef SYS_BIG_ENDIAN
-			for( int32_t index : std::iota( 0, M_MIN( length, sizeof( rejectpad ) ) ) )
+			for( int32_t index : std::iota( 0, M_MIN( length, (int32_t)sizeof( rejectpad ) ) ) )
 			{
 				byte_num = i % 4;
 				*dest = (rejectpad[i / 4] >> (byte_num * 8)) & 0xff;
 				++dest;
 			}
 #else
-			memcpy( dest, rejectpad, M_MIN( length, sizeof( rejectpad ) ) );
+			memcpy( dest, rejectpad, M_MIN( length, (int32_t)sizeof( rejectpad ) ) );
 #endif
 
 			// We only have a limited pad size.  Print a warning if the
 			// REJECT lump is too small.
-			if( length > sizeof( rejectpad ) )
+			if( length > (int32_t)sizeof( rejectpad ) )
 			{
 				fprintf(stderr, "PadRejectArray: REJECT lump too short to pad! (%u > %i)\n",
 								length, (int32_t)sizeof( rejectpad ) );
@@ -1444,6 +2166,7 @@ P_SetupLevel
     // UNUSED W_Profile ();
 	R_InitSkiesForLevel();
     P_InitThinkers ();
+	P_DirtyAllInstances();
 
     // if working with a devlopment map, reload it
     W_Reload ();
@@ -1495,7 +2218,7 @@ P_SetupLevel
 			loader.LoadExtendedSubsectors( lumpnum + ML_SSECTORS );
 			loader.LoadExtendedSegs( lumpnum + ML_SEGS );
 			loader.GroupLines();
-			loader.LoadReject( lumpnum + ML_REJECT );
+			loader.LoadExtendedReject( lumpnum + ML_REJECT );
 		}
 		break;
 
@@ -28,6 +28,11 @@
 // State.
 #include "r_state.h"
 
+#include "m_profile.h"
+
+#include <algorithm>
+#include <vector>
+
 //
 // P_CheckSight
 //
@@ -42,6 +47,73 @@ extern "C"
 	fixed_t		t2y;
 }
 
+// Everything one traversal touches lives here instead of in the globals
+// above, so that batched checks can run on the job system. Worker threads
+// can't write to line_t::validcount, so they keep their own stamps.
+constexpr int32_t MaxSightPathSectors = 16;
+
+typedef struct sighttrace_s
+{
+	fixed_t		sightzstart;
+	fixed_t		topslope;
+	fixed_t		bottomslope;
+
+	divline_t	strace;
+	fixed_t		t2x;
+	fixed_t		t2y;
+
+	int32_t*	linestamps;
+	int32_t		stamp;
+
+	// Sectors whose heights the result depends on. -1 when there
+	// are more than will fit, and any moving sector invalidates it.
+	int32_t		numpathsectors;
+	int32_t		pathsectors[ MaxSightPathSectors ];
+} sighttrace_t;
+
+typedef struct sightkey_s
+{
+	fixed_t		x1;
+	fixed_t		y1;
+	fixed_t		z1;
+	fixed_t		height1;
+	fixed_t		x2;
+	fixed_t		y2;
+	fixed_t		z2;
+	fixed_t		height2;
+
+	constexpr bool operator==( const sightkey_s& rhs ) const = default;
+} sightkey_t;
+
+typedef struct sightcacheentry_s
+{
+	sightkey_t	key;
+	uint32_t	batch;
+	uint32_t	movesequence;
+	doombool	result;
+	fixed_t		topslope;
+	fixed_t		bottomslope;
+	int32_t		numpathsectors;
+	int32_t		pathsectors[ MaxSightPathSectors ];
+} sightcacheentry_t;
+
+typedef struct sightquery_s
+{
+	mobj_t*				t1;
+	mobj_t*				t2;
+	sightcacheentry_t	entry;
+} sightquery_t;
+
+// Batching only pays for itself once there's enough work to spread around
+constexpr int32_t	MinSightBatchQueries	= 64;
+constexpr int32_t	SightQueriesPerJob		= 32;
+
+static std::vector< sightcacheentry_t >	sightcache;
+static std::vector< sightquery_t >		sightqueries;
+static std::vector< uint32_t >			sectormovesequence;
+static uint32_t							sightmovesequence = 0;
+static uint32_t							sightbatch = 0;
+
 // PTR_SightTraverse() for Doom 1.2 sight calculations
 // taken from prboom-plus/src/p_sight.c:69-102
 static doombool PTR_SightTraverse(intercept_t *in)
@@ -168,7 +240,7 @@ P_InterceptVector2
 // Returns true
 //  if strace crosses the given subsector successfully.
 //
-static doombool P_CrossSubsector (int num)
+static doombool P_CrossSubsector (sighttrace_t& trace, int num)
 {
     seg_t*		seg;
     line_t*		line;
@@ -204,15 +276,25 @@ static doombool P_CrossSubsector (int num)
 	line = seg->linedef;
 
 	// allready checked other side?
-	if (line->validcount == validcount)
-	    continue;
+	if (trace.linestamps != nullptr)
+	{
+	    if (trace.linestamps[line->index] == trace.stamp)
+		continue;
+
+	    trace.linestamps[line->index] = trace.stamp;
+	}
+	else
+	{
+	    if (line->validcount == validcount)
+		continue;
 	
-	line->validcount = validcount;
+	    line->validcount = validcount;
+	}
 
 	v1 = line->v1;
 	v2 = line->v2;
-	s1 = P_DivlineSide (v1->x,v1->y, &strace);
-	s2 = P_DivlineSide (v2->x, v2->y, &strace);
+	s1 = P_DivlineSide (v1->x,v1->y, &trace.strace);
+	s2 = P_DivlineSide (v2->x, v2->y, &trace.strace);
 
 	// line isn't crossed?
 	if (s1 == s2)
@@ -222,8 +304,8 @@ static doombool P_CrossSubsector (int num)
 	divl.y = v1->y;
 	divl.dx = v2->x - v1->x;
 	divl.dy = v2->y - v1->y;
-	s1 = P_DivlineSide (strace.x, strace.y, &divl);
-	s2 = P_DivlineSide (t2x, t2y, &divl);
+	s1 = P_DivlineSide (trace.strace.x, trace.strace.y, &divl);
+	s2 = P_DivlineSide (trace.t2x, trace.t2y, &divl);
 
 	// line isn't crossed?
 	if (s1 == s2)
@@ -246,6 +328,19 @@ static doombool P_CrossSubsector (int num)
 	front = seg->frontsector;
 	back = seg->backsector;
 
+	if (trace.numpathsectors >= 0)
+	{
+	    if (trace.numpathsectors + 2 > MaxSightPathSectors)
+	    {
+		trace.numpathsectors = -1;
+	    }
+	    else
+	    {
+		trace.pathsectors[trace.numpathsectors++] = front->index;
+		trace.pathsectors[trace.numpathsectors++] = back->index;
+	    }
+	}
+
 	// no wall to block sight with?
 	if (front->floorheight == back->floorheight
 	    && front->ceilingheight == back->ceilingheight)
@@ -268,23 +363,23 @@ static doombool P_CrossSubsector (int num)
 	if (openbottom >= opentop)	
 	    return false;		// stop
 	
-	frac = P_InterceptVector2 (&strace, &divl);
+	frac = P_InterceptVector2 (&trace.strace, &divl);
 		
 	if (front->floorheight != back->floorheight)
 	{
-	    slope = FixedDiv (openbottom - sightzstart , frac);
-	    if (slope > bottomslope)
-		bottomslope = slope;
+	    slope = FixedDiv (openbottom - trace.sightzstart , frac);
+	    if (slope > trace.bottomslope)
+		trace.bottomslope = slope;
 	}
 		
 	if (front->ceilingheight != back->ceilingheight)
 	{
-	    slope = FixedDiv (opentop - sightzstart , frac);
-	    if (slope < topslope)
-		topslope = slope;
+	    slope = FixedDiv (opentop - trace.sightzstart , frac);
+	    if (slope < trace.topslope)
+		trace.topslope = slope;
 	}
 		
-	if (topslope <= bottomslope)
+	if (trace.topslope <= trace.bottomslope)
 	    return false;		// stop				
     }
     // passed the subsector ok
@@ -298,7 +393,7 @@ static doombool P_CrossSubsector (int num)
 // Returns true
 //  if strace crosses the given node successfully.
 //
-static doombool P_CrossBSPNode (int bspnum)
+static doombool P_CrossBSPNode (sighttrace_t& trace, int bspnum)
 {
     node_t*	bsp;
     int		side;
@@ -306,9 +401,9 @@ static doombool P_CrossBSPNode (int bspnum)
     if (bspnum & NF_SUBSECTOR)
     {
 	if (bspnum == -1)
-	    return P_CrossSubsector (0);
+	    return P_CrossSubsector (trace, 0);
 	else
-	    return P_CrossSubsector (bspnum&(~NF_SUBSECTOR));
+	    return P_CrossSubsector (trace, bspnum&(~NF_SUBSECTOR));
     }
 		
     bsp = &nodes[bspnum];
@@ -317,23 +412,256 @@ static doombool P_CrossBSPNode (int bspnum)
 	// Redo this at some reasonable point please.
 
     // decide which side the start point is on
-    side = P_DivlineSide (strace.x, strace.y, &bsp->divline);
+    side = P_DivlineSide (trace.strace.x, trace.strace.y, &bsp->divline);
     if (side == 2)
 	side = 0;	// an "on" should cross both sides
 
     // cross the starting side
-    if (!P_CrossBSPNode (bsp->children[side]) )
+    if (!P_CrossBSPNode (trace, bsp->children[side]) )
 	return false;
 	
     // the partition plane is crossed here
-    if (side == P_DivlineSide (t2x, t2y,&bsp->divline))
+    if (side == P_DivlineSide (trace.t2x, trace.t2y,&bsp->divline))
     {
 	// the line doesn't touch the other side
 	return true;
     }
     
     // cross the ending side		
-    return P_CrossBSPNode (bsp->children[side^1]);
+    return P_CrossBSPNode (trace, bsp->children[side^1]);
+}
+
+static INLINE sightkey_t P_SightKey( mobj_t* t1, mobj_t* t2 )
+{
+	return { t1->x, t1->y, t1->z, t1->height, t2->x, t2->y, t2->z, t2->height };
+}
+
+static INLINE uint32_t P_SightHash( const sightkey_t& key )
+{
+	uint32_t hash = 2166136261u;
+	for( fixed_t val : { key.x1, key.y1, key.z1, key.height1, key.x2, key.y2, key.z2, key.height2 } )
+	{
+		hash = ( hash ^ (uint32_t)val ) * 16777619u;
+	}
+	return hash;
+}
+
+static void P_SightSetupTrace( sighttrace_t& trace, mobj_t* t1, mobj_t* t2 )
+{
+	trace.sightzstart = t1->z + t1->height - (t1->height>>2);
+	trace.topslope = (t2->z+t2->height) - trace.sightzstart;
+	trace.bottomslope = (t2->z) - trace.sightzstart;
+
+	trace.strace.x = t1->x;
+	trace.strace.y = t1->y;
+	trace.t2x = t2->x;
+	trace.t2y = t2->y;
+	trace.strace.dx = t2->x - t1->x;
+	trace.strace.dy = t2->y - t1->y;
+
+	trace.numpathsectors = 0;
+}
+
+static void P_SightFillEntry( sightcacheentry_t& entry, const sighttrace_t& trace, doombool result )
+{
+	entry.batch = sightbatch;
+	entry.movesequence = sightmovesequence;
+	entry.result = result;
+	entry.topslope = trace.topslope;
+	entry.bottomslope = trace.bottomslope;
+	entry.numpathsectors = trace.numpathsectors;
+	if( trace.numpathsectors > 0 )
+	{
+		std::copy( trace.pathsectors, trace.pathsectors + trace.numpathsectors, entry.pathsectors );
+	}
+}
+
+static INLINE doombool P_SightEntryValid( const sightcacheentry_t& entry, const sightkey_t& key )
+{
+	if( entry.batch != sightbatch || !( entry.key == key ) )
+	{
+		return false;
+	}
+
+	if( entry.numpathsectors < 0 )
+	{
+		return entry.movesequence == sightmovesequence;
+	}
+
+	for( int32_t sector : std::span( entry.pathsectors, entry.numpathsectors ) )
+	{
+		if( sectormovesequence[ sector ] > entry.movesequence )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void P_SightCacheStore( const sightcacheentry_t& entry )
+{
+	if( !sightcache.empty() )
+	{
+		sightcache[ P_SightHash( entry.key ) & ( sightcache.size() - 1 ) ] = entry;
+	}
+}
+
+//
+// P_SightSectorMoved
+// Any cached sight check that crossed this sector can't be trusted anymore.
+//
+DOOM_C_API void P_SightSectorMoved( sector_t* sector )
+{
+	++sightmovesequence;
+	if( sector->index < (int32_t)sectormovesequence.size() )
+	{
+		sectormovesequence[ sector->index ] = sightmovesequence;
+	}
+}
+
+static void P_SightAddQuery( mobj_t* t1, mobj_t* t2 )
+{
+	if( t2 == nullptr || t1 == t2 )
+	{
+		return;
+	}
+
+	// Same early out as P_CheckSight, no point traversing these
+	int32_t pnum = t1->subsector->sector->index * numsectors + t2->subsector->sector->index;
+	if( rejectmatrix[ pnum >> 3 ] & ( 1 << ( pnum & 7 ) ) )
+	{
+		return;
+	}
+
+	sightquery_t& query = sightqueries.emplace_back();
+	query.t1 = t1;
+	query.t2 = t2;
+	query.entry.key = P_SightKey( t1, t2 );
+}
+
+static void P_SightRunQueries( sightquery_t* begin, sightquery_t* end )
+{
+	thread_local std::vector< int32_t > linestamps;
+	thread_local int32_t stamp = 0;
+
+	if( linestamps.size() != (size_t)numlines )
+	{
+		linestamps.assign( numlines, 0 );
+		stamp = 0;
+	}
+
+	sighttrace_t trace = {};
+	trace.linestamps = linestamps.data();
+
+	for( sightquery_t& query : std::span( begin, end ) )
+	{
+		trace.stamp = ++stamp;
+		P_SightSetupTrace( trace, query.t1, query.t2 );
+		doombool result = P_CrossBSPNode( trace, numnodes - 1 );
+		P_SightFillEntry( query.entry, trace, result );
+	}
+}
+
+//
+// P_SightNewTic
+// Cached results never outlive the tic they were made in.
+//
+DOOM_C_API void P_SightNewTic( void )
+{
+	++sightbatch;
+
+	if( sectormovesequence.size() != (size_t)numsectors )
+	{
+		sectormovesequence.assign( numsectors, 0 );
+	}
+}
+
+//
+// P_SightBatchTic
+// Works out the sight checks that the mobjs from first onwards are
+// about to make and traverses them all on the job system. P_RunThinkers
+// calls this once every player has moved, since they're the targets
+// most likely to shift before the checks happen. Results are only used
+// when the same positions get checked again and none of the sectors
+// crossed have moved since, so nothing changes for demos.
+//
+DOOM_C_API void P_SightBatchTic( thinker_t* first )
+{
+	M_PROFILE_FUNC();
+
+	// Doom 1.2 sight goes through P_PathTraverse and its global intercepts
+	if( gameversion <= exe_doom_1_2 )
+	{
+		return;
+	}
+
+	sightqueries.clear();
+
+	for( thinker_t* thinker = first; thinker != &thinkercap; thinker = thinker->next )
+	{
+		// Actions only run when a state ends, so only monsters about
+		// to switch state this tic can go looking for anything
+		mobj_t* mobj = thinker_cast< mobj_t >( thinker );
+		if( mobj == nullptr
+			|| mobj->tics != 1
+			|| mobj->health <= 0
+			|| mobj->info->seestate == S_NULL )
+		{
+			continue;
+		}
+
+		if( mobj->target && ( mobj->target->flags & MF_SHOOTABLE ) )
+		{
+			P_SightAddQuery( mobj, mobj->target );
+		}
+		else
+		{
+			for( int32_t player : iota( 0, MAXPLAYERS ) )
+			{
+				if( playeringame[ player ] && players[ player ].health > 0 )
+				{
+					P_SightAddQuery( mobj, players[ player ].mo );
+				}
+			}
+		}
+
+		mobj_t* soundtarget = mobj->subsector->sector->soundtarget;
+		if( ( mobj->flags & MF_AMBUSH ) && soundtarget && soundtarget != mobj->target )
+		{
+			P_SightAddQuery( mobj, soundtarget );
+		}
+	}
+
+	size_t cachesize = 1024;
+	while( cachesize < sightqueries.size() * 2 )
+	{
+		cachesize <<= 1;
+	}
+
+	if( sightcache.size() != cachesize )
+	{
+		sightcache.assign( cachesize, {} );
+	}
+
+	if( (int32_t)sightqueries.size() < MinSightBatchQueries )
+	{
+		return;
+	}
+
+	{
+		M_PROFILE_NAMED( "Sight checks" );
+		sightquery_t* queries = sightqueries.data();
+		jobs->ParallelFor( 0, (int32_t)sightqueries.size(), SightQueriesPerJob, [ queries ]( int32_t begin, int32_t end )
+		{
+			P_SightRunQueries( queries + begin, queries + end );
+		} );
+	}
+
+	for( sightquery_t& query : sightqueries )
+	{
+		P_SightCacheStore( query.entry );
+	}
 }
 
 
@@ -378,15 +706,39 @@ P_CheckSight
                               PT_EARLYOUT | PT_ADDLINES, PTR_SightTraverse);
     }
 
-    strace.x = t1->x;
-    strace.y = t1->y;
-    t2x = t2->x;
-    t2y = t2->y;
-    strace.dx = t2->x - t1->x;
-    strace.dy = t2->y - t1->y;
+	sighttrace_t trace = {};
+	P_SightSetupTrace( trace, t1, t2 );
+
+    strace = trace.strace;
+    t2x = trace.t2x;
+    t2y = trace.t2y;
+
+	sightcacheentry_t entry = {};
+	entry.key = P_SightKey( t1, t2 );
+
+	// A hit leaves line_t::validcount unstamped. Every walk bumps
+	// validcount before comparing against it, so nothing can tell.
+	if( !sightcache.empty() )
+	{
+		const sightcacheentry_t& cached = sightcache[ P_SightHash( entry.key ) & ( sightcache.size() - 1 ) ];
+		if( P_SightEntryValid( cached, entry.key ) )
+		{
+			topslope = cached.topslope;
+			bottomslope = cached.bottomslope;
+			return cached.result;
+		}
+	}
 
     // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);	
+	doombool result = P_CrossBSPNode( trace, numnodes-1 );
+
+	topslope = trace.topslope;
+	bottomslope = trace.bottomslope;
+
+	P_SightFillEntry( entry, trace, result );
+	P_SightCacheStore( entry );
+
+    return result;
 }
 
 
@@ -1376,6 +1376,11 @@ void P_UpdateSpecials (void)
 				texturetranslation[ i + numtextures ] = numtextures + pic;
 			}
 		}
+
+		if( leveltime % anim->speed == 0 )
+		{
+			P_DirtyAnimatedInstances();
+		}
 	}
 
     
@@ -1386,6 +1391,7 @@ void P_UpdateSpecials (void)
 
 		line->frontside->textureoffset += line->scrollratex;
 		line->frontside->rowoffset += line->scrollratey;
+		P_DirtySide( line->frontside );
 
 	}
 
@@ -1414,6 +1420,7 @@ void P_UpdateSpecials (void)
 			buttonlist[i].btexture;
 		    break;
 		}
+		P_DirtySide( &sides[buttonlist[i].line->sidenum[0]] );
 		S_StartSound(&buttonlist[i].soundorg,sfx_swtchn);
 		memset(&buttonlist[i],0,sizeof(button_t));
 	    }
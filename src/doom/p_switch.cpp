@@ -259,6 +259,7 @@ P_ChangeSwitchTexture
 	{
 	    S_StartSound(buttonlist->soundorg,sound);
 	    sides[line->sidenum[0]].toptexture = switchlist[i^1];
+	    P_DirtySide( &sides[line->sidenum[0]] );
 
 	    if (useAgain)
 		P_StartButton(line,top,switchlist[i],BUTTONTIME);
@@ -271,6 +272,7 @@ P_ChangeSwitchTexture
 	    {
 		S_StartSound(buttonlist->soundorg,sound);
 		sides[line->sidenum[0]].midtexture = switchlist[i^1];
+		P_DirtySide( &sides[line->sidenum[0]] );
 
 		if (useAgain)
 		    P_StartButton(line, middle,switchlist[i],BUTTONTIME);
@@ -283,6 +285,7 @@ P_ChangeSwitchTexture
 		{
 		    S_StartSound(buttonlist->soundorg,sound);
 		    sides[line->sidenum[0]].bottomtexture = switchlist[i^1];
+		    P_DirtySide( &sides[line->sidenum[0]] );
 
 		    if (useAgain)
 			P_StartButton(line, bottom,switchlist[i],BUTTONTIME);
@@ -20,13 +20,22 @@
 
 
 #include "z_zone.h"
+#include "i_log.h"
 #include "p_local.h"
 
 #include "doomstat.h"
 
+#include <numeric>
+#include <span>
+#include <vector>
 
 uint64_t	leveltime;
 
+// Per-object loops get handed to the job system in chunks this big
+constexpr int32_t MobjsPerSortJob = 64;
+constexpr int32_t SectorsPerInstanceJob = 256;
+constexpr int32_t SidesPerInstanceJob = 512;
+
 //
 // THINKERS
 // All thinkers should be allocated by Z_Malloc
@@ -43,6 +52,40 @@ extern "C"
 	thinker_t	thinkercap;
 }
 
+ThinkerRegistry< mobj_t >		mobjthinkers;
+
+// Parallels mobjthinkers
+static std::vector< mobjrender_t > mobjrenderstorage;
+mobjrender_t* mobjrenders = nullptr;
+
+//
+// P_RegisterThinker
+// Mobjs get their think function after P_AddThinker, so anything that
+// can't be sorted in to the registry straight away gets another go when
+// P_RunThinkers comes across it.
+//
+static void P_RegisterThinker( thinker_t* thinker )
+{
+	if( thinker_cast< mobj_t >( thinker ) )
+	{
+		mobjthinkers.Add( (mobj_t*)thinker );
+		if( mobjthinkers.Capacity() > (int32_t)mobjrenderstorage.size() )
+		{
+			mobjrenderstorage.resize( mobjthinkers.Capacity() );
+			mobjrenders = mobjrenderstorage.data();
+		}
+		mobjrenders[ thinker->registryslot ] = {};
+	}
+}
+
+static void P_UnregisterThinker( thinker_t* thinker )
+{
+	if( thinker->registryslot >= 0 )
+	{
+		mobjthinkers.Remove( (mobj_t*)thinker );
+	}
+}
+
 
 //
 // P_InitThinkers
@@ -50,6 +93,11 @@ extern "C"
 DOOM_C_API void P_InitThinkers (void)
 {
     thinkercap.prev = thinkercap.next  = &thinkercap;
+
+	mobjthinkers.Clear();
+
+	mobjrenderstorage.clear();
+	mobjrenders = nullptr;
 }
 
 
@@ -65,6 +113,9 @@ DOOM_C_API void P_AddThinker (thinker_t* thinker)
     thinker->next = &thinkercap;
     thinker->prev = thinkercap.prev;
     thinkercap.prev = thinker;
+
+	thinker->registryslot = -1;
+	P_RegisterThinker( thinker );
 }
 
 
@@ -76,6 +127,7 @@ DOOM_C_API void P_AddThinker (thinker_t* thinker)
 //
 DOOM_C_API void P_RemoveThinker (thinker_t* thinker)
 {
+	P_UnregisterThinker( thinker );
 	thinker->function = nullptr;
 }
 
@@ -86,6 +138,22 @@ void P_RunThinkers (void)
 {
     thinker_t *currentthinker, *nextthinker;
 
+	// Player mobjs only move when their own thinkers run, so sight
+	// checks get batched straight after the last of them
+	int32_t pendingplayers = 0;
+	for( int32_t player : iota( 0, MAXPLAYERS ) )
+	{
+		if( playeringame[ player ] && players[ player ].mo != nullptr )
+		{
+			++pendingplayers;
+		}
+	}
+
+	if( pendingplayers == 0 )
+	{
+		P_SightBatchTic( thinkercap.next );
+	}
+
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
     {
@@ -101,22 +169,289 @@ void P_RunThinkers (void)
 		else
 		{
 			M_PROFILE_NAMED( "Run thinker" );
+			if( currentthinker->registryslot < 0 )
+			{
+				P_RegisterThinker( currentthinker );
+			}
+
 			if( currentthinker->function.Enabled() )
 			{
 				currentthinker->function(currentthinker);
 			}
 
-			if( mobj_t* mobj = thinker_cast< mobj_t >( currentthinker ) )
+			mobj_t* mobj = thinker_cast< mobj_t >( currentthinker );
+			if( pendingplayers > 0
+				&& mobj != nullptr
+				&& mobj->player != nullptr
+				&& mobj->player->mo == mobj
+				&& --pendingplayers == 0 )
 			{
-				if( !( mobj->flags & MF_NOSECTOR ) )
-				{
-					jobs->AddJob( [mobj]() { P_SortMobj( mobj ); } );
-				}
+				P_SightBatchTic( nextthinker );
 			}
 		}
 
 		currentthinker = nextthinker;
     }
+
+	// Sorting only once every thinker has run means nothing can move a
+	// mobj out from under its sort
+	{
+		M_PROFILE_NAMED( "Sort mobjs" );
+		std::span< mobj_t* > mobjs = mobjthinkers.Slots();
+		jobs->ParallelFor( 0, (int32_t)mobjs.size(), MobjsPerSortJob, [ mobjs ]( int32_t begin, int32_t end )
+		{
+			for( mobj_t* mobj : mobjs.subspan( begin, end - begin ) )
+			{
+				if( mobj && !( mobj->flags & MF_NOSECTOR ) )
+				{
+					P_SortMobj( mobj );
+				}
+			}
+		} );
+	}
+}
+
+//
+// Instance data
+// Only sectors and sides that have been marked dirty get copied in to
+// the instance buffers. The buffers swap every tic, so a change has to
+// land in both of them: a mark holds for the update after it's made
+// and the one after that. Anything that can't be bothered marking what
+// it touched can ask for everything to be rebuilt instead.
+//
+doombool verifyinstancedata = false;
+
+static std::vector< int32_t >		dirtysectors;
+static std::vector< int32_t >		lastdirtysectors;
+static std::vector< uint32_t >		sectordirtystamps;
+static std::vector< int32_t >		dirtysides;
+static std::vector< int32_t >		lastdirtysides;
+static std::vector< uint32_t >		sidedirtystamps;
+static uint32_t						dirtygeneration = 1;
+
+// Sectors borrowing another sector's light, indexed by the lender
+static std::vector< int32_t >		lightdependentstart;
+static std::vector< int32_t >		lightdependents;
+
+static std::vector< int32_t >		updatesectors;
+static std::vector< int32_t >		updatesides;
+
+static int32_t						fullinstancerebuilds = 0;
+static doombool						instanceflipped = false;
+static doombool						animatedinstances = false;
+
+DOOM_C_API void P_DirtySector( sector_t* sector )
+{
+	// Nothing to track against until the first full rebuild
+	if( sectordirtystamps.empty() )
+	{
+		return;
+	}
+
+	auto Mark = []( int32_t index )
+	{
+		if( sectordirtystamps[ index ] != dirtygeneration )
+		{
+			sectordirtystamps[ index ] = dirtygeneration;
+			dirtysectors.push_back( index );
+		}
+	};
+
+	Mark( sector->index );
+	for( int32_t index = lightdependentstart[ sector->index ]; index < lightdependentstart[ sector->index + 1 ]; ++index )
+	{
+		Mark( lightdependents[ index ] );
+	}
+}
+
+DOOM_C_API void P_DirtySide( side_t* side )
+{
+	if( sidedirtystamps.empty() )
+	{
+		return;
+	}
+
+	if( sidedirtystamps[ side->index ] != dirtygeneration )
+	{
+		sidedirtystamps[ side->index ] = dirtygeneration;
+		dirtysides.push_back( side->index );
+	}
+}
+
+DOOM_C_API void P_DirtyAnimatedInstances( void )
+{
+	animatedinstances = true;
+}
+
+DOOM_C_API void P_DirtyAllInstances( void )
+{
+	fullinstancerebuilds = 2;
+	animatedinstances = false;
+
+	dirtysectors.clear();
+	lastdirtysectors.clear();
+	sectordirtystamps.clear();
+	dirtysides.clear();
+	lastdirtysides.clear();
+	sidedirtystamps.clear();
+}
+
+static void P_BuildLightDependents( void )
+{
+	lightdependentstart.assign( numsectors + 1, 0 );
+	lightdependents.clear();
+
+	for( sector_t& sector : std::span( sectors, numsectors ) )
+	{
+		if( sector.floorlightsec != &sector )
+		{
+			++lightdependentstart[ sector.floorlightsec->index + 1 ];
+		}
+		if( sector.ceilinglightsec != &sector && sector.ceilinglightsec != sector.floorlightsec )
+		{
+			++lightdependentstart[ sector.ceilinglightsec->index + 1 ];
+		}
+	}
+
+	for( int32_t index : iota( 0, numsectors ) )
+	{
+		lightdependentstart[ index + 1 ] += lightdependentstart[ index ];
+	}
+
+	lightdependents.resize( lightdependentstart[ numsectors ] );
+	std::vector< int32_t > next( lightdependentstart.begin(), lightdependentstart.end() - 1 );
+
+	for( sector_t& sector : std::span( sectors, numsectors ) )
+	{
+		if( sector.floorlightsec != &sector )
+		{
+			lightdependents[ next[ sector.floorlightsec->index ]++ ] = sector.index;
+		}
+		if( sector.ceilinglightsec != &sector && sector.ceilinglightsec != sector.floorlightsec )
+		{
+			lightdependents[ next[ sector.ceilinglightsec->index ]++ ] = sector.index;
+		}
+	}
+}
+
+static void P_FillSectorInstance( const sector_t& sec, sectorinstance_t& inst )
+{
+	inst.floortex			= flatlookup[ flattranslation[ sec.floorpic ] ];
+	inst.ceiltex			= flatlookup[ flattranslation[ sec.ceilingpic ] ];
+	inst.colormap			= sec.colormap;
+	inst.floorheight		= inst.midtexfloor = FixedToRendFixed( sec.floorheight );
+	inst.ceilheight			= inst.midtexceil = FixedToRendFixed( sec.ceilingheight );
+	inst.lightlevel			= sec.lightlevel;
+	inst.floorlightlevel	= sec.floorlightsec->lightlevel;
+	inst.ceillightlevel		= sec.ceilinglightsec->lightlevel;
+	inst.flooroffsetx		= FixedToRendFixed( sec.flooroffsetx );
+	inst.flooroffsety		= FixedToRendFixed( sec.flooroffsety );
+	inst.ceiloffsetx		= FixedToRendFixed( sec.ceiloffsetx );
+	inst.ceiloffsety		= FixedToRendFixed( sec.ceiloffsety );
+	inst.floorrotation		= sec.floorrotation;
+	inst.ceilrotation		= sec.ceilrotation;
+	inst.snapfloor			= sec.snapfloor;
+	inst.snapceiling		= sec.snapceiling;
+	inst.activethisframe	= sec.lastactivetic == gametic
+							|| sec.floorlightsec->lastactivetic == gametic
+							|| sec.ceilinglightsec->lastactivetic == gametic;
+}
+
+static void P_FillSideInstance( const side_t& side, sideinstance_t& inst )
+{
+	inst.toptex		= side.toptexture ? texturelookup[ texturetranslation[ side.toptexture ] ] : NULL;
+	inst.midtex		= side.midtexture ? texturelookup[ texturetranslation[ side.midtexture ] ] : NULL;
+	inst.bottomtex	= side.bottomtexture ? texturelookup[ texturetranslation[ side.bottomtexture ] ] : NULL;
+	inst.coloffset	= FixedToRendFixed( side.textureoffset );
+	inst.rowoffset	= FixedToRendFixed( side.rowoffset );
+}
+
+static void P_FillMobjInstance( const mobj_t& mobj, mobjinstance_t& inst )
+{
+	inst.x			= FixedToRendFixed( mobj.x );
+	inst.y			= FixedToRendFixed( mobj.y );
+	inst.z			= FixedToRendFixed( mobj.z );
+	inst.angle		= mobj.angle;
+	inst.sprite		= mobj.sprite;
+	inst.frame		= mobj.frame;
+	inst.teleported	= mobj.teleporttic == gametic;
+}
+
+//
+// P_DirtyAnimatedTextures
+// Flat and texture animations swap out translations rather than touch
+// any sectors or sides, so the only way to find out who they changed is
+// to go looking. Still a lot cheaper than rewriting everything.
+//
+static void P_DirtyAnimatedTextures( void )
+{
+	M_PROFILE_FUNC();
+
+	for( int32_t index : iota( 0, numsectors ) )
+	{
+		const sector_t& sec = sectors[ index ];
+		if( currsectors[ index ].floortex != flatlookup[ flattranslation[ sec.floorpic ] ]
+			|| currsectors[ index ].ceiltex != flatlookup[ flattranslation[ sec.ceilingpic ] ] )
+		{
+			P_DirtySector( &sectors[ index ] );
+		}
+	}
+
+	for( int32_t index : iota( 0, numsides ) )
+	{
+		sideinstance_t expected = currsides[ index ];
+		P_FillSideInstance( sides[ index ], expected );
+		if( expected.toptex != currsides[ index ].toptex
+			|| expected.midtex != currsides[ index ].midtex
+			|| expected.bottomtex != currsides[ index ].bottomtex )
+		{
+			P_DirtySide( &sides[ index ] );
+		}
+	}
+}
+
+//
+// P_VerifyInstanceData
+// Rebuilds everything from scratch and compares it against what the
+// incremental update came up with. Anything that doesn't match is
+// something that changed without marking itself dirty.
+//
+static void P_VerifyInstanceData( void )
+{
+	M_PROFILE_FUNC();
+
+	for( int32_t index : iota( 0, numsectors ) )
+	{
+		sectorinstance_t expected = currsectors[ index ];
+		P_FillSectorInstance( sectors[ index ], expected );
+		if( memcmp( &expected, &currsectors[ index ], sizeof( sectorinstance_t ) ) != 0 )
+		{
+			I_LogAddEntryVar( Log_Warning, "P_VerifyInstanceData: Sector %d is stale on tic %llu", index, (unsigned long long)gametic );
+		}
+	}
+
+	for( int32_t index : iota( 0, numsides ) )
+	{
+		sideinstance_t expected = currsides[ index ];
+		P_FillSideInstance( sides[ index ], expected );
+		if( memcmp( &expected, &currsides[ index ], sizeof( sideinstance_t ) ) != 0 )
+		{
+			I_LogAddEntryVar( Log_Warning, "P_VerifyInstanceData: Side %d is stale on tic %llu", index, (unsigned long long)gametic );
+		}
+	}
+
+	for( mobj_t* mobj : mobjthinkers.Slots() )
+	{
+		if( mobj )
+		{
+			mobjinstance_t expected = {};
+			P_FillMobjInstance( *mobj, expected );
+			if( memcmp( &expected, &mobj->Render().curr, sizeof( mobjinstance_t ) ) != 0 )
+			{
+				I_LogAddEntryVar( Log_Warning, "P_VerifyInstanceData: Mobj %d is stale on tic %llu", mobj->thinker.registryslot, (unsigned long long)gametic );
+			}
+		}
+	}
 }
 
 void P_FlipInstanceData( void )
@@ -134,11 +469,20 @@ void P_FlipInstanceData( void )
 	currsides = prevsides;
 	prevsides = tempside;
 
-	for( thinker_t* th = thinkercap.next; th != &thinkercap; th = th->next )
+	instanceflipped = true;
+
+	mobjthinkers.Recycle();
+
+	for( mobj_t* mobj : mobjthinkers.Slots() )
 	{
-		if( mobj_t* mobj = thinker_cast< mobj_t >( th ) )
+		if( mobj )
 		{
-			mobj->prev = mobj->curr;
+			// Still things are the vast majority, don't dirty their cache lines for nothing
+			mobjrender_t& render = mobj->Render();
+			if( memcmp( &render.prev, &render.curr, sizeof( mobjinstance_t ) ) != 0 )
+			{
+				render.prev = render.curr;
+			}
 		}
 	}
 }
@@ -147,65 +491,139 @@ DOOM_C_API void P_UpdateInstanceData( void )
 {
 	M_PROFILE_FUNC();
 
-	int32_t index = 0;
-
-	sector_t* thissec = sectors;
-	sectorinstance_t* thissecinst = currsectors;
-	
-	for( index = 0; index < numsectors; ++index )
+	if( fullinstancerebuilds > 0 )
 	{
-		thissecinst->floortex			= flatlookup[ flattranslation[ thissec->floorpic ] ];
-		thissecinst->ceiltex			= flatlookup[ flattranslation[ thissec->ceilingpic ] ];
-		thissecinst->colormap			= thissec->colormap;
-		thissecinst->floorheight		= thissecinst->midtexfloor = FixedToRendFixed( thissec->floorheight );
-		thissecinst->ceilheight			= thissecinst->midtexceil = FixedToRendFixed( thissec->ceilingheight );
-		thissecinst->lightlevel			= thissec->lightlevel;
-		thissecinst->floorlightlevel	= thissec->floorlightsec->lightlevel;
-		thissecinst->ceillightlevel		= thissec->ceilinglightsec->lightlevel;
-		thissecinst->flooroffsetx		= FixedToRendFixed( thissec->flooroffsetx );
-		thissecinst->flooroffsety		= FixedToRendFixed( thissec->flooroffsety );
-		thissecinst->ceiloffsetx		= FixedToRendFixed( thissec->ceiloffsetx );
-		thissecinst->ceiloffsety		= FixedToRendFixed( thissec->ceiloffsety );
-		thissecinst->floorrotation		= thissec->floorrotation;
-		thissecinst->ceilrotation		= thissec->ceilrotation;
-		thissecinst->snapfloor			= thissec->snapfloor;
-		thissecinst->snapceiling		= thissec->snapceiling;
-		thissecinst->activethisframe	= thissec->lastactivetic == gametic
-										|| thissec->floorlightsec->lastactivetic == gametic
-										|| thissec->ceilinglightsec->lastactivetic == gametic;
-
-		++thissec;
-		++thissecinst;
+		M_PROFILE_NAMED( "Full rebuild" );
+
+		P_BuildLightDependents();
+		sectordirtystamps.assign( numsectors, 0 );
+		sidedirtystamps.assign( numsides, 0 );
+
+		// Marks made since the last flip still need to reach the other
+		// buffer, but with the stamps gone they could have been pushed
+		// more than once. Stamp them again, dropping the repeats, so
+		// nothing gets filled by two jobs at once later on.
+		auto Restamp = []( std::vector< int32_t >& dirty, std::vector< uint32_t >& stamps )
+		{
+			std::erase_if( dirty, [ &stamps ]( int32_t index )
+			{
+				if( stamps[ index ] == dirtygeneration )
+				{
+					return true;
+				}
+				stamps[ index ] = dirtygeneration;
+				return false;
+			} );
+		};
+		Restamp( dirtysectors, sectordirtystamps );
+		Restamp( dirtysides, sidedirtystamps );
+
+		updatesectors.resize( numsectors );
+		std::iota( updatesectors.begin(), updatesectors.end(), 0 );
+
+		jobs->ParallelFor( 0, numsectors, SectorsPerInstanceJob, []( int32_t begin, int32_t end )
+		{
+			for( int32_t index = begin; index < end; ++index )
+			{
+				P_FillSectorInstance( sectors[ index ], currsectors[ index ] );
+			}
+		} );
+
+		jobs->ParallelFor( 0, numsides, SidesPerInstanceJob, []( int32_t begin, int32_t end )
+		{
+			for( int32_t index = begin; index < end; ++index )
+			{
+				P_FillSideInstance( sides[ index ], currsides[ index ] );
+			}
+		} );
 	}
+	else
+	{
+		if( animatedinstances )
+		{
+			P_DirtyAnimatedTextures();
+			animatedinstances = false;
+		}
 
-	side_t* thisside = sides;
-	sideinstance_t* thissideinst = currsides;
+		// Anything marked last time that wasn't marked again this time
+		updatesectors.assign( dirtysectors.begin(), dirtysectors.end() );
+		for( int32_t index : lastdirtysectors )
+		{
+			if( sectordirtystamps[ index ] != dirtygeneration )
+			{
+				updatesectors.push_back( index );
+			}
+		}
 
-	for( index = 0; index < numsides; ++index )
+		updatesides.assign( dirtysides.begin(), dirtysides.end() );
+		for( int32_t index : lastdirtysides )
+		{
+			if( sidedirtystamps[ index ] != dirtygeneration )
+			{
+				updatesides.push_back( index );
+			}
+		}
+
+		jobs->ParallelFor( 0, (int32_t)updatesectors.size(), SectorsPerInstanceJob, []( int32_t begin, int32_t end )
+		{
+			for( int32_t index : std::span( updatesectors.data() + begin, updatesectors.data() + end ) )
+			{
+				P_FillSectorInstance( sectors[ index ], currsectors[ index ] );
+			}
+		} );
+
+		jobs->ParallelFor( 0, (int32_t)updatesides.size(), SidesPerInstanceJob, []( int32_t begin, int32_t end )
+		{
+			for( int32_t index : std::span( updatesides.data() + begin, updatesides.data() + end ) )
+			{
+				P_FillSideInstance( sides[ index ], currsides[ index ] );
+			}
+		} );
+	}
+
+	// Paused updates keep writing to the same buffer, so marks only
+	// age once there's been a flip
+	if( instanceflipped )
 	{
-		thissideinst->toptex		= thisside->toptexture ? texturelookup[ texturetranslation[ thisside->toptexture ] ] : NULL;
-		thissideinst->midtex		= thisside->midtexture ? texturelookup[ texturetranslation[ thisside->midtexture ] ] : NULL;
-		thissideinst->bottomtex		= thisside->bottomtexture ? texturelookup[ texturetranslation[ thisside->bottomtexture ] ] : NULL;
-		thissideinst->coloffset		= FixedToRendFixed( thisside->textureoffset );
-		thissideinst->rowoffset		= FixedToRendFixed( thisside->rowoffset );
-
-		++thisside;
-		++thissideinst;
+		instanceflipped = false;
+		fullinstancerebuilds = std::max( 0, fullinstancerebuilds - 1 );
+
+		lastdirtysectors.swap( dirtysectors );
+		dirtysectors.clear();
+		lastdirtysides.swap( dirtysides );
+		dirtysides.clear();
+		++dirtygeneration;
+
+		// Active flags are only true for the tic they were set on, and
+		// nothing else will come along and clear them
+		for( int32_t index : updatesectors )
+		{
+			if( currsectors[ index ].activethisframe )
+			{
+				P_DirtySector( &sectors[ index ] );
+			}
+		}
 	}
 
-	for( thinker_t* th = thinkercap.next; th != &thinkercap; th = th->next )
+	for( mobj_t* mobj : mobjthinkers.Slots() )
 	{
-		if( mobj_t* mobj = thinker_cast< mobj_t >( th ) )
+		if( mobj )
 		{
-			mobj->curr.x = FixedToRendFixed( mobj->x );
-			mobj->curr.y = FixedToRendFixed( mobj->y );
-			mobj->curr.z = FixedToRendFixed( mobj->z );
-			mobj->curr.angle = mobj->angle;
-			mobj->curr.sprite = mobj->sprite;
-			mobj->curr.frame = mobj->frame;
-			mobj->curr.teleported = mobj->teleporttic == gametic;
+			mobjinstance_t next = {};
+			P_FillMobjInstance( *mobj, next );
+
+			mobjinstance_t& curr = mobj->Render().curr;
+			if( memcmp( &next, &curr, sizeof( mobjinstance_t ) ) != 0 )
+			{
+				curr = next;
+			}
 		}
 	}
+
+	if( verifyinstancedata )
+	{
+		P_VerifyInstanceData();
+	}
 }
 
 //
@@ -245,17 +663,13 @@ DOOM_C_API void P_Ticker (void)
 		}
 	}
 
+	P_SightNewTic ();
     P_RunThinkers ();
     P_UpdateSpecials ();
     P_RespawnSpecials ();
 
 	P_UpdateInstanceData();
 
-	{
-		M_PROFILE_NAMED( "Wait on sorting" );
-		jobs->Flush();
-	}
-
     // for par times
     leveltime++;
 	session.level_time = leveltime;
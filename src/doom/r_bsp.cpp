@@ -91,10 +91,9 @@ void R_IncreaseDrawSegsCapacity( bspcontext_t& context )
 //  e.g. single sided LineDefs (middle texture)
 //  that entirely block the view.
 // 
-void R_ClipSolidWallSegment( rendercontext_t& rendercontext, wallcontext_t& wallcontext, int32_t first, int32_t last )
+template< typename _store >
+INLINE void R_ClipSolidWallSegmentImpl( bspcontext_t& bspcontext, int32_t first, int32_t last, _store&& StoreWallRange )
 {
-	bspcontext_t& bspcontext = rendercontext.bspcontext;
-
 	cliprange_t*	next;
 	cliprange_t*	start;
 
@@ -112,7 +111,7 @@ void R_ClipSolidWallSegment( rendercontext_t& rendercontext, wallcontext_t& wall
 		{
 			// Post is entirely visible (above start),
 			//  so insert a new clippost.
-			R_StoreWallRange( rendercontext, wallcontext, first, last );
+			StoreWallRange( first, last );
 
 			if( bspcontext.solidsegsend == ( bspcontext.solidsegs + bspcontext.maxsolidsegs ) )
 			{
@@ -132,7 +131,7 @@ void R_ClipSolidWallSegment( rendercontext_t& rendercontext, wallcontext_t& wall
 		}
 
 		// There is a fragment above *start.
-		R_StoreWallRange( rendercontext, wallcontext, first, start->first - 1 );
+		StoreWallRange( first, start->first - 1 );
 		// Now adjust the clip size.
 		start->first = first;
 	}
@@ -147,7 +146,7 @@ void R_ClipSolidWallSegment( rendercontext_t& rendercontext, wallcontext_t& wall
 	while (last >= (next+1)->first-1)
 	{
 		// There is a fragment between two posts.
-		R_StoreWallRange( rendercontext, wallcontext, next->last + 1, (next+1)->first - 1 );
+		StoreWallRange( next->last + 1, (next+1)->first - 1 );
 		++next;
 	
 		if (last <= next->last)
@@ -160,7 +159,7 @@ void R_ClipSolidWallSegment( rendercontext_t& rendercontext, wallcontext_t& wall
 	}
 	
 	// There is a fragment after *next.
-	R_StoreWallRange( rendercontext, wallcontext, next->last + 1, last );
+	StoreWallRange( next->last + 1, last );
 	// Adjust the clip size.
 	start->last = last;
 	
@@ -189,6 +188,14 @@ crunch:
 
 
 
+void R_ClipSolidWallSegment( rendercontext_t& rendercontext, wallcontext_t& wallcontext, int32_t first, int32_t last )
+{
+	R_ClipSolidWallSegmentImpl( rendercontext.bspcontext, first, last, [ &rendercontext, &wallcontext ]( int32_t start, int32_t stop )
+	{
+		R_StoreWallRange( rendercontext, wallcontext, start, stop );
+	} );
+}
+
 //
 // R_ClipPassWallSegment
 // Clips the given range of columns,
@@ -257,15 +264,14 @@ INLINE bool SectorInstancesMatch( const sectorinstance_t* lhs, const sectorinsta
 	return memcmp( lhs, rhs, sectorinstcmpsize ) == 0;
 }
 
-void R_AddLine( rendercontext_t& rendercontext, seg_t* line )
+//
+// R_ProjectLine
+// Does the view-dependent half of R_AddLine without touching
+// any clip lists. Returns how the resulting range needs to be
+// clipped, with the screen range in x1 and x2 (exclusive).
+//
+lineclip_t R_ProjectLine( const viewpoint_t& viewpoint, seg_t* line, sectorinstance_t* frontsectorinst, wallcontext_t& wallcontext, int32_t& x1, int32_t& x2 )
 {
-	wallcontext_t	wallcontext;
-
-	viewpoint_t& viewpoint		= rendercontext.viewpoint;
-	bspcontext_t& bspcontext	= rendercontext.bspcontext;
-
-	bspcontext.curline = line;
-
 	// OPTIMIZE: quickly reject orthogonal back sides.
 	angle_t angle1 = R_PointToAngle( &viewpoint, line->v1->rend.x, line->v1->rend.y );
 	angle_t angle2 = R_PointToAngle( &viewpoint, line->v2->rend.x, line->v2->rend.y );
@@ -277,7 +283,7 @@ void R_AddLine( rendercontext_t& rendercontext, seg_t* line )
 	// Back side? I.e. backface culling?
 	if (span >= ANG180)
 	{
-		return;
+		return LineClip_None;
 	}
 
 	// Global angle needed by segcalc.
@@ -293,7 +299,7 @@ void R_AddLine( rendercontext_t& rendercontext, seg_t* line )
 
 		// Totally off the left edge?
 		if (tspan >= span)
-			return;
+			return LineClip_None;
 	
 		angle1 = drs_current->clipangle;
 	}
@@ -304,7 +310,7 @@ void R_AddLine( rendercontext_t& rendercontext, seg_t* line )
 
 		// Totally off the left edge?
 		if (tspan >= span)
-			return;	
+			return LineClip_None;	
 		angle2 = M_NEGATE( drs_current->clipangle );
 	}
 
@@ -312,35 +318,35 @@ void R_AddLine( rendercontext_t& rendercontext, seg_t* line )
 	// but not necessarily visible.
 	angle1 = ( angle1 + ANG90 ) >> RENDERANGLETOFINESHIFT;
 	angle2 = ( angle2 + ANG90 ) >> RENDERANGLETOFINESHIFT;
-	int32_t x1 = drs_current->viewangletox[ angle1 ];
-	int32_t x2 = drs_current->viewangletox[ angle2 ];
+	x1 = drs_current->viewangletox[ angle1 ];
+	x2 = drs_current->viewangletox[ angle2 ];
 
 	// Does not cross a pixel?
 	if (x1 == x2)
 	{
-		return;
+		return LineClip_None;
 	}
 	
-	bspcontext.backsectorinst = line->backsector ? &rendsectors[ line->backsector->index ] : nullptr;
+	sectorinstance_t* backsectorinst = line->backsector ? &rendsectors[ line->backsector->index ] : nullptr;
 
 	// Single sided line?
-	if (!bspcontext.backsectorinst)
+	if (!backsectorinst)
 	{
-		goto clipsolid;
+		return LineClip_Solid;
 	}
 
 	// Closed door.
-	if (bspcontext.backsectorinst->ceilheight <= bspcontext.frontsectorinst->floorheight
-		|| bspcontext.backsectorinst->floorheight >= bspcontext.frontsectorinst->ceilheight)
+	if (backsectorinst->ceilheight <= frontsectorinst->floorheight
+		|| backsectorinst->floorheight >= frontsectorinst->ceilheight)
 	{
-		goto clipsolid;
+		return LineClip_Solid;
 	}
 
 	// Window.
-	if (bspcontext.backsectorinst->ceilheight != bspcontext.frontsectorinst->ceilheight
-		|| bspcontext.backsectorinst->floorheight != bspcontext.frontsectorinst->floorheight)
+	if (backsectorinst->ceilheight != frontsectorinst->ceilheight
+		|| backsectorinst->floorheight != frontsectorinst->floorheight)
 	{
-		goto clippass;
+		return LineClip_Pass;
 	}
 
 	// Reject empty lines used for triggers
@@ -348,18 +354,47 @@ void R_AddLine( rendercontext_t& rendercontext, seg_t* line )
 	// Identical floor and ceiling on both sides,
 	// identical light levels on both sides,
 	// and no middle texture.
-	if( SectorInstancesMatch( bspcontext.backsectorinst, bspcontext.frontsectorinst )
-		&& bspcontext.curline->sidedef->midtexture == 0 )
+	if( SectorInstancesMatch( backsectorinst, frontsectorinst )
+		&& line->sidedef->midtexture == 0 )
 	{
-		return;
+		return LineClip_None;
+	}
+
+	return LineClip_Pass;
+}
+
+void R_ClipLine( rendercontext_t& rendercontext, wallcontext_t& wallcontext, seg_t* line, lineclip_t clip, int32_t x1, int32_t x2 )
+{
+	bspcontext_t& bspcontext	= rendercontext.bspcontext;
+
+	bspcontext.curline = line;
+	bspcontext.backsectorinst = line->backsector ? &rendsectors[ line->backsector->index ] : nullptr;
+
+	if( clip == LineClip_Solid )
+	{
+		R_ClipSolidWallSegment( rendercontext, wallcontext, x1, x2-1 );
 	}
+	else
+	{
+		R_ClipPassWallSegment( rendercontext, wallcontext, x1, x2-1 );
+	}
+}
 
-clippass:
-	R_ClipPassWallSegment( rendercontext, wallcontext, x1, x2-1 );
-	return;
+void R_AddLine( rendercontext_t& rendercontext, seg_t* line )
+{
+	wallcontext_t	wallcontext;
+	int32_t			x1;
+	int32_t			x2;
+
+	bspcontext_t& bspcontext	= rendercontext.bspcontext;
+
+	bspcontext.curline = line;
 
-clipsolid:
-	R_ClipSolidWallSegment( rendercontext, wallcontext, x1, x2-1 );
+	lineclip_t clip = R_ProjectLine( rendercontext.viewpoint, line, bspcontext.frontsectorinst, wallcontext, x1, x2 );
+	if( clip != LineClip_None )
+	{
+		R_ClipLine( rendercontext, wallcontext, line, clip, x1, x2 );
+	}
 }
 
 
@@ -368,8 +403,10 @@ clipsolid:
 // Checks BSP node/subtree bounding box.
 // Returns true
 //  if some part of the bbox might be visible.
+// If extent is supplied, it receives the screen
+//  columns the bbox covers.
 //
-doombool R_CheckBBox( const viewpoint_t& viewpoint, const bspcontext_t& context, rend_fixed_t* bspcoord )
+doombool R_CheckBBox( const viewpoint_t& viewpoint, const bspcontext_t& context, rend_fixed_t* bspcoord, cliprange_t* extent = nullptr )
 {
 	constexpr int32_t checkcoord[12][4] =
 	{
@@ -431,6 +468,12 @@ doombool R_CheckBBox( const viewpoint_t& viewpoint, const bspcontext_t& context,
 		boxy = 2;
 	}
 		
+	if( extent )
+	{
+		extent->first = 0;
+		extent->last = drs_current->viewwidth - 1;
+	}
+
 	boxpos = ( boxy << 2 ) + boxx;
 	if ( boxpos == 5 )
 	{
@@ -489,6 +532,12 @@ doombool R_CheckBBox( const viewpoint_t& viewpoint, const bspcontext_t& context,
 	if( sx1 == sx2 )
 		return false;
 	--sx2;
+
+	if( extent )
+	{
+		extent->first = sx1;
+		extent->last = sx2;
+	}
 	
 	const cliprange_t* start = context.solidsegs;
 	while( start->last < sx2 )
@@ -601,3 +650,145 @@ void R_RenderBSPNode( rendercontext_t& rendercontext, int32_t bspnum )
 		R_RenderBSPNode( rendercontext, bsp->children[ side ^ 1 ] );
 	}
 }
+
+//
+// R_FrontEndSubsector
+// Records every seg that the current clip list lets through,
+// then updates the clip list with the solid ones.
+//
+static void R_FrontEndSubsector( bspfrontend_t& frontend, int32_t num, const cliprange_t& extent )
+{
+	bspcontext_t& bspcontext = frontend.bspcontext;
+
+	subsector_t* sub = &subsectors[ num ];
+	sectorinstance_t* frontsectorinst = &rendsectors[ sub->sector->index ];
+
+	bspfrontendsubsector_t& entry = frontend.subsectors.emplace_back();
+	entry.index = num;
+	entry.firstseg = (int32_t)frontend.segs.size();
+	entry.numsegs = 0;
+	entry.extent = extent;
+
+	seg_t* line = &segs[ sub->firstline ];
+	for( int32_t count = sub->numlines; count > 0; --count, ++line )
+	{
+		wallcontext_t	wallcontext;
+		int32_t			x1;
+		int32_t			x2;
+
+		lineclip_t clip = R_ProjectLine( frontend.viewpoint, line, frontsectorinst, wallcontext, x1, x2 );
+		if( clip == LineClip_None )
+		{
+			continue;
+		}
+
+		frontend.segs.push_back( { line, wallcontext.angle1, wallcontext.angle2, x1, x2, clip } );
+		++entry.numsegs;
+
+		if( clip == LineClip_Solid )
+		{
+			R_ClipSolidWallSegmentImpl( bspcontext, x1, x2 - 1, []( int32_t start, int32_t stop ) { } );
+		}
+	}
+}
+
+static void R_FrontEndBSPNode( bspfrontend_t& frontend, int32_t bspnum, const cliprange_t& extent )
+{
+	if( bspnum & NF_SUBSECTOR )
+	{
+		R_FrontEndSubsector( frontend, bspnum == -1 ? 0 : ( bspnum & ( ~NF_SUBSECTOR ) ), extent );
+		return;
+	}
+
+	node_t* bsp = &nodes[ bspnum ];
+	int32_t side = R_PointOnSide( frontend.viewpoint.x, frontend.viewpoint.y, bsp );
+
+	R_FrontEndBSPNode( frontend, bsp->children[ side ], extent );
+
+	cliprange_t backextent;
+	if( R_CheckBBox( frontend.viewpoint, frontend.bspcontext, bsp->rend.bbox[ side ^ LS_Back ], &backextent ) )
+	{
+		backextent.first = M_MAX( backextent.first, extent.first );
+		backextent.last = M_MIN( backextent.last, extent.last );
+		R_FrontEndBSPNode( frontend, bsp->children[ side ^ 1 ], backextent );
+	}
+}
+
+//
+// R_BuildBSPFrontEnd
+// Walks the BSP once over the entire view width. A context's
+// own walk visits a subset of what this visits, in the same
+// order, so replaying the overlapping entries produces the same
+// clip lists, drawsegs and planes as R_RenderBSPNode.
+//
+void R_BuildBSPFrontEnd( bspfrontend_t& frontend, const viewpoint_t& viewpoint )
+{
+	M_PROFILE_FUNC();
+
+	frontend.viewpoint = viewpoint;
+	frontend.subsectors.clear();
+	frontend.segs.clear();
+
+	frontend.bspcontext.maxsolidsegs = M_MAX( frontend.bspcontext.maxsolidsegs, (size_t)MAXSEGS );
+	R_ClearClipSegs( frontend.bspcontext, 0, drs_current->viewwidth );
+
+	cliprange_t extent = { 0, drs_current->viewwidth - 1 };
+	R_FrontEndBSPNode( frontend, numnodes - 1, extent );
+}
+
+//
+// R_RenderBSPFrontEnd
+// Per-context replacement for R_RenderBSPNode when the shared
+// front end has already been built for this frame.
+//
+void R_RenderBSPFrontEnd( rendercontext_t& rendercontext, const bspfrontend_t& frontend )
+{
+	M_PROFILE_FUNC();
+
+	bspcontext_t& bspcontext = rendercontext.bspcontext;
+
+	const int32_t mincol = rendercontext.begincolumn;
+	const int32_t maxcol = rendercontext.endcolumn - 1;
+
+	for( const bspfrontendsubsector_t& entry : frontend.subsectors )
+	{
+		if( entry.extent.last < mincol || entry.extent.first > maxcol )
+		{
+			continue;
+		}
+
+		subsector_t* sub = &subsectors[ entry.index ];
+		bspcontext.frontsectorinst = &rendsectors[ sub->sector->index ];
+
+#if RENDER_PERF_GRAPHING
+		uint64_t		startaddlines = I_GetTimeUS();
+#endif // RENDER_PERF_GRAPHING
+
+		for( const bspfrontendseg_t& seg : std::span( frontend.segs.data() + entry.firstseg, entry.numsegs ) )
+		{
+			if( seg.x2 <= mincol || seg.x1 > maxcol )
+			{
+				continue;
+			}
+
+			wallcontext_t wallcontext;
+			wallcontext.angle1 = seg.angle1;
+			wallcontext.angle2 = seg.angle2;
+			R_ClipLine( rendercontext, wallcontext, seg.line, seg.clip, seg.x1, seg.x2 );
+		}
+
+#if RENDER_PERF_GRAPHING
+		uint64_t		endaddlines = I_GetTimeUS();
+		bspcontext.addlinestimetaken += ( endaddlines - startaddlines );
+
+		uint64_t		startaddsprites = I_GetTimeUS();
+#endif // RENDER_PERF_GRAPHING
+
+		R_AddSprites( rendercontext, &rendsectors[ sub->sector->index ], sub->sector->index );
+
+#if RENDER_PERF_GRAPHING
+		uint64_t		endaddsprites = I_GetTimeUS();
+		bspcontext.addspritestimetaken += ( endaddsprites - startaddsprites );
+#endif // RENDER_PERF_GRAPHING
+	}
+}
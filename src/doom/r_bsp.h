@@ -24,6 +24,45 @@
 #include "r_defs.h"
 
 #if defined(__cplusplus)
+#include <vector>
+
+typedef enum lineclip_e
+{
+	LineClip_None,
+	LineClip_Pass,
+	LineClip_Solid,
+} lineclip_t;
+
+// A seg that survived the view-dependent tests of the shared
+// front end. x2 is exclusive, same as R_AddLine's working values.
+typedef struct bspfrontendseg_s
+{
+	seg_t*				line;
+	angle_t				angle1;
+	angle_t				angle2;
+	int32_t				x1;
+	int32_t				x2;
+	lineclip_t			clip;
+} bspfrontendseg_t;
+
+typedef struct bspfrontendsubsector_s
+{
+	int32_t				index;
+	int32_t				firstseg;
+	int32_t				numsegs;
+	cliprange_t			extent;
+} bspfrontendsubsector_t;
+
+// One full-width BSP walk per frame. Each render context then
+// only replays the entries that overlap its own columns.
+typedef struct bspfrontend_s
+{
+	viewpoint_t								viewpoint;
+	bspcontext_t							bspcontext;
+	std::vector< bspfrontendsubsector_t >	subsectors;
+	std::vector< bspfrontendseg_t >			segs;
+} bspfrontend_t;
+
 // BSP?
 void R_ClearClipSegs( bspcontext_t& context, int32_t mincol, int32_t maxcol );
 void R_IncreaseClipSegsCapacity( bspcontext_t& context );
@@ -32,6 +71,9 @@ void R_ClearDrawSegs( bspcontext_t& context );
 void R_IncreaseDrawSegsCapacity( bspcontext_t& context );
 
 void R_RenderBSPNode( rendercontext_t& rendercontext, int32_t bspnum );
+
+void R_BuildBSPFrontEnd( bspfrontend_t& frontend, const viewpoint_t& viewpoint );
+void R_RenderBSPFrontEnd( rendercontext_t& rendercontext, const bspfrontend_t& frontend );
 #endif // defined(__cplusplus)
 
 #endif
@@ -33,6 +33,7 @@
 #include "i_swap.h"
 #include "i_terminal.h"
 
+#include "m_config.h"
 #include "m_conv.h"
 #include "m_fixed.h"
 #include "m_misc.h"
@@ -43,15 +44,25 @@
 
 #include "r_main.h"
 #include "r_data.h"
+#include "r_kernels.h"
 #include "r_sky.h"
 #include "r_local.h"
 
+#include "sha1.h"
+
+#include "w_file.h"
 #include "w_wad.h"
 
 #include "z_zone.h"
 
 #include <stdio.h>
 
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 extern "C"
 {
 
@@ -171,6 +182,8 @@ extern "C"
 
 	lighttable_t			*colormaps;
 	byte*					tranmap;
+
+	int32_t					texture_composite_cache = 1;
 }
 
 std::unordered_map< std::string, texture_t* >	texturenamelookup;
@@ -309,14 +322,16 @@ void R_DrawColumnInCache( column_t* patch, byte* cache, int originy, int cachehe
 
 #define COMPOSITE_ZONE ( PU_LEVEL )
 
-void R_GenerateCompositeTexture(int texnum)
+// Does the actual compositing in to an already allocated block. Doesn't
+// touch the zone or the lump cache, so it's safe to call from a job as
+// long as the patches have been cached beforehand.
+static void R_CompositeTextureInBlock( int32_t texnum, byte* block, patch_t** realpatches )
 {
 	column_t*			patchcol;
 	int32_t				patchy = 0;
 	
 	texture_t* texture = textures[texnum];
 
-	byte* block = (byte*)Z_Malloc(texturecomposite[ texnum ].size, COMPOSITE_ZONE,  &texturecomposite[texnum].data );
 	memset( block, comp.no_medusa ? 0 : 0xFB, texturecomposite[ texnum ].size );
 
 	// Composite the columns together.
@@ -324,7 +339,7 @@ void R_GenerateCompositeTexture(int texnum)
 		
 	for( int32_t index = 0; index < texture->patchcount; index++, patch++ )
 	{
-		patch_t* realpatch = (patch_t*)W_CacheLumpNum (patch->patch, COMPOSITE_ZONE); // TODO: Change back to PU_CACHE when masked textures get composited
+		patch_t* realpatch = realpatches[ index ];
 		int32_t x1 = patch->originx;
 		int32_t x2 = M_MIN( x1 + SHORT(realpatch->width), texture->width );
 
@@ -355,6 +370,21 @@ void R_GenerateCompositeTexture(int texnum)
 	}
 }
 
+void R_GenerateCompositeTexture(int texnum)
+{
+	texture_t* texture = textures[texnum];
+
+	byte* block = (byte*)Z_Malloc(texturecomposite[ texnum ].size, COMPOSITE_ZONE,  &texturecomposite[texnum].data );
+
+	std::vector< patch_t* > realpatches( texture->patchcount );
+	for( int32_t index : iota( 0, (int32_t)texture->patchcount ) )
+	{
+		realpatches[ index ] = (patch_t*)W_CacheLumpNum( texture->patches[ index ].patch, COMPOSITE_ZONE ); // TODO: Change back to PU_CACHE when masked textures get composited
+	}
+
+	R_CompositeTextureInBlock( texnum, block, realpatches.data() );
+}
+
 //
 // R_GenerateLookup
 //
@@ -401,35 +431,38 @@ void R_GenerateLookup (int texnum)
 	Z_Free( patchcount );
 }
 
-void R_CacheCompositeFlat( int32_t flat )
+static void R_TransposeFlat( byte* transposedflatdata, byte* originalflatdata )
 {
-	auto& info = flatindexlookup[ flat ];
-
-	int32_t lump = info.lumpindex;
-
-	byte* transposedflatdata = (byte*)Z_Malloc( 64 * 64, COMPOSITE_ZONE, &flatcomposite[ flat ].data );
-	if( W_LumpLength( lump ) == 0 )
+	if( originalflatdata == nullptr )
 	{
 		memset( transposedflatdata, 0, 64 * 64 );
+		return;
 	}
-	else
-	{
-		byte* originalflatdata = (byte*)W_CacheLumpNum( lump, PU_CACHE );
 
-		byte* currsource = originalflatdata;
-		for( int32_t y : iota( 0, 64 ) )
+	byte* currsource = originalflatdata;
+	for( int32_t y : iota( 0, 64 ) )
+	{
+		byte* currdest = transposedflatdata + y;
+		for( [[maybe_unused]] int32_t x : iota( 0, 64 ) )
 		{
-			byte* currdest = transposedflatdata + y;
-			for( [[maybe_unused]] int32_t x : iota( 0, 64 ) )
-			{
-				*currdest = *currsource;
-				++currsource;
-				currdest += 64;
-			}
+			*currdest = *currsource;
+			++currsource;
+			currdest += 64;
 		}
 	}
 }
 
+void R_CacheCompositeFlat( int32_t flat )
+{
+	auto& info = flatindexlookup[ flat ];
+
+	int32_t lump = info.lumpindex;
+
+	byte* transposedflatdata = (byte*)Z_Malloc( 64 * 64, COMPOSITE_ZONE, &flatcomposite[ flat ].data );
+	byte* originalflatdata = W_LumpLength( lump ) == 0 ? nullptr : (byte*)W_CacheLumpNum( lump, PU_CACHE );
+	R_TransposeFlat( transposedflatdata, originalflatdata );
+}
+
 texturecomposite_t* R_CacheAndGetCompositeFlat( const char* flat )
 {
 	int32_t index = R_FlatNumForName( flat );
@@ -521,37 +554,8 @@ column_t* R_GetRawColumn( int32_t tex, int32_t patch, int32_t col )
 	return nullptr;
 }
 
-constexpr colfunc_t colfuncsforheight[] =
-{
-	&R_DrawColumn_Colormap_16,
-	&R_DrawColumn_Colormap_32,
-	&R_DrawColumn_Colormap_64,
-	&R_DrawColumn_Colormap_128,
-	&R_DrawColumn_Colormap_256,
-	&R_DrawColumn_Colormap_512,
-};
-
-constexpr colfunc_t transcolfuncsforheight[] =
-{
-	&R_DrawColumn_Transparent_16,
-	&R_DrawColumn_Transparent_32,
-	&R_DrawColumn_Transparent_64,
-	&R_DrawColumn_Transparent_128,
-	&R_DrawColumn_Transparent_256,
-	&R_DrawColumn_Transparent_512,
-};
-
-constexpr rasterfunc_t floorfuncs[ 7 ][ 6 ] =
-{
-	{	&R_RasteriseRegion16x16,	&R_RasteriseRegion16x32,	&R_RasteriseRegion16x64,	&R_RasteriseRegion16x128,	&R_RasteriseRegion16x256,	&R_RasteriseRegion16x512	},
-	{	&R_RasteriseRegion32x16,	&R_RasteriseRegion32x32,	&R_RasteriseRegion32x64,	&R_RasteriseRegion32x128,	&R_RasteriseRegion32x256,	&R_RasteriseRegion32x512	},
-	{	&R_RasteriseRegion64x16,	&R_RasteriseRegion64x32,	&R_RasteriseRegion64x64,	&R_RasteriseRegion64x128,	&R_RasteriseRegion64x256,	&R_RasteriseRegion64x512	},
-	{	&R_RasteriseRegion128x16,	&R_RasteriseRegion128x32,	&R_RasteriseRegion128x64,	&R_RasteriseRegion128x128,	&R_RasteriseRegion128x256,	&R_RasteriseRegion128x512	},
-	{	&R_RasteriseRegion256x16,	&R_RasteriseRegion256x32,	&R_RasteriseRegion256x64,	&R_RasteriseRegion256x128,	&R_RasteriseRegion256x256,	&R_RasteriseRegion256x512	},
-	{	&R_RasteriseRegion512x16,	&R_RasteriseRegion512x32,	&R_RasteriseRegion512x64,	&R_RasteriseRegion512x128,	&R_RasteriseRegion512x256,	&R_RasteriseRegion512x512	},
-	{	&R_RasteriseRegion1024x16,	&R_RasteriseRegion1024x32,	&R_RasteriseRegion1024x64,	&R_RasteriseRegion1024x128,	&R_RasteriseRegion1024x256,	&R_RasteriseRegion1024x512	},
-};
-
+// Wall and flat kernels come from renderkernels, which R_InitRenderKernels
+// has already filled with the best versions this CPU can run
 constexpr int32_t maxcolfuncs = 5;
 
 void R_InitTextureAndFlatComposites( void )
@@ -578,11 +582,11 @@ void R_InitTextureAndFlatComposites( void )
 
 		if( !comp.arbitrary_wall_sizes )
 		{
-			composite.wallrender = &R_DrawColumn_Colormap_128;
-			composite.transparentwallrender = &R_DrawColumn_Transparent_128;
-			composite.midtexrender = &R_SpriteDrawColumn_Colormap;
-			composite.transparentmidtexrender = &R_SpriteDrawColumn_Transparent;
-			composite.floorrender = &R_RasteriseRegion64x64;
+			composite.wallrender = renderkernels.wallcolumn[ 3 ];
+			composite.transparentwallrender = renderkernels.transparentcolumn[ 3 ];
+			composite.midtexrender = renderkernels.spritecolumn;
+			composite.transparentmidtexrender = renderkernels.spritetransparent;
+			composite.floorrender = renderkernels.flat[ 2 ][ 2 ];
 		}
 		else
 		{
@@ -596,8 +600,8 @@ void R_InitTextureAndFlatComposites( void )
 			}
 			else
 			{
-				composite.midtexrender = &R_SpriteDrawColumn_Colormap;
-				composite.transparentmidtexrender = &R_SpriteDrawColumn_Transparent;
+				composite.midtexrender = renderkernels.spritecolumn;
+				composite.transparentmidtexrender = renderkernels.spritetransparent;
 			}
 
 			if( logheightdouble != (double_t)logheight || logheight < 0 || logheight >= maxcolfuncs )
@@ -607,8 +611,8 @@ void R_InitTextureAndFlatComposites( void )
 			}
 			else
 			{
-				composite.wallrender = colfuncsforheight[ logheight ];
-				composite.transparentwallrender = transcolfuncsforheight[ logheight ];
+				composite.wallrender = renderkernels.wallcolumn[ logheight ];
+				composite.transparentwallrender = renderkernels.transparentcolumn[ logheight ];
 			}
 
 			double_t logwidthdouble = log2( texture->width ) - 4.0;
@@ -622,7 +626,7 @@ void R_InitTextureAndFlatComposites( void )
 			}
 			else
 			{
-				composite.floorrender = floorfuncs[ logwidth ][ logheight ];
+				composite.floorrender = renderkernels.flat[ logwidth ][ logheight ];
 			}
 		}
 
@@ -656,11 +660,11 @@ void R_InitTextureAndFlatComposites( void )
 		lumpinfo_t* lumpentry = lumpinfo[ entrydetails.lumpindex ];
 
 		composite.data = NULL;
-		composite.wallrender				= &R_DrawColumn_Colormap_64;
-		composite.transparentwallrender		= &R_DrawColumn_Transparent_64;
-		composite.midtexrender				= &R_DrawColumn_Colormap_64;
-		composite.transparentmidtexrender	= &R_DrawColumn_Transparent_64;
-		composite.floorrender				= &R_RasteriseRegion64x64;
+		composite.wallrender				= renderkernels.wallcolumn[ 2 ];
+		composite.transparentwallrender		= renderkernels.transparentcolumn[ 2 ];
+		composite.midtexrender				= renderkernels.wallcolumn[ 2 ];
+		composite.transparentmidtexrender	= renderkernels.transparentcolumn[ 2 ];
+		composite.floorrender				= renderkernels.flat[ 2 ][ 2 ];
 		strncpy( composite.name, lumpentry->name, 8 );
 		composite.namepadding = 0;
 		composite.size = 64 * 64;
@@ -1312,6 +1316,8 @@ translation_t* R_GetTranslation( const char* name )
 	return found->second;
 }
 
+static void R_EvictStaleComposites();
+
 //
 // R_InitData
 // Locates all the lumps
@@ -1331,6 +1337,11 @@ void R_InitData (void)
     R_InitColormaps ();
 	R_InitTranslations();
 	R_InitSkyDefs();
+
+	if( texture_composite_cache )
+	{
+		R_EvictStaleComposites();
+	}
 }
 
 
@@ -1468,6 +1479,261 @@ DOOM_C_API lighttable_t* R_GetColormapForNum( lumpindex_t colormapnum )
 	return nullptr;
 }
 
+// Composited textures are cached on disk, keyed by a hash of the texture
+// definition and the WADs the patches came from. A warm level load just
+// reads the composites straight back in. Each file also lists the WADs
+// it was built from, so entries that can never be hit again because a
+// WAD changed or went away can be cleaned out.
+static constexpr uint32_t CompositeCacheMagic = 0x54434E52; // RNCT
+static constexpr uint32_t CompositeCacheVersion = 2;
+
+struct compositecacheheader_t
+{
+	uint32_t	magic;
+	uint32_t	version;
+	int32_t		width;
+	int32_t		height;
+	int32_t		size;
+	int32_t		numwads;
+	int32_t		datastart;
+};
+
+struct compositecachewadentry_t
+{
+	int64_t		lastmodified;
+	uint64_t	length;
+	int32_t		pathlength;
+};
+
+struct compositecachewad_t
+{
+	std::string		path;
+	time_t			lastmodified;
+	uintmax_t		length;
+};
+
+static JobGroup compositeevictjobs;
+static std::atomic< int32_t > compositesevicted = 0;
+
+static std::string R_CompositeCacheDir()
+{
+	return std::string( configdir ) + "cache" DIR_SEPARATOR_S "composites" DIR_SEPARATOR_S;
+}
+
+static uintmax_t R_CompositeCacheFileSize( const std::filesystem::path& path )
+{
+	std::error_code error;
+	uintmax_t length = std::filesystem::file_size( path, error );
+	return error ? 0 : length;
+}
+
+// Thread safe, only touches the C runtime and the filesystem
+static bool R_CompositeCacheIsStale( const std::filesystem::path& path )
+{
+	FILE* file = fopen( path.string().c_str(), "rb" );
+	if( file == nullptr )
+	{
+		return false;
+	}
+
+	compositecacheheader_t header = {};
+	bool stale = false;
+	if( fread( &header, sizeof( header ), 1, file ) != 1
+		|| header.magic != CompositeCacheMagic
+		|| header.version != CompositeCacheVersion )
+	{
+		stale = true;
+	}
+	else
+	{
+		std::string wadpath;
+		for( int32_t wad = 0; wad < header.numwads && !stale; ++wad )
+		{
+			compositecachewadentry_t entry = {};
+			if( fread( &entry, sizeof( entry ), 1, file ) != 1
+				|| entry.pathlength <= 0
+				|| entry.pathlength > header.datastart )
+			{
+				// Could still be getting written, leave it alone
+				break;
+			}
+
+			wadpath.resize( entry.pathlength );
+			if( fread( wadpath.data(), 1, entry.pathlength, file ) != (size_t)entry.pathlength )
+			{
+				break;
+			}
+
+			stale = M_FileLastModified( wadpath.c_str() ) != (time_t)entry.lastmodified
+					|| R_CompositeCacheFileSize( wadpath ) != (uintmax_t)entry.length;
+		}
+	}
+
+	fclose( file );
+	return stale;
+}
+
+// Kicked off at startup. Precaching waits on it before touching the
+// cache, so it never races with composites being written.
+static void R_EvictStaleComposites()
+{
+	jobs->AddJob( compositeevictjobs, []()
+	{
+		std::error_code error;
+		std::filesystem::directory_iterator dir( R_CompositeCacheDir(), error );
+		if( error )
+		{
+			return;
+		}
+
+		for( const std::filesystem::directory_entry& entry : dir )
+		{
+			if( entry.is_regular_file( error )
+				&& entry.path().extension() == ".dat"
+				&& R_CompositeCacheIsStale( entry.path() )
+				&& std::filesystem::remove( entry.path(), error ) )
+			{
+				++compositesevicted;
+			}
+		}
+	} );
+}
+
+static std::string R_CompositeCachePath( int32_t texnum, std::unordered_map< wad_file_t*, compositecachewad_t >& wads, std::vector< const compositecachewad_t* >& texturewads )
+{
+	auto WADFor = [ &wads ]( lumpindex_t lump ) -> const compositecachewad_t&
+	{
+		wad_file_t* file = lumpinfo[ lump ]->wad_file;
+		auto found = wads.find( file );
+		if( found == wads.end() )
+		{
+			std::error_code error;
+			std::filesystem::path wadpath = std::filesystem::absolute( W_WadPathForLumpNum( lump ), error );
+			compositecachewad_t wad = { wadpath.string(), M_FileLastModified( wadpath.string().c_str() ), R_CompositeCacheFileSize( wadpath ) };
+			found = wads.insert( std::make_pair( file, wad ) ).first;
+		}
+		return found->second;
+	};
+
+	texture_t* texture = textures[ texnum ];
+
+	sha1_context_t context;
+	SHA1_Init( &context );
+	SHA1_Update( &context, (byte*)texture->name, DoomStrLen( texture->name ) );
+	SHA1_UpdateInt32( &context, texture->width );
+	SHA1_UpdateInt32( &context, texture->height );
+	SHA1_UpdateInt32( &context, comp.no_medusa );
+	SHA1_UpdateInt32( &context, comp.tall_patches );
+
+	texturewads.clear();
+	for( texpatch_t& patch : std::span( texture->patches, texture->patchcount ) )
+	{
+		const compositecachewad_t& wad = WADFor( patch.patch );
+		lumpinfo_t* lump = lumpinfo[ patch.patch ];
+
+		if( std::find( texturewads.begin(), texturewads.end(), &wad ) == texturewads.end() )
+		{
+			texturewads.push_back( &wad );
+		}
+
+		SHA1_UpdateInt32( &context, patch.originx );
+		SHA1_UpdateInt32( &context, patch.originy );
+		SHA1_Update( &context, (byte*)lump->name, DoomStrLen( lump->name ) );
+		SHA1_UpdateInt32( &context, lump->position );
+		SHA1_UpdateInt32( &context, lump->size );
+		SHA1_Update( &context, (byte*)wad.path.c_str(), wad.path.size() );
+		SHA1_UpdateInt32( &context, (unsigned)wad.lastmodified );
+		SHA1_UpdateInt32( &context, (unsigned)wad.length );
+	}
+
+	sha1_digest_t digest;
+	SHA1_Final( digest, &context );
+
+	char checksum[ sizeof( sha1_digest_t ) * 2 + 1 ] = {};
+	for( int32_t index : iota( 0, (int32_t)sizeof( sha1_digest_t ) ) )
+	{
+		M_snprintf( &checksum[ index * 2 ], 3, "%02x", digest[ index ] );
+	}
+
+	return R_CompositeCacheDir() + checksum + ".dat";
+}
+
+// Thread safe, the zone takes its own lock for the file handle. Cache
+// files get mapped so the composite comes straight out of the page
+// cache, falling back to plain reads where mapping isn't available.
+static bool R_LoadCachedComposite( int32_t texnum, const std::string& path, byte* block )
+{
+	wad_file_t* file = W_OpenMappedFile( path.c_str() );
+	if( file == nullptr )
+	{
+		return false;
+	}
+
+	texturecomposite_t& composite = texturecomposite[ texnum ];
+
+	compositecacheheader_t header = {};
+	bool valid = W_Read( file, 0, &header, sizeof( header ) ) == sizeof( header )
+				&& header.magic == CompositeCacheMagic
+				&& header.version == CompositeCacheVersion
+				&& header.width == composite.width
+				&& header.height == composite.height
+				&& header.size == composite.size
+				&& header.datastart >= (int32_t)sizeof( header )
+				&& file->length == (unsigned int)( header.datastart + composite.size );
+
+	if( valid )
+	{
+		byte* data = W_MapRange( file, header.datastart, composite.size );
+		if( data != nullptr )
+		{
+			memcpy( block, data, composite.size );
+		}
+		else
+		{
+			valid = W_Read( file, header.datastart, block, composite.size ) == (size_t)composite.size;
+		}
+	}
+
+	W_CloseFile( file );
+	return valid;
+}
+
+// Thread safe, only touches the C runtime
+static void R_SaveCachedComposite( int32_t texnum, const std::string& path, const std::vector< const compositecachewad_t* >& wads, const byte* block )
+{
+	texturecomposite_t& composite = texturecomposite[ texnum ];
+
+	FILE* file = fopen( path.c_str(), "wb" );
+	if( file == nullptr )
+	{
+		return;
+	}
+
+	int32_t datastart = sizeof( compositecacheheader_t );
+	for( const compositecachewad_t* wad : wads )
+	{
+		datastart += sizeof( compositecachewadentry_t ) + (int32_t)wad->path.size();
+	}
+
+	compositecacheheader_t header = { CompositeCacheMagic, CompositeCacheVersion, composite.width, composite.height, composite.size, (int32_t)wads.size(), datastart };
+	bool written = fwrite( &header, sizeof( header ), 1, file ) == 1;
+	for( const compositecachewad_t* wad : wads )
+	{
+		compositecachewadentry_t entry = { (int64_t)wad->lastmodified, (uint64_t)wad->length, (int32_t)wad->path.size() };
+		written = written
+				&& fwrite( &entry, sizeof( entry ), 1, file ) == 1
+				&& fwrite( wad->path.c_str(), 1, wad->path.size(), file ) == wad->path.size();
+	}
+	written = written && fwrite( block, 1, composite.size, file ) == (size_t)composite.size;
+	fclose( file );
+
+	if( !written )
+	{
+		// Don't leave a truncated file around to fail validation every load
+		remove( path.c_str() );
+	}
+}
+
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
@@ -1592,32 +1858,142 @@ void R_PrecacheLevel (void)
 		}
 	}
 	
-	// Precache flats.
+	// Everything that touches the zone or the lump cache needs to happen
+	// here on the main thread. The jobs only ever write in to the blocks
+	// they're given.
+	std::vector< int32_t > cachedflats;
+	std::vector< byte* > flatsources;
 	for( i=0 ; i< NumFlats() ; i++ )
 	{
 		flatcomposite[ i ].data = NULL;
 
 		if( flatpresent[ i ] )
 		{
-			R_CacheCompositeFlat( i );
+			lump = flatindexlookup[ i ].lumpindex;
+			Z_Malloc( 64 * 64, COMPOSITE_ZONE, &flatcomposite[ i ].data );
+			cachedflats.push_back( i );
+			flatsources.push_back( W_LumpLength( lump ) == 0 ? nullptr : (byte*)W_CacheLumpNum( lump, PU_STATIC ) );
 		}
 	}
 
-	// Precache textures.
+	JobGroup precachejobs;
+
+	// Flats are cheaper to transpose than they are to load off disk,
+	// so they don't get cached
+	constexpr int32_t FlatsPerJob = 64;
+	for( int32_t jobstart = 0; jobstart < (int32_t)cachedflats.size(); jobstart += FlatsPerJob )
+	{
+		int32_t jobend = M_MIN( jobstart + FlatsPerJob, (int32_t)cachedflats.size() );
+		jobs->AddJob( precachejobs, [ &cachedflats, &flatsources, jobstart, jobend ]()
+		{
+			for( int32_t index : iota( jobstart, jobend ) )
+			{
+				R_TransposeFlat( flatcomposite[ cachedflats[ index ] ].data, flatsources[ index ] );
+			}
+		} );
+	}
+
+	struct compositework_t
+	{
+		int32_t									texnum;
+		std::string								cachepath;
+		std::vector< const compositecachewad_t* >	wads;
+		std::vector< patch_t* >					patches;
+		bool									cached;
+	};
+
+	std::unordered_map< wad_file_t*, compositecachewad_t > cachewads;
+	std::vector< compositework_t > compositework;
+
+	bool usecache = texture_composite_cache != 0;
+	if( usecache )
+	{
+		// The log isn't thread safe, so the eviction reports back here
+		jobs->Flush( compositeevictjobs );
+		if( int32_t evicted = compositesevicted.exchange( 0 ); evicted > 0 )
+		{
+			I_LogAddEntryVar( Log_Normal, "R_PrecacheLevel: Removed %d cached composites built from old WADs", evicted );
+		}
+
+		std::error_code error;
+		std::filesystem::create_directories( R_CompositeCacheDir(), error );
+		usecache = !error;
+	}
+
 	for (i=0 ; i<numtextures ; i++)
 	{
 		if (!texturepresent[i])
 			continue;
 
-		texture = textures[i];
-	
+		Z_Malloc( texturecomposite[ i ].size, COMPOSITE_ZONE, &texturecomposite[ i ].data );
+
+		compositework_t work = { i };
+		if( usecache )
+		{
+			work.cachepath = R_CompositeCachePath( i, cachewads, work.wads );
+		}
+		compositework.push_back( std::move( work ) );
+	}
+
+	// Cached composites are read back in on the jobs alongside the flats.
+	// Only the ones that missed need their patches loaded.
+	constexpr int32_t CachedTexturesPerJob = 16;
+	if( usecache )
+	{
+		for( int32_t jobstart = 0; jobstart < (int32_t)compositework.size(); jobstart += CachedTexturesPerJob )
+		{
+			int32_t jobend = M_MIN( jobstart + CachedTexturesPerJob, (int32_t)compositework.size() );
+			jobs->AddJob( precachejobs, [ &compositework, jobstart, jobend ]()
+			{
+				for( compositework_t& work : std::span( compositework.begin() + jobstart, compositework.begin() + jobend ) )
+				{
+					work.cached = R_LoadCachedComposite( work.texnum, work.cachepath, texturecomposite[ work.texnum ].data );
+				}
+			} );
+		}
+
+		jobs->Flush( precachejobs );
+
+		std::erase_if( compositework, []( const compositework_t& work ) { return work.cached; } );
+	}
+
+	// Precache textures.
+	for( compositework_t& work : compositework )
+	{
+		texture = textures[ work.texnum ];
 		for (j=0 ; j<texture->patchcount ; j++)
 		{
 			lump = texture->patches[j].patch;
-			W_CacheLumpNum( lump , PU_LEVEL );
+			work.patches.push_back( (patch_t*)W_CacheLumpNum( lump , PU_LEVEL ) );
 		}
+	}
 
-		R_GenerateCompositeTexture( i );
+	constexpr int32_t TexturesPerJob = 8;
+	for( int32_t jobstart = 0; jobstart < (int32_t)compositework.size(); jobstart += TexturesPerJob )
+	{
+		int32_t jobend = M_MIN( jobstart + TexturesPerJob, (int32_t)compositework.size() );
+		jobs->AddJob( precachejobs, [ &compositework, jobstart, jobend ]()
+		{
+			for( compositework_t& work : std::span( compositework.begin() + jobstart, compositework.begin() + jobend ) )
+			{
+				byte* block = texturecomposite[ work.texnum ].data;
+				R_CompositeTextureInBlock( work.texnum, block, work.patches.data() );
+				if( !work.cachepath.empty() )
+				{
+					R_SaveCachedComposite( work.texnum, work.cachepath, work.wads, block );
+				}
+			}
+		} );
+	}
+
+	jobs->Flush( precachejobs );
+
+	for( size_t index : iota( (size_t)0, cachedflats.size() ) )
+	{
+		if( flatsources[ index ] != nullptr )
+		{
+			W_ReleaseLumpNum( flatindexlookup[ cachedflats[ index ] ].lumpindex );
+		}
 	}
 
 	for( auto& skyflatpair : skyflatlookup )
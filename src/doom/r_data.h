@@ -37,6 +37,9 @@ DOOM_C_API int32_t R_GetPatchYOffset( int32_t tex, int32_t patch );
 DOOM_C_API column_t* R_GetRawColumn( int32_t tex, int32_t patch, int32_t col );
 
 
+// If non-zero, level precaching keeps composited textures on disk
+DOOM_C_API extern int32_t texture_composite_cache;
+
 // I/O, setting up the stuff.
 DOOM_C_API void R_InitData (void);
 DOOM_C_API void R_PrecacheLevel (void);
@@ -82,6 +82,8 @@ typedef int32_t					vertclip_t;
 #define VANILLA_MAXVISSPRITES	128
 #define MAXVISSPRITES			1024
 
+#define DRAWSEGBUCKETSHIFT		5
+
 #define RENDER_PERF_GRAPHING	1
 #define MAXPROFILETIMES			( 35 * 4 )
 
@@ -613,10 +615,6 @@ typedef struct drawseg_s
 // I.e. a sprite object that is partly visible.
 typedef struct vissprite_s
 {
-	// Doubly linked list.
-	struct vissprite_s*	prev;
-	struct vissprite_s*	next;
-
 	int32_t				x1;
 	int32_t				x2;
 
@@ -897,19 +895,43 @@ typedef struct spritecontext_s
 {
 	int32_t				leftclip;
 	int32_t				rightclip;
+	int32_t				topclip;
+	int32_t				bottomclip;
 
-	// The +1 accounts for the overflow sprite
-	vissprite_t			vissprites[MAXVISSPRITES + 1];
+	// Matches mobjrender_t::rendered for things already projected
+	// in the current pass. Bumped every time a context renders
+	// another region in the same frame.
+	uint8_t				renderstamp;
 
+	// Scratch allocated, grows in MAXVISSPRITES steps
+	vissprite_t*		vissprites;
 	vissprite_t*		nextvissprite;
+	size_t				maxvissprites;
 
-	vissprite_t			vsprsortedhead;
+	// Back to front after R_SortVisSprites
+	vissprite_t**		sortedvissprites;
+	int32_t				numsortedvissprites;
+
+	// Drawsegs that can clip a sprite, bucketed by screen column.
+	// Each bucket lists drawseg indices in ascending order, so
+	// walking one backwards matches the vanilla clip order.
+	int32_t*			drawsegindex;
+	int32_t*			drawsegbucketstart;
+	int32_t*			drawsegworking;
+	int32_t*			drawsegmerged;
+	int32_t				numdrawsegbuckets;
 
 	vertclip_t*			clipbot;
 	vertclip_t*			cliptop;
 
 	vertclip_t*			mfloorclip;
 	vertclip_t*			mceilingclip;
+
+	// Screen bounds for player sprites, limited to the rows
+	// this context is rendering
+	vertclip_t*			screenfloorclip;
+	vertclip_t*			screenceilingclip;
+
 	rend_fixed_t		spryscale;
 	rend_fixed_t		spryiscale;
 	rend_fixed_t		sprtopscreen;
@@ -943,6 +965,12 @@ typedef struct colcontext_s
 	int32_t				centery;
 	rend_fixed_t		iscale;
 	rend_fixed_t		texturemid;
+
+	// Screen column the adjusted fuzz pattern is keyed on, and the
+	// rows fuzz is allowed to sample from
+	int32_t				fuzzcolumn;
+	int32_t				fuzztop;
+	int32_t				fuzzbottom;
 } colcontext_t;
 
 typedef struct player_s player_t;
@@ -973,6 +1001,42 @@ typedef struct viewpoint_s
 	angle_t				pitch;
 } viewpoint_t;
 
+// Per-context scratch memory. A list of cache line aligned chunks
+// that is bump allocated from and reset every frame. Chunks are kept
+// between frames, and new ones are only added when a frame needs more
+// than has ever been used before. Those get folded back into a single
+// chunk on the next reset, and trimmed back down on level load.
+typedef struct renderscratchchunk_s renderscratchchunk_t;
+
+struct renderscratchchunk_s
+{
+	renderscratchchunk_t*	next;
+	byte*					data;
+	size_t					size;
+};
+
+typedef struct renderscratch_s
+{
+	renderscratchchunk_t*	head;
+	renderscratchchunk_t*	tail;
+	renderscratchchunk_t*	curr;
+	size_t					pos;
+
+	size_t					used;
+	size_t					peak;
+	size_t					lastframe;
+	size_t					highwater;
+	size_t					capacity;
+	int32_t					numchunks;
+} renderscratch_t;
+
+typedef struct renderscratchmark_s
+{
+	renderscratchchunk_t*	curr;
+	size_t					pos;
+	size_t					used;
+} renderscratchmark_t;
+
 typedef struct rendercontext_s
 {
 	// Setup
@@ -985,6 +1049,8 @@ typedef struct rendercontext_s
 
 	int32_t				begincolumn;
 	int32_t				endcolumn;
+	int32_t				beginrow;
+	int32_t				endrow;
 
 	uint64_t			rendergametic;
 	pixel_t*			fuzzworkingbuffer;
@@ -1006,6 +1072,8 @@ typedef struct rendercontext_s
 	uint64_t			nextframetime;
 #endif // RENDER_PERF_GRAPHING
 
+	renderscratch_t		scratch;
+
 	bspcontext_t		bspcontext;
 	planecontext_t		planecontext;
 	spritecontext_t		spritecontext;
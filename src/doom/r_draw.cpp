@@ -29,6 +29,7 @@
 
 #include "m_misc.h"
 
+#include "r_kernels.h"
 #include "r_state.h"
 
 #include "v_video.h"
@@ -37,6 +38,8 @@
 
 #include "z_zone.h"
 
+#include <type_traits>
+
 extern "C"
 {
 
@@ -52,6 +55,7 @@ extern int32_t border_style;
 extern int32_t border_bezel_style;
 
 extern vbuffer_t* dest_buffer;
+extern doombool renderfuzz35Hz;
 
 //
 // All drawing to the view buffer is accomplished in this file.
@@ -698,6 +702,286 @@ void R_BackbufferDrawColumn_TranslatedAndTransparent( colcontext_t* context )
 	DrawColumn::Bytewise::BackbufferPaletteSwapTransparentDraw( context );
 }
 
+//
+// Vectorised kernels. Nothing calls these directly, R_InitRenderKernels
+// hands them out once it knows the CPU can run them and that they
+// produce exactly what the bytewise kernels produce.
+//
+// Texture heights top out at 512, so only the bottom 29 bits of a
+// frac ever matter. That lets us step fracs in 32-bit lanes and let
+// them wrap, which is twice as many pixels per vector as 64-bit lanes.
+//
+
+namespace DrawColumn
+{
+	struct Vectorised
+	{
+		template< size_t height, bool Translated, bool Transparent >
+		struct Remainder
+		{
+			using Original = DrawColumn::Bytewise::SamplerOriginal< height >;
+			using Sampler = std::conditional_t< Translated, typename Original::ColormapPaletteSwap, typename Original::Colormap >;
+			using Writer = std::conditional_t< Transparent, DrawColumn::Bytewise::WriterTransparent, DrawColumn::Bytewise::WriterDirect >;
+
+			// Whatever doesn't fill a full vector goes through the original path
+			static INLINE void Tail( colcontext_t* context, pixel_t*& dest, rend_fixed_t& frac, int32_t count )
+			{
+				while( count-- > 0 )
+				{
+					Writer::Write( context, dest, Sampler::Sample( context, frac ) );
+					frac += context->iscale;
+				}
+			}
+		};
+	};
+
+#if R_KERNELS_X86
+	struct AVX2
+	{
+		// Gathers read the dword that ends on the byte we want rather than
+		// the one that starts on it. That keeps every read inside the table,
+		// and every table we sample has a zone or lump header in front of
+		// it to absorb the three bytes of underrun.
+		static R_TARGET_AVX2 INLINE __m256i Gather( const byte* table, __m256i indices )
+		{
+			return _mm256_srli_epi32( _mm256_i32gather_epi32( (const int*)( table - 3 ), indices, 1 ), 24 );
+		}
+
+		static R_TARGET_AVX2 INLINE __m256i Load( const pixel_t* dest )
+		{
+			return _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)dest ) );
+		}
+
+		static R_TARGET_AVX2 INLINE void Store( pixel_t* dest, __m256i values )
+		{
+			const __m256i lowbytes = _mm256_setr_epi8(	0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+														0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 );
+			const __m256i lowdwords = _mm256_setr_epi32( 0, 4, 0, 0, 0, 0, 0, 0 );
+
+			values = _mm256_permutevar8x32_epi32( _mm256_shuffle_epi8( values, lowbytes ), lowdwords );
+			_mm_storel_epi64( (__m128i*)dest, _mm256_castsi256_si128( values ) );
+		}
+
+		template< size_t height, typename Lookup, bool Translated, bool Transparent >
+		requires( IsPowerOf2( height ) )
+		static R_TARGET_AVX2 void Draw( colcontext_t* context )
+		{
+			M_PROFILE_FUNC();
+
+			constexpr int32_t Mask = height - 1;
+
+			int32_t			count		= context->yh - context->yl + 1;
+			pixel_t*		dest		= context->output.data + Lookup::XOffset( context ) + Lookup::YOffset( context );
+			rend_fixed_t	frac		= Lookup::StartPos( context );
+
+			if( count >= 8 )
+			{
+				const __m256i	mask		= _mm256_set1_epi32( Mask );
+				const __m256i	step		= _mm256_set1_epi32( (int32_t)( context->iscale * 8 ) );
+				__m256i			fracs		= _mm256_add_epi32( _mm256_set1_epi32( (int32_t)frac )
+															, _mm256_mullo_epi32( _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 )
+																				, _mm256_set1_epi32( (int32_t)context->iscale ) ) );
+
+				int32_t			blocks		= count >> 3;
+				frac += context->iscale * ( blocks << 3 );
+				count &= 7;
+
+				do
+				{
+					__m256i samples = Gather( context->source, _mm256_and_si256( _mm256_srli_epi32( fracs, RENDFRACBITS ), mask ) );
+					if constexpr( Translated )
+					{
+						samples = Gather( context->translation, samples );
+					}
+					samples = Gather( context->colormap, samples );
+					if constexpr( Transparent )
+					{
+						samples = Gather( context->transparency, _mm256_add_epi32( samples, _mm256_slli_epi32( Load( dest ), 8 ) ) );
+					}
+					Store( dest, samples );
+
+					dest += 8;
+					fracs = _mm256_add_epi32( fracs, step );
+				} while( --blocks );
+			}
+
+			Vectorised::Remainder< height, Translated, Transparent >::Tail( context, dest, frac, count );
+		}
+	};
+#endif // R_KERNELS_X86
+
+#if R_KERNELS_ARM64
+	struct NEON
+	{
+		// There's no gather, but TBL can look up 64 bytes at a time.
+		// Four of those cover a full 256 byte colormap or translation.
+		// Indices out of range give zero, so the quarters just OR together.
+		struct Table
+		{
+			uint8x16x4_t quarters[ 4 ];
+		};
+
+		static INLINE void LoadTable( Table& table, const byte* source )
+		{
+			for( uint8x16x4_t& quarter : table.quarters )
+			{
+				quarter.val[ 0 ] = vld1q_u8( source );
+				quarter.val[ 1 ] = vld1q_u8( source + 16 );
+				quarter.val[ 2 ] = vld1q_u8( source + 32 );
+				quarter.val[ 3 ] = vld1q_u8( source + 48 );
+				source += 64;
+			}
+		}
+
+		static INLINE uint8x16_t Translate( const Table& table, uint8x16_t indices )
+		{
+			const uint8x16_t quartersize = vdupq_n_u8( 64 );
+
+			uint8x16_t result = vqtbl4q_u8( table.quarters[ 0 ], indices );
+			indices = vsubq_u8( indices, quartersize );
+			result = vorrq_u8( result, vqtbl4q_u8( table.quarters[ 1 ], indices ) );
+			indices = vsubq_u8( indices, quartersize );
+			result = vorrq_u8( result, vqtbl4q_u8( table.quarters[ 2 ], indices ) );
+			indices = vsubq_u8( indices, quartersize );
+			result = vorrq_u8( result, vqtbl4q_u8( table.quarters[ 3 ], indices ) );
+			return result;
+		}
+
+		template< size_t height, typename Lookup, bool Translated, bool Transparent >
+		requires( IsPowerOf2( height ) )
+		static void Draw( colcontext_t* context )
+		{
+			M_PROFILE_FUNC();
+
+			constexpr size_t Mask = height - 1;
+
+			int32_t			count		= context->yh - context->yl + 1;
+			pixel_t*		dest		= context->output.data + Lookup::XOffset( context ) + Lookup::YOffset( context );
+			rend_fixed_t	fracstep	= context->iscale;
+			rend_fixed_t	frac		= Lookup::StartPos( context );
+
+			// Loading the tables costs about as much as sixteen pixels,
+			// so short columns aren't worth it
+			if( count >= 16 )
+			{
+				Table colormap;
+				Table translation;
+				LoadTable( colormap, context->colormap );
+				if constexpr( Translated )
+				{
+					LoadTable( translation, context->translation );
+				}
+
+				alignas( 16 ) pixel_t texels[ 16 ];
+
+				do
+				{
+					for( pixel_t& texel : texels )
+					{
+						texel = context->source[ ( frac >> RENDFRACBITS ) & Mask ];
+						frac += fracstep;
+					}
+
+					uint8x16_t samples = vld1q_u8( texels );
+					if constexpr( Translated )
+					{
+						samples = Translate( translation, samples );
+					}
+					samples = Translate( colormap, samples );
+
+					if constexpr( Transparent )
+					{
+						vst1q_u8( texels, samples );
+						for( pixel_t texel : texels )
+						{
+							*dest = context->transparency[ (int32_t)texel + ( (int32_t)*dest << 8 ) ];
+							++dest;
+						}
+					}
+					else
+					{
+						vst1q_u8( dest, samples );
+						dest += 16;
+					}
+
+					count -= 16;
+				} while( count >= 16 );
+			}
+
+			Vectorised::Remainder< height, Translated, Transparent >::Tail( context, dest, frac, count );
+		}
+	};
+#endif // R_KERNELS_ARM64
+}
+
+template< typename Kernels >
+static void R_FillDrawColumnKernels( renderkernels_t* kernels )
+{
+	using namespace DrawColumn;
+
+	kernels->wallcolumn[ 0 ]					= &Kernels::template Draw< 16, ViewportLookup, false, false >;
+	kernels->wallcolumn[ 1 ]					= &Kernels::template Draw< 32, ViewportLookup, false, false >;
+	kernels->wallcolumn[ 2 ]					= &Kernels::template Draw< 64, ViewportLookup, false, false >;
+	kernels->wallcolumn[ 3 ]					= &Kernels::template Draw< 128, ViewportLookup, false, false >;
+	kernels->wallcolumn[ 4 ]					= &Kernels::template Draw< 256, ViewportLookup, false, false >;
+	kernels->wallcolumn[ 5 ]					= &Kernels::template Draw< 512, ViewportLookup, false, false >;
+
+	kernels->transparentcolumn[ 0 ]				= &Kernels::template Draw< 16, ViewportLookup, false, true >;
+	kernels->transparentcolumn[ 1 ]				= &Kernels::template Draw< 32, ViewportLookup, false, true >;
+	kernels->transparentcolumn[ 2 ]				= &Kernels::template Draw< 64, ViewportLookup, false, true >;
+	kernels->transparentcolumn[ 3 ]				= &Kernels::template Draw< 128, ViewportLookup, false, true >;
+	kernels->transparentcolumn[ 4 ]				= &Kernels::template Draw< 256, ViewportLookup, false, true >;
+	// Matches R_DrawColumn_Transparent_512, which samples as 256 high
+	kernels->transparentcolumn[ 5 ]				= &Kernels::template Draw< 256, ViewportLookup, false, true >;
+
+	kernels->spritecolumn						= &Kernels::template Draw< 128, ViewportSpriteLookup, false, false >;
+	kernels->spritetransparent					= &Kernels::template Draw< 128, ViewportSpriteLookup, false, true >;
+	kernels->spritetranslated					= &Kernels::template Draw< 128, ViewportSpriteLookup, true, false >;
+	kernels->spritetranslatedtransparent		= &Kernels::template Draw< 128, ViewportSpriteLookup, true, true >;
+}
+
+void R_GetDrawColumnKernels( renderkernels_t* kernels, renderkernelset_t set )
+{
+	switch( set )
+	{
+	case RKS_Scalar:
+		kernels->wallcolumn[ 0 ]				= &R_DrawColumn_Colormap_16;
+		kernels->wallcolumn[ 1 ]				= &R_DrawColumn_Colormap_32;
+		kernels->wallcolumn[ 2 ]				= &R_DrawColumn_Colormap_64;
+		kernels->wallcolumn[ 3 ]				= &R_DrawColumn_Colormap_128;
+		kernels->wallcolumn[ 4 ]				= &R_DrawColumn_Colormap_256;
+		kernels->wallcolumn[ 5 ]				= &R_DrawColumn_Colormap_512;
+
+		kernels->transparentcolumn[ 0 ]			= &R_DrawColumn_Transparent_16;
+		kernels->transparentcolumn[ 1 ]			= &R_DrawColumn_Transparent_32;
+		kernels->transparentcolumn[ 2 ]			= &R_DrawColumn_Transparent_64;
+		kernels->transparentcolumn[ 3 ]			= &R_DrawColumn_Transparent_128;
+		kernels->transparentcolumn[ 4 ]			= &R_DrawColumn_Transparent_256;
+		kernels->transparentcolumn[ 5 ]			= &R_DrawColumn_Transparent_512;
+
+		kernels->spritecolumn					= &R_SpriteDrawColumn_Colormap;
+		kernels->spritetransparent				= &R_SpriteDrawColumn_Transparent;
+		kernels->spritetranslated				= &R_SpriteDrawColumn_Translated;
+		kernels->spritetranslatedtransparent	= &R_SpriteDrawColumn_TranslatedAndTransparent;
+		break;
+
+#if R_KERNELS_X86
+	case RKS_AVX2:
+		R_FillDrawColumnKernels< DrawColumn::AVX2 >( kernels );
+		break;
+#endif // R_KERNELS_X86
+
+#if R_KERNELS_ARM64
+	case RKS_NEON:
+		R_FillDrawColumnKernels< DrawColumn::NEON >( kernels );
+		break;
+#endif // R_KERNELS_ARM64
+
+	default:
+		break;
+	}
+}
+
 
 //
 // Spectre/Invisibility.
@@ -830,9 +1114,27 @@ static const int32_t adjustedfuzzoffset[ ADJUSTEDFUZZTABLE ] =
 	FUZZOFF,-FUZZOFF,-FUZZOFF,-FUZZOFF,
 };
 
-thread_local int32_t	fuzzpos = 0;
-thread_local int32_t	cachedfuzzpos = 0;
-thread_local int32_t	framefuzzpos = 0;
+// Fuzz used to carry on from wherever the last column a thread drew
+// left off. Threads pick up different parts of the screen every frame,
+// so now every column works out where it starts in the table from
+// its position on screen and a seed that changes once per frame.
+static uint32_t				fuzzframeseed = 0;
+static uint64_t				fuzzgametic = ~0ull;
+
+void R_SetupFuzzForFrame( void )
+{
+	if( gametic != fuzzgametic || !renderfuzz35Hz )
+	{
+		fuzzframeseed = fuzzframeseed * 1664525u + 1013904223u;
+		fuzzgametic = gametic;
+	}
+}
+
+INLINE uint32_t R_FuzzColumnSeed( int32_t column )
+{
+	return fuzzframeseed + (uint32_t)column * FUZZPRIME;
+}
+
 //
 // Framebuffer postprocessing.
 // Creates a fuzzy image by copying pixels
@@ -841,55 +1143,29 @@ thread_local int32_t	framefuzzpos = 0;
 //  could create the SHADOW effect,
 //  i.e. spectres and invisible players.
 //
-void R_CacheFuzzColumn (void)
-{
-	cachedfuzzpos = fuzzpos;
-}
-
-void R_CacheFuzzColumnForFrame()
-{
-	framefuzzpos = cachedfuzzpos = fuzzpos;
-}
-
-void R_RestoreFuzzColumnForFrame()
-{
-	cachedfuzzpos = fuzzpos = framefuzzpos;
-}
-
+// Samples never leave [fuzztop, fuzzbottom]. Anything past
+// that could be getting drawn by another thread right now.
+//
 void R_DrawFuzzColumn ( colcontext_t* context ) 
 { 
-    int					count; 
-    pixel_t*			dest;
-	int32_t				fuzzposbase;
-	int32_t				fuzzposadd;
+	uint32_t			fuzzposadd = R_FuzzColumnSeed( context->x ) + context->yl;
 
-	fuzzposbase = fuzzpos;
-	fuzzposadd = fuzzposbase;
-
-	count = context->yh - context->yl;
-
-	dest = context->output.data + context->x * context->output.pitch + context->yl;
+	pixel_t* column = context->output.data + context->x * context->output.pitch;
 
     // Looks like an attempt at dithering,
     //  using the colormap #6 (of 0-31, a bit
     //  brighter than average).
-    do 
+	for( int32_t y = context->yl; y <= context->yh; ++y )
     {
 		// Lookup framebuffer, and retrieve
 		//  a pixel that is either one column
 		//  left or right of the current one.
 		// Add index from colormap to index.
-		*dest = colormaps[ 6*256 + dest[ fuzzoffset[ (uint32_t)fuzzposadd % FUZZTABLE ] ] ]; 
-
-		++dest;
+		int32_t sample = M_CLAMP( y + fuzzoffset[ fuzzposadd % FUZZTABLE ], context->fuzztop, context->fuzzbottom );
+		column[ y ] = colormaps[ 6*256 + column[ sample ] ]; 
 
 		++fuzzposadd;
-	
-	} while (count--);
-
-	// Doing the fuzzprime add basically eliminates banding
-	// But you kinda want it anyway to be able to see anything at high res...
-	fuzzpos += ( fuzzposadd - fuzzposbase /*+ ( M_Random() % FUZZPRIME )*/ );
+	}
 } 
 
 #define OLDFUZZ 1
@@ -898,19 +1174,26 @@ void R_DrawFuzzColumn ( colcontext_t* context )
 void R_DrawAdjustedFuzzColumn( colcontext_t* context )
 {
 	rend_fixed_t		originalcolfrac = RendFixedDiv( IntToRendFixed( 200 ), IntToRendFixed( drs_current->viewheight ) );
+
+	// Steps through the table in original 200-line pixels counted from
+	// the top of the screen, so a column split across tiles lines up
 	rend_fixed_t		oldfrac = 0;
-	rend_fixed_t		newfrac = 0;
+	rend_fixed_t		newfrac = originalcolfrac * context->yl;
 
-	int32_t				fuzzposadd			= fuzzpos = cachedfuzzpos;
+	uint32_t			fuzzposadd			= R_FuzzColumnSeed( context->fuzzcolumn ) + (uint32_t)RendFixedToInt( newfrac );
 	int32_t				fuzzpossample		= adjustedfuzzoffset[ fuzzposadd & ADJUSTEDFUZZTABLEMASK ];
 	pixel_t*			samplecolormap		= fuzzpossample < 0 ? context->fuzzdarkmap : context->fuzzlightmap;
 
 	int32_t count = context->yh - context->yl; 
 
-	pixel_t* dest = context->output.data + context->x * context->output.pitch + context->yl;
+	pixel_t* column = context->output.data + context->x * context->output.pitch;
+	pixel_t* dest = column + context->yl;
 
 	// count + 3 is correct. Since a 0 count will always sample one pixel. So make sure we copy one on each side of the sample.
-	memcpy( context->fuzzworkingbuffer, dest - 1, sizeof( pixel_t ) * ( count + 3 ) );
+	// The rows either side come from inside the region we own, another thread could be writing the real ones.
+	context->fuzzworkingbuffer[ 0 ] = column[ M_MAX( context->yl - 1, context->fuzztop ) ];
+	memcpy( context->fuzzworkingbuffer + 1, dest, sizeof( pixel_t ) * ( count + 1 ) );
+	context->fuzzworkingbuffer[ count + 2 ] = column[ M_MIN( context->yh + 1, context->fuzzbottom ) ];
 	pixel_t* src = context->fuzzworkingbuffer + 1;
 	int32_t srcadd = 0;
 
@@ -938,8 +1221,6 @@ void R_DrawAdjustedFuzzColumn( colcontext_t* context )
 		}
 
 	} while (count--);
-
-	fuzzpos = fuzzposadd + ( M_Random() % FUZZPRIME );
 }
 
 #else // !OLDFUZZ
@@ -953,7 +1234,7 @@ void R_DrawAdjustedFuzzColumn( colcontext_t* context )
 	constexpr rend_fixed_t offset = DoubleToRendFixed( 0.5 );
 
 	int32_t				fuzzposbase			= RendFixedToInt( drs_current->skyscaley + offset );
-	int32_t				fuzzposadd			= fuzzpos = cachedfuzzpos;
+	uint32_t			fuzzposadd			= R_FuzzColumnSeed( context->fuzzcolumn );
 	int32_t				fuzzpossample		= adjustedfuzzoffset[ fuzzposadd & ADJUSTEDFUZZTABLEMASK ] * fuzzposbase;
 	pixel_t*			samplecolormap		= context->fuzzlightmap;
 
@@ -990,8 +1271,6 @@ void R_DrawAdjustedFuzzColumn( colcontext_t* context )
 		}
 
 	} while (count--);
-
-	fuzzpos = fuzzposadd + ( M_Random() % FUZZPRIME );
 }
 
 #endif // OLDFUZZ
@@ -1063,7 +1342,7 @@ static void R_RemapBackBuffer( int32_t virtualx, int32_t virtualy, int32_t virtu
 void R_FillBackScreen (void) 
 { 
 	vbuffer_t src;
-	vbuffer_t inflated;
+	vbuffer_t inflated = {};
 
 	int32_t viewx = FixedToInt( FixedDiv( IntToFixed( drs_current->viewwindowx ),		V_WIDTHMULTIPLIER ) );
 	int32_t viewy = FixedToInt( FixedDiv( IntToFixed( drs_current->viewwindowy ),		V_HEIGHTMULTIPLIER ) );
@@ -1146,11 +1425,15 @@ void R_FillBackScreen (void)
 		src.pixel_size_bytes = 1;
 		src.magic_value = vbuffer_magic;
 
-		V_TransposeBuffer( &src, &inflated, PU_CACHE );
+		// The owner lives on this stack frame, so the block can't be
+		// left around for the purge to write through later
+		V_TransposeBuffer( &src, &inflated, PU_STATIC );
 
 		V_TileBuffer( &inflated, 0, 0, V_VIRTUALWIDTH, V_VIRTUALHEIGHT - ST_HEIGHT );
 		//V_FillBorder( &inflated, 0, V_VIRTUALHEIGHT - ST_HEIGHT );
 
+		Z_Free( inflated.data );
+
 		break;
 	}
 
@@ -103,9 +103,8 @@ void R_DrawColumn_OneSample ( colcontext_t* context );
 
 
 // The Spectre/Invisibility effect.
-void R_CacheFuzzColumn();
-void R_CacheFuzzColumnForFrame();
-void R_RestoreFuzzColumnForFrame();
+// Picks the pattern for the frame. Call before any rendering starts.
+void R_SetupFuzzForFrame( void );
 void R_DrawFuzzColumn ( colcontext_t* context );
 void R_DrawAdjustedFuzzColumn( colcontext_t* context );
 void R_DrawHeatwaveFuzzColumn( colcontext_t* context );
@@ -0,0 +1,370 @@
+//
+// Copyright(C) 2020-2022 Ethan Watson
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION: Renderer kernel registry. Picks the vectorised
+//              column and span kernels the CPU supports at startup,
+//              checking each against the scalar reference first.
+//
+
+#include "r_kernels.h"
+
+#include "i_log.h"
+#include "m_argv.h"
+#include "m_container.h"
+#include "m_fixed.h"
+#include "m_misc.h"
+
+#include <cstring>
+#include <span>
+#include <vector>
+
+#if R_KERNELS_X86 && defined( _MSC_VER ) && !defined( __clang__ )
+#include <intrin.h>
+#endif
+
+renderkernels_t		renderkernels;
+renderkernelset_t	renderkernelset = RKS_Scalar;
+
+static const char* kernelsetnames[ RKS_Max ] =
+{
+	"scalar",
+	"AVX2",
+	"NEON",
+};
+
+const char* R_RenderKernelSetName( renderkernelset_t set )
+{
+	return set >= RKS_Scalar && set < RKS_Max ? kernelsetnames[ set ] : "unknown";
+}
+
+static doombool R_CPUSupports( renderkernelset_t set )
+{
+	switch( set )
+	{
+	case RKS_Scalar:
+		return true;
+
+#if R_KERNELS_X86
+	case RKS_AVX2:
+		{
+#if defined( _MSC_VER ) && !defined( __clang__ )
+			constexpr int32_t OSXSAVE	= 1 << 27;
+			constexpr int32_t AVX		= 1 << 28;
+			constexpr int32_t AVX2		= 1 << 5;
+
+			int32_t registers[ 4 ];
+			__cpuid( registers, 0 );
+			if( registers[ 0 ] < 7 )
+			{
+				return false;
+			}
+
+			__cpuid( registers, 1 );
+			if( ( registers[ 2 ] & ( OSXSAVE | AVX ) ) != ( OSXSAVE | AVX ) )
+			{
+				return false;
+			}
+
+			// The OS also needs to be preserving the upper halves of the YMM registers
+			if( ( _xgetbv( 0 ) & 6 ) != 6 )
+			{
+				return false;
+			}
+
+			__cpuidex( registers, 7, 0 );
+			return ( registers[ 1 ] & AVX2 ) != 0;
+#else
+			// Does the OSXSAVE/XGETBV dance for us
+			__builtin_cpu_init();
+			return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+		}
+#endif // R_KERNELS_X86
+
+#if R_KERNELS_ARM64
+	case RKS_NEON:
+		return true;
+#endif // R_KERNELS_ARM64
+
+	default:
+		break;
+	}
+
+	return false;
+}
+
+//
+// Self-test. Every candidate kernel gets run over the same random data
+// as its scalar reference, and it needs to produce exactly the same
+// bytes. Not just in the span it was asked to draw, the whole buffer
+// gets checked so that overruns get caught too.
+//
+
+// Vectorised kernels read the three bytes in front of a table, so every
+// test table gets some slack in front of it like the zone would give it
+constexpr size_t TestTablePadding		= 16;
+constexpr int32_t TestPitch				= 512;
+constexpr int32_t TestColumnCases		= 96;
+constexpr int32_t TestSpanCases			= 48;
+constexpr int32_t TestSpanMaxLength		= 64;
+constexpr int32_t TestColormaps			= 32;
+
+class KernelTestRandom
+{
+public:
+	KernelTestRandom( uint32_t seed )
+		: state( seed )
+	{
+	}
+
+	uint32_t Next()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	int64_t Range( int64_t min, int64_t max )
+	{
+		uint64_t value = ( (uint64_t)Next() << 32 ) | Next();
+		return min + (int64_t)( value % (uint64_t)( max - min + 1 ) );
+	}
+
+	void Fill( byte* data, size_t size )
+	{
+		for( byte& val : std::span( data, size ) )
+		{
+			val = (byte)Next();
+		}
+	}
+
+private:
+	uint32_t state;
+};
+
+class KernelTestTable
+{
+public:
+	KernelTestTable( size_t size, KernelTestRandom& random )
+		: storage( TestTablePadding + size )
+	{
+		random.Fill( storage.data(), storage.size() );
+	}
+
+	byte* Data() { return storage.data() + TestTablePadding; }
+
+private:
+	std::vector< byte > storage;
+};
+
+static doombool R_TestColumnKernel( colfunc_t reference, colfunc_t candidate )
+{
+	KernelTestRandom random( 0x1D4A11A5 );
+
+	KernelTestTable source( 1024, random );
+	KernelTestTable colormap( 256, random );
+	KernelTestTable translation( 256, random );
+	KernelTestTable transparency( 256 * 256, random );
+
+	std::vector< pixel_t > expected( TestPitch * 2 );
+	std::vector< pixel_t > actual( TestPitch * 2 );
+
+	constexpr rend_fixed_t FixedScales[] =
+	{
+		IntToRendFixed( 1 ),
+		IntToRendFixed( 1 ) / 3,
+		IntToRendFixed( 1 ) / 16,
+		IntToRendFixed( 2 ) + 0x3421,
+		IntToRendFixed( 7 ) - 1,
+	};
+
+	for( int32_t testcase : iota( 0, TestColumnCases ) )
+	{
+		colcontext_t context = {};
+		context.source			= source.Data();
+		context.sourceheight	= IntToRendFixed( 128 );
+		context.colormap		= colormap.Data();
+		context.translation		= translation.Data();
+		context.transparency	= transparency.Data();
+		context.x				= 1;
+		context.centery			= 100;
+		context.yl				= (int32_t)random.Range( 0, 255 );
+		context.yh				= context.yl + (int32_t)random.Range( 0, 255 );
+		context.texturemid		= random.Range( -IntToRendFixed( 256 ), IntToRendFixed( 256 ) );
+		context.iscale			= testcase < (int32_t)arrlen( FixedScales ) ? FixedScales[ testcase ]
+																	: random.Range( 1, IntToRendFixed( 4 ) );
+
+		random.Fill( expected.data(), expected.size() );
+		memcpy( actual.data(), expected.data(), expected.size() );
+
+		context.output.pitch = TestPitch;
+		context.output.data = expected.data();
+		reference( &context );
+
+		context.output.data = actual.data();
+		candidate( &context );
+
+		if( memcmp( expected.data(), actual.data(), expected.size() ) != 0 )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static doombool R_TestSpanKernel( rasterspanfunc_t reference, rasterspanfunc_t candidate )
+{
+	KernelTestRandom random( 0xF1A75EED );
+
+	KernelTestTable source( 1024 * 512, random );
+	KernelTestTable colormaps( TestColormaps * 256, random );
+
+	std::vector< rastercache_t > raster( TestSpanMaxLength );
+	std::vector< pixel_t > expected( TestSpanMaxLength + 16 );
+	std::vector< pixel_t > actual( TestSpanMaxLength + 16 );
+
+	for( int32_t testcase : iota( 0, TestSpanCases ) )
+	{
+		for( rastercache_t& row : raster )
+		{
+			row.colormap = colormaps.Data() + random.Range( 0, TestColormaps - 1 ) * 256;
+		}
+
+		// Leap blocks are 4, 8 or 16 pixels, but the tails get tested too
+		int32_t count = (int32_t)random.Range( 1, TestSpanMaxLength / 4 ) * 4 - ( testcase & 3 );
+
+		rend_fixed_t xfrac = random.Range( -( IntToRendFixed( 1 ) << 20 ), IntToRendFixed( 1 ) << 20 );
+		rend_fixed_t yfrac = random.Range( -( IntToRendFixed( 1 ) << 20 ), IntToRendFixed( 1 ) << 20 );
+		rend_fixed_t xstep = random.Range( -IntToRendFixed( 16 ), IntToRendFixed( 16 ) );
+		rend_fixed_t ystep = random.Range( -IntToRendFixed( 16 ), IntToRendFixed( 16 ) );
+
+		random.Fill( expected.data(), expected.size() );
+		memcpy( actual.data(), expected.data(), expected.size() );
+
+		reference( expected.data(), source.Data(), raster.data(), xfrac, xstep, yfrac, ystep, count );
+		candidate( actual.data(), source.Data(), raster.data(), xfrac, xstep, yfrac, ystep, count );
+
+		if( memcmp( expected.data(), actual.data(), expected.size() ) != 0 )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+typedef struct kernelselection_s
+{
+	int32_t		vectorised;
+	int32_t		rejected;
+} kernelselection_t;
+
+template< typename _func, typename _test >
+static void R_SelectKernel( _func& dest, _func reference, _func candidate, kernelselection_t& selection, const char* name, _test&& test )
+{
+	dest = reference;
+	if( candidate == nullptr || candidate == reference )
+	{
+		return;
+	}
+
+	if( test( reference, candidate ) )
+	{
+		dest = candidate;
+		++selection.vectorised;
+	}
+	else
+	{
+		I_LogAddEntryVar( Log_Warning, "R_InitRenderKernels: %s %s kernel doesn't match the scalar kernel, ignoring it", kernelsetnames[ renderkernelset ], name );
+		++selection.rejected;
+	}
+}
+
+void R_InitRenderKernels( void )
+{
+	renderkernels_t reference = {};
+	R_GetDrawColumnKernels( &reference, RKS_Scalar );
+	R_GetRasteriserKernels( &reference, RKS_Scalar );
+
+	renderkernels = reference;
+	renderkernelset = RKS_Scalar;
+
+	//!
+	// @category video
+	//
+	// Always use the scalar renderer kernels, even if the CPU supports
+	// vectorised versions.
+	//
+
+	if( M_ParmExists( "-nosimd" ) )
+	{
+		I_LogAddEntry( Log_System, "R_InitRenderKernels: Vectorised kernels disabled from command line" );
+		return;
+	}
+
+	for( int32_t set = RKS_Max - 1; set > RKS_Scalar; --set )
+	{
+		if( R_CPUSupports( (renderkernelset_t)set ) )
+		{
+			renderkernelset = (renderkernelset_t)set;
+			break;
+		}
+	}
+
+	if( renderkernelset == RKS_Scalar )
+	{
+		I_LogAddEntry( Log_System, "R_InitRenderKernels: No supported vector instruction set, using scalar kernels" );
+		return;
+	}
+
+	renderkernels_t candidates = {};
+	R_GetDrawColumnKernels( &candidates, renderkernelset );
+	R_GetRasteriserKernels( &candidates, renderkernelset );
+
+	kernelselection_t selection = {};
+	char name[ 64 ];
+
+	for( int32_t index : iota( 0, RK_COLUMNHEIGHTS ) )
+	{
+		M_snprintf( name, sizeof( name ), "wall column %d", 16 << index );
+		R_SelectKernel( renderkernels.wallcolumn[ index ], reference.wallcolumn[ index ], candidates.wallcolumn[ index ], selection, name, &R_TestColumnKernel );
+		M_snprintf( name, sizeof( name ), "transparent column %d", 16 << index );
+		R_SelectKernel( renderkernels.transparentcolumn[ index ], reference.transparentcolumn[ index ], candidates.transparentcolumn[ index ], selection, name, &R_TestColumnKernel );
+	}
+
+	R_SelectKernel( renderkernels.spritecolumn, reference.spritecolumn, candidates.spritecolumn, selection, "sprite column", &R_TestColumnKernel );
+	R_SelectKernel( renderkernels.spritetransparent, reference.spritetransparent, candidates.spritetransparent, selection, "transparent sprite column", &R_TestColumnKernel );
+	R_SelectKernel( renderkernels.spritetranslated, reference.spritetranslated, candidates.spritetranslated, selection, "translated sprite column", &R_TestColumnKernel );
+	R_SelectKernel( renderkernels.spritetranslatedtransparent, reference.spritetranslatedtransparent, candidates.spritetranslatedtransparent, selection, "translated transparent sprite column", &R_TestColumnKernel );
+
+	for( int32_t width : iota( 0, RK_FLATWIDTHS ) )
+	{
+		for( int32_t height : iota( 0, RK_FLATHEIGHTS ) )
+		{
+			M_snprintf( name, sizeof( name ), "%dx%d flat", 16 << width, 16 << height );
+			R_SelectKernel( renderkernels.flatspan[ width ][ height ], reference.flatspan[ width ][ height ], candidates.flatspan[ width ][ height ], selection, name, &R_TestSpanKernel );
+
+			// The rasteriser is only as good as the span inside it
+			renderkernels.flat[ width ][ height ] = renderkernels.flatspan[ width ][ height ] == reference.flatspan[ width ][ height ]
+													? reference.flat[ width ][ height ]
+													: candidates.flat[ width ][ height ];
+		}
+	}
+
+	I_LogAddEntryVar( Log_System, "R_InitRenderKernels: Using %s kernels, %d vectorised, %d rejected by self-test"
+									, kernelsetnames[ renderkernelset ]
+									, selection.vectorised
+									, selection.rejected );
+}
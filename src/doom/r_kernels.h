@@ -0,0 +1,106 @@
+//
+// Copyright(C) 2020-2022 Ethan Watson
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION: Renderer kernel registry. Picks the vectorised
+//              column and span kernels the CPU supports at startup,
+//              checking each against the scalar reference first.
+//
+
+#ifndef __R_KERNELS__
+#define __R_KERNELS__
+
+#include "doomtype.h"
+#include "r_defs.h"
+
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __i386__ ) || defined( __x86_64__ )
+	#define R_KERNELS_X86 1
+	#define R_KERNELS_ARM64 0
+#elif defined( _M_ARM64 ) || defined( __aarch64__ )
+	#define R_KERNELS_X86 0
+	#define R_KERNELS_ARM64 1
+#else
+	#define R_KERNELS_X86 0
+	#define R_KERNELS_ARM64 0
+#endif
+
+// GCC and Clang need to be told per function which instruction sets
+// they can use, so that the kernels compile without raising the
+// baseline for the rest of the executable. MSVC lets you use any
+// intrinsic anywhere.
+#if R_KERNELS_X86 && ( defined( __GNUC__ ) || defined( __clang__ ) )
+	#define R_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#else
+	#define R_TARGET_AVX2
+#endif
+
+#if R_KERNELS_X86
+	#include <immintrin.h>
+#elif R_KERNELS_ARM64
+	// NEON is mandatory on AArch64, so there's no target juggling required
+	#include <arm_neon.h>
+#endif
+
+typedef enum renderkernelset_e
+{
+	RKS_Scalar,
+	RKS_AVX2,
+	RKS_NEON,
+
+	RKS_Max,
+} renderkernelset_t;
+
+// Fills dest with count perspective correct flat samples, starting
+// with raster. Leap blocks are always a multiple of four pixels.
+typedef void (*rasterspanfunc_t)( pixel_t* dest, pixel_t* source, rastercache_t* raster
+								, rend_fixed_t xfrac, rend_fixed_t xstep
+								, rend_fixed_t yfrac, rend_fixed_t ystep
+								, int32_t count );
+
+#define RK_COLUMNHEIGHTS 6
+#define RK_FLATWIDTHS 7
+#define RK_FLATHEIGHTS 6
+
+typedef struct renderkernels_s
+{
+	// Power-of-two texture heights, 16 -> 512
+	colfunc_t			wallcolumn[ RK_COLUMNHEIGHTS ];
+	colfunc_t			transparentcolumn[ RK_COLUMNHEIGHTS ];
+
+	colfunc_t			spritecolumn;
+	colfunc_t			spritetransparent;
+	colfunc_t			spritetranslated;
+	colfunc_t			spritetranslatedtransparent;
+
+	// Power-of-two flat sizes, 16 -> 1024 wide and 16 -> 512 high.
+	// The span is what actually does the work and what gets tested,
+	// the rasteriser just needs to be the one built around that span.
+	rasterfunc_t		flat[ RK_FLATWIDTHS ][ RK_FLATHEIGHTS ];
+	rasterspanfunc_t	flatspan[ RK_FLATWIDTHS ][ RK_FLATHEIGHTS ];
+} renderkernels_t;
+
+// The kernels the renderer should be calling
+DOOM_C_API extern renderkernels_t		renderkernels;
+DOOM_C_API extern renderkernelset_t		renderkernelset;
+
+// Selects the best kernels for this CPU. Needs to happen before any
+// composites are built, as they cache the function pointers.
+DOOM_C_API void R_InitRenderKernels( void );
+
+DOOM_C_API const char* R_RenderKernelSetName( renderkernelset_t set );
+
+// Each kernel provider fills in what it supports for the given set,
+// and leaves everything else NULL
+DOOM_C_API void R_GetDrawColumnKernels( renderkernels_t* kernels, renderkernelset_t set );
+DOOM_C_API void R_GetRasteriserKernels( renderkernels_t* kernels, renderkernelset_t set );
+
+#endif // __R_KERNELS__
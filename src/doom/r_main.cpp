@@ -37,6 +37,7 @@
 #include "p_local.h"
 #include "r_main.h"
 #include "r_local.h"
+#include "r_kernels.h"
 
 #include "w_wad.h"
 
@@ -93,6 +94,10 @@ extern "C"
 	double_t				renderscalecontextsby = 0.0;
 	int32_t					rebalancescale = 25;
 	doombool				renderSIMDcolumns = false;
+	doombool				rendersharedbsp = false;
+	doombool				rendertiling = false;
+	int32_t					rendertilecolumns = 2;
+	int32_t					rendertilerows = 2;
 	atomicval_t				renderthreadCPUmelter = 0;
 	int32_t					performancegraphscale = 20;
 
@@ -107,6 +112,7 @@ extern "C"
 
 	// just for profiling purposes
 	int32_t					framecount;	
+	uint64_t				renderviewtime = 0;
 
 	constexpr size_t DRSNumViewAngles = RENDERFINEANGLES / 2;
 
@@ -167,9 +173,20 @@ extern "C"
 }
 
 // Actually expects C++ linkage
-std::atomic< atomicval_t >	renderscratchpos = 0;
-std::atomic< atomicval_t >	renderscratchsize = 0;
-byte*		renderscratch = nullptr;
+thread_local renderscratch_t*	renderscratchcurrent = nullptr;
+renderscratch_t				renderframescratch = {};
+
+bspfrontend_t				renderfrontend;
+
+typedef struct rendertile_s
+{
+	int32_t					begincolumn;
+	int32_t					endcolumn;
+	int32_t					beginrow;
+	int32_t					endrow;
+} rendertile_t;
+
+std::vector< rendertile_t >	rendertiles;
 
 constexpr int32_t viewwidthforblocks[] =
 {
@@ -522,6 +539,7 @@ void R_BindRenderVariables( void )
 	M_BindIntVariable("additional_light_boost",		&additional_light_boost );
 	M_BindIntVariable("vertical_fov_degrees",		&vertical_fov_degrees );
 	M_BindIntVariable("view_bobbing_percent",			&view_bobbing_percent );
+	M_BindIntVariable("texture_composite_cache",	&texture_composite_cache );
 }
 
 #define PI acos(-1.0)
@@ -867,6 +885,12 @@ void R_ResetContext( rendercontext_t& context, int32_t leftclip, int32_t rightcl
 	context.endcolumn = context.spritecontext.rightclip = rightclip;
 }
 
+void R_ResetContextRows( rendercontext_t& context, int32_t topclip, int32_t bottomclip )
+{
+	context.beginrow = context.spritecontext.topclip = topclip;
+	context.endrow = context.spritecontext.bottomclip = bottomclip;
+}
+
 void R_AllocateContextData( rendercontext_t& context )
 {
 	M_PROFILE_FUNC();
@@ -875,54 +899,46 @@ void R_AllocateContextData( rendercontext_t& context )
 
 	R_ClearClipSegs( context.bspcontext, context.begincolumn, context.endcolumn );
 	R_ClearDrawSegs( context.bspcontext );
-	R_ClearPlanes( &context.planecontext, drs_current->viewwidth, drs_current->viewheight );
+	R_ClearPlanes( &context.planecontext, drs_current->viewwidth, drs_current->viewheight, context.beginrow, context.endrow );
 	R_ClearSprites( context.spritecontext );
 }
 
-void R_RenderViewContext( rendercontext_t& rendercontext )
+//
+// R_RenderViewContextRegion
+// Renders whatever columns and rows the context is currently
+// set up for. Column mode calls this once per frame, tile mode
+// calls it for every tile the context pulls off the queue.
+//
+void R_RenderViewContextRegion( rendercontext_t& rendercontext )
 {
 	M_PROFILE_FUNC();
 
-	byte*			output		= rendercontext.buffer.data + rendercontext.buffer.pitch * rendercontext.begincolumn;
-	size_t			outputsize	= rendercontext.buffer.pitch * (rendercontext.endcolumn - rendercontext.begincolumn );
-
-	rendercontext.starttime = I_GetTimeUS();
-#if RENDER_PERF_GRAPHING
-	rendercontext.bspcontext.storetimetaken = 0;
-	rendercontext.bspcontext.solidtimetaken = 0;
-	rendercontext.bspcontext.maskedtimetaken = 0;
-	rendercontext.bspcontext.findvisplanetimetaken = 0;
-	rendercontext.bspcontext.addspritestimetaken = 0;
-	rendercontext.bspcontext.addlinestimetaken = 0;
-
-	rendercontext.planecontext.flattimetaken = 0;
-
-	rendercontext.spritecontext.maskedtimetaken = 0;
-#endif
-
-	if( gametic != rendercontext.rendergametic )
-	{
-		R_CacheFuzzColumnForFrame();
-	}
-	else if( renderfuzz35Hz )
-	{
-		R_RestoreFuzzColumnForFrame();
-	}
-
-	rendercontext.rendergametic = gametic;
+	++rendercontext.spritecontext.renderstamp;
 
 	R_AllocateContextData( rendercontext );
 
-	if( voidcleartype == Void_Black )
+	if( voidcleartype == Void_Black || voidcleartype == Void_Whacky )
 	{
-		memset( output, 0, outputsize );
-	}
-	else if( voidcleartype == Void_Whacky )
-	{
-		memset( output, whacky_void_indices[ ( rendercontext.starttime % whacky_void_microseconds ) / ( whacky_void_microseconds / num_whacky_void_indices ) ], outputsize );
+		byte clearcolor = voidcleartype == Void_Black ? 0
+						: whacky_void_indices[ ( rendercontext.starttime % whacky_void_microseconds ) / ( whacky_void_microseconds / num_whacky_void_indices ) ];
+
+		if( rendercontext.beginrow == 0 && rendercontext.endrow == drs_current->viewheight )
+		{
+			byte*			output		= rendercontext.buffer.data + rendercontext.buffer.pitch * rendercontext.begincolumn;
+			size_t			outputsize	= rendercontext.buffer.pitch * (rendercontext.endcolumn - rendercontext.begincolumn );
+			memset( output, clearcolor, outputsize );
+		}
+		else
+		{
+			for( int32_t x = rendercontext.begincolumn; x < rendercontext.endcolumn; ++x )
+			{
+				byte* output = rendercontext.viewbuffer.data + rendercontext.viewbuffer.pitch * x + rendercontext.beginrow;
+				memset( output, clearcolor, rendercontext.endrow - rendercontext.beginrow );
+			}
+		}
 	}
 #if 0
-	else if( voidcleartype == Void_Sky )
+	if( voidcleartype == Void_Sky )
 	{
 		colcontext_t skycontext = {};
 
@@ -954,10 +970,18 @@ void R_RenderViewContext( rendercontext_t& rendercontext )
 		}
 	}
 #endif
-		
+	
 	rendercontext.planecontext.output = rendercontext.viewbuffer;
 	rendercontext.planecontext.spantype = M_MAX( Span_PolyRaster_Log2_4, M_MIN( (int32_t)( log2f( drs_current->frame_height * 0.02f ) + 0.5f ), Span_PolyRaster_Log2_32 ) );
 
+	// Tiles always replay the shared walk, walking the whole BSP again
+	// for every tile would make the front end cost scale with tile count
+	if( rendersharedbsp || rendertiling )
+	{
+		M_PROFILE_NAMED( "R_RenderBSPFrontEnd" );
+		R_RenderBSPFrontEnd( rendercontext, renderfrontend );
+	}
+	else
 	{
 		M_PROFILE_NAMED( "R_RenderBSPNode" );
 		R_RenderBSPNode( rendercontext, numnodes-1 );
@@ -967,7 +991,29 @@ void R_RenderViewContext( rendercontext_t& rendercontext )
 		M_PROFILE_NAMED( "R_DrawMasked" );
 		R_DrawMasked( rendercontext );
 	}
+}
+
+void R_RenderViewContextBegin( rendercontext_t& rendercontext )
+{
+	rendercontext.starttime = I_GetTimeUS();
+#if RENDER_PERF_GRAPHING
+	rendercontext.bspcontext.storetimetaken = 0;
+	rendercontext.bspcontext.solidtimetaken = 0;
+	rendercontext.bspcontext.maskedtimetaken = 0;
+	rendercontext.bspcontext.findvisplanetimetaken = 0;
+	rendercontext.bspcontext.addspritestimetaken = 0;
+	rendercontext.bspcontext.addlinestimetaken = 0;
+
+	rendercontext.planecontext.flattimetaken = 0;
+
+	rendercontext.spritecontext.maskedtimetaken = 0;
+#endif
+
+	rendercontext.rendergametic = gametic;
+}
 
+void R_RenderViewContextEnd( rendercontext_t& rendercontext )
+{
 	rendercontext.endtime = I_GetTimeUS();
 	rendercontext.timetaken = rendercontext.endtime - rendercontext.starttime;
 
@@ -1001,6 +1047,192 @@ void R_RenderViewContext( rendercontext_t& rendercontext )
 #endif
 }
 
+void R_RenderViewContext( rendercontext_t& rendercontext )
+{
+	M_PROFILE_FUNC();
+
+	RenderScratchScope scope( rendercontext.scratch );
+
+	R_RenderViewContextBegin( rendercontext );
+	R_RenderViewContextRegion( rendercontext );
+	R_RenderViewContextEnd( rendercontext );
+}
+
+//
+// R_RenderViewContextTiles
+// Keeps pulling tiles off the shared queue until there are none
+// left. Timing covers every tile this context ended up rendering.
+//
+void R_RenderViewContextTiles( rendercontext_t& rendercontext, std::atomic< int32_t >& nexttile )
+{
+	M_PROFILE_FUNC();
+
+	RenderScratchScope scope( rendercontext.scratch );
+
+	R_RenderViewContextBegin( rendercontext );
+
+	// Nothing a tile allocates outlives it, so every tile reuses
+	// the same scratch memory
+	renderscratchmark_t mark = R_ScratchMark( rendercontext.scratch );
+
+	int32_t tile;
+	while( ( tile = nexttile.fetch_add( 1 ) ) < (int32_t)rendertiles.size() )
+	{
+		const rendertile_t& curr = rendertiles[ tile ];
+		R_ResetContext( rendercontext, curr.begincolumn, curr.endcolumn );
+		R_ResetContextRows( rendercontext, curr.beginrow, curr.endrow );
+		R_RenderViewContextRegion( rendercontext );
+		R_ScratchRewind( rendercontext.scratch, mark );
+	}
+
+	R_RenderViewContextEnd( rendercontext );
+}
+
+//
+// R_SetupTiles
+// Splits the view into a grid of column strips and row bands.
+// Tile sizes are fixed; balancing comes from threads pulling
+// the next free tile as soon as they finish their last one.
+//
+void R_SetupTiles( void )
+{
+	int32_t numcolumns = M_MAX( 1, num_render_contexts * rendertilecolumns );
+	int32_t numrows = M_MAX( 1, rendertilerows );
+
+	numcolumns = M_MIN( numcolumns, drs_current->viewwidth );
+	numrows = M_MIN( numrows, drs_current->viewheight );
+
+	// mobjrender_t::rendered holds a per-pass stamp in a byte, a single
+	// context can't be allowed to see more tiles than that per frame
+	constexpr int32_t MaxTiles = 255;
+	numcolumns = M_MIN( numcolumns, MaxTiles / numrows );
+
+	rendertiles.clear();
+	for( int32_t row = 0; row < numrows; ++row )
+	{
+		int32_t beginrow = ( drs_current->viewheight * row ) / numrows;
+		int32_t endrow = ( drs_current->viewheight * ( row + 1 ) ) / numrows;
+
+		for( int32_t column = 0; column < numcolumns; ++column )
+		{
+			int32_t begincolumn = ( drs_current->viewwidth * column ) / numcolumns;
+			int32_t endcolumn = ( drs_current->viewwidth * ( column + 1 ) ) / numcolumns;
+
+			rendertiles.push_back( { begincolumn, endcolumn, beginrow, endrow } );
+		}
+	}
+}
+
+static void R_ScratchAddChunk( renderscratch_t& scratch, size_t numbytes )
+{
+	size_t chunksize = M_MAX( RenderScratchChunkSize, AlignTo< RenderScratchChunkSize >( numbytes ) );
+	size_t allocsize = sizeof( renderscratchchunk_t ) + chunksize + RenderScratchAlignment;
+
+	// Render threads grow their own arenas mid-frame, and the zone
+	// isn't safe to allocate from off the main thread
+	renderscratchchunk_t* chunk = (renderscratchchunk_t*)malloc( allocsize );
+	if( chunk == nullptr )
+	{
+		I_Error( "R_ScratchAddChunk: Failed to allocate %d bytes of scratch memory", (int32_t)allocsize );
+	}
+	chunk->next = nullptr;
+	chunk->data = (byte*)AlignTo< RenderScratchAlignment >( (uintptr_t)( chunk + 1 ) );
+	chunk->size = chunksize;
+
+	if( scratch.tail ) scratch.tail->next = chunk;
+	else scratch.head = chunk;
+	scratch.tail = chunk;
+
+	scratch.capacity += chunksize;
+	++scratch.numchunks;
+}
+
+static void R_ScratchFreeChunks( renderscratch_t& scratch )
+{
+	renderscratchchunk_t* next = nullptr;
+	for( renderscratchchunk_t* chunk = scratch.head; chunk != nullptr; chunk = next )
+	{
+		next = chunk->next;
+		free( chunk );
+	}
+
+	scratch.head = scratch.tail = scratch.curr = nullptr;
+	scratch.capacity = 0;
+	scratch.numchunks = 0;
+}
+
+//
+// R_ScratchGrow
+// Slow path for when the current chunk can't fit an allocation.
+// Moves on to the next chunk that can, adding a new one to the end
+// of the list if none of them do. Whatever was left in the previous
+// chunk goes unused until the next reset.
+//
+byte* R_ScratchGrow( renderscratch_t& scratch, size_t numbytes )
+{
+	renderscratchchunk_t* next = scratch.curr ? scratch.curr->next : scratch.head;
+	while( next != nullptr && next->size < numbytes )
+	{
+		next = next->next;
+	}
+
+	if( next == nullptr )
+	{
+		R_ScratchAddChunk( scratch, numbytes );
+		next = scratch.tail;
+	}
+
+	scratch.curr = next;
+	scratch.pos = numbytes;
+	scratch.used += numbytes;
+	scratch.peak = M_MAX( scratch.peak, scratch.used );
+
+	return next->data;
+}
+
+//
+// R_ScratchReset
+// Nothing is live between frames, so if the last frame spilled into
+// extra chunks they get swapped out for a single chunk that fits the
+// new high water mark. Frames after that stay on the fast path, and
+// the space wasted at the end of each spilled chunk is given back.
+//
+void R_ScratchReset( renderscratch_t& scratch )
+{
+	scratch.lastframe = scratch.peak;
+	scratch.highwater = M_MAX( scratch.highwater, scratch.peak );
+
+	if( scratch.numchunks > 1 )
+	{
+		R_ScratchFreeChunks( scratch );
+		R_ScratchAddChunk( scratch, scratch.highwater );
+	}
+
+	scratch.curr = scratch.head;
+	scratch.pos = 0;
+	scratch.used = 0;
+	scratch.peak = 0;
+}
+
+//
+// R_ScratchTrim
+// A busy map can leave an arena far bigger than the next one needs.
+// Drop back to the default chunk size and let it grow again.
+//
+void R_ScratchTrim( renderscratch_t& scratch )
+{
+	if( scratch.capacity > RenderScratchChunkSize )
+	{
+		R_ScratchFreeChunks( scratch );
+	}
+
+	scratch.curr = scratch.head;
+	scratch.pos = 0;
+	scratch.used = 0;
+	scratch.peak = 0;
+	scratch.highwater = 0;
+}
+
 void R_InitContexts( void )
 {
 	int32_t currstart = 0;
@@ -1029,6 +1261,7 @@ void R_InitContexts( void )
 		renderdatas[ currcontext ].context.bspcontext.maxdrawsegs = MAXDRAWSEGS;
 		renderdatas[ currcontext ].context.bspcontext.maxsolidsegs = MAXSEGS;
 		renderdatas[ currcontext ].context.planecontext.maxopenings = MAXOPENINGS;
+		renderdatas[ currcontext ].context.spritecontext.maxvissprites = MAXVISSPRITES;
 
 		R_ResetContext( renderdatas[ currcontext ].context, renderdatas[ currcontext ].context.begincolumn, renderdatas[ currcontext ].context.endcolumn );
 	}
@@ -1053,6 +1286,16 @@ void R_RefreshContexts( void )
 		}
 	}
 #endif // RENDER_PERF_GRAPHING
+
+	R_ScratchTrim( renderframescratch );
+	if( renderdatas )
+	{
+		for( int32_t currcontext = 0; currcontext < maxrendercontexts; ++currcontext )
+		{
+			R_ScratchTrim( renderdatas[ currcontext ].context.scratch );
+		}
+	}
+
 	renderrebalancecontexts = true;
 }
 
@@ -1285,6 +1528,7 @@ void R_RenderUpdateFrameSize( void )
 
 static doombool debugwindow_renderthreadinggraphs = false;
 static doombool debugwindow_renderthreadingoptions = false;
+static doombool debugwindow_renderscratch = false;
 
 #if RENDER_PERF_GRAPHING
 static void R_RenderGraphTab( const char* graphname, ptrdiff_t frameavgoffs, ptrdiff_t backgroundoffs, ptrdiff_t dataoffs, int32_t datalen, ptrdiff_t nextentryoffs )
@@ -1408,6 +1652,43 @@ static void R_RenderThreadingGraphsWindow( const char* name, void* data )
 }
 #endif // RENDER_PERF_GRAPHING
 
+static void R_RenderScratchRow( const char* arenaname, const renderscratch_t& scratch )
+{
+	igText( "%s", arenaname );
+	igNextColumn();
+	igText( "%0.1fKB", scratch.lastframe / 1024.0 );
+	igNextColumn();
+	igText( "%0.1fKB", M_MAX( scratch.highwater, scratch.peak ) / 1024.0 );
+	igNextColumn();
+	igText( "%0.1fKB (%d)", scratch.capacity / 1024.0, scratch.numchunks );
+	igNextColumn();
+}
+
+static void R_RenderScratchWindow( const char* name, void* data )
+{
+	char arenaname[ 32 ];
+
+	igColumns( 4, "ScratchColumns", false );
+	igText( "Arena" );
+	igNextColumn();
+	igText( "Last frame" );
+	igNextColumn();
+	igText( "High water" );
+	igNextColumn();
+	igText( "Capacity (chunks)" );
+	igNextColumn();
+	igSeparator();
+
+	R_RenderScratchRow( "Frame", renderframescratch );
+	for( int32_t currcontext = 0; currcontext < num_render_contexts; ++currcontext )
+	{
+		M_snprintf( arenaname, sizeof( arenaname ), "Context %d", currcontext );
+		R_RenderScratchRow( arenaname, renderdatas[ currcontext ].context.scratch );
+	}
+
+	igEndColumns();
+}
+
 static void R_RenderThreadingOptionsWindow( const char* name, void* data )
 {
 	bool WorkingBool = I_AtomicLoad( &renderthreadCPUmelter ) != 0;
@@ -1446,7 +1727,28 @@ static void R_RenderThreadingOptionsWindow( const char* name, void* data )
 		R_RebalanceContexts();
 	}
 	igSliderInt( "Balancing scale", &rebalancescale, 1, 40, "%d%%", ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_NoInput );
+	igCheckbox( "Tiled rendering", (bool*)&rendertiling );
+	if( igIsItemHovered( ImGuiHoveredFlags_None ) )
+	{
+		igBeginTooltip();
+		igText( "Splits the view into column strips and row bands\n"
+				"that threads pull from a shared queue, instead of\n"
+				"one load balanced strip per thread." );
+		igEndTooltip();
+	}
+	igSliderInt( "Tile columns per thread", &rendertilecolumns, 1, 8, "%d", ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_NoInput );
+	igSliderInt( "Tile rows", &rendertilerows, 1, 8, "%d", ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_NoInput );
 	igCheckbox( "SIMD columns", (bool*)&renderSIMDcolumns );
+	igCheckbox( "Shared BSP traversal", (bool*)&rendersharedbsp );
+	if( igIsItemHovered( ImGuiHoveredFlags_None ) )
+	{
+		igBeginTooltip();
+		igText( "Walks the BSP once per frame on the main thread\n"
+				"and has every context consume the visible segs\n"
+				"that overlap its columns, instead of every\n"
+				"context doing its own full traversal." );
+		igEndTooltip();
+	}
 	igNewLine();
 	igText( "Debug options" );
 	igSeparator();
@@ -1467,6 +1769,7 @@ void R_Init (void)
 	frame_width = render_width;
 	frame_height = render_height;
 
+	R_InitRenderKernels();
     R_InitData ();
 	R_InitColFuncs();
 	I_TerminalPrintf( Log_None, "." );
@@ -1483,16 +1786,13 @@ void R_Init (void)
 	R_ExecuteSetViewSize( );
     I_TerminalPrintf( Log_None, "." );
 
-	renderscratchsize = 32 * 1024 * 1024;
-	renderscratch = (byte*)Z_Malloc( (int32_t)renderscratchsize, PU_STATIC, nullptr );
-	renderscratchpos = 0;
-
 	M_RegisterDashboardRadioButton( "Render|Clear style|None", NULL, &voidcleartype, Void_NoClear );
 	M_RegisterDashboardRadioButton( "Render|Clear style|Black", NULL, &voidcleartype, Void_Black );
 	M_RegisterDashboardRadioButton( "Render|Clear style|Whacky", NULL, &voidcleartype, Void_Whacky );
 	M_RegisterDashboardRadioButton( "Render|Clear style|Sky", NULL, &voidcleartype, Void_Sky );
 
 	M_RegisterDashboardWindow( "Render|Threading|Options", "Render Threading Options", 500, 500, &debugwindow_renderthreadingoptions, Menu_Normal, &R_RenderThreadingOptionsWindow );
+	M_RegisterDashboardWindow( "Render|Threading|Scratch memory", "Render Scratch Memory", 450, 250, &debugwindow_renderscratch, Menu_Normal, &R_RenderScratchWindow );
 #if RENDER_PERF_GRAPHING
 	M_RegisterDashboardWindow( "Render|Threading|Graphs", "Render Graphs", 500, 550, &debugwindow_renderthreadinggraphs, Menu_Overlay, &R_RenderThreadingGraphsWindow );
 #endif //RENDER_PERF_GRAPHING
@@ -1704,7 +2004,9 @@ void R_SetupFrame( player_t* player, double_t framepercent, doombool isconsolepl
 	int32_t		currstart;
 	int32_t		desiredwidth;
 
-	if( player->mo->curr.teleported )
+	const mobjrender_t& playerrender = player->mo->Render();
+
+	if( playerrender.curr.teleported )
 	{
 		R_RebalanceContexts();
 	}
@@ -1715,32 +2017,41 @@ void R_SetupFrame( player_t* player, double_t framepercent, doombool isconsolepl
 
 	viewpoint_t viewpoint = {};
 
-	renderscratchpos = 0;
+	if( rendertiling )
+	{
+		R_SetupTiles();
+	}
+
+	R_ScratchReset( renderframescratch );
+	for( int32_t currcontext = 0; currcontext < maxrendercontexts; ++currcontext )
+	{
+		R_ScratchReset( renderdatas[ currcontext ].context.scratch );
+	}
+
 	viewpoint.player = player;
 	viewpoint.weaponbob = FixedToRendFixed( player->bob );
 	viewpoint.yslope = drs_current->yslope;
 	viewpoint.centery = drs_current->centery;
 	viewpoint.centeryfrac = drs_current->centeryfrac;
-	viewpoint.yaw = player->mo->curr.angle + viewangleoffset;
+	viewpoint.yaw = playerrender.curr.angle + viewangleoffset;
 	viewpoint.pitch = player->viewpitch;
 
 	extralight = player->extralight + additional_light_boost;
 
-	jobs->AddJob( []()
+	JobGroup setupjobs;
+
+	jobs->AddJob( setupjobs, []()
 	{
-		for( thinker_t* th = thinkercap.next; th != &thinkercap; th = th->next )
+		// Retired slots included, nothing is going to look at them
+		for( mobjrender_t& render : std::span( mobjrenders, mobjthinkers.Capacity() ) )
 		{
-			if( mobj_t* mobj = thinker_cast< mobj_t >( th ) )
-			{
-				constexpr size_t renderedsize = sizeof( mobj->rendered );
-				memset( mobj->rendered, 0, renderedsize );
-			}
+			memset( render.rendered, 0, sizeof( render.rendered ) );
 		}
 	} );
 
 	if( true )
 	{
-		jobs->AddJob( [ &viewpoint, &mouseevents ]()
+		jobs->AddJob( setupjobs, [ &viewpoint, &mouseevents ]()
 		{
 			int64_t mouseamount = mouseevents.looky;
 			int64_t newangle = viewpoint.pitch;
@@ -1757,6 +2068,7 @@ void R_SetupFrame( player_t* player, double_t framepercent, doombool isconsolepl
 			rend_fixed_t halffovtan = renderfinetangent[ halffov ];
 			rend_fixed_t horizonscale = RendFixedDiv( viewangletan, halffovtan );
 
+			RenderScratchScope scope( renderframescratch );
 			rend_fixed_t* yslope = viewpoint.yslope = R_AllocateScratch< rend_fixed_t >( drs_current->viewheight );
 			rend_fixed_t horizon = viewpoint.centeryfrac = drs_current->centeryfrac + RendFixedMul( horizonscale, drs_current->centeryfrac );
 			int32_t centery = viewpoint.centery = RendFixedToInt( horizon );
@@ -1788,16 +2100,16 @@ void R_SetupFrame( player_t* player, double_t framepercent, doombool isconsolepl
 			rend_fixed_t adjustedviewy;
 			rend_fixed_t adjustedviewz;
 
-			if( player->mo->curr.teleported )
+			if( playerrender.curr.teleported )
 			{
-				adjustedviewx = selectcurr ? player->mo->curr.x : player->mo->prev.x;
-				adjustedviewy = selectcurr ? player->mo->curr.y : player->mo->prev.y;
-				adjustedviewz = selectcurr ? player->mo->curr.z : player->mo->prev.z;
+				adjustedviewx = selectcurr ? playerrender.curr.x : playerrender.prev.x;
+				adjustedviewy = selectcurr ? playerrender.curr.y : playerrender.prev.y;
+				adjustedviewz = selectcurr ? playerrender.curr.z : playerrender.prev.z;
 			}
 			else
 			{
-				adjustedviewx = RendFixedLerp( player->mo->prev.x, player->mo->curr.x, viewpoint.lerp );
-				adjustedviewy = RendFixedLerp( player->mo->prev.y, player->mo->curr.y, viewpoint.lerp );
+				adjustedviewx = RendFixedLerp( playerrender.prev.x, playerrender.curr.x, viewpoint.lerp );
+				adjustedviewy = RendFixedLerp( playerrender.prev.y, playerrender.curr.y, viewpoint.lerp );
 				adjustedviewz = RendFixedLerp( player->prevviewz, player->currviewz, viewpoint.lerp );
 			}
 
@@ -1818,14 +2130,14 @@ void R_SetupFrame( player_t* player, double_t framepercent, doombool isconsolepl
 			else
 			{
 				rend_fixed_t result;
-				if( player->mo->curr.teleported )
+				if( playerrender.curr.teleported )
 				{
-					result = selectcurr ? player->mo->curr.angle : player->mo->prev.angle;
+					result = selectcurr ? playerrender.curr.angle : playerrender.prev.angle;
 				}
 				else
 				{
-					int64_t start	= player->mo->prev.angle;
-					int64_t end		= player->mo->curr.angle;
+					int64_t start	= playerrender.prev.angle;
+					int64_t end		= playerrender.curr.angle;
 					int64_t path	= end - start;
 					if( llabs( path ) > ANG180 )
 					{
@@ -1892,10 +2204,10 @@ void R_SetupFrame( player_t* player, double_t framepercent, doombool isconsolepl
 		}
 		else
 		{
-			viewpoint.x = player->mo->curr.x;
-			viewpoint.y = player->mo->curr.y;
+			viewpoint.x = playerrender.curr.x;
+			viewpoint.y = playerrender.curr.y;
 			viewpoint.z = player->currviewz;
-			viewpoint.yaw = player->mo->curr.angle + viewangleoffset;
+			viewpoint.yaw = playerrender.curr.angle + viewangleoffset;
 			viewpoint.lerp = 0;
 
 			memcpy( rendsectors, currsectors, sizeof( sectorinstance_t ) * numsectors );
@@ -2000,7 +2312,7 @@ void R_SetupFrame( player_t* player, double_t framepercent, doombool isconsolepl
 		fixedcolormap = 0;
 	}
 
-	jobs->Flush();
+	jobs->Flush( setupjobs );
 
 	for( currcontext = 0; currcontext < num_render_contexts; ++currcontext )
 	{
@@ -2013,6 +2325,18 @@ void R_SetupFrame( player_t* player, double_t framepercent, doombool isconsolepl
 
 		renderdatas[ currcontext ].context.viewpoint = viewpoint;
 		renderdatas[ currcontext ].context.viewbuffer = buffer;
+		renderdatas[ currcontext ].context.spritecontext.renderstamp = 0;
+		R_ResetContextRows( renderdatas[ currcontext ].context, 0, drs_current->viewheight );
+	}
+
+	if( rendertiling )
+	{
+		// Tiles own the context's columns now. Whatever slice
+		// setup we had is meaningless, so start fresh when we
+		// switch back.
+		renderrebalancecontexts = true;
+		framecount++;
+		return;
 	}
 
 	if( renderloadbalancing && renderscalecontextsby > 0 )
@@ -2063,6 +2387,8 @@ void R_RenderPlayerView(player_t* player, double_t framepercent, doombool iscons
 	byte* outputcolumn;
 	byte* endcolumn;
 
+	uint64_t viewstart = I_GetTimeUS();
+
 	R_SetupFrame( player, framepercent, isconsoleplayer );
 
 	// NetUpdate can cause lump loads, so we wait until rendering is done before doing it again.
@@ -2071,17 +2397,44 @@ void R_RenderPlayerView(player_t* player, double_t framepercent, doombool iscons
 
 	wadrenderlock = true;
 
-	for( currcontext = 1; currcontext < num_render_contexts; ++currcontext )
+	R_SetupFuzzForFrame();
+
+	if( rendersharedbsp || rendertiling )
+	{
+		RenderScratchScope scope( renderframescratch );
+		R_BuildBSPFrontEnd( renderfrontend, renderdatas[ 0 ].context.viewpoint );
+	}
+
+	JobGroup renderjobs;
+
+	if( rendertiling )
 	{
-		jobs->AddJob( [currcontext]()
+		std::atomic< int32_t > nexttile = 0;
+
+		for( currcontext = 1; currcontext < num_render_contexts; ++currcontext )
 		{
-			R_RenderViewContext( renderdatas[ currcontext ].context );
-		} );
+			jobs->AddJob( renderjobs, [currcontext, &nexttile]()
+			{
+				R_RenderViewContextTiles( renderdatas[ currcontext ].context, nexttile );
+			} );
+		}
+		R_RenderViewContextTiles( renderdatas[ 0 ].context, nexttile );
+		jobs->Flush( renderjobs );
+	}
+	else
+	{
+		for( currcontext = 1; currcontext < num_render_contexts; ++currcontext )
+		{
+			jobs->AddJob( renderjobs, [currcontext]()
+			{
+				R_RenderViewContext( renderdatas[ currcontext ].context );
+			} );
+		}
+		R_RenderViewContext( renderdatas[ 0 ].context );
+		jobs->Flush( renderjobs );
 	}
-	R_RenderViewContext( renderdatas[ 0 ].context );
-	jobs->Flush();
 
-	if( rendersplitvisualise )
+	if( rendersplitvisualise && !rendertiling )
 	{
 		for( currcontext = 1; currcontext < num_render_contexts; ++currcontext )
 		{
@@ -2097,4 +2450,20 @@ void R_RenderPlayerView(player_t* player, double_t framepercent, doombool iscons
 	}
 
 	wadrenderlock = false;
+
+	renderviewtime += I_GetTimeUS() - viewstart;
+}
+
+uint64_t R_GetFrameTimings( uint64_t* contexttimes, int32_t maxcontexts, int32_t* numcontexts )
+{
+	int32_t count = M_MIN( num_render_contexts, maxcontexts );
+	for( int32_t currcontext = 0; currcontext < count; ++currcontext )
+	{
+		contexttimes[ currcontext ] = renderdatas[ currcontext ].context.timetaken;
+	}
+	*numcontexts = count;
+
+	uint64_t viewtime = renderviewtime;
+	renderviewtime = 0;
+	return viewtime;
 }
@@ -128,22 +128,103 @@ DOOM_C_API void R_RebalanceContexts( void );
 // Called by M_Responder.
 DOOM_C_API void R_SetViewSize (int blocks, int detail);
 
+// Returns time spent in R_RenderPlayerView since the last call, and
+// fills out the last timetaken of each context. Used for benchmarking.
+DOOM_C_API uint64_t R_GetFrameTimings( uint64_t* contexttimes, int32_t maxcontexts, int32_t* numcontexts );
+
 #if defined( __cplusplus )
 
 #include "m_container.h"
 #include "i_thread.h"
 
-template< typename _ty, typename... _args >
-INLINE _ty* R_AllocateScratchSingle( const _args&... args )
+#include <cstddef>
+
+// Chunks start on a cache line, which is also the most an allocation
+// can ask to be aligned to. Anything that doesn't ask gets what malloc
+// would give it.
+constexpr size_t RenderScratchAlignment = 64;
+constexpr size_t RenderScratchDefaultAlignment = alignof( std::max_align_t );
+constexpr size_t RenderScratchChunkSize = 4 * 1024 * 1024;
+
+// Whichever arena the current thread is rendering with. Render
+// contexts bind their own, anything else must bind one explicitly.
+extern thread_local renderscratch_t*	renderscratchcurrent;
+
+byte* R_ScratchGrow( renderscratch_t& scratch, size_t numbytes );
+void R_ScratchReset( renderscratch_t& scratch );
+void R_ScratchTrim( renderscratch_t& scratch );
+
+INLINE byte* R_ScratchAllocate( renderscratch_t& scratch, size_t numbytes, size_t alignment = RenderScratchDefaultAlignment )
+{
+	size_t start = ( scratch.pos + alignment - 1 ) & ~( alignment - 1 );
+	if( scratch.curr == nullptr || start + numbytes > scratch.curr->size )
+	{
+		return R_ScratchGrow( scratch, numbytes );
+	}
+
+	byte* output = scratch.curr->data + start;
+	scratch.used += start + numbytes - scratch.pos;
+	scratch.pos = start + numbytes;
+	scratch.peak = M_MAX( scratch.peak, scratch.used );
+
+	return output;
+}
+
+// Grows the most recent allocation where it is. Only works when nothing
+// has been allocated since and its chunk still has room.
+INLINE bool R_ScratchTryExtend( renderscratch_t& scratch, void* data, size_t oldbytes, size_t newbytes )
+{
+	if( scratch.curr == nullptr || (byte*)data + oldbytes != scratch.curr->data + scratch.pos )
+	{
+		return false;
+	}
+
+	size_t start = (byte*)data - scratch.curr->data;
+	if( start + newbytes > scratch.curr->size )
+	{
+		return false;
+	}
+
+	scratch.pos = start + newbytes;
+	scratch.used += newbytes - oldbytes;
+	scratch.peak = M_MAX( scratch.peak, scratch.used );
+
+	return true;
+}
+
+INLINE renderscratchmark_t R_ScratchMark( renderscratch_t& scratch )
+{
+	return { scratch.curr, scratch.pos, scratch.used };
+}
+
+// Throws away everything allocated since the mark was taken
+INLINE void R_ScratchRewind( renderscratch_t& scratch, const renderscratchmark_t& mark )
 {
-	// TODO: per-thread scratchpad???
-	extern std::atomic< atomicval_t >	renderscratchpos;
-	extern byte*						renderscratch;
+	scratch.curr = mark.curr;
+	scratch.pos = mark.pos;
+	scratch.used = mark.used;
+}
+
+struct RenderScratchScope
+{
+	RenderScratchScope( renderscratch_t& scratch )
+		: prev( renderscratchcurrent )
+	{
+		renderscratchcurrent = &scratch;
+	}
 
-	constexpr atomicval_t numbytes = AlignTo< 16 >( sizeof( _ty ) );
-	atomicval_t pos = renderscratchpos.fetch_add( numbytes );
+	~RenderScratchScope()
+	{
+		renderscratchcurrent = prev;
+	}
+
+	renderscratch_t* prev;
+};
 
-	_ty* output = (_ty*)( renderscratch + pos );
+template< typename _ty, typename... _args >
+INLINE _ty* R_AllocateScratchSingle( const _args&... args )
+{
+	_ty* output = (_ty*)R_ScratchAllocate( *renderscratchcurrent, sizeof( _ty ), M_MAX( alignof( _ty ), RenderScratchDefaultAlignment ) );
 
 	if constexpr( sizeof...( _args ) == 1 )
 	{
@@ -160,21 +241,7 @@ INLINE _ty* R_AllocateScratchSingle( const _args&... args )
 template< typename _ty, typename... _args >
 INLINE _ty* R_AllocateScratch( atomicval_t numinstances, const _args&... args )
 {
-	// TODO: per-thread scratchpad???
-	extern std::atomic< atomicval_t >	renderscratchpos;
-	extern std::atomic< atomicval_t >	renderscratchsize;
-	extern byte*						renderscratch;
-
-	constexpr atomicval_t sizeofsingleobj = AlignTo< 16 >( sizeof( _ty ) );
-
-	atomicval_t numbytes = sizeofsingleobj * numinstances;
-	atomicval_t pos = renderscratchpos.fetch_add( numbytes );
-	if( pos + numbytes > renderscratchsize.load() )
-	{
-		I_Error( "R_AllocateScratch: No more scratchpad memory available" );
-	}
-
-	_ty* output = (_ty*)( renderscratch + pos );
+	_ty* output = (_ty*)R_ScratchAllocate( *renderscratchcurrent, sizeof( _ty ) * numinstances, M_MAX( alignof( _ty ), RenderScratchDefaultAlignment ) );
 
 	if constexpr( sizeof...( _args ) == 1 )
 	{
@@ -42,12 +42,14 @@
 
 //
 // R_ClearPlanes
-// At begining of frame.
+// At begining of frame. The clip arrays start out limited to
+// [toprow, bottomrow), which confines walls, flats and every
+// sprite clip derived from them to that band of the screen.
 //
-void R_ClearPlanes( planecontext_t* context, int32_t width, int32_t height )
+void R_ClearPlanes( planecontext_t* context, int32_t width, int32_t height, int32_t toprow, int32_t bottomrow )
 {
-	context->floorclip = R_AllocateScratch< vertclip_t >( width, height );
-	context->ceilingclip = R_AllocateScratch< vertclip_t >( width, -1 );
+	context->floorclip = R_AllocateScratch< vertclip_t >( width, (vertclip_t)bottomrow );
+	context->ceilingclip = R_AllocateScratch< vertclip_t >( width, (vertclip_t)( toprow - 1 ) );
 
 	context->openingscount = context->maxopenings;
 	context->openings = R_AllocateScratch< vertclip_t >( context->openingscount );
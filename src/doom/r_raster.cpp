@@ -24,9 +24,12 @@
 #include "r_main.h"
 
 #include "r_defs.h"
+#include "r_kernels.h"
 #include "r_state.h"
 #include "m_misc.h"
 
+#include <utility>
+
 INLINE void Rotate( rend_fixed_t& x, rend_fixed_t& y, uint32_t finerot )
 {
 	rend_fixed_t cos = renderfinecosine[ finerot ];
@@ -51,21 +54,113 @@ struct PreSizedSampleUntranslated
 						, pixel_t*& dest
 						, planecontext_t& planecontext )
 	{
-		constexpr int64_t YBitIndex = FirstSetBitIndex( RightmostBit( Height ) );
-		constexpr int64_t XFracMask = IntToRendFixed( Width - 1 );
-		constexpr int64_t YFracMask = IntToRendFixed( Height - 1 );
-		constexpr int64_t XShift = RENDFRACBITS - YBitIndex;
-		constexpr int64_t YShift = RENDFRACBITS;
-
 		const rastercache_t& thisraster = planecontext.raster[ top ];
-		int32_t spot = ( ( yfrac & YFracMask ) >> YShift ) | ( ( xfrac & XFracMask ) >> XShift );
-		*dest++ = thisraster.colormap[ source [ spot ] ];
+		*dest++ = thisraster.colormap[ source [ Spot( xfrac, yfrac ) ] ];
 		++top;
 		xfrac += xstep;
 		yfrac += ystep;
 	}
+
+	static constexpr int64_t YBitIndex = FirstSetBitIndex( RightmostBit( Height ) );
+	static constexpr int64_t XFracMask = IntToRendFixed( Width - 1 );
+	static constexpr int64_t YFracMask = IntToRendFixed( Height - 1 );
+	static constexpr int64_t XShift = RENDFRACBITS - YBitIndex;
+	static constexpr int64_t YShift = RENDFRACBITS;
+
+	static INLINE int32_t Spot( rend_fixed_t xfrac, rend_fixed_t yfrac )
+	{
+		return (int32_t)( ( ( yfrac & YFracMask ) >> YShift ) | ( ( xfrac & XFracMask ) >> XShift ) );
+	}
+};
+
+// Same sampling as above, but whole leap blocks get handed off to a span
+// kernel instead of being unrolled
+template< int64_t Width, int64_t Height, rasterspanfunc_t SpanFunc >
+struct PreSizedSpanUntranslated : public PreSizedSampleUntranslated< Width, Height >
+{
+	static constexpr rasterspanfunc_t Span = SpanFunc;
 };
 
+template< int64_t Width, int64_t Height >
+void R_RasteriseSpan( pixel_t* dest, pixel_t* source, rastercache_t* raster
+					, rend_fixed_t xfrac, rend_fixed_t xstep
+					, rend_fixed_t yfrac, rend_fixed_t ystep
+					, int32_t count )
+{
+	using Sampler = PreSizedSampleUntranslated< Width, Height >;
+
+	while( count-- > 0 )
+	{
+		*dest++ = raster->colormap[ source[ Sampler::Spot( xfrac, yfrac ) ] ];
+		++raster;
+		xfrac += xstep;
+		yfrac += ystep;
+	}
+}
+
+#if R_KERNELS_X86
+// Flat sizes top out at 1024x512, so only the bottom 30 bits of a frac
+// ever survive the masks. Fracs can step in 32-bit lanes and wrap.
+template< int64_t Width, int64_t Height >
+R_TARGET_AVX2 void R_RasteriseSpanAVX2( pixel_t* dest, pixel_t* source, rastercache_t* raster
+									, rend_fixed_t xfrac, rend_fixed_t xstep
+									, rend_fixed_t yfrac, rend_fixed_t ystep
+									, int32_t count )
+{
+	using Sampler = PreSizedSampleUntranslated< Width, Height >;
+
+	const __m256i		xmask		= _mm256_set1_epi32( (int32_t)Sampler::XFracMask );
+	const __m256i		ymask		= _mm256_set1_epi32( (int32_t)Sampler::YFracMask );
+	const __m256i		lanes		= _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 );
+	const __m256i		xsteps		= _mm256_set1_epi32( (int32_t)( xstep * 8 ) );
+	const __m256i		ysteps		= _mm256_set1_epi32( (int32_t)( ystep * 8 ) );
+	const __m256i		lowbytes	= _mm256_setr_epi8(	0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+														0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 );
+	const __m256i		lowdwords	= _mm256_setr_epi32( 0, 4, 0, 0, 0, 0, 0, 0 );
+
+	__m256i				xfracs		= _mm256_add_epi32( _mm256_set1_epi32( (int32_t)xfrac ), _mm256_mullo_epi32( lanes, _mm256_set1_epi32( (int32_t)xstep ) ) );
+	__m256i				yfracs		= _mm256_add_epi32( _mm256_set1_epi32( (int32_t)yfrac ), _mm256_mullo_epi32( lanes, _mm256_set1_epi32( (int32_t)ystep ) ) );
+
+	int32_t				blocks		= count >> 3;
+	xfrac += xstep * ( blocks << 3 );
+	yfrac += ystep * ( blocks << 3 );
+	count &= 7;
+
+	while( blocks-- > 0 )
+	{
+		__m256i spots = _mm256_or_si256( _mm256_srli_epi32( _mm256_and_si256( yfracs, ymask ), (int32_t)Sampler::YShift )
+										, _mm256_srli_epi32( _mm256_and_si256( xfracs, xmask ), (int32_t)Sampler::XShift ) );
+
+		// Gathers read the dword that ends on the byte we want, see the
+		// column kernels for why that's safe
+		__m256i texels = _mm256_srli_epi32( _mm256_i32gather_epi32( (const int*)( source - 3 ), spots, 1 ), 24 );
+
+		// Every row has its own colormap, but they're all carved out of the
+		// same lighting table so they can be addressed from the first one
+		lighttable_t* basecolormap = raster[ 0 ].colormap;
+		__m256i lights = _mm256_setr_epi32( 0
+										, (int32_t)( raster[ 1 ].colormap - basecolormap )
+										, (int32_t)( raster[ 2 ].colormap - basecolormap )
+										, (int32_t)( raster[ 3 ].colormap - basecolormap )
+										, (int32_t)( raster[ 4 ].colormap - basecolormap )
+										, (int32_t)( raster[ 5 ].colormap - basecolormap )
+										, (int32_t)( raster[ 6 ].colormap - basecolormap )
+										, (int32_t)( raster[ 7 ].colormap - basecolormap ) );
+
+		__m256i samples = _mm256_i32gather_epi32( (const int*)( basecolormap - 3 ), _mm256_add_epi32( lights, texels ), 1 );
+		samples = _mm256_permutevar8x32_epi32( _mm256_shuffle_epi8( _mm256_srli_epi32( samples, 24 ), lowbytes ), lowdwords );
+		_mm_storel_epi64( (__m128i*)dest, _mm256_castsi256_si128( samples ) );
+
+		dest += 8;
+		raster += 8;
+		xfracs = _mm256_add_epi32( xfracs, xsteps );
+		yfracs = _mm256_add_epi32( yfracs, ysteps );
+	}
+
+	R_RasteriseSpan< Width, Height >( dest, source, raster, xfrac, xstep, yfrac, ystep, count );
+}
+#endif // R_KERNELS_X86
+
 struct ArbitrarySampleUntranslated
 {
 	constexpr ArbitrarySampleUntranslated( int32_t w, int32_t h )
@@ -156,49 +251,58 @@ INLINE void R_RasteriseColumnImpl( rendercontext_t* rendercontext, Sampler& samp
 		xstep =	( nextxfrac - xfrac ) >> LeapLog2;
 		ystep =	( nextyfrac - yfrac ) >> LeapLog2;
 
-		if constexpr( LeapLog2 >= 5 )
+		if constexpr( requires { Sampler::Span; } )
 		{
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+			Sampler::Span( dest, source, rendercontext->planecontext.raster + top, xfrac, xstep, yfrac, ystep, Leap );
+			dest += Leap;
+			top += Leap;
 		}
-		if constexpr( LeapLog2 >= 4 )
+		else
 		{
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-		}
-		if constexpr( LeapLog2 >= 3 )
-		{
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-		}
-		if constexpr( LeapLog2 >= 2 )
-		{
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
-			sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+			if constexpr( LeapLog2 >= 5 )
+			{
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+			}
+			if constexpr( LeapLog2 >= 4 )
+			{
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+			}
+			if constexpr( LeapLog2 >= 3 )
+			{
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+			}
+			if constexpr( LeapLog2 >= 2 )
+			{
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+				sampler.Sample( top, xfrac, xstep, yfrac, ystep, source, dest, rendercontext->planecontext );
+			}
 		}
 
 		xfrac = nextxfrac;
@@ -401,7 +505,7 @@ void R_RasteriseRegion32x32( rendercontext_t* rendercontext, rasterregion_t* fir
 void R_RasteriseRegion32x64( rendercontext_t* rendercontext, rasterregion_t* firstregion, texturecomposite_t* texture )
 {
 	M_PROFILE_FUNC();
-	PreSizedSampleUntranslated< 32, 16 > sampler;
+	PreSizedSampleUntranslated< 32, 64 > sampler;
 	RasteriseRegion( rendercontext, firstregion, texture, sampler );
 }
 
@@ -409,7 +513,7 @@ void R_RasteriseRegion32x64( rendercontext_t* rendercontext, rasterregion_t* fir
 void R_RasteriseRegion32x128( rendercontext_t* rendercontext, rasterregion_t* firstregion, texturecomposite_t* texture )
 {
 	M_PROFILE_FUNC();
-	PreSizedSampleUntranslated< 32, 16 > sampler;
+	PreSizedSampleUntranslated< 32, 128 > sampler;
 	RasteriseRegion( rendercontext, firstregion, texture, sampler );
 }
 
@@ -650,3 +754,69 @@ void R_RasteriseRegionArbitrary( rendercontext_t* rendercontext, rasterregion_t*
 	ArbitrarySampleUntranslated sampler( texture->width, texture->height );
 	RasteriseRegion( rendercontext, firstregion, texture, sampler );
 }
+
+#if R_KERNELS_X86
+template< int64_t Width, int64_t Height >
+void R_RasteriseRegionAVX2( rendercontext_t* rendercontext, rasterregion_t* firstregion, texturecomposite_t* texture )
+{
+	M_PROFILE_FUNC();
+	PreSizedSpanUntranslated< Width, Height, &R_RasteriseSpanAVX2< Width, Height > > sampler;
+	RasteriseRegion( rendercontext, firstregion, texture, sampler );
+}
+#endif // R_KERNELS_X86
+
+constexpr rasterfunc_t scalarflatfuncs[ RK_FLATWIDTHS ][ RK_FLATHEIGHTS ] =
+{
+	{	&R_RasteriseRegion16x16,	&R_RasteriseRegion16x32,	&R_RasteriseRegion16x64,	&R_RasteriseRegion16x128,	&R_RasteriseRegion16x256,	&R_RasteriseRegion16x512	},
+	{	&R_RasteriseRegion32x16,	&R_RasteriseRegion32x32,	&R_RasteriseRegion32x64,	&R_RasteriseRegion32x128,	&R_RasteriseRegion32x256,	&R_RasteriseRegion32x512	},
+	{	&R_RasteriseRegion64x16,	&R_RasteriseRegion64x32,	&R_RasteriseRegion64x64,	&R_RasteriseRegion64x128,	&R_RasteriseRegion64x256,	&R_RasteriseRegion64x512	},
+	{	&R_RasteriseRegion128x16,	&R_RasteriseRegion128x32,	&R_RasteriseRegion128x64,	&R_RasteriseRegion128x128,	&R_RasteriseRegion128x256,	&R_RasteriseRegion128x512	},
+	{	&R_RasteriseRegion256x16,	&R_RasteriseRegion256x32,	&R_RasteriseRegion256x64,	&R_RasteriseRegion256x128,	&R_RasteriseRegion256x256,	&R_RasteriseRegion256x512	},
+	{	&R_RasteriseRegion512x16,	&R_RasteriseRegion512x32,	&R_RasteriseRegion512x64,	&R_RasteriseRegion512x128,	&R_RasteriseRegion512x256,	&R_RasteriseRegion512x512	},
+	{	&R_RasteriseRegion1024x16,	&R_RasteriseRegion1024x32,	&R_RasteriseRegion1024x64,	&R_RasteriseRegion1024x128,	&R_RasteriseRegion1024x256,	&R_RasteriseRegion1024x512	},
+};
+
+// Index N covers flat size ( 16 << ( N / RK_FLATHEIGHTS ) ) x ( 16 << ( N % RK_FLATHEIGHTS ) )
+template< size_t Index >
+constexpr int64_t FlatWidth = 16ll << ( Index / RK_FLATHEIGHTS );
+
+template< size_t Index >
+constexpr int64_t FlatHeight = 16ll << ( Index % RK_FLATHEIGHTS );
+
+template< size_t... Indices >
+static void R_FillScalarSpans( renderkernels_t* kernels, std::index_sequence< Indices... > )
+{
+	( ( kernels->flatspan[ Indices / RK_FLATHEIGHTS ][ Indices % RK_FLATHEIGHTS ] = &R_RasteriseSpan< FlatWidth< Indices >, FlatHeight< Indices > > ), ... );
+}
+
+#if R_KERNELS_X86
+template< size_t... Indices >
+static void R_FillAVX2Kernels( renderkernels_t* kernels, std::index_sequence< Indices... > )
+{
+	( ( kernels->flat[ Indices / RK_FLATHEIGHTS ][ Indices % RK_FLATHEIGHTS ] = &R_RasteriseRegionAVX2< FlatWidth< Indices >, FlatHeight< Indices > > ), ... );
+	( ( kernels->flatspan[ Indices / RK_FLATHEIGHTS ][ Indices % RK_FLATHEIGHTS ] = &R_RasteriseSpanAVX2< FlatWidth< Indices >, FlatHeight< Indices > > ), ... );
+}
+#endif // R_KERNELS_X86
+
+void R_GetRasteriserKernels( renderkernels_t* kernels, renderkernelset_t set )
+{
+	constexpr auto AllFlatSizes = std::make_index_sequence< RK_FLATWIDTHS * RK_FLATHEIGHTS >();
+
+	switch( set )
+	{
+	case RKS_Scalar:
+		memcpy( kernels->flat, scalarflatfuncs, sizeof( scalarflatfuncs ) );
+		R_FillScalarSpans( kernels, AllFlatSizes );
+		break;
+
+#if R_KERNELS_X86
+	case RKS_AVX2:
+		R_FillAVX2Kernels( kernels, AllFlatSizes );
+		break;
+#endif // R_KERNELS_X86
+
+	default:
+		// No gather on NEON, the flat kernels stay scalar there
+		break;
+	}
+}
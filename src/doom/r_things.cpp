@@ -34,6 +34,7 @@
 
 #include "r_main.h"
 #include "r_local.h"
+#include "r_kernels.h"
 
 #include "w_wad.h"
 
@@ -254,21 +255,57 @@ void R_InitSprites()
 //
 void R_ClearSprites ( spritecontext_t& spritecontext )
 {
+	spritecontext.vissprites = R_AllocateScratch< vissprite_t >( spritecontext.maxvissprites );
 	spritecontext.nextvissprite = spritecontext.vissprites;
+	spritecontext.sortedvissprites = nullptr;
+	spritecontext.numsortedvissprites = 0;
 
 	spritecontext.clipbot = R_AllocateScratch< vertclip_t >( drs_current->viewwidth );
 	spritecontext.cliptop = R_AllocateScratch< vertclip_t >( drs_current->viewwidth );
+
+	if( spritecontext.topclip == 0 && spritecontext.bottomclip == drs_current->viewheight )
+	{
+		spritecontext.screenfloorclip = drs_current->screenheightarray;
+		spritecontext.screenceilingclip = drs_current->negonearray;
+	}
+	else
+	{
+		spritecontext.screenfloorclip = R_AllocateScratch< vertclip_t >( drs_current->viewwidth, (vertclip_t)spritecontext.bottomclip );
+		spritecontext.screenceilingclip = R_AllocateScratch< vertclip_t >( drs_current->viewwidth, (vertclip_t)( spritecontext.topclip - 1 ) );
+	}
 }
 
 
+//
+// R_IncreaseVisSpritesCapacity
+// Doubles the array, so sprite heavy views only copy a handful of times.
+// If nothing else has been allocated since, it just grows in place.
+// Otherwise the old array stays put until the arena resets, which with
+// doubling can never add up to more than the new array.
+//
+void R_IncreaseVisSpritesCapacity( spritecontext_t& spritecontext )
+{
+	vissprite_t* oldsprites = spritecontext.vissprites;
+	size_t oldsize = spritecontext.maxvissprites;
+	size_t newsize = oldsize * 2;
+
+	if( !R_ScratchTryExtend( *renderscratchcurrent, oldsprites, sizeof( vissprite_t ) * oldsize, sizeof( vissprite_t ) * newsize ) )
+	{
+		spritecontext.vissprites = R_AllocateScratch< vissprite_t >( newsize );
+		memcpy( spritecontext.vissprites, oldsprites, sizeof( vissprite_t ) * oldsize );
+	}
+	spritecontext.maxvissprites = newsize;
+	spritecontext.nextvissprite = spritecontext.vissprites + oldsize;
+}
+
 vissprite_t* R_NewVisSprite ( spritecontext_t& spritecontext )
 {
-	if ( spritecontext.nextvissprite < &spritecontext.vissprites[ MAXVISSPRITES ] )
+	if ( spritecontext.nextvissprite == spritecontext.vissprites + spritecontext.maxvissprites )
 	{
-		return spritecontext.nextvissprite++;
+		R_IncreaseVisSpritesCapacity( spritecontext );
 	}
 
-	return spritecontext.nextvissprite;
+	return spritecontext.nextvissprite++;
 }
 
 
@@ -354,9 +391,7 @@ void R_DrawVisSprite( rendercontext_t& rendercontext, vissprite_t* vis, int32_t
 
 	column_t*			column;
 	int32_t				texturecolumn;
-	int32_t				prevfuzzcolumn;
 	patch_t*			patch;
-	int32_t				fuzzcolumn;
 
 	colcontext_t		spritecolcontext = {};
 	spritecolcontext.centery = vis->centery;
@@ -368,12 +403,12 @@ void R_DrawVisSprite( rendercontext_t& rendercontext, vissprite_t* vis, int32_t
 	spritecolcontext.transparency = vis->tranmap;
 	if( vis->translation )
 	{
-		spritecolcontext.colfunc = vis->tranmap ? &R_SpriteDrawColumn_TranslatedAndTransparent : &R_SpriteDrawColumn_Translated;
+		spritecolcontext.colfunc = vis->tranmap ? renderkernels.spritetranslatedtransparent : renderkernels.spritetranslated;
 		spritecolcontext.translation = vis->translation;
 	}
 	else
 	{
-		spritecolcontext.colfunc = vis->tranmap ? &R_SpriteDrawColumn_Transparent : &R_SpriteDrawColumn_Colormap;
+		spritecolcontext.colfunc = vis->tranmap ? renderkernels.spritetransparent : renderkernels.spritecolumn;
 	}
 
 	if (!spritecolcontext.colormap)
@@ -383,6 +418,8 @@ void R_DrawVisSprite( rendercontext_t& rendercontext, vissprite_t* vis, int32_t
 		spritecolcontext.fuzzworkingbuffer = rendercontext.fuzzworkingbuffer;
 		spritecolcontext.fuzzlightmap = rendercontext.viewpoint.colormaps + 6 * 256;
 		spritecolcontext.fuzzdarkmap = rendercontext.viewpoint.colormaps + 14 * 256;
+		spritecolcontext.fuzztop = spritecontext.topclip;
+		spritecolcontext.fuzzbottom = spritecontext.bottomclip - 1;
 	}
 	
 	spritecolcontext.iscale = abs( vis->iscale );
@@ -412,7 +449,7 @@ void R_DrawVisSprite( rendercontext_t& rendercontext, vissprite_t* vis, int32_t
 			int32_t fuzzcolumn = RendFixedToInt( fuzzcolumnpos );
 			if( prevfuzzcolumn != fuzzcolumn )
 			{
-				R_CacheFuzzColumn();
+				spritecolcontext.fuzzcolumn = fuzzcolumn;
 				prevfuzzcolumn = fuzzcolumn;
 			}
 		}
@@ -422,7 +459,6 @@ void R_DrawVisSprite( rendercontext_t& rendercontext, vissprite_t* vis, int32_t
 		R_DrawMaskedColumn( spritecontext, spritecolcontext, column );
 	}
 #else
-	prevfuzzcolumn = -1;
 	rend_fixed_t frac = vis->startfrac;
 	for( spritecolcontext.x = vis->x1; spritecolcontext.x <= vis->x2; spritecolcontext.x++, frac += vis->xiscale )
 	{
@@ -434,12 +470,7 @@ void R_DrawVisSprite( rendercontext_t& rendercontext, vissprite_t* vis, int32_t
 
 		if( !spritecolcontext.colormap && fuzz_style != Fuzz_Original )
 		{
-			fuzzcolumn = ( spritecolcontext.x * 100 ) / FUZZ_X_RATIO;
-			if(prevfuzzcolumn != fuzzcolumn)
-			{
-				R_CacheFuzzColumn();
-				prevfuzzcolumn = fuzzcolumn;
-			}
+			spritecolcontext.fuzzcolumn = ( spritecolcontext.x * 100 ) / FUZZ_X_RATIO;
 		}
 
 		column = (column_t *)( (byte *)patch + LONG(patch->columnofs[texturecolumn]) );
@@ -476,33 +507,35 @@ void R_ProjectSprite( rendercontext_t& rendercontext, mobj_t* thing, sectorinsta
 
 	vissprite_t*	vis;
 
-	rend_fixed_t	thingx			= thing->curr.x;
-	rend_fixed_t	thingy			= thing->curr.y;
-	rend_fixed_t	thingz			= thing->curr.z;
+	mobjrender_t&	render			= thing->Render();
+
+	rend_fixed_t	thingx			= render.curr.x;
+	rend_fixed_t	thingy			= render.curr.y;
+	rend_fixed_t	thingz			= render.curr.z;
 
-	int32_t			thingframe		= thing->curr.frame;
-	int32_t			thingsprite		= thing->curr.sprite;
-	angle_t			thingangle		= thing->curr.angle;
+	int32_t			thingframe		= render.curr.frame;
+	int32_t			thingsprite		= render.curr.sprite;
+	angle_t			thingangle		= render.curr.angle;
 
 	if( interpolate_this_frame )
 	{
 		doombool selectcurr = ( viewpoint.lerp >= ( RENDFRACUNIT >> 1 ) );
-		if( thing->curr.teleported )
+		if( render.curr.teleported )
 		{
-			thingx = selectcurr ? thing->curr.x : thing->prev.x;
-			thingy = selectcurr ? thing->curr.y : thing->prev.y;
-			thingz = selectcurr ? thing->curr.z : thing->prev.z;
+			thingx = selectcurr ? render.curr.x : render.prev.x;
+			thingy = selectcurr ? render.curr.y : render.prev.y;
+			thingz = selectcurr ? render.curr.z : render.prev.z;
 		}
 		else
 		{
-			thingx = RendFixedLerp( thing->prev.x, thing->curr.x, viewpoint.lerp );
-			thingy = RendFixedLerp( thing->prev.y, thing->curr.y, viewpoint.lerp );
-			thingz = RendFixedLerp( thing->prev.z, thing->curr.z, viewpoint.lerp );
+			thingx = RendFixedLerp( render.prev.x, render.curr.x, viewpoint.lerp );
+			thingy = RendFixedLerp( render.prev.y, render.curr.y, viewpoint.lerp );
+			thingz = RendFixedLerp( render.prev.z, render.curr.z, viewpoint.lerp );
 		}
 
-		thingframe = selectcurr ? thing->curr.frame : thing->prev.frame;
-		thingsprite = selectcurr ? thing->curr.sprite : thing->prev.sprite;
-		thingangle = selectcurr ? thing->curr.angle : thing->prev.angle;
+		thingframe = selectcurr ? render.curr.frame : render.prev.frame;
+		thingsprite = selectcurr ? render.curr.sprite : render.prev.sprite;
+		thingangle = selectcurr ? render.curr.angle : render.prev.angle;
 
 		if( thingsprite == -1 ) // Spawned in current frame
 		{
@@ -596,7 +629,7 @@ void R_ProjectSprite( rendercontext_t& rendercontext, mobj_t* thing, sectorinsta
 		return;
 	}
 
-	thing->rendered[ rendercontext.index ] = true;
+	render.rendered[ rendercontext.index ] = spritecontext.renderstamp;
 
 	// store information in a vissprite
 	vis = R_NewVisSprite( spritecontext );
@@ -684,7 +717,7 @@ void R_AddSprites( rendercontext_t& rendercontext, sectorinstance_t* sec, int32_
 	// Handle all things in sector.
 	for( sectormobj_t* curr = (sectormobj_t*)sec->sectormobjs; curr != nullptr; curr = curr->next )
 	{
-		if( !curr->mobj->rendered[ rendercontext.index ] )
+		if( curr->mobj->Render().rendered[ rendercontext.index ] != spritecontext.renderstamp )
 		{
 			R_ProjectSprite( rendercontext, curr->mobj, sec );
 		}
@@ -878,8 +911,8 @@ void R_DrawPlayerSprites( rendercontext_t& rendercontext )
 	pspdef_t*	psp;
 
 	// clip to screen bounds
-	spritecontext.mfloorclip = drs_current->screenheightarray;
-	spritecontext.mceilingclip = drs_current->negonearray;
+	spritecontext.mfloorclip = spritecontext.screenfloorclip;
+	spritecontext.mceilingclip = spritecontext.screenceilingclip;
 
 	// add all active psprites
 	for (i=0, psp = viewpoint.player->psprites; i<NUMPSPRITES; i++,psp++)
@@ -894,62 +927,180 @@ void R_DrawPlayerSprites( rendercontext_t& rendercontext )
 
 //
 // R_SortVisSprites
+// LSD radix sort on scale, a byte at a time. Stable, so sprites
+// of equal scale keep projection order exactly like the old
+// selection sort did. Passes where every key has the same byte
+// are skipped, which is most of the upper bytes in practice.
 //
+typedef struct vissortkey_s
+{
+	uint64_t			key;
+	vissprite_t*		sprite;
+} vissortkey_t;
 
 void R_SortVisSprites ( spritecontext_t& spritecontext )
 {
 	M_PROFILE_FUNC();
 
-	int32_t			i;
-	int32_t			count;
-	vissprite_t*	ds;
-	vissprite_t*	best;
-	vissprite_t		unsorted;
-
-	count = (int32_t)( spritecontext.nextvissprite - spritecontext.vissprites );
-	
-	unsorted.next = unsorted.prev = &unsorted;
+	int32_t count = (int32_t)( spritecontext.nextvissprite - spritecontext.vissprites );
 
+	spritecontext.numsortedvissprites = count;
 	if (!count)
 	{
 		return;
 	}
-		
-	for ( ds = spritecontext.vissprites ; ds < spritecontext.nextvissprite; ds++)
+
+	vissortkey_t* keys = R_AllocateScratch< vissortkey_t >( count );
+	vissortkey_t* working = R_AllocateScratch< vissortkey_t >( count );
+
+	constexpr uint64_t signflip = 0x8000000000000000ull;
+	for( int32_t index : iota( 0, count ) )
+	{
+		vissprite_t* spr = &spritecontext.vissprites[ index ];
+		keys[ index ] = { (uint64_t)spr->scale ^ signflip, spr };
+	}
+
+	for( int32_t shift = 0; shift < 64; shift += 8 )
+	{
+		int32_t buckets[ 256 ] = {};
+		for( vissortkey_t& curr : std::span( keys, count ) )
+		{
+			++buckets[ ( curr.key >> shift ) & 0xFF ];
+		}
+
+		if( buckets[ ( keys[ 0 ].key >> shift ) & 0xFF ] == count )
+		{
+			continue;
+		}
+
+		int32_t total = 0;
+		for( int32_t& bucket : buckets )
+		{
+			int32_t thisbucket = bucket;
+			bucket = total;
+			total += thisbucket;
+		}
+
+		for( vissortkey_t& curr : std::span( keys, count ) )
+		{
+			working[ buckets[ ( curr.key >> shift ) & 0xFF ]++ ] = curr;
+		}
+
+		std::swap( keys, working );
+	}
+
+	spritecontext.sortedvissprites = R_AllocateScratch< vissprite_t* >( count );
+	for( int32_t index : iota( 0, count ) )
 	{
-		ds->next = ds+1;
-		ds->prev = ds-1;
+		spritecontext.sortedvissprites[ index ] = keys[ index ].sprite;
 	}
+}
 
-	spritecontext.vissprites[0].prev = &unsorted;
-	unsorted.next = &spritecontext.vissprites[0];
-	(spritecontext.nextvissprite -1 )->next = &unsorted;
-	unsorted.prev = spritecontext.nextvissprite - 1;
+//
+// R_BuildDrawSegIndex
+// Buckets every drawseg that could possibly clip a sprite by the
+// columns it covers. Plain walls with no silhouette and no masked
+// texture never affect sprites, so they don't go in at all. Scale is
+// left for R_DrawSprite to test per drawseg same as it always has:
+// drawsegs behind a sprite still draw their masked textures, so they
+// can't be dropped from a bucket just for being further away.
+//
+void R_BuildDrawSegIndex( rendercontext_t& rendercontext )
+{
+	M_PROFILE_FUNC();
 
-	// pull the vissprites out by scale
+	bspcontext_t&		bspcontext		= rendercontext.bspcontext;
+	spritecontext_t&	spritecontext	= rendercontext.spritecontext;
 
-	spritecontext.vsprsortedhead.next = spritecontext.vsprsortedhead.prev = &spritecontext.vsprsortedhead;
-	for (i=0 ; i<count ; i++)
+	int32_t numdrawsegs = (int32_t)( bspcontext.thisdrawseg - bspcontext.drawsegs );
+	int32_t width = M_MAX( 1, spritecontext.rightclip - spritecontext.leftclip );
+	int32_t numbuckets = ( ( width - 1 ) >> DRAWSEGBUCKETSHIFT ) + 1;
+
+	auto BucketFor = [ &spritecontext, numbuckets ]( int32_t x ) -> int32_t
 	{
-		rend_fixed_t bestscale = LLONG_MAX;
-		best = unsorted.next;
-		for (ds=unsorted.next ; ds!= &unsorted ; ds=ds->next)
+		return M_CLAMP( ( x - spritecontext.leftclip ) >> DRAWSEGBUCKETSHIFT, 0, numbuckets - 1 );
+	};
+
+	spritecontext.numdrawsegbuckets = numbuckets;
+	spritecontext.drawsegbucketstart = R_AllocateScratch< int32_t >( numbuckets + 1, 0 );
+	spritecontext.drawsegworking = R_AllocateScratch< int32_t >( M_MAX( numdrawsegs, 1 ) );
+	spritecontext.drawsegmerged = R_AllocateScratch< int32_t >( M_MAX( numdrawsegs, 1 ) );
+
+	int32_t* bucketstart = spritecontext.drawsegbucketstart;
+
+	for( drawseg_t& ds : std::span( bspcontext.drawsegs, numdrawsegs ) )
+	{
+		if( ds.silhouette || ds.maskedtexturecol )
 		{
-			if (ds->scale < bestscale)
+			for( int32_t bucket = BucketFor( ds.x1 ); bucket <= BucketFor( ds.x2 ); ++bucket )
 			{
-				bestscale = ds->scale;
-				best = ds;
+				++bucketstart[ bucket + 1 ];
+			}
+		}
+	}
+
+	for( int32_t bucket : iota( 0, numbuckets ) )
+	{
+		bucketstart[ bucket + 1 ] += bucketstart[ bucket ];
+	}
+
+	spritecontext.drawsegindex = R_AllocateScratch< int32_t >( M_MAX( bucketstart[ numbuckets ], 1 ) );
+
+	int32_t* fill = R_AllocateScratch< int32_t >( numbuckets );
+	memcpy( fill, bucketstart, sizeof( int32_t ) * numbuckets );
+
+	for( int32_t index : iota( 0, numdrawsegs ) )
+	{
+		drawseg_t& ds = bspcontext.drawsegs[ index ];
+		if( ds.silhouette || ds.maskedtexturecol )
+		{
+			for( int32_t bucket = BucketFor( ds.x1 ); bucket <= BucketFor( ds.x2 ); ++bucket )
+			{
+				spritecontext.drawsegindex[ fill[ bucket ]++ ] = index;
 			}
 		}
-		best->next->prev = best->prev;
-		best->prev->next = best->next;
-		best->next = &spritecontext.vsprsortedhead;
-		best->prev = spritecontext.vsprsortedhead.prev;
-		spritecontext.vsprsortedhead.prev->next = best;
-		spritecontext.vsprsortedhead.prev = best;
 	}
 }
 
+//
+// R_GatherDrawSegs
+// Returns the ascending list of drawseg indices that might overlap
+// [x1, x2]. A single bucket is returned in place, anything wider
+// is merged back and forth between the two working buffers.
+//
+static std::span< int32_t > R_GatherDrawSegs( spritecontext_t& spritecontext, int32_t x1, int32_t x2 )
+{
+	int32_t firstbucket = M_CLAMP( ( x1 - spritecontext.leftclip ) >> DRAWSEGBUCKETSHIFT, 0, spritecontext.numdrawsegbuckets - 1 );
+	int32_t lastbucket = M_CLAMP( ( x2 - spritecontext.leftclip ) >> DRAWSEGBUCKETSHIFT, 0, spritecontext.numdrawsegbuckets - 1 );
+
+	int32_t* bucketstart = spritecontext.drawsegbucketstart;
+
+	if( firstbucket == lastbucket )
+	{
+		return std::span( spritecontext.drawsegindex + bucketstart[ firstbucket ], bucketstart[ firstbucket + 1 ] - bucketstart[ firstbucket ] );
+	}
+
+	int32_t* working = spritecontext.drawsegworking;
+	int32_t* merged = spritecontext.drawsegmerged;
+	int32_t* workingend = std::copy( spritecontext.drawsegindex + bucketstart[ firstbucket ]
+									, spritecontext.drawsegindex + bucketstart[ firstbucket + 1 ]
+									, working );
+
+	for( int32_t bucket = firstbucket + 1; bucket <= lastbucket; ++bucket )
+	{
+		int32_t* bucketbegin = spritecontext.drawsegindex + bucketstart[ bucket ];
+		int32_t* bucketend = spritecontext.drawsegindex + bucketstart[ bucket + 1 ];
+
+		// Each bucket is sorted with no repeats, so a union gets rid
+		// of the drawsegs that straddle both without needing to hit
+		// the heap like inplace_merge does
+		int32_t* mergedend = std::set_union( working, workingend, bucketbegin, bucketend, merged );
+		std::swap( working, merged );
+		workingend = mergedend;
+	}
+
+	return std::span( working, workingend - working );
+}
 
 //
 // R_DrawSprite
@@ -985,8 +1136,11 @@ void R_DrawSprite( rendercontext_t& rendercontext, vissprite_t* spr )
 	// Scan drawsegs from end to start for obscuring segs.
 	// The first drawseg that has a greater scale
 	//  is the clip seg.
-	for (ds = bspcontext.thisdrawseg - 1 ; ds >= bspcontext.drawsegs ; ds--)
+	std::span< int32_t > candidates = R_GatherDrawSegs( spritecontext, spr->x1, spr->x2 );
+	for( auto curr = candidates.rbegin(); curr != candidates.rend(); ++curr )
 	{
+		ds = bspcontext.drawsegs + *curr;
+
 		// determine if the drawseg obscures the sprite
 		if (ds->x1 > spr->x2
 			|| ds->x2 < spr->x1
@@ -1079,7 +1233,7 @@ void R_DrawSprite( rendercontext_t& rendercontext, vissprite_t* spr )
 	if( spr->sector->clipceiling )
 	{
 		int32_t seccliptop = RendFixedToInt( rendercontext.viewpoint.centeryfrac - RendFixedMul( spr->sector->ceilheight - viewpoint.z, spr->scale ) + RENDFRACUNIT - 1 );
-		seccliptop = M_MAX( -1, seccliptop );
+		seccliptop = M_MAX( spritecontext.topclip - 1, seccliptop );
 		for (x=spr->x1 ; x<=spr->x2 ; x++)
 		{
 			cliptop[x] = cliptop[x] == -2 ? seccliptop : M_MAX( cliptop[x], seccliptop );
@@ -1089,7 +1243,7 @@ void R_DrawSprite( rendercontext_t& rendercontext, vissprite_t* spr )
 	if( spr->sector->clipfloor )
 	{
 		int32_t secclipbot = RendFixedToInt( rendercontext.viewpoint.centeryfrac - RendFixedMul( spr->sector->floorheight - viewpoint.z, spr->scale ) + RENDFRACUNIT - 1 );
-		secclipbot = M_MIN( drs_current->viewheight, secclipbot );
+		secclipbot = M_MIN( spritecontext.bottomclip, secclipbot );
 		for (x=spr->x1 ; x<=spr->x2 ; x++)
 		{
 			clipbot[x] = clipbot[x] == -2 ? secclipbot : M_MIN( clipbot[x], secclipbot );
@@ -1102,10 +1256,10 @@ void R_DrawSprite( rendercontext_t& rendercontext, vissprite_t* spr )
 	for (x = spr->x1 ; x<=spr->x2 ; x++)
 	{
 		if (clipbot[x] == -2)
-			clipbot[x] = drs_current->viewheight;
+			clipbot[x] = spritecontext.bottomclip;
 
 		if (cliptop[x] == -2)
-			cliptop[x] = -1;
+			cliptop[x] = spritecontext.topclip - 1;
 
 		if( cliptop[x] == clipbot[x] ) ++clippedcolumns;
 	}
@@ -1133,17 +1287,16 @@ void R_DrawSprite( rendercontext_t& rendercontext, vissprite_t* spr )
 //
 void R_DrawMasked( rendercontext_t& rendercontext )
 {
-	vissprite_t*	spr;
 	drawseg_t*		ds;
 	
 	R_SortVisSprites( rendercontext.spritecontext );
 
-	if ( rendercontext.spritecontext.nextvissprite > rendercontext.spritecontext.vissprites)
+	if ( rendercontext.spritecontext.numsortedvissprites > 0 )
 	{
+		R_BuildDrawSegIndex( rendercontext );
+
 		// draw all vissprites back to front
-		for (spr = rendercontext.spritecontext.vsprsortedhead.next ;
-				spr != &rendercontext.spritecontext.vsprsortedhead ;
-				spr = spr->next)
+		for( vissprite_t* spr : std::span( rendercontext.spritecontext.sortedvissprites, rendercontext.spritecontext.numsortedvissprites ) )
 		{
 			R_DrawSprite( rendercontext, spr );
 		}
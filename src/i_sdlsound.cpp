@@ -31,6 +31,13 @@
 #include <filesystem>
 #include <fstream>
 #include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "doomtype.h"
 
@@ -40,16 +47,26 @@
 #include "i_system.h"
 #include "i_swap.h"
 #include "i_terminal.h"
+#include "i_thread.h"
+#include "i_timer.h"
 
 #include "m_argv.h"
 #include "m_config.h"
 #include "m_conv.h"
+#include "m_fixed.h"
 #include "m_misc.h"
 
+#include "w_file.h"
 #include "w_wad.h"
 
 #include "z_zone.h"
 
+#if ARCH_CHECK( x64 )
+	#include <emmintrin.h>
+#elif ARCH_CHECK( ARM64 )
+	#include <arm_neon.h>
+#endif // ARCH_CHECK
+
 extern "C"
 {
 	// Scale factor used when converting libsamplerate floating point numbers
@@ -64,7 +81,7 @@ extern "C"
 }
 
 //#define DEBUG_DUMP_WAVS
-#define NUM_CHANNELS 16
+#define NUM_CHANNELS 128
 
 typedef struct allocated_sound_s allocated_sound_t;
 
@@ -73,7 +90,9 @@ struct allocated_sound_s
     sfxinfo_t *sfxinfo;
     Mix_Chunk chunk;
     int use_count;
-    int pitch;
+    // Chunk data points in to a sound pack rather than following this
+    // header, and doesn't count towards snd_cachesize
+    doombool packed;
     allocated_sound_t *prev, *next;
 };
 
@@ -85,10 +104,9 @@ static int mixer_freq;
 static Uint16 mixer_format;
 static int mixer_channels;
 static doombool use_sfx_prefix;
-static allocated_sound_t* (*ExpandSoundData)(sfxinfo_t *sfxinfo,
-											byte *data,
-											int samplerate,
-											int length) = nullptr;
+
+typedef struct resamplejob_s resamplejob_t;
+static void (*ExpandSoundData)(resamplejob_t* job) = nullptr;
 
 // Doubly-linked list of allocated sounds.
 // When a sound is played, it is moved to the head, so that the oldest
@@ -157,7 +175,10 @@ static void FreeAllocatedSound(allocated_sound_t *snd)
 
     // Keep track of the amount of allocated sound data:
 
-    allocated_sounds_size -= snd->chunk.alen;
+    if (!snd->packed)
+    {
+        allocated_sounds_size -= snd->chunk.alen;
+    }
 
     free(snd);
 }
@@ -185,7 +206,7 @@ static doombool FindAndFreeSound(void)
 
     while (snd != NULL)
     {
-        if (snd->use_count == 0)
+        if (snd->use_count == 0 && !snd->packed)
         {
             FreeAllocatedSound(snd);
             return true;
@@ -257,10 +278,10 @@ static allocated_sound_t *AllocateSound(sfxinfo_t *sfxinfo, size_t len)
     snd->chunk.alen = len;
     snd->chunk.allocated = 1;
     snd->chunk.volume = MIX_MAX_VOLUME;
-    snd->pitch = NORM_PITCH;
 
     snd->sfxinfo = sfxinfo;
     snd->use_count = 0;
+    snd->packed = false;
 
     // Keep track of how much memory all these cached sounds are using...
 
@@ -303,15 +324,15 @@ static void UnlockAllocatedSound(allocated_sound_t *snd)
 }
 
 // Search through the list of allocated sounds and return the one that matches
-// the supplied sfxinfo entry and pitch level.
+// the supplied sfxinfo entry.
 
-static allocated_sound_t * GetAllocatedSoundBySfxInfoAndPitch(sfxinfo_t *sfxinfo, int pitch)
+static allocated_sound_t * GetAllocatedSoundBySfxInfo(sfxinfo_t *sfxinfo)
 {
     allocated_sound_t * p = allocated_sounds_head;
 
     while (p != NULL)
     {
-        if (p->sfxinfo == sfxinfo && p->pitch == pitch)
+        if (p->sfxinfo == sfxinfo)
         {
             return p;
         }
@@ -321,47 +342,300 @@ static allocated_sound_t * GetAllocatedSoundBySfxInfoAndPitch(sfxinfo_t *sfxinfo
     return NULL;
 }
 
-// Allocate a new sound chunk and pitch-shift an existing sound up-or-down
-// into it.
+// Sound effects are mixed here instead of on SDL_mixer channels, which
+// are left for music. Every voice reads straight out of its allocated
+// sound, stepping through it at whatever rate its pitch asks for, so
+// starting a sound never allocates.
+//
+// The mixer runs on the audio thread and never waits on the main thread.
+// The main thread writes what it wants a voice doing in to the voice's
+// request under a spinlock. The mixer copies the request out at the
+// start of each pass if it can get that lock, and carries on with what
+// it had if it can't. Stopping also publishes the newest id stopped on
+// the voice outside of the lock, so a pass that misses the lock still
+// drops anything stopped. Every start gets a new id, and the mixer reports
+// back the id of whatever it ran out on, so running out can never stop
+// a sound that was started on the channel since. Samples are only
+// given back once no pass that could still be reading them is running.
+
+constexpr int32_t MixBlockFrames = 256;
+constexpr int32_t MixHistoryLength = SOUNDMIXER_HISTORY;
+constexpr uint64_t MixUnityStep = 1ull << 32;
+
+typedef struct mixerrequest_s
+{
+	const int16_t*			samples;		// Interleaved stereo, null when stopped
+	uint64_t				numframes;
+	uint64_t				step;
+	int16_t					leftvol;		// Q15
+	int16_t					rightvol;
+	uint32_t				startid;
+} mixerrequest_t;
+
+typedef struct mixervoice_s
+{
+	// Only written by the main thread, and only with the lock held
+	mixerrequest_t			request;
+	Spinlock				requestlock;
+	std::atomic< uint32_t >	stoppedid;
+
+	// Only written by the audio thread
+	mixerrequest_t			current;
+	uint64_t				position;		// 32.32 fixed point, in frames
+	std::atomic< uint32_t >	finishedid;
+} mixervoice_t;
+
+static mixervoice_t voices[NUM_CHANNELS];
+static uint32_t mixer_nextstartid = 1;
+
+// Odd while the mixer is running
+static std::atomic< uint32_t > mixer_pass;
+
+static std::atomic< int32_t > mixer_voicesplaying;
+static std::atomic< int32_t > mixer_framespermix;
+static std::atomic< int32_t > mixer_nexthistory;
+static float mixer_history[ MixHistoryLength ];
 
-static allocated_sound_t * PitchShift(allocated_sound_t *insnd, int pitch)
+// Adds count frames of interleaved stereo source to the accumulator,
+// scaled by the voice's volumes.
+
+static void MixFrames(int32_t* accum, const int16_t* source, int32_t count,
+                      int16_t leftvol, int16_t rightvol)
 {
-    allocated_sound_t * outsnd;
-    Sint16 *inp, *outp;
-    Sint16 *srcbuf, *dstbuf;
-    Uint32 srclen, dstlen;
+	int32_t frame = 0;
 
-    srcbuf = (Sint16 *)insnd->chunk.abuf;
-    srclen = insnd->chunk.alen;
+#if ARCH_CHECK( x64 )
+	__m128i vol = _mm_set_epi16( rightvol, leftvol, rightvol, leftvol, rightvol, leftvol, rightvol, leftvol );
+	for( ; frame + 4 <= count; frame += 4 )
+	{
+		__m128i src = _mm_loadu_si128( (const __m128i*)( source + frame * 2 ) );
+		__m128i lo = _mm_mullo_epi16( src, vol );
+		__m128i hi = _mm_mulhi_epi16( src, vol );
+		__m128i first = _mm_srai_epi32( _mm_unpacklo_epi16( lo, hi ), 15 );
+		__m128i second = _mm_srai_epi32( _mm_unpackhi_epi16( lo, hi ), 15 );
+
+		__m128i* dest = (__m128i*)( accum + frame * 2 );
+		_mm_storeu_si128( dest, _mm_add_epi32( _mm_loadu_si128( dest ), first ) );
+		_mm_storeu_si128( dest + 1, _mm_add_epi32( _mm_loadu_si128( dest + 1 ), second ) );
+	}
+#elif ARCH_CHECK( ARM64 )
+	const int16_t vollanes[ 8 ] = { leftvol, rightvol, leftvol, rightvol, leftvol, rightvol, leftvol, rightvol };
+	int16x8_t vol = vld1q_s16( vollanes );
+	for( ; frame + 4 <= count; frame += 4 )
+	{
+		int16x8_t src = vld1q_s16( source + frame * 2 );
+		int32x4_t first = vshrq_n_s32( vmull_s16( vget_low_s16( src ), vget_low_s16( vol ) ), 15 );
+		int32x4_t second = vshrq_n_s32( vmull_high_s16( src, vol ), 15 );
 
-    // determine ratio pitch:NORM_PITCH and apply to srclen, then invert.
-    // This is an approximation of vanilla behaviour based on measurements
-    dstlen = (int)((1 + (1 - (float)pitch / NORM_PITCH)) * srclen);
+		int32_t* dest = accum + frame * 2;
+		vst1q_s32( dest, vaddq_s32( vld1q_s32( dest ), first ) );
+		vst1q_s32( dest + 4, vaddq_s32( vld1q_s32( dest + 4 ), second ) );
+	}
+#endif // ARCH_CHECK
 
-    // ensure that the new buffer is an even length
-    if ((dstlen % 2) == 0)
-    {
-        dstlen++;
-    }
+	for( ; frame < count; ++frame )
+	{
+		accum[ frame * 2 ] += ( source[ frame * 2 ] * leftvol ) >> 15;
+		accum[ frame * 2 + 1 ] += ( source[ frame * 2 + 1 ] * rightvol ) >> 15;
+	}
+}
 
-    outsnd = AllocateSound(insnd->sfxinfo, dstlen);
+// Adds the accumulator to what SDL_mixer has already put in the stream,
+// saturating the result down to 16 bits.
 
-    if (!outsnd)
-    {
-        return NULL;
-    }
+static void MixDown(int16_t* stream, const int32_t* accum, int32_t count)
+{
+	int32_t sample = 0;
+	count *= 2;
 
-    outsnd->pitch = pitch;
-    dstbuf = (Sint16 *)outsnd->chunk.abuf;
+#if ARCH_CHECK( x64 )
+	for( ; sample + 8 <= count; sample += 8 )
+	{
+		__m128i* dest = (__m128i*)( stream + sample );
+		__m128i existing = _mm_loadu_si128( dest );
+		__m128i first = _mm_add_epi32( _mm_loadu_si128( (const __m128i*)( accum + sample ) )
+										, _mm_srai_epi32( _mm_unpacklo_epi16( existing, existing ), 16 ) );
+		__m128i second = _mm_add_epi32( _mm_loadu_si128( (const __m128i*)( accum + sample + 4 ) )
+										, _mm_srai_epi32( _mm_unpackhi_epi16( existing, existing ), 16 ) );
+		_mm_storeu_si128( dest, _mm_packs_epi32( first, second ) );
+	}
+#elif ARCH_CHECK( ARM64 )
+	for( ; sample + 8 <= count; sample += 8 )
+	{
+		int16x8_t existing = vld1q_s16( stream + sample );
+		int32x4_t first = vaddw_s16( vld1q_s32( accum + sample ), vget_low_s16( existing ) );
+		int32x4_t second = vaddw_high_s16( vld1q_s32( accum + sample + 4 ), existing );
+		vst1q_s16( stream + sample, vcombine_s16( vqmovn_s32( first ), vqmovn_s32( second ) ) );
+	}
+#endif // ARCH_CHECK
 
-    // loop over output buffer. find corresponding input cell, copy over
-    for (outp = dstbuf; outp < dstbuf + dstlen/2; ++outp)
-    {
-        inp = srcbuf + (int)((float)(outp - dstbuf) / dstlen * srclen);
-        *outp = *inp;
-    }
+	for( ; sample < count; ++sample )
+	{
+		int32_t mixed = stream[ sample ] + accum[ sample ];
+		stream[ sample ] = (int16_t)M_CLAMP( mixed, INT16_MIN, INT16_MAX );
+	}
+}
+
+// Mixes up to count frames of a voice. Pitched voices get their frames
+// gathered first so that the same kernel does the volume work.
+
+static void MixVoice(mixervoice_t* voice, int32_t* accum, int32_t count)
+{
+	const mixerrequest_t& current = voice->current;
+	uint64_t end = current.numframes << 32;
+	uint64_t remaining = ( end - voice->position + current.step - 1 ) / current.step;
+	count = (int32_t)M_MIN( (uint64_t)count, remaining );
+
+	if (current.step == MixUnityStep)
+	{
+		MixFrames(accum, current.samples + ( voice->position >> 32 ) * 2, count,
+		          current.leftvol, current.rightvol);
+		voice->position += (uint64_t)count << 32;
+	}
+	else
+	{
+		int16_t gathered[ MixBlockFrames * 2 ];
+		for (int32_t frame = 0; frame < count; ++frame)
+		{
+			const int16_t* source = current.samples + ( voice->position >> 32 ) * 2;
+			gathered[ frame * 2 ] = source[ 0 ];
+			gathered[ frame * 2 + 1 ] = source[ 1 ];
+			voice->position += current.step;
+		}
+		MixFrames(accum, gathered, count, current.leftvol, current.rightvol);
+	}
+
+	if (voice->position >= end)
+	{
+		voice->finishedid.store(voice->current.startid);
+		voice->current.samples = NULL;
+	}
+}
+
+// Start ids only ever go up, so stopping one stops everything started
+// on the voice before it too.
+
+static bool StartIdStopped(uint32_t startid, uint32_t stoppedid)
+{
+	return (int32_t)( stoppedid - startid ) >= 0;
+}
+
+// Picks up whatever the main thread has asked a voice to do since the
+// last pass. A new start id means starting from the top, otherwise it's
+// just a volume change. A request that has already run out stays
+// stopped until something new is started. Missing the lock still has
+// to honour a stop, as the main thread may already have given the
+// samples back.
+
+static void UpdateVoice(mixervoice_t* voice)
+{
+	if (voice->requestlock.TryAcquire())
+	{
+		if (voice->request.startid != voice->current.startid)
+		{
+			voice->position = 0;
+		}
+		voice->current = voice->request;
+		voice->requestlock.Release();
+	}
+
+	if (voice->current.startid == voice->finishedid.load(std::memory_order_relaxed)
+		|| StartIdStopped(voice->current.startid, voice->stoppedid.load()))
+	{
+		voice->current.samples = NULL;
+	}
+}
+
+// Registered as SDL_mixer's post mix callback, so it runs on the audio
+// thread after music has been mixed in.
+
+static void MixVoices(void *udata, Uint8 *stream, int len)
+{
+	alignas( 16 ) int32_t accum[ MixBlockFrames * 2 ];
+
+	mixer_pass.fetch_add(1);
+
+	uint64_t start = I_GetTimeUS();
+
+	for (mixervoice_t& voice : voices)
+	{
+		UpdateVoice(&voice);
+	}
+
+	int16_t* output = (int16_t*)stream;
+	int32_t totalframes = len / 4;
+	int32_t playing = 0;
+
+	for (int32_t first = 0; first < totalframes; first += MixBlockFrames)
+	{
+		int32_t count = M_MIN( MixBlockFrames, totalframes - first );
+		memset(accum, 0, sizeof(int32_t) * count * 2);
+
+		playing = 0;
+		for (mixervoice_t& voice : voices)
+		{
+			if (voice.current.samples != NULL)
+			{
+				MixVoice(&voice, accum, count);
+				++playing;
+			}
+		}
+
+		MixDown(output + first * 2, accum, count);
+	}
+
+	int32_t history = mixer_nexthistory.load();
+	mixer_history[ history ] = (float)( I_GetTimeUS() - start );
+	mixer_nexthistory.store( ( history + 1 ) % MixHistoryLength );
+	mixer_voicesplaying.store(playing);
+	mixer_framespermix.store(totalframes);
+
+	mixer_pass.fetch_add(1);
+}
+
+// Waits out a mix pass if there's one running. A stop published before
+// calling this is guaranteed to be seen by the next pass whether or not
+// it gets the request lock, so once this returns nothing the mixer had
+// before can still be in use.
+
+static void WaitForMixerPass()
+{
+	uint32_t pass = mixer_pass.load();
+	if ((pass & 1) == 0)
+	{
+		return;
+	}
+
+	while (mixer_pass.load() == pass)
+	{
+		std::this_thread::yield();
+	}
+}
+
+// Speeds a voice up or down the same amount the old pitch shifted
+// copies of sounds used to.
+
+static uint64_t PitchStep(int pitch)
+{
+    int64_t divisor = M_MAX( 2 * NORM_PITCH - pitch, 1 );
+    return ( (uint64_t)NORM_PITCH << 32 ) / divisor;
+}
+
+static void SetVoiceVolume(mixerrequest_t* request, int vol, int sep)
+{
+    int left, right;
+
+    left = ((254 - sep) * vol) / 127;
+    right = ((sep) * vol) / 127;
+
+    if (left < 0) left = 0;
+    else if ( left > 255) left = 255;
+    if (right < 0) right = 0;
+    else if (right > 255) right = 255;
 
-    return outsnd;
+    // 255 is full volume, same as Mix_SetPanning
+    request->leftvol = (int16_t)( left * 128 );
+    request->rightvol = (int16_t)( right * 128 );
 }
 
 // When a sound stops, check if it is still playing.  If it is not,
@@ -372,7 +646,11 @@ static void ReleaseSoundOnChannel(int channel)
 {
     allocated_sound_t *snd = channels_playing[channel];
 
-    Mix_HaltChannel(channel);
+    mixervoice_t* voice = &voices[channel];
+    voice->requestlock.Acquire();
+    voice->request.samples = NULL;
+    voice->stoppedid.store(voice->request.startid);
+    voice->requestlock.Release();
 
     if (snd == NULL)
     {
@@ -381,21 +659,38 @@ static void ReleaseSoundOnChannel(int channel)
 
     channels_playing[channel] = NULL;
 
-    UnlockAllocatedSound(snd);
+    // The mixer could be part way through a pass that's reading it
+    WaitForMixerPass();
 
-    // if the sound is a pitch-shift and it's not in use, immediately
-    // free it
-    if (snd->pitch != NORM_PITCH && snd->use_count <= 0)
-    {
-        FreeAllocatedSound(snd);
-    }
+    UnlockAllocatedSound(snd);
 }
 
+// Resampling is the expensive part of loading a sound, so it's done as
+// a job that only touches its own copy of the lump data. Whoever waits
+// on it moves the output in to a sound pack on the main thread.
+
+struct resamplejob_s
+{
+	sfxinfo_t*				sfxinfo;
+	int32_t					lumpnum;
+	int32_t					resampletype;
+	int32_t					samplerate;
+	std::vector< byte >		input;
+
+	std::vector< byte >		output;
+	uint32_t				clipped;
+	int32_t					result;
+
+	doombool				onjobsystem;
+	JobGroup				group;			// Just this job, so waiting on it never waits on anything else
+	std::atomic< bool >		done;
+};
+
 // Returns the conversion mode for libsamplerate to use.
 
-static int SRC_ConversionMode(void)
+static int SRC_ConversionMode(int32_t resampletype)
 {
-    switch (sound_resample_type)
+    switch (resampletype)
     {
         // Ascending numbers give higher quality
 
@@ -418,36 +713,27 @@ static int SRC_ConversionMode(void)
 //   unsigned 8 bits --> signed 16 bits
 //   mono --> stereo
 //   samplerate --> mixer_freq
-// Returns number of clipped samples.
+// Counts the number of clipped samples.
 // DWF 2008-02-10 with cleanups by Simon Howard.
+// Safe to run on any thread, so nothing in here can touch the WAD or
+// the allocated sound list.
 
-static allocated_sound_t* ExpandSoundData_SRC(sfxinfo_t *sfxinfo,
-                                   byte *data,
-                                   int samplerate,
-                                   int length)
+static void ExpandSoundData_SRC(resamplejob_t* job)
 {
 	SRC_DATA src_data;
-	float *data_in;
-	uint32_t i, abuf_index=0, clipped=0;
-	int32_t retn;
+	uint32_t i, abuf_index=0;
+	uint32_t length = (uint32_t)job->input.size();
 	int16_t *expanded;
-	allocated_sound_t *snd;
-	Mix_Chunk *chunk;
 
+    std::vector< float > data_in( length );
     src_data.input_frames = length;
-    data_in = (float*)malloc(length * sizeof(float));
-    src_data.data_in = data_in;
-    src_data.src_ratio = (double)mixer_freq / samplerate;
+    src_data.data_in = data_in.data();
+    src_data.src_ratio = (double)mixer_freq / job->samplerate;
 
     // We include some extra space here in case of rounding-up.
     src_data.output_frames = src_data.src_ratio * length + (mixer_freq / 4);
-    src_data.data_out = (float*)malloc(src_data.output_frames * sizeof(float));
-
-
-    if( src_data.data_in == NULL || src_data.data_out == NULL )
-	{
-		I_Error( "Error allocating data for sound %s in WAD %s.", sfxinfo->name, W_WadNameForLumpNum( sfxinfo->lumpnum ) );
-	}
+    std::vector< float > data_out( src_data.output_frames );
+    src_data.data_out = data_out.data();
 
     // Convert input data to floats
 
@@ -456,30 +742,20 @@ static allocated_sound_t* ExpandSoundData_SRC(sfxinfo_t *sfxinfo,
         // Unclear whether 128 should be interpreted as "zero" or whether a
         // symmetrical range should be assumed.  The following assumes a
         // symmetrical range.
-        data_in[i] = data[i] / 127.5 - 1;
+        data_in[i] = job->input[i] / 127.5 - 1;
     }
 
     // Do the sound conversion
 
-	retn = src_simple(&src_data, SRC_ConversionMode(), 1);
-	if( retn != 0 )
+	job->clipped = 0;
+	job->result = src_simple(&src_data, SRC_ConversionMode(job->resampletype), 1);
+	if( job->result != 0 )
 	{
-		I_Error( "Error resampling sound %s in WAD %s.", sfxinfo->name, W_WadNameForLumpNum( sfxinfo->lumpnum ) );
+		return;
 	}
 
-    // Allocate the new chunk.
-
-//    alen = src_data.output_frames_gen * 4;
-
-    snd = AllocateSound(sfxinfo, src_data.output_frames_gen * 4);
-
-    if (snd == nullptr)
-    {
-        return nullptr;
-    }
-
-    chunk = &snd->chunk;
-    expanded = (int16_t *) chunk->abuf;
+    job->output.resize(src_data.output_frames_gen * 4);
+    expanded = (int16_t *) job->output.data();
 
     // Convert the result back into 16-bit integers.
 
@@ -514,12 +790,12 @@ static allocated_sound_t* ExpandSoundData_SRC(sfxinfo_t *sfxinfo,
         if (cvtval_i < -INT16_MAX)
         {
             cvtval_i = -INT16_MAX;
-            ++clipped;
+            ++job->clipped;
         }
         else if (cvtval_i > INT16_MAX)
         {
             cvtval_i = INT16_MAX;
-            ++clipped;
+            ++job->clipped;
         }
 
         // Left and right channels
@@ -527,18 +803,6 @@ static allocated_sound_t* ExpandSoundData_SRC(sfxinfo_t *sfxinfo,
         expanded[abuf_index++] = cvtval_i;
         expanded[abuf_index++] = cvtval_i;
     }
-
-    free(data_in);
-    free(src_data.data_out);
-
-    if (clipped > 0)
-    {
-        fprintf(stderr, "Sound '%s': clipped %u samples (%0.2f %%)\n", 
-                        sfxinfo->name, clipped,
-                        400.0 * clipped / chunk->alen);
-    }
-
-    return snd;
 }
 
 #ifdef DEBUG_DUMP_WAVS
@@ -594,89 +858,360 @@ static void WriteWAV(char *filename, byte *data,
 // Load and convert a sound effect
 // Returns true if successful
 
-// This is copypasta code, need to find a real place for it to live
-static time_t GetLastModifiedTime( const std::filesystem::path& stdpath )
+// Resampled sounds are cached on disk in one pack per WAD and resampler.
+// A pack is a header, an index, and then every sound's samples back to
+// back. It gets mapped the first time any sound from its WAD is wanted,
+// and every sound loaded from it points straight in to the mapping.
+//
+// Sounds resampled this session are held on to until the pack can be
+// rewritten. That's straight away if there was no pack on disk, but
+// otherwise has to wait until nothing is playing out of the old one.
+
+constexpr uint32_t SoundPackMagic = 0x58465352; // 'RSFX'
+constexpr int32_t SoundPackVersion = 1;
+constexpr size_t SoundPackAlignment = 16;
+
+typedef PACKED_STRUCT( soundpackheader_s
 {
-	auto filetime = std::filesystem::last_write_time( stdpath );
-#if WIN32
-	auto utctime = std::chrono::file_clock::to_utc( filetime );
-	auto systime = std::chrono::utc_clock::to_sys( utctime );
-#else
-	auto systime = std::chrono::file_clock::to_sys( filetime );
-#endif
-	return std::chrono::system_clock::to_time_t( systime );
-}
+	uint32_t		magic;
+	int32_t			version;
+	int32_t			samplerate;
+	float_t			scale;
+	uint32_t		numsounds;
+} ) soundpackheader_t;
+
+typedef PACKED_STRUCT( soundpackentry_s
+{
+	char			name[ 8 ];
+	uint32_t		offset;
+	uint32_t		length;
+} ) soundpackentry_t;
 
-typedef struct sfxpath_s
+typedef struct soundpack_s
 {
-	sfxinfo_t*				sfxinfo;
-	std::filesystem::path	path;
-	std::string				pathstring;
+	std::string												path;
+	wad_file_t*												file;
+	byte*													data;
+	doombool												ownsdata;
+
+	std::unordered_map< std::string, soundpackentry_t >		entries;
+	std::map< std::string, std::vector< byte > >			pending;
+} soundpack_t;
 
-	std::filesystem::path	folder;
-} sfxpath_t;
+// One set per resampler, keyed on WAD path. A quality change fills in
+// the new resampler's packs while the old ones are still being played.
+static std::unordered_map< std::string, soundpack_t > soundpacks[ arrlen( outputtypes ) ];
 
-sfxpath_t GetPath( sfxinfo_t* sfxinfo )
+static std::string SoundPackName( int32_t lumpnum )
 {
-	sfxpath_t output = { sfxinfo };
+	const char* name = W_GetNameForNum( lumpnum );
+	return ToLower( std::string( name, strnlen( name, 8 ) ) );
+}
 
-	const char* WADFile = W_WadPathForLumpNum( sfxinfo->lumpnum );
-	std::filesystem::path WADFilePath = std::filesystem::absolute( WADFile );
+static void CloseSoundPack( soundpack_t& pack )
+{
+	if( pack.file )
+	{
+		if( pack.ownsdata )
+		{
+			free( pack.data );
+		}
+		W_CloseFile( pack.file );
+	}
 
-	time_t lastmodified = GetLastModifiedTime( WADFilePath );
-	size_t filelength = std::filesystem::file_size( WADFilePath );
+	pack.file = nullptr;
+	pack.data = nullptr;
+	pack.ownsdata = false;
+	pack.entries.clear();
+}
 
-	output.pathstring = configdir;
-	output.pathstring += "cache" DIR_SEPARATOR_S "sound" DIR_SEPARATOR_S;
-	output.pathstring += M_BaseName( WADFile );
-	output.pathstring += "." + std::to_string( lastmodified ) + "." + std::to_string( filelength ) + DIR_SEPARATOR_S;
-	output.pathstring += outputtypes[ sound_resample_type ];
-	output.pathstring += DIR_SEPARATOR_S;
+static void OpenSoundPack( soundpack_t& pack )
+{
+	if( !std::filesystem::exists( std::filesystem::path( pack.path ) ) )
+	{
+		return;
+	}
 
-	output.folder = std::filesystem::path( output.pathstring );
+	pack.file = W_OpenMappedFile( pack.path.c_str() );
+	if( !pack.file )
+	{
+		return;
+	}
 
-	output.pathstring += ToLower( std::string( W_GetNameForNum( sfxinfo->lumpnum ) ) ) + ".dat";
+	pack.data = pack.file->mapped;
+	if( !pack.data )
+	{
+		// No mapping on this platform, so one big read is the next best thing
+		pack.data = (byte*)malloc( pack.file->length );
+		pack.ownsdata = true;
+		if( W_Read( pack.file, 0, pack.data, pack.file->length ) != pack.file->length )
+		{
+			CloseSoundPack( pack );
+			return;
+		}
+	}
 
-	output.path = std::filesystem::path( output.pathstring );
+	size_t packlength = pack.file->length;
+	soundpackheader_t header;
+	if( packlength < sizeof( soundpackheader_t ) )
+	{
+		CloseSoundPack( pack );
+		return;
+	}
+	memcpy( &header, pack.data, sizeof( soundpackheader_t ) );
+
+	// Anything that changes the resampled output has to invalidate the pack
+	if( header.magic != SoundPackMagic
+		|| header.version != SoundPackVersion
+		|| header.samplerate != mixer_freq
+		|| header.scale != libsamplerate_scale
+		|| packlength < sizeof( soundpackheader_t ) + (size_t)header.numsounds * sizeof( soundpackentry_t ) )
+	{
+		CloseSoundPack( pack );
+		return;
+	}
 
-	return output;
+	const soundpackentry_t* index = (const soundpackentry_t*)( pack.data + sizeof( soundpackheader_t ) );
+	for( uint32_t soundnum = 0; soundnum < header.numsounds; ++soundnum )
+	{
+		soundpackentry_t entry;
+		memcpy( &entry, &index[ soundnum ], sizeof( soundpackentry_t ) );
+		if( (size_t)entry.offset + entry.length > packlength )
+		{
+			CloseSoundPack( pack );
+			return;
+		}
+		pack.entries[ std::string( entry.name, strnlen( entry.name, 8 ) ) ] = entry;
+	}
 }
 
-static allocated_sound_t* LoadFromCache( sfxpath_t& path )
+static soundpack_t& GetSoundPack( const char* wadpath, int32_t resampletype )
 {
-	if( std::filesystem::exists( path.path ) )
+	auto found = soundpacks[ resampletype ].find( wadpath );
+	if( found != soundpacks[ resampletype ].end() )
 	{
-		size_t sounddatalen = std::filesystem::file_size( path.path );
-		byte* sounddata = (byte*)malloc( sounddatalen );
-		FILE* input = fopen( path.pathstring.c_str(), "rb" );
-		fread( sounddata, 1, sounddatalen, input );
-		fclose( input );
+		return found->second;
+	}
+
+	soundpack_t& pack = soundpacks[ resampletype ][ wadpath ];
+	pack.file = nullptr;
+	pack.data = nullptr;
+	pack.ownsdata = false;
+
+	std::filesystem::path WADFilePath = std::filesystem::absolute( wadpath );
+
+	time_t lastmodified = M_FileLastModified( WADFilePath.string().c_str() );
+	size_t filelength = std::filesystem::file_size( WADFilePath );
 
-		allocated_sound_t* sound = (allocated_sound_t*)sounddata;
-		sound->sfxinfo = path.sfxinfo;
-		sound->prev = nullptr;
-		sound->next = nullptr;
-		sound->chunk.abuf = (Uint8*)( sound + 1 );
+	pack.path = configdir;
+	pack.path += "cache" DIR_SEPARATOR_S "sound" DIR_SEPARATOR_S;
+	pack.path += M_BaseName( wadpath );
+	pack.path += "." + std::to_string( lastmodified ) + "." + std::to_string( filelength ) + DIR_SEPARATOR_S;
+	pack.path += outputtypes[ resampletype ];
+	pack.path += ".sfxpack";
 
-		allocated_sounds_size += sounddatalen;
+	OpenSoundPack( pack );
+
+	return pack;
+}
+
+static allocated_sound_t* LoadFromPack( soundpack_t& pack, const std::string& name, sfxinfo_t* sfxinfo )
+{
+	auto found = pack.entries.find( name );
+	if( found != pack.entries.end() )
+	{
+		allocated_sound_t* sound = (allocated_sound_t*)malloc( sizeof( allocated_sound_t ) );
+		if( sound == nullptr )
+		{
+			return nullptr;
+		}
+
+		sound->chunk.abuf = pack.data + found->second.offset;
+		sound->chunk.alen = found->second.length;
+		sound->chunk.allocated = 0;
+		sound->chunk.volume = MIX_MAX_VOLUME;
+		sound->sfxinfo = sfxinfo;
+		sound->use_count = 0;
+		sound->packed = true;
 
 		AllocatedSoundLink( sound );
 
 		return sound;
 	}
 
+	// Resampled earlier this session and since pushed out of the cache
+	auto pending = pack.pending.find( name );
+	if( pending != pack.pending.end() )
+	{
+		allocated_sound_t* sound = AllocateSound( sfxinfo, pending->second.size() );
+		if( sound != nullptr )
+		{
+			memcpy( sound->chunk.abuf, pending->second.data(), pending->second.size() );
+		}
+		return sound;
+	}
+
 	return nullptr;
 }
 
-static void SaveToCache( sfxpath_t& path, allocated_sound_t* data )
+// Rewrites a pack with everything it already had plus everything
+// resampled since. If the old pack is open then no sound can be
+// pointing in to it, as it gets closed before the new one goes in.
+static void WriteSoundPack( soundpack_t& pack )
 {
-	std::filesystem::create_directories( path.folder );
-	FILE* output = fopen( path.pathstring.c_str(), "wb" );
-	fwrite( data, 1, sizeof( allocated_sound_t ) + data->chunk.alen, output );
-	fclose( output );
+	if( pack.pending.empty() )
+	{
+		return;
+	}
+
+	std::vector< soundpackentry_t > index;
+	std::vector< const byte* > sources;
+
+	for( auto& existing : pack.entries )
+	{
+		if( pack.pending.find( existing.first ) == pack.pending.end() )
+		{
+			index.push_back( existing.second );
+			sources.push_back( pack.data + existing.second.offset );
+		}
+	}
+
+	for( auto& added : pack.pending )
+	{
+		soundpackentry_t entry = {};
+		memcpy( entry.name, added.first.c_str(), M_MIN( added.first.size(), sizeof( entry.name ) ) );
+		entry.length = (uint32_t)added.second.size();
+		index.push_back( entry );
+		sources.push_back( added.second.data() );
+	}
+
+	soundpackheader_t header;
+	header.magic = SoundPackMagic;
+	header.version = SoundPackVersion;
+	header.samplerate = mixer_freq;
+	header.scale = libsamplerate_scale;
+	header.numsounds = (uint32_t)index.size();
+
+	size_t offset = sizeof( soundpackheader_t ) + sizeof( soundpackentry_t ) * index.size();
+	for( soundpackentry_t& entry : index )
+	{
+		offset = AlignTo< SoundPackAlignment >( offset );
+		entry.offset = (uint32_t)offset;
+		offset += entry.length;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories( std::filesystem::path( pack.path ).parent_path(), error );
+
+	std::string temppath = pack.path + ".tmp";
+	FILE* output = fopen( temppath.c_str(), "wb" );
+	if( !output )
+	{
+		return;
+	}
+
+	bool written = fwrite( &header, sizeof( soundpackheader_t ), 1, output ) == 1;
+	written &= fwrite( index.data(), sizeof( soundpackentry_t ), index.size(), output ) == index.size();
+
+	constexpr byte padding[ SoundPackAlignment ] = {};
+	size_t position = sizeof( soundpackheader_t ) + sizeof( soundpackentry_t ) * index.size();
+	for( size_t entrynum = 0; entrynum < index.size(); ++entrynum )
+	{
+		written &= fwrite( padding, 1, index[ entrynum ].offset - position, output ) == index[ entrynum ].offset - position;
+		written &= fwrite( sources[ entrynum ], 1, index[ entrynum ].length, output ) == index[ entrynum ].length;
+		position = index[ entrynum ].offset + index[ entrynum ].length;
+	}
+	written &= fclose( output ) == 0;
+
+	if( !written )
+	{
+		std::filesystem::remove( std::filesystem::path( temppath ), error );
+		return;
+	}
+
+	CloseSoundPack( pack );
+	std::filesystem::rename( std::filesystem::path( temppath ), std::filesystem::path( pack.path ), error );
+	pack.pending.clear();
+	OpenSoundPack( pack );
 }
 
-static allocated_sound_t* CacheSFX(sfxinfo_t *sfxinfo)
+// Packs that are already open can only be rewritten once every sound
+// has been freed, so the caller has to say when that's the case.
+static void FlushSoundPacks( int32_t resampletype, doombool soundsreleased )
+{
+	for( auto& packpair : soundpacks[ resampletype ] )
+	{
+		soundpack_t& pack = packpair.second;
+		if( soundsreleased || pack.file == nullptr )
+		{
+			WriteSoundPack( pack );
+		}
+	}
+}
+
+static void CloseAllSoundPacks( int32_t resampletype )
+{
+	for( auto& packpair : soundpacks[ resampletype ] )
+	{
+		CloseSoundPack( packpair.second );
+	}
+	soundpacks[ resampletype ].clear();
+}
+
+// Every resample that hasn't been moved in to a pack yet. Only ever
+// touched on the main thread, the jobs hold their own references.
+static std::vector< std::shared_ptr< resamplejob_t > > resamplejobs;
+
+// Quality changes resample on a thread of their own. There can be
+// hundreds of them, and they'd crowd the frame's jobs off the workers.
+// Precache resamples are few enough to share the job system, each in
+// a group of its own that only a wait on that sound ever flushes.
+static std::unique_ptr< JobThread > backgroundresampler;
+static int32_t target_resample_type = 0;
+
+// Everything that's been precached, ie everything a quality change
+// needs to resample
+static std::unordered_set< sfxinfo_t* > knownsounds;
+
+extern std::unique_ptr< JobSystem > jobs;
+
+typedef enum resampledispatch_e
+{
+	Resample_Inline,
+	Resample_Jobs,
+	Resample_Background,
+} resampledispatch_t;
+
+static resamplejob_t* FindResampleJob( int32_t lumpnum, int32_t resampletype )
+{
+	for( auto& job : resamplejobs )
+	{
+		if( job->lumpnum == lumpnum && job->resampletype == resampletype )
+		{
+			return job.get();
+		}
+	}
+
+	return nullptr;
+}
+
+static doombool ResamplesInFlight( int32_t resampletype )
+{
+	for( auto& job : resamplejobs )
+	{
+		if( job->resampletype == resampletype )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Checks the lump is a sound, takes a copy of its samples and starts
+// resampling them. Returns nullptr for invalid sounds.
+
+static resamplejob_t* QueueResample( sfxinfo_t* sfxinfo, int32_t resampletype, resampledispatch_t dispatch )
 {
 	int32_t lumpnum;
 	uint32_t lumplen;
@@ -684,78 +1219,235 @@ static allocated_sound_t* CacheSFX(sfxinfo_t *sfxinfo)
 	uint32_t length;
 	byte *data;
 
-	// need to load the sound
+	lumpnum = sfxinfo->lumpnum;
+	data = (byte*)W_CacheLumpNum(lumpnum, PU_STATIC);
+	lumplen = W_LumpLength(lumpnum);
 
-	sfxpath_t path = GetPath( sfxinfo );
+	// Check the header, and ensure this is a valid sound
 
-	allocated_sound_t* sound = LoadFromCache( path );
-	if( !sound )
+	if (lumplen < 8
+	 || data[0] != 0x03 || data[1] != 0x00)
 	{
-		lumpnum = sfxinfo->lumpnum;
-		data = (byte*)W_CacheLumpNum(lumpnum, PU_STATIC);
-		lumplen = W_LumpLength(lumpnum);
+		// Invalid sound
 
-		// Check the header, and ensure this is a valid sound
+		W_ReleaseLumpNum(lumpnum);
+		return nullptr;
+	}
 
-		if (lumplen < 8
-		 || data[0] != 0x03 || data[1] != 0x00)
-		{
-			// Invalid sound
+	// 16 bit sample rate field, 32 bit length field
 
-			return nullptr;
-		}
+	samplerate = (data[3] << 8) | data[2];
+	length = (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
+
+	// If the header specifies that the length of the sound is greater than
+	// the length of the lump itself, this is an invalid sound lump
+
+	// We also discard sound lumps that are less than 49 samples long,
+	// as this is how DMX behaves - although the actual cut-off length
+	// seems to vary slightly depending on the sample rate.  This needs
+	// further investigation to better understand the correct
+	// behavior.
+
+	if (length > lumplen - 8 || length <= 48)
+	{
+		W_ReleaseLumpNum(lumpnum);
+		return nullptr;
+	}
 
-		// 16 bit sample rate field, 32 bit length field
+	// The DMX sound library seems to skip the first 16 and last 16
+	// bytes of the lump - reason unknown.
 
-		samplerate = (data[3] << 8) | data[2];
-		length = (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
+	data += 16;
+	length -= 32;
 
-		// If the header specifies that the length of the sound is greater than
-		// the length of the lump itself, this is an invalid sound lump
+	std::shared_ptr< resamplejob_t > job = std::make_shared< resamplejob_t >();
+	job->sfxinfo = sfxinfo;
+	job->lumpnum = lumpnum;
+	job->resampletype = resampletype;
+	job->samplerate = samplerate;
+	job->input.assign( data + 8, data + 8 + length );
+	job->clipped = 0;
+	job->result = 0;
+	job->onjobsystem = dispatch == Resample_Jobs && jobs;
+	job->done = false;
 
-		// We also discard sound lumps that are less than 49 samples long,
-		// as this is how DMX behaves - although the actual cut-off length
-		// seems to vary slightly depending on the sample rate.  This needs
-		// further investigation to better understand the correct
-		// behavior.
+	// don't need the original lump any more
+	W_ReleaseLumpNum(lumpnum);
 
-		if (length > lumplen - 8 || length <= 48)
+	resamplejobs.push_back( job );
+
+	auto run = [ job ]()
+	{
+		ExpandSoundData( job.get() );
+		job->done.store( true );
+		job->done.notify_all();
+	};
+
+	if( job->onjobsystem )
+	{
+		jobs->AddJob( job->group, run );
+	}
+	else if( dispatch == Resample_Background && backgroundresampler )
+	{
+		backgroundresampler->AddJob( run );
+	}
+	else
+	{
+		run();
+	}
+
+	return job.get();
+}
+
+static void WaitForResample( resamplejob_t* job )
+{
+	if( job->onjobsystem )
+	{
+		// Runs the job here if no worker has picked it up yet, which
+		// also catches it stuck behind a worker that's been switched off
+		jobs->Flush( job->group );
+	}
+	else
+	{
+		job->done.wait( false );
+	}
+}
+
+// Moves a finished resample in to its pack, ready for LoadFromPack.
+
+static void CommitResample( resamplejob_t* job )
+{
+	if( job->result != 0 )
+	{
+		I_Error( "Error resampling sound %s in WAD %s.", job->sfxinfo->name, W_WadNameForLumpNum( job->lumpnum ) );
+	}
+
+	if (job->clipped > 0)
+	{
+		fprintf(stderr, "Sound '%s': clipped %u samples (%0.2f %%)\n", 
+						job->sfxinfo->name, job->clipped,
+						400.0 * job->clipped / job->output.size());
+	}
+
+#ifdef DEBUG_DUMP_WAVS
+	{
+		char filename[16];
+
+		M_snprintf(filename, sizeof(filename), "%s.wav",
+				   DEH_String(job->sfxinfo->name));
+		WriteWAV(filename, job->output.data(), job->output.size(), mixer_freq);
+	}
+#endif
+
+	soundpack_t& pack = GetSoundPack( W_WadPathForLumpNum( job->lumpnum ), job->resampletype );
+	pack.pending[ SoundPackName( job->lumpnum ) ] = std::move( job->output );
+
+	auto found = std::find_if( resamplejobs.begin(), resamplejobs.end(), [ job ]( auto& queued ) { return queued.get() == job; } );
+	resamplejobs.erase( found );
+}
+
+// Starts resampling a sound unless this resampler already has it or is
+// working on it. Returns true if a job was started.
+
+static doombool ResampleIfUncached( sfxinfo_t* sfxinfo, int32_t resampletype, resampledispatch_t dispatch )
+{
+	soundpack_t& pack = GetSoundPack( W_WadPathForLumpNum( sfxinfo->lumpnum ), resampletype );
+	std::string name = SoundPackName( sfxinfo->lumpnum );
+
+	if( pack.entries.find( name ) != pack.entries.end()
+		|| pack.pending.find( name ) != pack.pending.end()
+		|| FindResampleJob( sfxinfo->lumpnum, resampletype ) != nullptr )
+	{
+		return false;
+	}
+
+	return QueueResample( sfxinfo, resampletype, dispatch ) != nullptr;
+}
+
+static allocated_sound_t* CacheSFX(sfxinfo_t *sfxinfo)
+{
+	// need to load the sound
+
+	soundpack_t& pack = GetSoundPack( W_WadPathForLumpNum( sfxinfo->lumpnum ), sound_resample_type );
+	std::string name = SoundPackName( sfxinfo->lumpnum );
+
+	allocated_sound_t* sound = LoadFromPack( pack, name, sfxinfo );
+	if( !sound )
+	{
+		// Precaching might have got this one going already
+		resamplejob_t* job = FindResampleJob( sfxinfo->lumpnum, sound_resample_type );
+		if( !job )
+		{
+			job = QueueResample( sfxinfo, sound_resample_type, Resample_Inline );
+		}
+
+		if( !job )
 		{
 			return nullptr;
 		}
 
-		// The DMX sound library seems to skip the first 16 and last 16
-		// bytes of the lump - reason unknown.
+		WaitForResample( job );
+		CommitResample( job );
+
+		sound = LoadFromPack( pack, name, sfxinfo );
+	}
+
+	return sound;
+}
+
+// The new resampler has everything it needs, so swap over to it. This
+// cuts off whatever is playing, same as changing quality always has.
+
+static void SwitchResampleType()
+{
+	int32_t oldtype = sound_resample_type;
+
+	for( int32_t index = 0; index < NUM_CHANNELS; ++index )
+	{
+		ReleaseSoundOnChannel( index );
+	}
+
+	FreeAllAllocatedSounds();
+
+	sound_resample_type = target_resample_type;
 
-		data += 16;
-		length -= 32;
+	// Nothing points in to the old resampler's packs any more
+	FlushSoundPacks( oldtype, true );
+	CloseAllSoundPacks( oldtype );
 
-		// Sample rate conversion
+	FlushSoundPacks( sound_resample_type, false );
+}
 
-		sound = ExpandSoundData(sfxinfo, data + 8, samplerate, length);
-		if ( !sound )
+static void CommitFinishedResamples()
+{
+	doombool committed = false;
+
+	for( size_t index = 0; index < resamplejobs.size(); )
+	{
+		if( resamplejobs[ index ]->done.load() )
 		{
-			return nullptr;
+			CommitResample( resamplejobs[ index ].get() );
+			committed = true;
 		}
-
-#ifdef DEBUG_DUMP_WAVS
+		else
 		{
-			char filename[16];
-			allocated_sound_t * snd;
-
-			M_snprintf(filename, sizeof(filename), "%s.wav",
-					   DEH_String(sfxinfo->name));
-			snd = GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, NORM_PITCH);
-			WriteWAV(filename, snd->chunk.abuf, snd->chunk.alen,mixer_freq);
+			++index;
 		}
-#endif
-		// don't need the original lump any more
-		W_ReleaseLumpNum(lumpnum);
+	}
 
-		SaveToCache( path, sound );
+	if( committed && resamplejobs.empty() )
+	{
+		for( int32_t resampletype = 0; resampletype < (int32_t)arrlen( outputtypes ); ++resampletype )
+		{
+			FlushSoundPacks( resampletype, false );
+		}
 	}
 
-	return sound;
+	if( target_resample_type != sound_resample_type
+		&& !ResamplesInFlight( target_resample_type ) )
+	{
+		SwitchResampleType();
+	}
 }
 
 static void GetSfxLumpName(sfxinfo_t *sfx, char *buf, size_t buf_len)
@@ -780,6 +1472,10 @@ static void GetSfxLumpName(sfxinfo_t *sfx, char *buf, size_t buf_len)
     }
 }
 
+// Sounds that aren't cached on disk get resampled on the job system.
+// Nothing waits on them here; UpdateSound picks up the results, and
+// anything played before then waits on just the job it needs.
+
 static void I_SDL_PrecacheSounds(sfxinfo_t *sounds, int num_sounds)
 {
     char namebuf[9];
@@ -793,31 +1489,52 @@ static void I_SDL_PrecacheSounds(sfxinfo_t *sounds, int num_sounds)
 
         if (sounds[i].lumpnum != -1)
         {
-            CacheSFX(&sounds[i]);
+            knownsounds.insert(&sounds[i]);
+            ResampleIfUncached(&sounds[i], sound_resample_type, Resample_Jobs);
         }
     }
 }
 
+// Resamples in the background and keeps playing the current quality
+// until it's done. Passing no sounds resamples everything precached.
+
 static void I_SDL_ChangeSoundQuality( int32_t sound_quality, sfxinfo_t* sounds, int num_sounds )
 {
-	if( sound_quality != sound_resample_type )
+	if( sound_quality == target_resample_type || SRC_ConversionMode( sound_quality ) < 0 )
 	{
-		sound_resample_type = sound_quality;
+		return;
+	}
 
-		for( int32_t index = 0; index < NUM_CHANNELS; ++index )
+	for( int32_t index = 0; index < num_sounds; ++index )
+	{
+		if( sounds[ index ].lumpnum != -1 )
 		{
-			ReleaseSoundOnChannel( index );
+			knownsounds.insert( &sounds[ index ] );
 		}
+	}
 
-		FreeAllAllocatedSounds();
+	target_resample_type = sound_quality;
 
-		for( int32_t index = 0; index < num_sounds; ++index )
-		{
-			if( sounds[ index ].lumpnum != -1 )
-			{
-				CacheSFX( &sounds[ index ] );
-			}
-		}
+	// Changed back before the last change finished
+	if( target_resample_type == sound_resample_type )
+	{
+		return;
+	}
+
+	if( !backgroundresampler )
+	{
+		backgroundresampler = std::make_unique< JobThread >();
+	}
+
+	for( sfxinfo_t* sfxinfo : knownsounds )
+	{
+		ResampleIfUncached( sfxinfo, target_resample_type, Resample_Background );
+	}
+
+	// Otherwise UpdateSound switches over once the last job is done
+	if( !ResamplesInFlight( target_resample_type ) )
+	{
+		SwitchResampleType();
 	}
 }
 
@@ -826,7 +1543,7 @@ static void I_SDL_ChangeSoundQuality( int32_t sound_quality, sfxinfo_t* sounds,
 static doombool LockSound(sfxinfo_t *sfxinfo)
 {
     // If the sound isn't loaded, load it now
-    if (GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, NORM_PITCH) == NULL)
+    if (GetAllocatedSoundBySfxInfo(sfxinfo) == NULL)
     {
         if (!CacheSFX(sfxinfo))
         {
@@ -834,7 +1551,7 @@ static doombool LockSound(sfxinfo_t *sfxinfo)
         }
     }
 
-    LockAllocatedSound(GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, NORM_PITCH));
+    LockAllocatedSound(GetAllocatedSoundBySfxInfo(sfxinfo));
 
     return true;
 }
@@ -855,22 +1572,15 @@ static int I_SDL_GetSfxLumpNum(sfxinfo_t *sfx)
 
 static void I_SDL_UpdateSoundParams(int handle, int vol, int sep)
 {
-    int left, right;
-
     if (!sound_initialized || handle < 0 || handle >= NUM_CHANNELS)
     {
         return;
     }
 
-    left = ((254 - sep) * vol) / 127;
-    right = ((sep) * vol) / 127;
-
-    if (left < 0) left = 0;
-    else if ( left > 255) left = 255;
-    if (right < 0) right = 0;
-    else if (right > 255) right = 255;
-
-    Mix_SetPanning(handle, left, right);
+    mixervoice_t* voice = &voices[handle];
+    voice->requestlock.Acquire();
+    SetVoiceVolume(&voice->request, vol, sep);
+    voice->requestlock.Release();
 }
 
 //
@@ -883,7 +1593,8 @@ static void I_SDL_UpdateSoundParams(int handle, int vol, int sep)
 // As our sound handling does not handle
 //  priority, it is ignored.
 // Pitching (that is, increased speed of playback)
-//  is set, but currently not used by mixing.
+//  is done by the mixer stepping through the
+//  sound faster or slower.
 //
 
 static int I_SDL_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep, int pitch)
@@ -907,45 +1618,27 @@ static int I_SDL_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep, i
         return -1;
     }
 
-    snd = GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, pitch);
+    snd = GetAllocatedSoundBySfxInfo(sfxinfo);
 
-    if (snd == NULL)
-    {
-        allocated_sound_t *newsnd;
-        // fetch the base sound effect, un-pitch-shifted
-        snd = GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, NORM_PITCH);
+    channels_playing[channel] = snd;
 
-        if (snd == NULL)
-        {
-            return -1;
-        }
+    // play sound, with separation etc.
 
-        if (snd_pitchshift)
-        {
-            newsnd = PitchShift(snd, pitch);
-
-            if (newsnd)
-            {
-                LockAllocatedSound(newsnd);
-                UnlockAllocatedSound(snd);
-                snd = newsnd;
-            }
-        }
-    }
-    else
+    // Zero is what finishedid starts out as
+    uint32_t startid = mixer_nextstartid++;
+    if (startid == 0)
     {
-        LockAllocatedSound(snd);
+        startid = mixer_nextstartid++;
     }
 
-    // play sound
-
-    Mix_PlayChannel(channel, &snd->chunk, 0);
-
-    channels_playing[channel] = snd;
-
-    // set separation, etc.
-
-    I_SDL_UpdateSoundParams(channel, vol, sep);
+    mixervoice_t* voice = &voices[channel];
+    voice->requestlock.Acquire();
+    voice->request.samples = (const int16_t*)snd->chunk.abuf;
+    voice->request.numframes = snd->chunk.alen / 4;
+    voice->request.step = snd_pitchshift ? PitchStep(pitch) : MixUnityStep;
+    voice->request.startid = startid;
+    SetVoiceVolume(&voice->request, vol, sep);
+    voice->requestlock.Release();
 
     return channel;
 }
@@ -971,7 +1664,10 @@ static doombool I_SDL_SoundIsPlaying(int handle)
         return false;
     }
 
-    return Mix_Playing(handle);
+    // Only the main thread writes the request, so no need for the lock
+    const mixervoice_t* voice = &voices[handle];
+    return voice->request.samples != NULL
+        && voice->finishedid.load() != voice->request.startid;
 }
 
 //
@@ -994,6 +1690,8 @@ static void I_SDL_UpdateSound(void)
             ReleaseSoundOnChannel(i);
         }
     }
+
+    CommitFinishedResamples();
 }
 
 static void I_SDL_ShutdownSound(void)
@@ -1003,12 +1701,56 @@ static void I_SDL_ShutdownSound(void)
         return;
     }
 
+    for (int i = 0; i < NUM_CHANNELS; ++i)
+    {
+        ReleaseSoundOnChannel(i);
+    }
+
+    Mix_SetPostMix(NULL, NULL);
     Mix_CloseAudio();
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
 
+    // Keep whatever has finished resampling, drop the rest
+    backgroundresampler.reset();
+    for (size_t index = 0; index < resamplejobs.size(); )
+    {
+        if (resamplejobs[index]->done.load() && resamplejobs[index]->result == 0)
+        {
+            CommitResample(resamplejobs[index].get());
+        }
+        else
+        {
+            ++index;
+        }
+    }
+    resamplejobs.clear();
+    knownsounds.clear();
+
+    FreeAllAllocatedSounds();
+    for (int32_t resampletype = 0; resampletype < (int32_t)arrlen(outputtypes); ++resampletype)
+    {
+        FlushSoundPacks(resampletype, true);
+        CloseAllSoundPacks(resampletype);
+    }
+
     sound_initialized = false;
 }
 
+static void I_SDL_GetMixerStats(soundmixerstats_t* stats)
+{
+    stats->voicesplaying = mixer_voicesplaying.load();
+    stats->maxvoices = NUM_CHANNELS;
+    stats->samplerate = mixer_freq;
+    stats->framespermix = mixer_framespermix.load();
+
+    // Oldest first
+    int32_t next = mixer_nexthistory.load();
+    for (int32_t index = 0; index < MixHistoryLength; ++index)
+    {
+        stats->mixtimes[index] = mixer_history[(next + index) % MixHistoryLength];
+    }
+}
+
 // Calculate slice size, based on snd_maxslicetime_ms.
 // The result must be a power of two.
 
@@ -1065,22 +1807,48 @@ static doombool I_SDL_InitSound(doombool _use_sfx_prefix)
         I_Error( "Unable to set up sound." );
     }
 
+    // The mixer only deals in 16 bit stereo, so only the frequency
+    // is allowed to change
+#if SDL_VERSIONNUM(SDL_MIXER_MAJOR_VERSION, SDL_MIXER_MINOR_VERSION, SDL_MIXER_PATCHLEVEL) >= SDL_VERSIONNUM(2, 0, 2)
+    if (Mix_OpenAudioDevice(snd_samplerate, AUDIO_S16SYS, 2, GetSliceSize(),
+                            NULL, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE) < 0)
+#else
     if (Mix_OpenAudio(snd_samplerate, AUDIO_S16SYS, 2, GetSliceSize()) < 0)
+#endif
     {
         I_Error( "Error initialising SDL_mixer: %s", Mix_GetError() );
     }
 
     Mix_QuerySpec(&mixer_freq, &mixer_format, &mixer_channels);
 
-    if (SRC_ConversionMode() < 0)
+    if (mixer_format != AUDIO_S16SYS || mixer_channels != 2)
+    {
+        I_Error( "I_SDL_InitSound: Sound effects need 16 bit stereo output, got format 0x%x with %d channels",
+                 mixer_format, mixer_channels );
+    }
+
+    if (SRC_ConversionMode(sound_resample_type) < 0)
     {
         I_Error("I_SDL_InitSound: Invalid value for sound_resample_type: %i",
                 sound_resample_type);
     }
 
     ExpandSoundData = ExpandSoundData_SRC;
+    target_resample_type = sound_resample_type;
+
+    // SDL_mixer only plays music now
+    Mix_AllocateChannels(0);
+
+    for (i=0; i<NUM_CHANNELS; ++i)
+    {
+        voices[i].request = {};
+        voices[i].current = {};
+        voices[i].position = 0;
+        voices[i].finishedid.store(0);
+        voices[i].stoppedid.store(0);
+    }
 
-    Mix_AllocateChannels(NUM_CHANNELS);
+    Mix_SetPostMix(MixVoices, NULL);
 
     SDL_PauseAudio(0);
 
@@ -1113,5 +1881,6 @@ DOOM_C_API sound_module_t sound_sdl_module =
     I_SDL_SoundIsPlaying,
     I_SDL_PrecacheSounds,
 	I_SDL_ChangeSoundQuality,
+	I_SDL_GetMixerStats,
 };
 
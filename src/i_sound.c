@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <SDL2/SDL_mixer.h>
 
@@ -205,6 +206,10 @@ void I_InitSound(doombool use_sfx_prefix)
 
     nosound = M_CheckParm("-nosound") > 0;
 
+    // Benchmarks run headless, so never open an audio device
+
+    nosound |= M_ParmExists("-benchmark");
+
     //!
     // @vanilla
     //
@@ -393,6 +398,16 @@ void I_ChangeSoundQuality( int32_t sound_quality, sfxinfo_t* sounds, int num_sou
 	}
 }
 
+void I_GetSoundMixerStats( soundmixerstats_t* stats )
+{
+	memset( stats, 0, sizeof( *stats ) );
+
+	if( sound_module != NULL && sound_module->GetMixerStats != NULL )
+	{
+		sound_module->GetMixerStats( stats );
+	}
+}
+
 void I_InitMusic(void)
 {
 }
@@ -105,6 +105,21 @@ DOOM_C_API typedef enum
     SNDDEVICE_CD = 10,
 } snddevice_t;
 
+#define SOUNDMIXER_HISTORY 128
+
+// How hard the sound effect mixer is working
+
+DOOM_C_API typedef struct soundmixerstats_s
+{
+    int32_t voicesplaying;
+    int32_t maxvoices;
+    int32_t samplerate;
+    int32_t framespermix;
+
+    // Microseconds spent in each of the most recent mixes, oldest first
+    float mixtimes[SOUNDMIXER_HISTORY];
+} soundmixerstats_t;
+
 // Interface for sound modules
 
 DOOM_C_API typedef struct
@@ -152,8 +167,15 @@ DOOM_C_API typedef struct
 
     void (*CacheSounds)(sfxinfo_t *sounds, int num_sounds);
 
+    // Switch to a different resampler. Sounds can be NULL, in which
+    // case everything that has been precached is resampled.
+
 	void (*ChangeSoundQuality)( int sound_quality, sfxinfo_t* sounds, int num_sounds );
 
+    // Fill in how hard the sound effect mixer is working, if there is one.
+
+	void (*GetMixerStats)( soundmixerstats_t* stats );
+
 } sound_module_t;
 
 DOOM_C_API void I_InitSound(doombool use_sfx_prefix);
@@ -166,6 +188,7 @@ DOOM_C_API void I_StopSound(int channel);
 DOOM_C_API doombool I_SoundIsPlaying(int channel);
 DOOM_C_API void I_PrecacheSounds(sfxinfo_t *sounds, int num_sounds);
 DOOM_C_API void I_ChangeSoundQuality( int32_t sound_quality, sfxinfo_t* sounds, int num_sounds );
+DOOM_C_API void I_GetSoundMixerStats( soundmixerstats_t* stats );
 
 // Interface for music modules
 
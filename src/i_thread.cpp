@@ -121,3 +121,449 @@ void JobThread::SetupThreadName()
 #endif // OS_CHECK
 	M_ProfileThreadInit( threadname );
 }
+
+thread_local JobSystem::Worker* JobSystem::currentworker = nullptr;
+
+JobSystem::Worker::Worker( JobSystem* sys, size_t workerindex )
+	: system( sys )
+	, index( workerindex )
+{
+}
+
+void JobSystem::Worker::Start()
+{
+	worker_thread = std::thread( [ this ](){ this->Run(); } );
+}
+
+void JobSystem::Worker::SetupThreadName()
+{
+	constexpr size_t BufferSize = 256;
+	char threadname[ BufferSize ] = { 0 };
+	sprintf( threadname, "Job thread %d", (int32_t)JobThread::num_threads_created.fetch_add( 1 ) );
+
+#if OS_CHECK( WINDOWS )
+	wchar_t wthreadname[ BufferSize ] = { 0 };
+	MultiByteToWideChar( CP_ACP, MB_PRECOMPOSED, threadname, -1, wthreadname, BufferSize );
+	SetThreadDescription( worker_thread.native_handle(), wthreadname );
+#endif // OS_CHECK
+	M_ProfileThreadInit( threadname );
+}
+
+void JobSystem::Worker::Run()
+{
+	SetupThreadName();
+	currentworker = this;
+
+	Job job;
+	uint64_t waitcount = 0;
+	while( !system->terminate.load() )
+	{
+		if( system->PopPinned( *this, job )
+			|| ( index < system->activeworkers.load()
+				&& ( system->PopOwn( *this, job ) || system->Steal( index, job ) ) ) )
+		{
+			system->Execute( job );
+			waitcount = 0;
+			continue;
+		}
+
+		if( ++waitcount < SpinCount || !system->allowparking.load() )
+		{
+			system->Backoff( waitcount );
+			continue;
+		}
+
+		// Announce ourselves before sampling the epoch so that any
+		// AddJob that lands after our last look is guaranteed to see
+		// a sleeper and bump the epoch we're about to wait on.
+		system->sleepers.fetch_add( 1 );
+		uint32_t epoch = system->wakeepoch.load();
+		if( !system->HasWork( *this ) && !system->terminate.load() )
+		{
+			system->wakeepoch.wait( epoch );
+		}
+		system->sleepers.fetch_sub( 1 );
+		waitcount = 0;
+	}
+
+	currentworker = nullptr;
+	M_ProfileThreadDeinit();
+}
+
+JobSystem::JobSystem( size_t maxnumjobs )
+	: maxjobs( maxnumjobs )
+	, activeworkers( maxnumjobs )
+	, nextworker( 0 )
+	, pending( 0 )
+	, wakeepoch( 0 )
+	, sleepers( 0 )
+	, allowparking( true )
+	, terminate( false )
+{
+	workers.reserve( maxnumjobs );
+	for( size_t index = 0; index < maxnumjobs; ++index )
+	{
+		workers.emplace_back( std::make_unique< Worker >( this, index ) );
+	}
+
+	// Workers steal from each other, so don't let any of them
+	// run until the entire pool exists.
+	for( auto& worker : workers )
+	{
+		worker->Start();
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	FlushAll();
+
+	terminate.store( true );
+	Wake();
+
+	for( auto& worker : workers )
+	{
+		if( worker->worker_thread.joinable() )
+		{
+			worker->worker_thread.join();
+		}
+	}
+}
+
+void JobSystem::AddJob( const func_type& func )
+{
+	size_t numactive = activeworkers.load();
+	if( numactive == 0 )
+	{
+		func_type local = func;
+		local();
+		return;
+	}
+
+	Push( PickWorker( numactive ), func, nullptr, false );
+}
+
+void JobSystem::AddJob( JobGroup& group, const func_type& func )
+{
+	size_t numactive = activeworkers.load();
+	if( numactive == 0 )
+	{
+		func_type local = func;
+		local();
+		return;
+	}
+
+	Push( PickWorker( numactive ), func, group.pending, false );
+}
+
+JobSystem::Worker& JobSystem::PickWorker( size_t numactive )
+{
+	// Jobs spawned from a job stay local to that worker for cache
+	// reasons, anything else gets spread out and stolen as needed.
+	return currentworker && currentworker->system == this && currentworker->index < numactive
+			? *currentworker
+			: *workers[ nextworker.fetch_add( 1 ) % numactive ];
+}
+
+void JobSystem::SetMaxJobs( size_t maxnumjobs )
+{
+	activeworkers.store( M_MIN( maxnumjobs, maxjobs ) );
+	Wake();
+}
+
+void JobSystem::Flush( JobGroup& group )
+{
+	// The calling thread helps out instead of sitting on its hands, but
+	// only with this group. Picking up someone else's job could leave
+	// us running long after the group's finished.
+	Job job;
+	uint64_t waitcount = 0;
+	int64_t remaining;
+	while( ( remaining = group.pending->load() ) > 0 )
+	{
+		if( StealFromGroup( group.pending, job ) )
+		{
+			Execute( job );
+			waitcount = 0;
+		}
+		else if( ++waitcount < SpinCount )
+		{
+			Backoff( waitcount );
+		}
+		else
+		{
+			group.pending->wait( remaining );
+		}
+	}
+}
+
+void JobSystem::FlushAll()
+{
+	// Pinned jobs are left alone, they belong to their worker.
+	Job job;
+	uint64_t waitcount = 0;
+	int64_t remaining;
+	while( ( remaining = pending.load() ) > 0 )
+	{
+		if( Steal( workers.size(), job ) )
+		{
+			Execute( job );
+			waitcount = 0;
+		}
+		else if( ++waitcount < SpinCount )
+		{
+			Backoff( waitcount );
+		}
+		else
+		{
+			pending.wait( remaining );
+		}
+	}
+}
+
+void JobSystem::Batch::Work()
+{
+	int32_t chunkbegin;
+	while( ( chunkbegin = next.fetch_add( chunksize ) ) < end )
+	{
+		func( context, chunkbegin, M_MIN( chunkbegin + chunksize, end ) );
+
+		if( remaining.fetch_sub( 1 ) == 1 )
+		{
+			remaining.notify_all();
+		}
+	}
+}
+
+void JobSystem::RunBatch( int32_t begin, int32_t end, int32_t chunksize, batchfunc_type func, void* context )
+{
+	if( end <= begin )
+	{
+		return;
+	}
+
+	chunksize = M_MAX( chunksize, 1 );
+	int32_t numchunks = ( end - begin + chunksize - 1 ) / chunksize;
+	size_t numactive = activeworkers.load();
+
+	if( numchunks == 1 || numactive == 0 )
+	{
+		func( context, begin, end );
+		return;
+	}
+
+	// Helpers can get to the batch after the last chunk is done and
+	// this function has returned, so it can't live on the stack.
+	// They'll never touch func or context once the counter runs out.
+	std::shared_ptr< Batch > batch = std::make_shared< Batch >();
+	batch->next = begin;
+	batch->end = end;
+	batch->chunksize = chunksize;
+	batch->func = func;
+	batch->context = context;
+	batch->remaining = numchunks;
+
+	size_t numhelpers = M_MIN( numactive, (size_t)numchunks - 1 );
+	for( size_t helper = 0; helper < numhelpers; ++helper )
+	{
+		AddJob( [ batch ]() { batch->Work(); } );
+	}
+
+	batch->Work();
+
+	int32_t remaining;
+	while( ( remaining = batch->remaining.load() ) > 0 )
+	{
+		batch->remaining.wait( remaining );
+	}
+}
+
+void JobSystem::NewProfileFrame()
+{
+	JobGroup group;
+	for( auto& worker : workers )
+	{
+		Push( *worker, []()
+		{
+			M_ProfileNewFrame();
+		}, group.pending, true );
+	}
+	Flush( group );
+}
+
+bool JobSystem::PopOwn( Worker& worker, Job& output )
+{
+	bool found = false;
+	worker.lock.Acquire();
+	if( !worker.jobs.empty() )
+	{
+		output = std::move( worker.jobs.back() );
+		worker.jobs.pop_back();
+		found = true;
+	}
+	worker.lock.Release();
+	return found;
+}
+
+bool JobSystem::PopPinned( Worker& worker, Job& output )
+{
+	bool found = false;
+	worker.lock.Acquire();
+	if( !worker.pinned.empty() )
+	{
+		output = std::move( worker.pinned.front() );
+		worker.pinned.pop_front();
+		found = true;
+	}
+	worker.lock.Release();
+	return found;
+}
+
+bool JobSystem::Steal( size_t thiefindex, Job& output )
+{
+	size_t numworkers = workers.size();
+	if( numworkers == 0 )
+	{
+		return false;
+	}
+
+	// Start next to the thief so everyone isn't hammering worker 0
+	size_t start = ( thiefindex + 1 ) % numworkers;
+	for( size_t offset = 0; offset < numworkers; ++offset )
+	{
+		size_t victimindex = ( start + offset ) % numworkers;
+		if( victimindex == thiefindex )
+		{
+			continue;
+		}
+
+		Worker& victim = *workers[ victimindex ];
+		victim.lock.Acquire();
+		if( !victim.jobs.empty() )
+		{
+			output = std::move( victim.jobs.front() );
+			victim.jobs.pop_front();
+			victim.lock.Release();
+			return true;
+		}
+		victim.lock.Release();
+	}
+
+	return false;
+}
+
+bool JobSystem::StealFromGroup( const groupcounter_type& group, Job& output )
+{
+	// Queues are short enough that a linear search is fine. The owner
+	// takes from the back, so look at the front first for the same
+	// reason Steal does.
+	for( auto& worker : workers )
+	{
+		worker->lock.Acquire();
+		for( auto it = worker->jobs.begin(); it != worker->jobs.end(); ++it )
+		{
+			if( it->group == group )
+			{
+				output = std::move( *it );
+				worker->jobs.erase( it );
+				worker->lock.Release();
+				return true;
+			}
+		}
+		worker->lock.Release();
+	}
+
+	return false;
+}
+
+bool JobSystem::HasWork( Worker& worker )
+{
+	worker.lock.Acquire();
+	bool found = !worker.pinned.empty();
+	worker.lock.Release();
+
+	if( found || worker.index >= activeworkers.load() )
+	{
+		return found;
+	}
+
+	for( auto& curr : workers )
+	{
+		curr->lock.Acquire();
+		found = !curr->jobs.empty();
+		curr->lock.Release();
+		if( found )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::Push( Worker& worker, const func_type& func, const groupcounter_type& group, bool pin )
+{
+	pending.fetch_add( 1 );
+	if( group )
+	{
+		group->fetch_add( 1 );
+	}
+
+	worker.lock.Acquire();
+	if( pin )
+	{
+		worker.pinned.push_back( { func, group } );
+	}
+	else
+	{
+		worker.jobs.push_back( { func, group } );
+	}
+	worker.lock.Release();
+
+	Wake();
+}
+
+void JobSystem::Execute( Job& job )
+{
+	job.func();
+	job.func = nullptr;
+
+	if( job.group )
+	{
+		if( job.group->fetch_sub( 1 ) == 1 )
+		{
+			job.group->notify_all();
+		}
+		job.group = nullptr;
+	}
+
+	if( pending.fetch_sub( 1 ) == 1 )
+	{
+		pending.notify_all();
+	}
+}
+
+void JobSystem::Wake()
+{
+	wakeepoch.fetch_add( 1 );
+	if( sleepers.load() > 0 )
+	{
+		wakeepoch.notify_all();
+	}
+}
+
+void JobSystem::Backoff( uint64_t waitcount )
+{
+	if( ( waitcount & YieldMask ) == YieldMask )
+	{
+		std::this_thread::yield();
+	}
+	else if( ( waitcount & PauseMask ) == PauseMask )
+	{
+#if ( ARCH_CHECK( x86 ) || ARCH_CHECK( x64 ) )
+		_mm_pause();
+#elif ( ARCH_CHECK( ARM32 ) || ARCH_CHECK( ARM64 ) )
+		__yield();
+#endif // ARCH_CHECK
+	}
+}
@@ -61,6 +61,8 @@ DOOM_C_API atomicval_t I_AtomicDecrement( atomicptr_t atomic, atomicval_t val );
 #include "m_profile.h"
 #include <functional>
 #include <atomic>
+#include <deque>
+#include <memory>
 #include <thread>
 
 class Spinlock
@@ -71,7 +73,7 @@ public:
 	{
 	}
 
-	INLINE bool Acquire()
+	INLINE void Acquire()
 	{
 		uint64_t waitcount = 0;
 		bool expected = false;
@@ -99,7 +101,13 @@ public:
 		}
 	}
 
-	INLINE bool Release()
+	INLINE bool TryAcquire()
+	{
+		bool expected = false;
+		return locked.compare_exchange_strong( expected, true );
+	}
+
+	INLINE void Release()
 	{
 		locked.store( false );
 	}
@@ -110,6 +118,8 @@ private:
 
 class JobThread
 {
+	friend class JobSystem;
+
 public:
 	enum : size_t { queue_size = 16384 };
 	using func_type = std::function< void() >;
@@ -193,6 +203,8 @@ private:
 				waitcount = Wait( waitcount );
 			}
 		}
+
+		M_ProfileThreadDeinit();
 	}
 
 	AtomicCircularQueue< func_type >	jobs;
@@ -203,72 +215,144 @@ private:
 	static std::atomic< size_t >		num_threads_created;
 };
 
+// Counts the jobs added through it, so whoever queued them can wait
+// on just their own work instead of everything else in flight. The
+// counter is shared with the jobs so it can outlive the group if a
+// job is still on its way out when the waiter returns.
+class JobGroup
+{
+	friend class JobSystem;
+
+public:
+	JobGroup()
+		: pending( std::make_shared< std::atomic< int64_t > >( 0 ) )
+	{
+	}
+
+	bool Done() const						{ return pending->load() == 0; }
+
+private:
+	std::shared_ptr< std::atomic< int64_t > >	pending;
+};
+
+// Work-stealing job system. Every worker owns a deque; the owner
+// pushes and pops from the back, idle workers steal from the front
+// of everyone else's. Workers that can't find anything park on an
+// atomic wait instead of spinning. Waiting is done per JobGroup, and
+// the thread doing the waiting only ever helps out with that group's
+// jobs, so a long running job elsewhere can't hold it up.
 class JobSystem
 {
 public:
 	static constexpr int32_t MaxJobs = JOBSYSTEM_MAXJOBS;
 
-	using func_type = JobThread::func_type;
+	using func_type = std::function< void() >;
 
-	JobSystem( size_t maxnumjobs )
-		: jobpool( maxnumjobs )
-		, maxjobs( maxnumjobs )
-	{
-		nextjobthread = jobpool.begin();
-		endjobthread = nextjobthread + maxnumjobs;
-	}
+	JobSystem( size_t maxnumjobs );
+	~JobSystem();
 
-	void AddJob( const func_type& func )
-	{
-		if( endjobthread == jobpool.begin() )
-		{
-			func();
-		}
-		else
-		{
-			nextjobthread->AddJob( func );
-			if( ++nextjobthread == endjobthread )
-			{
-				nextjobthread = jobpool.begin();
-			}
-		}
-	}
+	// Fire and forget, nothing can wait on these short of FlushAll()
+	void AddJob( const func_type& func );
+	void AddJob( JobGroup& group, const func_type& func );
+	void SetMaxJobs( size_t maxnumjobs );
+
+	// Safe to call from inside a job, it'll run the group's jobs itself
+	// if nobody else has got to them yet
+	void Flush( JobGroup& group );
 
-	void SetMaxJobs( size_t maxnumjobs )
+	// Waits on every job ever added. Only for tearing a system down.
+	void FlushAll();
+
+	void NewProfileFrame();
+
+	// Runs func( chunkbegin, chunkend ) over [begin, end) in chunks of
+	// chunksize, with the calling thread helping out, and returns once
+	// every chunk is done. Only one job per worker gets queued no matter
+	// how big the range is; they all pull chunks off a shared counter.
+	template< typename _func >
+	void ParallelFor( int32_t begin, int32_t end, int32_t chunksize, _func&& func )
 	{
-		maxnumjobs = M_MIN( maxnumjobs, maxjobs );
-		endjobthread = jobpool.begin() + maxnumjobs;
-		if( nextjobthread - endjobthread >= 0 )
+		using functype = std::remove_reference_t< _func >;
+		RunBatch( begin, end, chunksize, []( void* context, int32_t chunkbegin, int32_t chunkend )
 		{
-			nextjobthread = jobpool.begin();
-		}
+			( *(functype*)context )( chunkbegin, chunkend );
+		}, (void*)&func );
 	}
 
-	void Flush()
+	// Idle workers spin forever instead of parking when this is off.
+	void SetAllowParking( bool allow )		{ allowparking.store( allow ); }
+
+private:
+	static constexpr uint64_t SpinCount = 0x0000000000000800ull;
+	static constexpr uint64_t YieldMask = 0x000000000000007Full;
+	static constexpr uint64_t PauseMask = 0x000000000000000Full;
+
+	using batchfunc_type = void (*)( void* context, int32_t chunkbegin, int32_t chunkend );
+
+	struct Batch
 	{
-		for( JobThread& currthread : jobpool )
-		{
-			currthread.Flush();
-		}
-	}
+		void Work();
+
+		std::atomic< int32_t >			next;
+		int32_t							end;
+		int32_t							chunksize;
+		batchfunc_type					func;
+		void*							context;
+		std::atomic< int32_t >			remaining;
+	};
+
+	using groupcounter_type = std::shared_ptr< std::atomic< int64_t > >;
 
-	void NewProfileFrame()
+	struct Job
 	{
-		for( JobThread& currthread : jobpool )
-		{
-			currthread.AddJob( []()
-			{
-				M_ProfileNewFrame();
-			} );
-			currthread.Flush();
-		}
-	}
+		func_type						func;
+		groupcounter_type				group;
+	};
 
-private:
-	std::vector< JobThread >			jobpool;
-	std::vector< JobThread >::iterator	nextjobthread;
-	std::vector< JobThread >::iterator	endjobthread;
-	size_t								maxjobs;
+	struct Worker
+	{
+		Worker( JobSystem* sys, size_t index );
+
+		void Start();
+		void SetupThreadName();
+		void Run();
+
+		JobSystem*						system;
+		size_t							index;
+
+		Spinlock						lock;
+		std::deque< Job >				jobs;
+		// Jobs that must run on this thread specifically. Never stolen.
+		std::deque< Job >				pinned;
+
+		std::thread						worker_thread;
+	};
+
+	bool PopOwn( Worker& worker, Job& output );
+	bool PopPinned( Worker& worker, Job& output );
+	bool Steal( size_t thiefindex, Job& output );
+	bool StealFromGroup( const groupcounter_type& group, Job& output );
+	bool HasWork( Worker& worker );
+
+	void RunBatch( int32_t begin, int32_t end, int32_t chunksize, batchfunc_type func, void* context );
+	Worker& PickWorker( size_t numactive );
+	void Push( Worker& worker, const func_type& func, const groupcounter_type& group, bool pin );
+	void Execute( Job& job );
+	void Wake();
+	void Backoff( uint64_t waitcount );
+
+	std::vector< std::unique_ptr< Worker > >	workers;
+	size_t										maxjobs;
+	std::atomic< size_t >						activeworkers;
+	std::atomic< size_t >						nextworker;
+
+	std::atomic< int64_t >						pending;
+	std::atomic< uint32_t >						wakeepoch;
+	std::atomic< int32_t >						sleepers;
+	std::atomic< bool >							allowparking;
+	std::atomic< bool >							terminate;
+
+	static thread_local Worker*					currentworker;
 };
 
 #endif //defined( __cplusplus )
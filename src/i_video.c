@@ -228,6 +228,7 @@ static doombool display_fps_dots;
 // video buffer.
 
 static doombool noblit;
+static doombool headless;
 
 // Callback function to invoke to determine whether to grab the 
 // mouse pointer.
@@ -1121,6 +1122,12 @@ void I_GraphicsCheckCommandLine(void)
 
     noblit = M_CheckParm ("-noblit");
 
+    // Benchmarks still render every frame in to the software buffers,
+    // but never present them or show a window.
+
+    headless = M_ParmExists("-benchmark");
+    noblit |= headless;
+
     //!
     // @category video 
     //
@@ -1366,6 +1373,11 @@ static void SetVideoMode(void)
     // retina displays, especially when using small window sizes.
     window_flags |= SDL_WINDOW_ALLOW_HIGHDPI;
 
+    if (headless)
+    {
+        window_flags |= SDL_WINDOW_HIDDEN;
+    }
+
     I_GetWindowPosition(&x, &y, w, h);
 
     // Create window and renderer contexts. We set the window title
@@ -876,6 +876,15 @@ static default_t extra_defaults_list[] =
 
     CONFIG_VARIABLE_INT(num_software_backbuffers),
 
+    //!
+    // @game doom
+    //
+    // If non-zero, composited wall textures are cached on disk so that
+    // levels load faster the next time they're played.
+    //
+
+    CONFIG_VARIABLE_INT(texture_composite_cache),
+
     //!
     // @game doom
     //
@@ -1913,6 +1922,14 @@ static default_t extra_defaults_list[] =
 	//
 	CONFIG_VARIABLE_INT(first_launch),
 
+	//!
+	// Megabytes of purgable zone memory, mostly cached lumps, to keep
+	// resident before the least recently used blocks are freed. Zero keeps
+	// everything.
+	//
+
+	CONFIG_VARIABLE_INT(zone_cache_budget_mb),
+
 	//!
 	// @game doom
 	//
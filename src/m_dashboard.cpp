@@ -14,6 +14,7 @@
 
 #include "m_dashboard.h"
 #include "i_log.h"
+#include "i_sound.h"
 #include "i_system.h"
 #include "i_video.h"
 
@@ -23,6 +24,9 @@
 #include "m_misc.h"
 #include "m_container.h"
 
+#include "w_wad.h"
+#include "z_zone.h"
+
 #include "txt_main.h"
 
 #include "doomkeys.h"
@@ -739,6 +743,8 @@ static const char* remaptypenames[ Remap_Max ] =
 };
 
 static doombool aboutwindow_open = false;
+static doombool zonewindow_open = false;
+static doombool soundmixerwindow_open = false;
 static doombool licenceswindow_open = false;
 
 static int32_t lastrenderwidth = 0;
@@ -938,6 +944,61 @@ static void M_LicencesWindow( const char* itemname, void* data )
 	igPopID();
 }
 
+static void M_ZoneMemoryWindow( const char* itemname, void* data )
+{
+	zonestats_t zone = {};
+	Z_GetStats( &zone );
+
+	lumpcachestats_t lumps = {};
+	W_GetCacheStats( &lumps );
+
+	uint64_t lookups = lumps.hits + lumps.misses;
+	double_t hitrate = lookups > 0 ? (double_t)lumps.hits * 100.0 / (double_t)lookups : 0.0;
+
+	igText( "Lump cache" );
+	igSeparator();
+	igText( "Hits: %llu", (unsigned long long)lumps.hits );
+	igText( "Misses: %llu", (unsigned long long)lumps.misses );
+	igText( "Hit rate: %.2f%%", hitrate );
+	igText( "Memory mapped: %llu", (unsigned long long)lumps.mapped );
+	igNewLine();
+
+	igText( "Purgable zone memory" );
+	igSeparator();
+	igText( "Resident: %.2f MB in %d blocks", (double_t)zone.purgablebytes / ( 1024.0 * 1024.0 ), zone.purgableblocks );
+	igText( "Evictions: %llu (%.2f MB)", (unsigned long long)zone.evictions, (double_t)zone.evictedbytes / ( 1024.0 * 1024.0 ) );
+	igSliderInt( "Budget (MB)", &zone_cache_budget_mb, 0, 2048, zone_cache_budget_mb > 0 ? "%d" : "Unlimited", ImGuiSliderFlags_AlwaysClamp );
+}
+
+static void M_SoundMixerWindow( const char* itemname, void* data )
+{
+	soundmixerstats_t mixer;
+	I_GetSoundMixerStats( &mixer );
+
+	float_t average = 0.f;
+	float_t peak = 0.f;
+	for( float_t mixtime : mixer.mixtimes )
+	{
+		average += mixtime;
+		peak = M_MAX( peak, mixtime );
+	}
+	average /= SOUNDMIXER_HISTORY;
+
+	// How much of the time the audio thread has to fill a buffer gets spent mixing
+	float_t budget = mixer.samplerate > 0 ? (float_t)mixer.framespermix * 1000000.f / (float_t)mixer.samplerate : 0.f;
+
+	igText( "Voices: %d / %d", mixer.voicesplaying, mixer.maxvoices );
+	igText( "Buffer: %d frames at %d Hz", mixer.framespermix, mixer.samplerate );
+	igSeparator();
+	igText( "Mix time: %.1f us average, %.1f us peak", average, peak );
+	igText( "Load: %.2f%%", budget > 0.f ? average * 100.f / budget : 0.f );
+
+	ImVec2 graphsize;
+	igGetContentRegionAvail( &graphsize );
+	graphsize.y = 80.f;
+	igPlotLines_FloatPtr( "##mixtimes", mixer.mixtimes, SOUNDMIXER_HISTORY, 0, NULL, 0.f, M_MAX( peak, 1.f ), graphsize, sizeof( float ) );
+}
+
 void M_InitDashboard( void )
 {
 	char themefullpath[ MAXNAMELENGTH + 1 ];
@@ -997,6 +1058,8 @@ void M_InitDashboard( void )
 	M_RegisterDashboardCheckbox( "Core|Pause While Active", "Multiplayer ignores this", (doombool*)&dashboardpausesplaysim );
 	M_RegisterDashboardWindow( "Core|About", "About " PACKAGE_NAME, 0, 0, &aboutwindow_open, Menu_Normal, &M_AboutWindow );
 	M_RegisterDashboardWindow( "Core|Licences", "Licences", 0, 0, &licenceswindow_open, Menu_Normal, &M_LicencesWindow );
+	M_RegisterDashboardWindow( "Tools|Zone memory", "Zone Memory", 400, 250, &zonewindow_open, Menu_Normal, &M_ZoneMemoryWindow );
+	M_RegisterDashboardWindow( "Tools|Sound mixer", "Sound Mixer", 400, 200, &soundmixerwindow_open, Menu_Normal, &M_SoundMixerWindow );
 	M_RegisterDashboardSeparator( "Core" );
 	M_RegisterDashboardButton( "Core|Quit", "Yes, this means quit the game", &M_OnDashboardCoreQuit, NULL );
 }
@@ -1011,6 +1074,7 @@ void M_BindDashboardVariables( void )
 	M_BindIntVariable( "dashboard_theme",			&dashboard_theme );
 	M_BindIntVariable( "dashboard_pausesplaysim",	&dashboardpausesplaysim );
 	M_BindIntVariable( "first_launch",				&first_launch );
+	M_BindIntVariable( "zone_cache_budget_mb",		&zone_cache_budget_mb );
 }
 
 static void M_DashboardWelcomeWindow( const char* itemname, void* data )
@@ -51,6 +51,7 @@
 #include <filesystem>
 #include <fstream>
 #include <iterator>
+#include <mutex>
 #include <chrono>
 #include <ranges>
 #include <regex>
@@ -172,11 +173,7 @@ constexpr const char* idgames_api_file		= "action=get&out=json&file=";
 constexpr const char* cache_local			= "cache" DIR_SEPARATOR_S "local" DIR_SEPARATOR_S;
 constexpr const char* cache_download		= "cache" DIR_SEPARATOR_S "download" DIR_SEPARATOR_S;
 constexpr const char* cache_extracted		= "cache" DIR_SEPARATOR_S "extracted" DIR_SEPARATOR_S;
-
-constexpr const char* WADRegexString = ".+\\.wad$";
-constexpr const char* DEHRegexString = ".+\\.deh$";
-static const std::regex WADRegex = std::regex( WADRegexString, std::regex_constants::icase );
-static const std::regex DEHRegex = std::regex( DEHRegexString, std::regex_constants::icase );
+constexpr const char* cache_index			= "cache" DIR_SEPARATOR_S "local" DIR_SEPARATOR_S "index.bin";
 
 typedef struct idgamesmirror_s
 {
@@ -1023,6 +1020,11 @@ namespace launcher
 		int32_t			should_merge;
 		int32_t			has_dehacked_lump;
 
+		// The titlepic and text file are left in the cache until
+		// something actually wants to show them
+		bool			titlepic_loaded;
+		bool			text_file_loaded;
+
 		Image			titlepic;
 		std::vector< bgra_t > titlepic_raw;
 	};
@@ -1054,7 +1056,7 @@ namespace launcher
 			std::filesystem::path textpath = path + "textfile.txt";
 			FILE* textfile = fopen( textpath.string().c_str(), "wb" );
 			fwrite( entry.text_file.c_str(), sizeof( char ), entry.text_file.size(), textfile );
-			fclose( infofile );
+			fclose( textfile );
 		}
 
 		if( !entry.titlepic_raw.empty() )
@@ -1102,8 +1104,17 @@ namespace launcher
 		entry.is_voices_iwad		= to< int32_t >( root[ "is_voices_iwad" ] );
 		entry.should_merge			= to< int32_t >( root[ "should_merge" ] );
 		entry.has_dehacked_lump		= to< int32_t >( root[ "has_dehacked_lump" ] );
+	}
 
-		std::string textpath = path + "textfile.txt";
+	void LoadTextFile( DoomFileEntry& entry )
+	{
+		if( entry.text_file_loaded )
+		{
+			return;
+		}
+		entry.text_file_loaded = true;
+
+		std::string textpath = entry.cache_path + "textfile.txt";
 		std::filesystem::path textstdpath = std::filesystem::path( textpath );
 		if( std::filesystem::exists( textstdpath ) )
 		{
@@ -1112,18 +1123,38 @@ namespace launcher
 			fread( (void*)entry.text_file.data(), sizeof( char ), entry.text_file.length(), textfile );
 			fclose( textfile );
 		}
+	}
 
-		std::string titlepicpath = path + "titlepic.tga";
-		if( std::filesystem::exists( std::filesystem::path( titlepicpath ) ) )
+	// Needs a GL context, so only call this from the main thread or the
+	// launcher's job thread
+	void LoadTitlepic( DoomFileEntry& entry )
+	{
+		if( !entry.titlepic_loaded )
 		{
-			TGAHeader header;
-			FILE* tgafile = fopen( titlepicpath.c_str(), "rb" );
-			fread( (void*)&header, sizeof( TGAHeader ), 1, tgafile );
-			entry.titlepic.width = header.width;
-			entry.titlepic.height = header.height;
-			entry.titlepic_raw.resize( header.width * header.height );
-			fread( entry.titlepic_raw.data(), sizeof( bgra_t ), header.width * header.height, tgafile );
-			fclose( tgafile );
+			entry.titlepic_loaded = true;
+
+			std::string titlepicpath = entry.cache_path + "titlepic.tga";
+			if( entry.titlepic_raw.empty() && std::filesystem::exists( std::filesystem::path( titlepicpath ) ) )
+			{
+				TGAHeader header;
+				FILE* tgafile = fopen( titlepicpath.c_str(), "rb" );
+				fread( (void*)&header, sizeof( TGAHeader ), 1, tgafile );
+				entry.titlepic.width = header.width;
+				entry.titlepic.height = header.height;
+				entry.titlepic_raw.resize( header.width * header.height );
+				fread( entry.titlepic_raw.data(), sizeof( bgra_t ), header.width * header.height, tgafile );
+				fclose( tgafile );
+			}
+		}
+
+		if( !entry.titlepic_raw.empty() && !entry.titlepic.tex )
+		{
+			if( entry.titlepic_raw.size() != (size_t)( entry.titlepic.width * entry.titlepic.height ) )
+			{
+				I_Error( "IWAD '%s' has malformed TITLEPIC", entry.filename.c_str() );
+			}
+
+			entry.titlepic.tex = I_TextureCreate( entry.titlepic.width, entry.titlepic.height, Format_BGRA8, entry.titlepic_raw.data() );
 		}
 	}
 
@@ -1136,24 +1167,35 @@ namespace launcher
 		return false;
 	}
 
-	time_t GetLastModifiedTime( const std::filesystem::path& stdpath )
+	INLINE bool IsWADPath( const std::filesystem::path& stdpath )
 	{
-		auto filetime = std::filesystem::last_write_time( stdpath );
-#if WIN32
-		auto utctime = std::chrono::file_clock::to_utc( filetime );
-		auto systime = std::chrono::utc_clock::to_sys( utctime );
-#else
-		auto systime = std::chrono::file_clock::to_sys( filetime );
-#endif
-		return std::chrono::system_clock::to_time_t( systime );
+		return EqualCaseInsensitive( stdpath.extension().string(), ".wad" );
+	}
+
+	INLINE bool IsDehackedPath( const std::filesystem::path& stdpath )
+	{
+		return EqualCaseInsensitive( stdpath.extension().string(), ".deh" );
 	}
 
+	// Files are parsed on worker threads. Two files with the same name,
+	// size and timestamp share a cache folder, so access to the cache
+	// folders goes through a striped lock. The log isn't thread safe.
+	constexpr size_t NumCacheLocks = 64;
+	static std::mutex entrycachelocks[ NumCacheLocks ];
+	static std::mutex parseloglock;
+
+	// The main job system doesn't exist this early, so the launcher
+	// keeps a pool of its own for walking the disk. It lives as long as
+	// the launcher window does, so refreshing the lists doesn't spin up
+	// a new set of threads each time.
+	static std::unique_ptr< JobSystem > parsers;
+
 	DoomFileEntry ParseDoomFile( const std::filesystem::path& stdpath )
 	{
 		std::string path = stdpath.string();
 		std::string filename = stdpath.filename().string();
 
-		time_t lastmodified = GetLastModifiedTime( stdpath );
+		time_t lastmodified = M_FileLastModified( stdpath.string().c_str() );
 		size_t filelength = std::filesystem::file_size( stdpath );
 
 		std::string cachepath = HOME_PATH
@@ -1174,6 +1216,8 @@ namespace launcher
 		entry.last_modified = lastmodified;
 		entry.file_length = filelength;
 
+		std::lock_guard< std::mutex > cachelock( entrycachelocks[ std::hash< std::string >()( cachepath ) % NumCacheLocks ] );
+
 		if( !M_CheckParm( "-invalidatewadcache" ) && DoomFileEntryExists( stdcachepath ) )
 		{
 			ReadEntry( entry, stdcachepath );
@@ -1182,7 +1226,7 @@ namespace launcher
 		if( M_CheckParm( "-invalidatewadcache" ) || entry.version != DoomFileEntryVersion )
 		{
 			entry.version = DoomFileEntryVersion;
-			if( std::regex_match( filename, DEHRegex ) )
+			if( IsDehackedPath( stdpath ) )
 			{
 				entry.type = DoomFileType::Dehacked;
 			}
@@ -1436,9 +1480,12 @@ namespace launcher
 							if( patchwidth <= 0 || patchwidth > 854
 								|| patchheight <= 0 || patchheight > 200 )
 							{
-								I_LogAddEntryVar( Log_Warning, "%s '%' has malformed TITLEPIC, replacing with all white"
-									, ( entry.type == DoomFileType::IWAD ? "IWAD" : "PWAD" )
-									, entry.filename.c_str() );
+								{
+									std::lock_guard< std::mutex > loglock( parseloglock );
+									I_LogAddEntryVar( Log_Warning, "%s '%' has malformed TITLEPIC, replacing with all white"
+										, ( entry.type == DoomFileType::IWAD ? "IWAD" : "PWAD" )
+										, entry.filename.c_str() );
+								}
 								// malformed titlepic
 								entry.titlepic.width = 320;
 								entry.titlepic.height = 200;
@@ -1495,9 +1542,12 @@ namespace launcher
 					}
 					else
 					{
-						I_LogAddEntryVar( Log_Warning, "%s '%' has no TITLEPIC, replacing with all white"
-							, ( entry.type == DoomFileType::IWAD ? "IWAD" : "PWAD" )
-							, entry.filename.c_str() );
+						{
+							std::lock_guard< std::mutex > loglock( parseloglock );
+							I_LogAddEntryVar( Log_Warning, "%s '%' has no TITLEPIC, replacing with all white"
+								, ( entry.type == DoomFileType::IWAD ? "IWAD" : "PWAD" )
+								, entry.filename.c_str() );
+						}
 						// malformed titlepic
 						entry.titlepic.width = 320;
 						entry.titlepic.height = 200;
@@ -1520,22 +1570,192 @@ namespace launcher
 			}
 
 			WriteEntry( entry, stdcachepath );
+
+			// Thousands of decoded titlepics add up fast. It's on disk
+			// now, so LoadTitlepic can go and get it when it's wanted.
+			entry.text_file_loaded = true;
+			std::vector< bgra_t >().swap( entry.titlepic_raw );
 		}
 
-		if( !entry.titlepic_raw.empty() && !entry.titlepic.tex )
+		return entry;
+	}
+
+	using DoomFileEntries = std::vector< DoomFileEntry >;
+	using DoomFileIndex = std::unordered_map< std::string, DoomFileEntry >;
+
+	// Everything ParseDoomFile works out for every file we've seen, in
+	// one file instead of one folder per WAD. A file whose length and
+	// timestamp match its record never gets opened at all.
+	constexpr uint32_t DoomFileIndexMagic = 0x58444952; // 'RIDX'
+
+	PACKED_STRUCT( DoomFileIndexHeader
+	{
+		uint32_t		magic;
+		int32_t			version;
+		uint32_t		num_entries;
+	});
+
+	// Followed by the full path, filename and cache path, unterminated
+	PACKED_STRUCT( DoomFileIndexRecord
+	{
+		uint64_t		file_length;
+		int64_t			last_modified;
+		int32_t			type;
+		int32_t			game_mode;
+		int32_t			game_mission;
+		int32_t			game_variant;
+		int32_t			is_voices_iwad;
+		int32_t			should_merge;
+		int32_t			has_dehacked_lump;
+		uint32_t		full_path_length;
+		uint32_t		filename_length;
+		uint32_t		cache_path_length;
+	});
+
+	DoomFileIndex ReadDoomFileIndex()
+	{
+		DoomFileIndex index;
+
+		if( M_CheckParm( "-invalidatewadcache" ) )
+		{
+			return index;
+		}
+
+		std::string indexpath = HOME_PATH + cache_index;
+		std::error_code error;
+		size_t indexlength = std::filesystem::file_size( std::filesystem::path( indexpath ), error );
+		if( error || indexlength < sizeof( DoomFileIndexHeader ) )
+		{
+			return index;
+		}
+
+		std::vector< byte > data;
+		data.resize( indexlength );
+		FILE* indexfile = fopen( indexpath.c_str(), "rb" );
+		if( !indexfile )
+		{
+			return index;
+		}
+		size_t readlength = fread( data.data(), sizeof( byte ), indexlength, indexfile );
+		fclose( indexfile );
+
+		if( readlength != indexlength )
 		{
-			if( entry.titlepic_raw.size() != ( entry.titlepic.width * entry.titlepic.height ) )
+			return index;
+		}
+
+		const byte* curr = data.data();
+		const byte* end = data.data() + indexlength;
+
+		DoomFileIndexHeader header;
+		memcpy( &header, curr, sizeof( DoomFileIndexHeader ) );
+		curr += sizeof( DoomFileIndexHeader );
+
+		if( header.magic != DoomFileIndexMagic || header.version != DoomFileEntryVersion )
+		{
+			return index;
+		}
+
+		index.reserve( header.num_entries );
+		for( uint32_t recordnum = 0; recordnum < header.num_entries; ++recordnum )
+		{
+			DoomFileIndexRecord record;
+			if( (size_t)( end - curr ) < sizeof( DoomFileIndexRecord ) )
 			{
-				I_Error( "IWAD '%' has malformed TITLEPIC", entry.filename.c_str() );
+				break;
 			}
+			memcpy( &record, curr, sizeof( DoomFileIndexRecord ) );
+			curr += sizeof( DoomFileIndexRecord );
 
-			entry.titlepic.tex = I_TextureCreate( entry.titlepic.width, entry.titlepic.height, Format_BGRA8, entry.titlepic_raw.data() );
+			size_t stringslength = (size_t)record.full_path_length + record.filename_length + record.cache_path_length;
+			if( (size_t)( end - curr ) < stringslength )
+			{
+				break;
+			}
+
+			DoomFileEntry entry = DoomFileEntry();
+			entry.version				= DoomFileEntryVersion;
+			entry.type					= (DoomFileType)record.type;
+			entry.file_length			= record.file_length;
+			entry.last_modified			= (time_t)record.last_modified;
+			entry.game_mode				= (GameMode_t)record.game_mode;
+			entry.game_mission			= (GameMission_t)record.game_mission;
+			entry.game_variant			= (GameVariant_t)record.game_variant;
+			entry.is_voices_iwad		= record.is_voices_iwad;
+			entry.should_merge			= record.should_merge;
+			entry.has_dehacked_lump		= record.has_dehacked_lump;
+
+			entry.full_path.assign( (const char*)curr, record.full_path_length );
+			curr += record.full_path_length;
+			entry.filename.assign( (const char*)curr, record.filename_length );
+			curr += record.filename_length;
+			entry.cache_path.assign( (const char*)curr, record.cache_path_length );
+			curr += record.cache_path_length;
+
+			std::string key = entry.full_path;
+			index[ key ] = std::move( entry );
 		}
 
-		return entry;
+		return index;
 	}
 
-	using DoomFileEntries = std::vector< DoomFileEntry >;
+	void WriteDoomFileIndex( const DoomFileEntries& entries )
+	{
+		std::vector< byte > data;
+		auto append = [ &data ]( const void* source, size_t length )
+		{
+			data.insert( data.end(), (const byte*)source, (const byte*)source + length );
+		};
+
+		DoomFileIndexHeader header;
+		header.magic = DoomFileIndexMagic;
+		header.version = DoomFileEntryVersion;
+		header.num_entries = (uint32_t)entries.size();
+		append( &header, sizeof( DoomFileIndexHeader ) );
+
+		for( const DoomFileEntry& entry : entries )
+		{
+			DoomFileIndexRecord record;
+			record.file_length			= entry.file_length;
+			record.last_modified		= (int64_t)entry.last_modified;
+			record.type					= (int32_t)entry.type;
+			record.game_mode			= (int32_t)entry.game_mode;
+			record.game_mission			= (int32_t)entry.game_mission;
+			record.game_variant			= (int32_t)entry.game_variant;
+			record.is_voices_iwad		= entry.is_voices_iwad;
+			record.should_merge			= entry.should_merge;
+			record.has_dehacked_lump	= entry.has_dehacked_lump;
+			record.full_path_length		= (uint32_t)entry.full_path.size();
+			record.filename_length		= (uint32_t)entry.filename.size();
+			record.cache_path_length	= (uint32_t)entry.cache_path.size();
+
+			append( &record, sizeof( DoomFileIndexRecord ) );
+			append( entry.full_path.data(), entry.full_path.size() );
+			append( entry.filename.data(), entry.filename.size() );
+			append( entry.cache_path.data(), entry.cache_path.size() );
+		}
+
+		std::string indexpath = HOME_PATH + cache_index;
+		std::string temppath = indexpath + ".tmp";
+
+		std::error_code error;
+		std::filesystem::create_directories( std::filesystem::path( indexpath ).parent_path(), error );
+
+		// Written to the side and moved over the top so that a launcher
+		// that dies half way through doesn't leave a torn index behind
+		FILE* indexfile = fopen( temppath.c_str(), "wb" );
+		if( !indexfile )
+		{
+			return;
+		}
+		bool written = fwrite( data.data(), sizeof( byte ), data.size(), indexfile ) == data.size();
+		written &= ( fclose( indexfile ) == 0 );
+
+		if( written )
+		{
+			std::filesystem::rename( std::filesystem::path( temppath ), std::filesystem::path( indexpath ), error );
+		}
+	}
 
 	class DoomFileList
 	{
@@ -1576,57 +1796,118 @@ namespace launcher
 			Views.insert( Views.end(), IWADPaths.begin(), IWADPaths.end() );
 			Views.push_back( CacheCStr );
 
-			for( auto dir : Transform( Views, []( const char* pathname )
-							{
-								std::error_code error;
-								auto it = std::filesystem::recursive_directory_iterator( std::filesystem::path( pathname ), std::filesystem::directory_options::skip_permission_denied, error );
-								if( error ) return std::filesystem::recursive_directory_iterator();
-								return it;
-							} ) )
+			const DoomFileIndex index = ReadDoomFileIndex();
+
+			// Every directory is a job, and every file that isn't in the
+			// index or has changed since it was indexed is a job.
+			JobGroup parsejobs;
+
+			std::mutex foundlock;
+			DoomFileEntries found;
+
+			auto AddFound = [ this, &foundlock, &found ]( DoomFileEntry&& entry )
 			{
-				total_files += std::distance( dir, std::filesystem::recursive_directory_iterator{} );
-			}
+				std::lock_guard< std::mutex > lock( foundlock );
+				found.push_back( std::move( entry ) );
+				++parsed_files;
+			};
 
-			for( auto dir : Transform( Views, []( const char* pathname )
-							{
-								std::error_code error;
-								auto it = std::filesystem::recursive_directory_iterator( std::filesystem::path( pathname ), std::filesystem::directory_options::skip_permission_denied, error );
-								if( error ) return std::filesystem::recursive_directory_iterator();
-								return it;
-							} ) )
+			std::function< void( const std::filesystem::path& ) > WalkDirectory;
+			WalkDirectory = [ this, &parsejobs, &index, &AddFound, &WalkDirectory ]( const std::filesystem::path& dir )
 			{
-				for( auto file : dir )
+				std::error_code error;
+				auto it = std::filesystem::directory_iterator( dir, std::filesystem::directory_options::skip_permission_denied, error );
+				for( ; !error && it != std::filesystem::directory_iterator{}; it.increment( error ) )
 				{
 					if( abort_work.load() == true )
 					{
 						break;
 					}
 
-					std::string pathstring = file.path().string();
-
-					if( std::regex_match( pathstring, WADRegex )
-						|| std::regex_match( pathstring, DEHRegex ) )
+					const std::filesystem::directory_entry& file = *it;
+					std::error_code typeerror;
+					if( file.is_directory( typeerror ) )
 					{
-						DoomFileEntry entry = ParseDoomFile( file.path() );
-						if( entry.type == DoomFileType::IWAD && entry.game_mission != heretic && entry.game_mission != hexen && entry.game_mission != strife )
+						// Same as the recursive iterator, don't chase links to directories
+						if( !file.is_symlink( typeerror ) )
 						{
-							if( !entry.titlepic_raw.empty() && !entry.titlepic.tex )
+							parsers->AddJob( parsejobs, [ &WalkDirectory, path = file.path() ]()
 							{
-								entry.titlepic.tex = I_TextureCreate( entry.titlepic.width, entry.titlepic.height, Format_BGRA8, entry.titlepic_raw.data() );
-							}
-							IWADs.push_back( entry );
+								WalkDirectory( path );
+							} );
 						}
-						if( entry.type == DoomFileType::PWAD ) PWADs.push_back( entry );
-						if( entry.type == DoomFileType::Dehacked ) DEHs.push_back( entry );
+						continue;
 					}
 
-					++parsed_files;
+					if( !IsWADPath( file.path() ) && !IsDehackedPath( file.path() ) )
+					{
+						continue;
+					}
+
+					++total_files;
+
+					std::error_code staterror;
+					std::string fullpath = std::filesystem::absolute( file.path(), staterror ).string();
+					auto indexed = index.find( fullpath );
+					if( indexed != index.end()
+						&& indexed->second.file_length == file.file_size( staterror )
+						&& indexed->second.last_modified == M_FileLastModified( file.path().string().c_str() ) )
+					{
+						DoomFileEntry entry = indexed->second;
+						AddFound( std::move( entry ) );
+						continue;
+					}
+
+					parsers->AddJob( parsejobs, [ this, &AddFound, path = file.path() ]()
+					{
+						if( abort_work.load() == false )
+						{
+							AddFound( ParseDoomFile( path ) );
+						}
+					} );
 				}
+			};
+
+			for( const char* pathname : Views )
+			{
+				parsers->AddJob( parsejobs, [ &WalkDirectory, path = std::filesystem::path( pathname ) ]()
+				{
+					WalkDirectory( path );
+				} );
+			}
+			parsers->Flush( parsejobs );
+
+			if( abort_work.load() == true )
+			{
+				lists_ready = false;
+				return;
+			}
+
+			WriteDoomFileIndex( found );
+
+			// Directory order was never guaranteed, and now it's not even
+			// repeatable. Sort so the lists look the same every launch.
+			std::sort( found.begin(), found.end(), []( const DoomFileEntry& lhs, const DoomFileEntry& rhs )
+			{
+				int32_t compare = strcasecmp( lhs.filename.c_str(), rhs.filename.c_str() );
+				return compare != 0 ? compare < 0 : lhs.full_path < rhs.full_path;
+			} );
+
+			for( DoomFileEntry& entry : found )
+			{
+				if( entry.type == DoomFileType::IWAD && entry.game_mission != heretic && entry.game_mission != hexen && entry.game_mission != strife )
+				{
+					// The IWAD selector shows every titlepic straight away
+					LoadTitlepic( entry );
+					IWADs.push_back( entry );
+				}
+				if( entry.type == DoomFileType::PWAD ) PWADs.push_back( entry );
+				if( entry.type == DoomFileType::Dehacked ) DEHs.push_back( entry );
 			}
 
 			//glFlush();
 
-			lists_ready = !abort_work.load();
+			lists_ready = true;
 		}
 
 		INLINE bool ListsReady() const { return lists_ready.load(); }
@@ -1957,11 +2238,7 @@ namespace launcher
 				int32_t index = Select( pwads, entry );
 				if( index >= 0 )
 				{
-					DoomFileEntry& local = pwads.container->at( index );
-					if( !local.titlepic_raw.empty() && !local.titlepic.tex )
-					{
-						local.titlepic.tex = I_TextureCreate( local.titlepic.width, local.titlepic.height, Format_BGRA8, local.titlepic_raw.data() );
-					}
+					LoadTitlepic( pwads.container->at( index ) );
 				}
 			}
 			if( entry.type == DoomFileType::Dehacked ) Select( dehs, entry );
@@ -2069,7 +2346,9 @@ namespace launcher
 				{
 					if( current >= 0 )
 					{
-						igText( pwads.container->at( current ).text_file.c_str() );
+						DoomFileEntry& entry = pwads.container->at( current );
+						LoadTextFile( entry );
+						igText( entry.text_file.c_str() );
 					}
 				}
 				igEndChildFrame();
@@ -2459,18 +2738,12 @@ namespace launcher
 			auto directoryiterator = std::filesystem::recursive_directory_iterator( std::filesystem::path( extractedpath ), std::filesystem::directory_options::skip_permission_denied, error );
 			for( auto& file : directoryiterator )
 			{
-				std::string filepath = file.path().string();
-				if( std::regex_match( filepath, WADRegex )
-					|| std::regex_match( filepath, DEHRegex ) )
+				if( IsWADPath( file.path() ) || IsDehackedPath( file.path() ) )
 				{
 					DoomFileEntry entry = ParseDoomFile( file.path() );
+					LoadTitlepic( entry );
 					if( entry.type == DoomFileType::IWAD )
 					{
-						if( !entry.titlepic_raw.empty() && !entry.titlepic.tex )
-						{
-							entry.titlepic.tex = I_TextureCreate( entry.titlepic.width, entry.titlepic.height, Format_BGRA8, entry.titlepic_raw.data() );
-						}
-
 						if( addtoselector ) iwadselector->Add( entry );
 						iwads.push_back( entry );
 					}
@@ -3174,7 +3447,7 @@ namespace launcher
 				}
 
 				bool isdisabled = false;
-				if( dehselected < 0 || dehselected >= doomfileselector->SelectedDEHs().size() )
+				if( dehselected < 0 || dehselected >= (int32_t)doomfileselector->SelectedDEHs().size() )
 				{
 					igPushItemFlag( ImGuiItemFlags_Disabled, true );
 					isdisabled = true;
@@ -3191,7 +3464,7 @@ namespace launcher
 				if( igButtonEx( "X##dehacked_remove", buttonsize, ImGuiButtonFlags_None ) )
 				{
 					if( doomfileselector->Deselect( doomfileselector->SelectedDEHs()[ dehselected ] )
-						&& dehselected >= doomfileselector->SelectedDEHs().size() )
+						&& dehselected >= (int32_t)doomfileselector->SelectedDEHs().size() )
 					{
 						dehselected = doomfileselector->SelectedDEHs().size() - 1;
 					}
@@ -3282,7 +3555,7 @@ namespace launcher
 				}
 
 				bool isdisabled = false;
-				if( pwadselected < 0 || pwadselected >= doomfileselector->SelectedPWADs().size() )
+				if( pwadselected < 0 || pwadselected >= (int32_t)doomfileselector->SelectedPWADs().size() )
 				{
 					igPushItemFlag( ImGuiItemFlags_Disabled, true );
 					isdisabled = true;
@@ -3300,7 +3573,7 @@ namespace launcher
 				if( igButtonEx( "X##pwads_remove", buttonsize, ImGuiButtonFlags_None ) )
 				{
 					if( doomfileselector->Deselect( doomfileselector->SelectedPWADs()[ pwadselected ] )
-						&& pwadselected >= doomfileselector->SelectedPWADs().size() )
+						&& pwadselected >= (int32_t)doomfileselector->SelectedPWADs().size() )
 					{
 						pwadselected = doomfileselector->SelectedPWADs().size() - 1;
 					}
@@ -4135,6 +4408,7 @@ std::string M_DashboardLauncherWindow()
 	}
 	SDL_GL_MakeCurrent( window, glcontext );
 
+	launcher::parsers = std::make_unique< JobSystem >( M_MAX( (int32_t)I_ThreadGetHardwareCount() - 1, 1 ) );
 	launcher::jobs = std::make_shared< JobThread >();
 	launcher::jobs->AddJob( []()
 		{
@@ -4187,6 +4461,7 @@ std::string M_DashboardLauncherWindow()
 
 	launcher::jobs->Flush();
 	launcher::jobs = nullptr;
+	launcher::parsers = nullptr;
 
 	dashboardactive = Dash_Inactive;
 
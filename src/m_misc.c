@@ -32,6 +32,8 @@
 #ifdef _MSC_VER
 #include <direct.h>
 #endif
+#include <sys/types.h>
+#include <sys/stat.h>
 #else
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -176,6 +178,21 @@ long M_FileLength(FILE *handle)
     return length;
 }
 
+// Get the last time a file was written to, in seconds since the epoch.
+// Returns 0 if the file can't be found.
+
+time_t M_FileLastModified(const char *path)
+{
+    struct stat filestat;
+
+    if (stat(path, &filestat) != 0)
+    {
+        return 0;
+    }
+
+    return filestat.st_mtime;
+}
+
 //
 // M_WriteFile
 //
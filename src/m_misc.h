@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <time.h>
 
 #include "doomtype.h"
 
@@ -42,6 +43,7 @@ DOOM_C_API char *M_TempFile(const char *s);
 DOOM_C_API doombool M_FileExists(const char *file);
 DOOM_C_API char *M_FileCaseExists(const char *file);
 DOOM_C_API long M_FileLength(FILE *handle);
+DOOM_C_API time_t M_FileLastModified(const char *path);
 DOOM_C_API doombool M_StrToInt(const char *str, int *result);
 DOOM_C_API char *M_DirName(const char *path);
 DOOM_C_API const char *M_BaseName(const char *path);
@@ -17,15 +17,20 @@
 
 #include "m_profile.h"
 
+#include "m_argv.h"
 #include "m_container.h"
 #include "m_dashboard.h"
+#include "m_misc.h"
 
+#include "i_log.h"
+#include "i_system.h"
 #include "i_timer.h"
 #include "i_thread.h"
 
 #include "cimguiglue.h"
 
 #include <atomic>
+#include <mutex>
 #include <thread>
 
 typedef struct profiledata_s profiledata_t;
@@ -49,10 +54,40 @@ struct profiledata_s
 	std::vector< profiledata_s >	childcalls;
 };
 
+typedef enum traceeventtype_e : uint32_t
+{
+	TE_Begin,
+	TE_End,
+	TE_Frame,
+} traceeventtype_t;
+
+// Trace events are fixed size and written to a list of chunks per
+// thread, so recording never takes a lock. Chunks are reserved up front
+// once a thread has shown how many events it writes a frame, and only
+// get allocated mid-capture if that guess was short. The thread id is
+// implied by whichever list the event lives in.
+typedef struct traceevent_s
+{
+	uint64_t						timestamp;
+	uint32_t						markerid;
+	traceeventtype_t				type;
+} traceevent_t;
+
 typedef struct profilethread_s
 {
 	DoomString						threadname;
 	profiledata_t					rootprofile;
+
+	int32_t							threadindex = -1;
+	traceevent_t**					tracechunks = nullptr;
+	std::atomic< uint64_t >			tracehead = 0;
+	uint64_t						traceframestart = 0;
+	int32_t							traceframes = 0;
+	uint64_t						tracedropped = 0;
+
+	// Set for as long as the owning thread is writing an event, so the
+	// dump can wait for everyone to get out of the way
+	std::atomic< bool >				tracewriting = false;
 } profilethread_t;
 
 typedef enum profilemode_e : int32_t
@@ -60,20 +95,42 @@ typedef enum profilemode_e : int32_t
 	PM_Uninitialized,
 	PM_Capturing,
 	PM_SingleFrame,
+	PM_TraceCapturing,
+	PM_TraceComplete,
 } profilemode_t;
 
 constexpr int32_t MaxProfileThreads = 128;
+constexpr uint64_t TraceChunkShift = 16;
+constexpr uint64_t TraceEventsPerChunk = 1ull << TraceChunkShift;
+constexpr uint64_t TraceChunkMask = TraceEventsPerChunk - 1;
+constexpr uint64_t MaxTraceChunks = 1024;
+constexpr uint32_t MaxTraceMarkers = 4096;
+constexpr uint32_t InvalidTraceMarker = MaxTraceMarkers;
 
 thread_local profilethread_t profilethread;
 thread_local profiledata_t* currprofile = nullptr;
 
+// Thread indices are handed out in whatever order threads register,
+// so the main thread marks itself instead
+thread_local bool profilemainthread = false;
+
 static std::atomic< profilemode_t >		profilemode;
 static std::atomic< bool >				rendering;
+// Threads come and go with the job systems that own them, so slots get
+// reused and the list can have holes. Anything that reads another
+// thread's data holds the lock, so it can't be unregistered midway.
+static std::mutex						profilethreadslock;
 static profilethread_t*					profilethreads[ MaxProfileThreads ];
 static std::atomic< int32_t >			numprofilethreads;
 
 static int32_t							currthreadview = 0;
 
+static std::atomic< const char* >		tracemarkers[ MaxTraceMarkers ];
+static int32_t							traceframestocapture = 0;
+static int32_t							traceframescaptured = 0;
+static const char*						tracefilename = nullptr;
+static std::atomic< bool >				tracewritten;
+
 static doombool							profilewindowactive = false;
 
 auto ProfileThreads()			{ return std::span( profilethreads, numprofilethreads ); }
@@ -131,24 +188,38 @@ DOOM_C_API void M_ProfileWindow( const char* itemname, void* data )
 			profilemode = PM_Capturing;
 		}
 		break;
+	case PM_TraceCapturing:
+		igText( "Capturing trace to %s (%d/%d frames)", tracefilename, traceframescaptured, traceframestocapture );
+		return;
+	case PM_TraceComplete:
+		igText( "Trace written to %s", tracefilename );
+		return;
 	default:
 		return;
 	}
 
+	std::lock_guard< std::mutex > lock( profilethreadslock );
+	if( CurrProfileThread() == nullptr )
+	{
+		currthreadview = 0;
+	}
+
 	if( numprofilethreads.load() > 1 )
 	{
 		igSameLine( 0, -1 );
 		if( igBeginCombo( "Thread", CurrProfileThread()->threadname.c_str(), ImGuiComboFlags_None ) )
 		{
-			int32_t index = 0;
+			int32_t index = -1;
 			for( profilethread_t* thread : ProfileThreads() )
 			{
+				++index;
+				if( thread == nullptr ) continue;
+
 				bool selected = index == currthreadview;
 				if( igSelectable_Bool( thread->threadname.c_str(), selected, ImGuiSelectableFlags_None, zero ) )
 				{
 					currthreadview = index;
 				}
-				++index;
 			}
 			igEndCombo();
 		}
@@ -196,12 +267,224 @@ DOOM_C_API void M_ProfileWindow( const char* itemname, void* data )
 	igPopScrollableArea();
 }
 
+// Marker names are string literals, so the pointer itself is the
+// identity. Interned with an open addressed table that is only ever
+// appended to, which keeps lookups lock free from any thread.
+static uint32_t M_TraceMarkerID( const char* markername )
+{
+	uint32_t hash = (uint32_t)( ( (uintptr_t)markername >> 2 ) * 0x9E3779B1u );
+	for( uint32_t probe = 0; probe < MaxTraceMarkers; ++probe )
+	{
+		uint32_t slot = ( hash + probe ) & ( MaxTraceMarkers - 1 );
+		const char* existing = tracemarkers[ slot ].load( std::memory_order_acquire );
+		if( existing == nullptr
+			&& tracemarkers[ slot ].compare_exchange_strong( existing, markername, std::memory_order_acq_rel ) )
+		{
+			return slot;
+		}
+		if( existing == markername )
+		{
+			return slot;
+		}
+	}
+
+	return InvalidTraceMarker;
+}
+
+static traceevent_t* M_TraceChunk( profilethread_t& thread, uint64_t chunk )
+{
+	if( chunk >= MaxTraceChunks )
+	{
+		return nullptr;
+	}
+
+	if( thread.tracechunks[ chunk ] == nullptr )
+	{
+		thread.tracechunks[ chunk ] = (traceevent_t*)malloc( sizeof( traceevent_t ) * TraceEventsPerChunk );
+	}
+
+	return thread.tracechunks[ chunk ];
+}
+
+static void M_TraceReserve( profilethread_t& thread, uint64_t numevents )
+{
+	uint64_t numchunks = M_MIN( ( numevents + TraceChunkMask ) >> TraceChunkShift, MaxTraceChunks );
+	for( uint64_t chunk = 0; chunk < numchunks; ++chunk )
+	{
+		if( M_TraceChunk( thread, chunk ) == nullptr )
+		{
+			break;
+		}
+	}
+}
+
+static INLINE void M_TraceRecord( traceeventtype_t type, const char* markername, uint64_t timestamp )
+{
+	if( profilethread.tracechunks == nullptr ) return;
+
+	// Pairs with the dump setting the mode before it checks this flag,
+	// one of us is guaranteed to see the other
+	profilethread.tracewriting.store( true );
+	if( profilemode.load() == PM_TraceCapturing )
+	{
+		uint64_t head = profilethread.tracehead.load( std::memory_order_relaxed );
+		if( traceevent_t* chunk = M_TraceChunk( profilethread, head >> TraceChunkShift ) )
+		{
+			chunk[ head & TraceChunkMask ] = { timestamp, M_TraceMarkerID( markername ), type };
+			profilethread.tracehead.store( head + 1, std::memory_order_release );
+		}
+		else
+		{
+			++profilethread.tracedropped;
+		}
+	}
+	profilethread.tracewriting.store( false, std::memory_order_release );
+}
+
+static void M_TraceWriteName( FILE* file, const char* name )
+{
+	fputc( '"', file );
+	for( const char* curr = name; *curr; ++curr )
+	{
+		if( *curr == '"' || *curr == '\\' )
+		{
+			fputc( '\\', file );
+		}
+		fputc( *curr, file );
+	}
+	fputc( '"', file );
+}
+
+static void M_TraceWriteEvent( FILE* file, bool& first, const char* phase, uint32_t markerid, uint64_t timestamp, int32_t threadindex )
+{
+	const char* name = markerid < MaxTraceMarkers ? tracemarkers[ markerid ].load( std::memory_order_acquire ) : nullptr;
+
+	fprintf( file, "%s\n\t\t{ \"name\": ", first ? "" : "," );
+	M_TraceWriteName( file, name ? name : "<unknown>" );
+	fprintf( file, ", \"ph\": \"%s\", \"ts\": %llu, \"pid\": 0, \"tid\": %d%s }"
+				, phase, (unsigned long long)timestamp, threadindex
+				, phase[ 0 ] == 'i' ? ", \"s\": \"p\"" : "" );
+	first = false;
+}
+
+// Chrome trace event format, loadable in chrome://tracing, Perfetto
+// and Speedscope. Events that couldn't be stored are counted rather
+// than written, so any end without a matching begin is dropped and
+// anything still open is closed at the last timestamp seen on that
+// thread.
+static void M_TraceWriteFile( void )
+{
+	if( tracefilename == nullptr || tracewritten.exchange( true ) ) return;
+
+	std::lock_guard< std::mutex > lock( profilethreadslock );
+
+	// Nobody starts a new event once the mode changes. Wait for anyone
+	// halfway through one before reading their chunks.
+	profilemode = PM_TraceComplete;
+	for( profilethread_t* thread : ProfileThreads() )
+	{
+		while( thread != nullptr && thread->tracewriting.load() ) { I_Yield(); }
+	}
+
+	FILE* file = fopen( tracefilename, "wb" );
+	if( file == nullptr )
+	{
+		I_LogAddEntryVar( Log_Warning, "M_TraceWriteFile: Couldn't open %s for writing", tracefilename );
+		return;
+	}
+
+	fprintf( file, "{\n\t\"displayTimeUnit\": \"ms\",\n\t\"traceEvents\": [" );
+
+	bool first = true;
+	std::vector< uint32_t > openmarkers;
+
+	for( profilethread_t* thread : ProfileThreads() )
+	{
+		if( thread == nullptr ) continue;
+
+		fprintf( file, "%s\n\t\t{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": { \"name\": "
+					, first ? "" : ",", thread->threadindex );
+		M_TraceWriteName( file, thread->threadname.c_str() );
+		fprintf( file, " } }" );
+		first = false;
+
+		if( thread->tracechunks == nullptr ) continue;
+
+		uint64_t head = thread->tracehead.load( std::memory_order_acquire );
+		uint64_t lasttimestamp = 0;
+
+		openmarkers.clear();
+
+		for( uint64_t index = 0; index < head; ++index )
+		{
+			const traceevent_t& event = thread->tracechunks[ index >> TraceChunkShift ][ index & TraceChunkMask ];
+			lasttimestamp = event.timestamp;
+
+			switch( event.type )
+			{
+			case TE_Begin:
+				openmarkers.push_back( event.markerid );
+				M_TraceWriteEvent( file, first, "B", event.markerid, event.timestamp, thread->threadindex );
+				break;
+			case TE_End:
+				if( openmarkers.empty() ) break;
+				openmarkers.pop_back();
+				M_TraceWriteEvent( file, first, "E", event.markerid, event.timestamp, thread->threadindex );
+				break;
+			case TE_Frame:
+				M_TraceWriteEvent( file, first, "i", event.markerid, event.timestamp, thread->threadindex );
+				break;
+			}
+		}
+
+		while( !openmarkers.empty() )
+		{
+			M_TraceWriteEvent( file, first, "E", openmarkers.back(), lasttimestamp, thread->threadindex );
+			openmarkers.pop_back();
+		}
+	}
+
+	fprintf( file, "\n\t]\n}\n" );
+	fclose( file );
+
+	I_LogAddEntryVar( Log_Normal, "M_TraceWriteFile: Wrote %d frames to %s", traceframescaptured, tracefilename );
+
+	for( profilethread_t* thread : ProfileThreads() )
+	{
+		if( thread != nullptr && thread->tracedropped > 0 )
+		{
+			I_LogAddEntryVar( Log_Warning, "M_TraceWriteFile: %s dropped %llu events, the trace is missing data"
+										, thread->threadname.c_str(), (unsigned long long)thread->tracedropped );
+		}
+	}
+}
+
 DOOM_C_API void M_ProfileInit( void )
 {
 	if constexpr( PROFILING_ENABLED )
 	{
 		M_RegisterDashboardWindow( "Tools|Profiling", "Profiling", 500, 400, &profilewindowactive, Menu_Normal, &M_ProfileWindow );
 		profilemode = PM_Capturing;
+		profilemainthread = true;
+
+		//!
+		// @arg <n> <file>
+		// @category obscure
+		//
+		// Record profile markers from every thread for the first n frames
+		// and write them to file in Chrome trace format.
+		//
+		int32_t p = M_CheckParmWithArgs( "-profilecapture", 2 );
+		if( p )
+		{
+			M_StrToInt( myargv[ p + 1 ], &traceframestocapture );
+			tracefilename = myargv[ p + 2 ];
+			if( traceframestocapture > 0 )
+			{
+				profilemode = PM_TraceCapturing;
+				I_AtExit( &M_TraceWriteFile, true );
+			}
+		}
 	}
 }
 
@@ -211,17 +494,96 @@ DOOM_C_API void M_ProfileThreadInit( const char* threadname )
 	{
 		profilethread.threadname = threadname;
 
-		int32_t threadindex = numprofilethreads.fetch_add( 1 );
-		profilethreads[ threadindex ] = &profilethread;
+		std::lock_guard< std::mutex > lock( profilethreadslock );
+
+		profilethread_t** freeslot = std::find( profilethreads, profilethreads + MaxProfileThreads, nullptr );
+		if( freeslot == profilethreads + MaxProfileThreads )
+		{
+			I_LogAddEntryVar( Log_Warning, "M_ProfileThreadInit: No room to profile %s, already tracking %d threads", threadname, MaxProfileThreads );
+			return;
+		}
+
+		int32_t threadindex = (int32_t)( freeslot - profilethreads );
+		profilethread.threadindex = threadindex;
+		numprofilethreads = M_MAX( numprofilethreads.load(), threadindex + 1 );
 
-		M_ProfileNewFrame();
+		if( profilemode.load() == PM_TraceCapturing )
+		{
+			profilethread.tracechunks = (traceevent_t**)calloc( MaxTraceChunks, sizeof( traceevent_t* ) );
+			M_TraceReserve( profilethread, TraceEventsPerChunk );
+			profilethreads[ threadindex ] = &profilethread;
+		}
+		else
+		{
+			profilethreads[ threadindex ] = &profilethread;
+			M_ProfileNewFrame();
+		}
+	}
+}
+
+DOOM_C_API void M_ProfileThreadDeinit( void )
+{
+	if constexpr( PROFILING_ENABLED )
+	{
+		std::lock_guard< std::mutex > lock( profilethreadslock );
+
+		if( profilethread.threadindex < 0 )
+		{
+			return;
+		}
+
+		profilethreads[ profilethread.threadindex ] = nullptr;
+		profilethread.threadindex = -1;
+
+		// Anything this thread recorded goes with it
+		if( profilethread.tracechunks != nullptr )
+		{
+			for( traceevent_t* chunk : std::span( profilethread.tracechunks, MaxTraceChunks ) )
+			{
+				free( chunk );
+			}
+			free( profilethread.tracechunks );
+			profilethread.tracechunks = nullptr;
+		}
 	}
 }
 
+DOOM_C_API doombool M_ProfileTraceDumpPending( void )
+{
+	return profilemode.load() == PM_TraceCapturing && traceframescaptured >= traceframestocapture;
+}
+
 DOOM_C_API void M_ProfileNewFrame( void )
 {
 	if constexpr( PROFILING_ENABLED )
 	{
+		if( profilemode.load() == PM_TraceCapturing )
+		{
+			// Only the main thread's frames count towards the capture
+			if( profilemainthread )
+			{
+				if( traceframescaptured >= traceframestocapture )
+				{
+					M_TraceWriteFile();
+					return;
+				}
+				++traceframescaptured;
+			}
+
+			// One full frame is enough to go on. Leave some headroom,
+			// frames later in the capture are rarely all the same size.
+			uint64_t head = profilethread.tracehead.load( std::memory_order_relaxed );
+			if( ++profilethread.traceframes == 2 && profilethread.tracechunks != nullptr )
+			{
+				uint64_t perframe = head - profilethread.traceframestart;
+				M_TraceReserve( profilethread, head + ( perframe * traceframestocapture * 5 ) / 4 );
+			}
+			profilethread.traceframestart = head;
+
+			M_TraceRecord( TE_Frame, "Frame", I_GetTimeUS() );
+			return;
+		}
+
 		if( profilemode.load() != PM_Capturing ) return;
 		while( rendering.load() ) { I_Yield(); }
 
@@ -235,6 +597,12 @@ DOOM_C_API void M_ProfilePushMarker( const char* markername, const char* file, s
 {
 	if constexpr( PROFILING_ENABLED )
 	{
+		if( profilemode.load() == PM_TraceCapturing )
+		{
+			M_TraceRecord( TE_Begin, markername, I_GetTimeUS() );
+			return;
+		}
+
 		if( profilemode.load() != PM_Capturing ) return;
 		while( rendering.load() ) { I_Yield(); }
 
@@ -266,6 +634,12 @@ DOOM_C_API void M_ProfilePopMarker( const char* markername )
 	{
 		uint64_t endtime = I_GetTimeUS();
 
+		if( profilemode.load() == PM_TraceCapturing )
+		{
+			M_TraceRecord( TE_End, markername, endtime );
+			return;
+		}
+
 		if( profilemode.load() != PM_Capturing ) return;
 		while( rendering.load() ) { I_Yield(); }
 
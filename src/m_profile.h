@@ -36,8 +36,13 @@
 
 DOOM_C_API void M_ProfileInit( void );
 DOOM_C_API void M_ProfileThreadInit( const char* threadname );
+DOOM_C_API void M_ProfileThreadDeinit( void );
 DOOM_C_API void M_ProfileNewFrame( void );
 
+// True when the next M_ProfileNewFrame() is going to write out a trace
+// capture. Whoever owns worker threads should let them go idle first.
+DOOM_C_API doombool M_ProfileTraceDumpPending( void );
+
 DOOM_C_API void M_ProfilePushMarker( const char* markername, const char* file, size_t line );
 DOOM_C_API void M_ProfilePopMarker( const char* markername );
 
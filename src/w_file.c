@@ -17,15 +17,18 @@
 //
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "config.h"
 
 #include "doomtype.h"
 #include "m_argv.h"
+#include "m_misc.h"
 
 #include "w_file.h"
 
 extern wad_file_class_t stdc_wad_file;
+extern wad_file_class_t zip_wad_file;
 
 #ifdef _WIN32
 extern wad_file_class_t win32_wad_file;
@@ -48,9 +51,19 @@ static wad_file_class_t *wad_file_classes[] =
 
 wad_file_t *W_OpenFile(const char *path)
 {
-    wad_file_t *result;
-    int i;
+    // PK3 files are ZIPs with a different hat on
+
+    if (M_StringEndsWith(path, ".pk3") || M_StringEndsWith(path, ".PK3")
+     || M_StringEndsWith(path, ".zip") || M_StringEndsWith(path, ".ZIP"))
+    {
+        return zip_wad_file.OpenFile(path);
+    }
+
+    return W_OpenRawFile(path);
+}
 
+wad_file_t *W_OpenRawFile(const char *path)
+{
     //!
     // @category obscure
     //
@@ -63,6 +76,14 @@ wad_file_t *W_OpenFile(const char *path)
         return stdc_wad_file.OpenFile(path);
     }
 
+    return W_OpenMappedFile(path);
+}
+
+wad_file_t *W_OpenMappedFile(const char *path)
+{
+    wad_file_t *result;
+    int i;
+
     // Try all classes in order until we find one that works
 
     result = NULL;
@@ -82,7 +103,11 @@ wad_file_t *W_OpenFile(const char *path)
 
 void W_CloseFile(wad_file_t *wad)
 {
+    // Every class duplicates the path on open, but none of them free it
+    char *path = (char *) wad->path;
+
     wad->file_class->CloseFile(wad);
+    free(path);
 }
 
 size_t W_Read(wad_file_t *wad, unsigned int offset,
@@ -91,3 +116,18 @@ size_t W_Read(wad_file_t *wad, unsigned int offset,
     return wad->file_class->Read(wad, offset, buffer, buffer_len);
 }
 
+byte *W_MapRange(wad_file_t *wad, unsigned int offset, size_t length)
+{
+    if (wad->mapped != NULL)
+    {
+        return wad->mapped + offset;
+    }
+
+    if (wad->file_class->MapLump != NULL)
+    {
+        return wad->file_class->MapLump(wad, offset, length);
+    }
+
+    return NULL;
+}
+
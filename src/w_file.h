@@ -49,6 +49,11 @@ DOOM_C_API typedef struct
     // provided buffer.  Returns the number of bytes read.
     size_t (*Read)(wad_file_t *file, unsigned int offset,
                    void *buffer, size_t buffer_len);
+
+    // Optional. Returns a pointer straight in to memory for the given
+    // range when the whole range can be served without a copy, even if
+    // the file as a whole isn't mapped. NULL otherwise.
+    byte *(*MapLump)(wad_file_t *file, unsigned int offset, size_t length);
 } wad_file_class_t;
 
 DOOM_C_API struct _wad_file_s
@@ -77,6 +82,15 @@ DOOM_C_API struct _wad_file_s
 
 DOOM_C_API wad_file_t *W_OpenFile(const char *path);
 
+// As W_OpenFile, but never treats the file as an archive.
+
+DOOM_C_API wad_file_t *W_OpenRawFile(const char *path);
+
+// As W_OpenRawFile, but maps the file in to memory whether -mmap was
+// given or not. Falls back to plain reads if the platform can't map.
+
+DOOM_C_API wad_file_t *W_OpenMappedFile(const char *path);
+
 // Close the specified WAD file.
 
 DOOM_C_API void W_CloseFile(wad_file_t *wad);
@@ -88,4 +102,9 @@ DOOM_C_API void W_CloseFile(wad_file_t *wad);
 DOOM_C_API size_t W_Read(wad_file_t *wad, unsigned int offset,
               void *buffer, size_t buffer_len);
 
+// Returns a pointer to the given range if it's directly addressable,
+// whether that's from a mapped file or from the file class itself.
+
+DOOM_C_API byte *W_MapRange(wad_file_t *wad, unsigned int offset, size_t length);
+
 #endif /* #ifndef __W_FILE__ */
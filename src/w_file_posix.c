@@ -135,17 +135,15 @@ size_t W_POSIX_Read(wad_file_t *wad, unsigned int offset,
 
     posix_wad = (posix_wad_file_t *) wad;
 
-    // Jump to the specified position in the file.
-
-    lseek(posix_wad->handle, offset, SEEK_SET);
-
-    // Read into the buffer.
+    // Read into the buffer. Positioned reads leave the file offset
+    // alone, so lumps can load from several threads at once.
 
     bytes_read = 0;
     byte_buffer = buffer;
 
     while (buffer_len > 0) {
-        result = read(posix_wad->handle, byte_buffer, buffer_len);
+        result = pread(posix_wad->handle, byte_buffer, buffer_len,
+                       (off_t) offset + bytes_read);
 
         if (result < 0) {
             perror("W_POSIX_Read");
@@ -17,6 +17,7 @@
 //
 
 #include <stdio.h>
+#include <SDL2/SDL_mutex.h>
 
 #include "m_misc.h"
 #include "w_file.h"
@@ -26,6 +27,10 @@ typedef struct
 {
     wad_file_t wad;
     FILE *fstream;
+
+    // Seeking and reading share the stream position, so lumps loaded
+    // from different threads have to take turns.
+    SDL_mutex *lock;
 } stdc_wad_file_t;
 
 extern wad_file_class_t stdc_wad_file;
@@ -50,6 +55,7 @@ static wad_file_t *W_StdC_OpenFile(const char *path)
     result->wad.length = M_FileLength(fstream);
     result->wad.path = M_StringDuplicate(path);
     result->fstream = fstream;
+    result->lock = SDL_CreateMutex();
 
     return &result->wad;
 }
@@ -61,6 +67,7 @@ static void W_StdC_CloseFile(wad_file_t *wad)
     stdc_wad = (stdc_wad_file_t *) wad;
 
     fclose(stdc_wad->fstream);
+    SDL_DestroyMutex(stdc_wad->lock);
     Z_Free(stdc_wad);
 }
 
@@ -75,6 +82,8 @@ size_t W_StdC_Read(wad_file_t *wad, unsigned int offset,
 
     stdc_wad = (stdc_wad_file_t *) wad;
 
+    SDL_LockMutex(stdc_wad->lock);
+
     // Jump to the specified position in the file.
 
     fseek(stdc_wad->fstream, offset, SEEK_SET);
@@ -83,6 +92,8 @@ size_t W_StdC_Read(wad_file_t *wad, unsigned int offset,
 
     result = fread(buffer, 1, buffer_len, stdc_wad->fstream);
 
+    SDL_UnlockMutex(stdc_wad->lock);
+
     return result;
 }
 
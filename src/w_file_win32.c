@@ -21,6 +21,7 @@
 #ifdef _WIN32
 
 #include <stdio.h>
+#include <string.h>
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -162,23 +163,18 @@ size_t W_Win32_Read(wad_file_t *wad, unsigned int offset,
 {
     win32_wad_file_t *win32_wad;
     DWORD bytes_read;
-    DWORD result;
+    OVERLAPPED position;
 
     win32_wad = (win32_wad_file_t *) wad;
 
-    // Jump to the specified position in the file.
-
-    result = SetFilePointer(win32_wad->handle, offset, NULL, FILE_BEGIN);
-
-    if (result == INVALID_SET_FILE_POINTER)
-    {
-        I_Error("W_Win32_Read: Failed to set file pointer to %i",
-                offset);
-    }
+    // Read into the buffer. Giving the offset with the read rather than
+    // moving the file pointer first means lumps can load from several
+    // threads at once.
 
-    // Read into the buffer.
+    memset(&position, 0, sizeof(position));
+    position.Offset = offset;
 
-    if (!ReadFile(win32_wad->handle, buffer, buffer_len, &bytes_read, NULL))
+    if (!ReadFile(win32_wad->handle, buffer, buffer_len, &bytes_read, &position))
     {
         I_Error("W_Win32_Read: Error reading from file");
     }
@@ -0,0 +1,528 @@
+//
+// Copyright(C) 2020-2022 Ethan Watson
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	PK3/ZIP archives as WAD files. Entries get laid out one after the
+//	other in a virtual file, with namespace folders turned in to the
+//	marker ranges the rest of the code expects. Stored entries come
+//	straight out of the archive, deflated entries get inflated when
+//	they're first read.
+//
+
+#include "doomtype.h"
+
+#include "i_swap.h"
+#include "i_system.h"
+#include "i_terminal.h"
+
+#include "m_misc.h"
+
+#include "w_file.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+extern "C"
+{
+	extern wad_file_class_t zip_wad_file;
+}
+
+static constexpr uint32_t ZipLocalHeaderSig		= 0x04034B50;
+static constexpr uint32_t ZipCentralHeaderSig	= 0x02014B50;
+static constexpr uint32_t ZipEndOfDirSig		= 0x06054B50;
+
+static constexpr size_t ZipLocalHeaderSize		= 30;
+static constexpr size_t ZipCentralHeaderSize	= 46;
+static constexpr size_t ZipEndOfDirSize			= 22;
+static constexpr size_t ZipMaxCommentSize		= 65535;
+
+static constexpr uint16_t ZipMethodStored		= 0;
+static constexpr uint16_t ZipMethodDeflated		= 8;
+
+typedef struct zipentry_s
+{
+	uint32_t		position;		// In the virtual file
+	uint32_t		size;
+	uint32_t		compressedsize;
+	uint32_t		dataoffset;		// In the archive
+	uint16_t		method;
+	char			name[ 8 ];
+} zipentry_t;
+
+typedef struct zip_wad_file_s
+{
+	wad_file_t					wad;
+	wad_file_t*					archive;
+	std::vector< zipentry_t >	entries;
+} zip_wad_file_t;
+
+// Folders that map to marker ranges. There's no support for standalone
+// textures, so they go in as patches for TEXTURE1/2 to reference.
+// Anything in a folder not listed here is ignored.
+typedef struct zipnamespace_s
+{
+	const char*		folder;
+	const char*		start;
+	const char*		end;
+} zipnamespace_t;
+
+static constexpr zipnamespace_t ZipNamespaces[] =
+{
+	{ "",			nullptr,		nullptr		},
+	{ "flats",		"FF_START",		"FF_END"	},
+	{ "sprites",	"SS_START",		"SS_END"	},
+	{ "patches",	"PP_START",		"PP_END"	},
+	{ "textures",	"PP_START",		"PP_END"	},
+	{ "colormaps",	"C_START",		"C_END"		},
+	{ "graphics",	nullptr,		nullptr		},
+	{ "sounds",		nullptr,		nullptr		},
+	{ "music",		nullptr,		nullptr		},
+};
+
+static INLINE uint16_t ReadU16( const byte* data )
+{
+	return (uint16_t)( data[ 0 ] | ( data[ 1 ] << 8 ) );
+}
+
+static INLINE uint32_t ReadU32( const byte* data )
+{
+	return (uint32_t)data[ 0 ] | ( (uint32_t)data[ 1 ] << 8 ) | ( (uint32_t)data[ 2 ] << 16 ) | ( (uint32_t)data[ 3 ] << 24 );
+}
+
+static bool ZipReadExact( wad_file_t* archive, uint32_t offset, void* buffer, size_t length )
+{
+	if( archive->mapped != nullptr )
+	{
+		if( (size_t)offset + length > archive->length )
+		{
+			return false;
+		}
+		memcpy( buffer, archive->mapped + offset, length );
+		return true;
+	}
+
+	return W_Read( archive, offset, buffer, length ) == length;
+}
+
+// Doom names are the file name without extension, uppercase, up to 8 chars
+static void ZipLumpName( const std::string& path, char* dest )
+{
+	size_t start = path.find_last_of( '/' );
+	start = ( start == std::string::npos ) ? 0 : start + 1;
+	size_t end = path.find_first_of( '.', start );
+	end = ( end == std::string::npos ) ? path.size() : end;
+
+	memset( dest, 0, 8 );
+	for( size_t index = 0; index < 8 && start + index < end; ++index )
+	{
+		dest[ index ] = (char)toupper( path[ start + index ] );
+	}
+}
+
+static int32_t ZipNamespaceFor( const std::string& path )
+{
+	size_t slash = path.find_first_of( '/' );
+	if( slash == std::string::npos )
+	{
+		return 0;
+	}
+
+	std::string folder = path.substr( 0, slash );
+	std::transform( folder.begin(), folder.end(), folder.begin(), []( char c ) { return (char)tolower( c ); } );
+
+	for( int32_t index = 1; index < (int32_t)arrlen( ZipNamespaces ); ++index )
+	{
+		if( folder == ZipNamespaces[ index ].folder )
+		{
+			return index;
+		}
+	}
+
+	return -1;
+}
+
+static bool ZipReadDirectory( zip_wad_file_t* zip )
+{
+	wad_file_t* archive = zip->archive;
+	if( archive->length < ZipEndOfDirSize )
+	{
+		return false;
+	}
+
+	// The end of directory record sits behind an optional comment, so
+	// search backwards for it
+	size_t taillength = std::min< size_t >( archive->length, ZipEndOfDirSize + ZipMaxCommentSize );
+	std::vector< byte > tail( taillength );
+	if( !ZipReadExact( archive, (uint32_t)( archive->length - taillength ), tail.data(), taillength ) )
+	{
+		return false;
+	}
+
+	const byte* endofdir = nullptr;
+	for( size_t offset = taillength - ZipEndOfDirSize + 1; offset-- > 0; )
+	{
+		if( ReadU32( &tail[ offset ] ) == ZipEndOfDirSig )
+		{
+			endofdir = &tail[ offset ];
+			break;
+		}
+	}
+
+	if( endofdir == nullptr )
+	{
+		return false;
+	}
+
+	uint16_t numentries = ReadU16( endofdir + 10 );
+	uint32_t dirsize = ReadU32( endofdir + 12 );
+	uint32_t diroffset = ReadU32( endofdir + 16 );
+
+	if( numentries == 0xFFFF || diroffset == 0xFFFFFFFF )
+	{
+		I_TerminalPrintf( Log_Warning, " %s is a ZIP64 archive, which isn't supported\n", archive->path );
+		return false;
+	}
+
+	std::vector< byte > directory( dirsize );
+	if( !ZipReadExact( archive, diroffset, directory.data(), dirsize ) )
+	{
+		return false;
+	}
+
+	std::vector< std::vector< zipentry_t > > namespaces( arrlen( ZipNamespaces ) );
+
+	const byte* curr = directory.data();
+	const byte* end = directory.data() + dirsize;
+	for( uint16_t entry = 0; entry < numentries; ++entry )
+	{
+		if( curr + ZipCentralHeaderSize > end || ReadU32( curr ) != ZipCentralHeaderSig )
+		{
+			return false;
+		}
+
+		uint16_t flags				= ReadU16( curr + 8 );
+		uint16_t method				= ReadU16( curr + 10 );
+		uint32_t compressedsize		= ReadU32( curr + 20 );
+		uint32_t size				= ReadU32( curr + 24 );
+		uint16_t namelength			= ReadU16( curr + 28 );
+		uint16_t extralength		= ReadU16( curr + 30 );
+		uint16_t commentlength		= ReadU16( curr + 32 );
+		uint32_t localoffset		= ReadU32( curr + 42 );
+
+		if( curr + ZipCentralHeaderSize + namelength > end )
+		{
+			return false;
+		}
+
+		std::string path( (const char*)curr + ZipCentralHeaderSize, namelength );
+		curr += ZipCentralHeaderSize + namelength + extralength + commentlength;
+
+		bool isdirectory = !path.empty() && path.back() == '/';
+		bool encrypted = ( flags & 0x0001 ) != 0;
+		int32_t namespaceindex = ZipNamespaceFor( path );
+
+		if( isdirectory || namespaceindex < 0 )
+		{
+			continue;
+		}
+
+		if( encrypted || ( method != ZipMethodStored && method != ZipMethodDeflated ) )
+		{
+			I_TerminalPrintf( Log_Warning, " %s: skipping %s, unsupported compression\n", archive->path, path.c_str() );
+			continue;
+		}
+
+		// Data offsets can only be found from the local header, as the
+		// extra field there doesn't need to match the central directory
+		byte localheader[ ZipLocalHeaderSize ];
+		if( !ZipReadExact( archive, localoffset, localheader, ZipLocalHeaderSize )
+			|| ReadU32( localheader ) != ZipLocalHeaderSig )
+		{
+			return false;
+		}
+
+		zipentry_t newentry = {};
+		newentry.size			= size;
+		newentry.compressedsize	= compressedsize;
+		newentry.dataoffset		= localoffset + (uint32_t)ZipLocalHeaderSize + ReadU16( localheader + 26 ) + ReadU16( localheader + 28 );
+		newentry.method			= method;
+		ZipLumpName( path, newentry.name );
+
+		if( (size_t)newentry.dataoffset + compressedsize > archive->length )
+		{
+			return false;
+		}
+
+		namespaces[ namespaceindex ].push_back( newentry );
+	}
+
+	// Lay the entries out in one virtual file, markers included
+	uint64_t position = 0;
+	auto AddEntry = [ zip, &position ]( zipentry_t entry )
+	{
+		entry.position = (uint32_t)position;
+		position += entry.size;
+		zip->entries.push_back( entry );
+	};
+
+	auto AddMarker = [ &AddEntry ]( const char* name )
+	{
+		zipentry_t marker = {};
+		strncpy( marker.name, name, 8 );
+		AddEntry( marker );
+	};
+
+	for( int32_t index = 0; index < (int32_t)arrlen( ZipNamespaces ); ++index )
+	{
+		if( namespaces[ index ].empty() )
+		{
+			continue;
+		}
+
+		const zipnamespace_t& space = ZipNamespaces[ index ];
+		if( space.start ) AddMarker( space.start );
+		for( zipentry_t& entry : namespaces[ index ] )
+		{
+			AddEntry( entry );
+		}
+		if( space.end ) AddMarker( space.end );
+	}
+
+	// Lump positions are signed 32 bit
+	if( position > 0x7FFFFFFFull )
+	{
+		I_TerminalPrintf( Log_Warning, " %s uncompresses to more than 2GB, which isn't supported\n", archive->path );
+		return false;
+	}
+
+	zip->wad.length = (unsigned int)position;
+	return true;
+}
+
+static wad_file_t* W_Zip_OpenFile( const char* path )
+{
+	wad_file_t* archive = W_OpenRawFile( path );
+	if( archive == nullptr )
+	{
+		return nullptr;
+	}
+
+	zip_wad_file_t* zip = Z_MallocAs( zip_wad_file_t, PU_STATIC, nullptr );
+	zip->wad.file_class = &zip_wad_file;
+	zip->wad.mapped = nullptr;
+	zip->wad.length = 0;
+	zip->wad.path = M_StringDuplicate( path );
+	zip->archive = archive;
+
+	if( !ZipReadDirectory( zip ) )
+	{
+		I_TerminalPrintf( Log_Warning, " %s isn't a valid ZIP archive\n", path );
+		W_CloseFile( archive );
+		zip->~zip_wad_file_t();
+		Z_Free( zip );
+		return nullptr;
+	}
+
+	return &zip->wad;
+}
+
+static void W_Zip_CloseFile( wad_file_t* wad )
+{
+	zip_wad_file_t* zip = (zip_wad_file_t*)wad;
+
+	W_CloseFile( zip->archive );
+	zip->~zip_wad_file_t();
+	Z_Free( zip );
+}
+
+static const zipentry_t* ZipEntryAt( zip_wad_file_t* zip, unsigned int offset )
+{
+	// Markers have no size, so make sure to land on the entry that
+	// actually holds the offset
+	auto found = std::upper_bound( zip->entries.begin(), zip->entries.end(), offset
+									, []( unsigned int value, const zipentry_t& entry ) { return value < entry.position; } );
+
+	while( found != zip->entries.begin() )
+	{
+		--found;
+		if( found->size > 0 && offset < found->position + found->size )
+		{
+			return &*found;
+		}
+		if( found->position < offset )
+		{
+			break;
+		}
+	}
+
+	return nullptr;
+}
+
+static size_t ZipInflate( zip_wad_file_t* zip, const zipentry_t* entry, uint32_t skip, byte* buffer, size_t length )
+{
+	std::vector< byte > compressed;
+	const byte* source = nullptr;
+	if( zip->archive->mapped != nullptr )
+	{
+		source = zip->archive->mapped + entry->dataoffset;
+	}
+	else
+	{
+		compressed.resize( entry->compressedsize );
+		if( W_Read( zip->archive, entry->dataoffset, compressed.data(), entry->compressedsize ) != entry->compressedsize )
+		{
+			return 0;
+		}
+		source = compressed.data();
+	}
+
+	// Reads almost always start at the front of the lump. Anything else
+	// has to inflate what comes before it too.
+	std::vector< byte > prefix( skip );
+
+	z_stream stream = {};
+	if( inflateInit2( &stream, -MAX_WBITS ) != Z_OK )
+	{
+		return 0;
+	}
+
+	stream.next_in = (Bytef*)source;
+	stream.avail_in = entry->compressedsize;
+
+	int32_t result = Z_OK;
+	if( skip > 0 )
+	{
+		stream.next_out = prefix.data();
+		stream.avail_out = skip;
+		while( result == Z_OK && stream.avail_out > 0 )
+		{
+			result = inflate( &stream, Z_NO_FLUSH );
+		}
+	}
+
+	size_t inflated = 0;
+	if( result == Z_OK )
+	{
+		stream.next_out = buffer;
+		stream.avail_out = (uInt)length;
+		while( result == Z_OK && stream.avail_out > 0 )
+		{
+			result = inflate( &stream, Z_NO_FLUSH );
+		}
+		inflated = length - stream.avail_out;
+	}
+
+	inflateEnd( &stream );
+
+	return ( result == Z_OK || result == Z_STREAM_END ) ? inflated : 0;
+}
+
+static size_t W_Zip_Read( wad_file_t* wad, unsigned int offset, void* buffer, size_t buffer_len )
+{
+	zip_wad_file_t* zip = (zip_wad_file_t*)wad;
+
+	byte* dest = (byte*)buffer;
+	size_t bytesread = 0;
+	while( bytesread < buffer_len )
+	{
+		const zipentry_t* entry = ZipEntryAt( zip, offset );
+		if( entry == nullptr )
+		{
+			break;
+		}
+
+		uint32_t skip = offset - entry->position;
+		size_t length = std::min< size_t >( buffer_len - bytesread, entry->size - skip );
+
+		size_t thisread = 0;
+		if( entry->method == ZipMethodStored )
+		{
+			thisread = W_Read( zip->archive, entry->dataoffset + skip, dest, length );
+		}
+		else
+		{
+			thisread = ZipInflate( zip, entry, skip, dest, length );
+		}
+
+		bytesread += thisread;
+		if( thisread < length )
+		{
+			break;
+		}
+
+		dest += length;
+		offset += (unsigned int)length;
+	}
+
+	return bytesread;
+}
+
+static byte* W_Zip_MapLump( wad_file_t* wad, unsigned int offset, size_t length )
+{
+	zip_wad_file_t* zip = (zip_wad_file_t*)wad;
+
+	if( zip->archive->mapped == nullptr || length == 0 )
+	{
+		return nullptr;
+	}
+
+	const zipentry_t* entry = ZipEntryAt( zip, offset );
+	if( entry == nullptr
+		|| entry->method != ZipMethodStored
+		|| offset + length > entry->position + entry->size )
+	{
+		return nullptr;
+	}
+
+	return zip->archive->mapped + entry->dataoffset + ( offset - entry->position );
+}
+
+doombool W_ZipDirectory( wad_file_t* wad, filelump_t** fileinfo, int32_t* numfilelumps )
+{
+	if( wad->file_class != &zip_wad_file )
+	{
+		return false;
+	}
+
+	zip_wad_file_t* zip = (zip_wad_file_t*)wad;
+
+	*numfilelumps = (int32_t)zip->entries.size();
+	*fileinfo = (filelump_t*)Z_Malloc( sizeof( filelump_t ) * M_MAX( *numfilelumps, 1 ), PU_STATIC, 0 );
+
+	filelump_t* curr = *fileinfo;
+	for( const zipentry_t& entry : zip->entries )
+	{
+		// Stored little endian, same as a real WAD directory
+		curr->filepos = LONG( (int32_t)entry.position );
+		curr->size = LONG( (int32_t)entry.size );
+		memcpy( curr->name, entry.name, 8 );
+		++curr;
+	}
+
+	return true;
+}
+
+wad_file_class_t zip_wad_file =
+{
+	W_Zip_OpenFile,
+	W_Zip_CloseFile,
+	W_Zip_Read,
+	W_Zip_MapLump,
+};
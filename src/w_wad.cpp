@@ -25,6 +25,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "doomtype.h"
 
 #include "i_swap.h"
@@ -70,6 +73,17 @@ constexpr auto operator&( _type lhs, _type rhs )
 
 std::vector< wad_file_t* > wadfiles;
 
+// Lump loads lock their lump's shard so that only one thread reads any
+// given lump. Actually reading goes through one lock, as the stdc file
+// class seeks and reads on a shared FILE*.
+static constexpr int32_t LumpLockShards = 64;
+static std::mutex lumplocks[ LumpLockShards ];
+static std::mutex wadreadlock;
+
+static std::atomic< uint64_t > lumpcachehits = 0;
+static std::atomic< uint64_t > lumpcachemisses = 0;
+static std::atomic< uint64_t > lumpcachemapped = 0;
+
 const std::vector< wad_file_t* >& W_GetLoadedWADFiles()
 {
 	return wadfiles;
@@ -165,7 +179,14 @@ wad_file_t *W_AddFileWithType(const char *filename, wadtype_t type)
 
 	int32_t iswad = strcasecmp( filename + M_MAX( strlen( filename ) - 3, 0 ), "wad" );
 	int32_t iswidepix = strcasecmp(filename + M_MAX( strlen( filename ) - 7, 0 ), "widepix" );
-    if ( iswad != 0	&& iswidepix != 0 )
+	if( W_ZipDirectory( wad_file, &fileinfo, &numfilelumps ) )
+	{
+		// PK3/ZIP archive, the directory is built from the archive's
+		// own and treated like a PWAD from here on in
+		foundtype = type | wt_pwad;
+		wad_file->type = foundtype;
+	}
+    else if ( iswad != 0	&& iswidepix != 0 )
     {
 		// single lump file
 
@@ -405,9 +426,13 @@ void W_ReadLump(lumpindex_t lump, void *dest)
 
     l = lumpinfo[lump];
 
-    V_BeginRead(l->size);
+	{
+		std::lock_guard< std::mutex > lock( wadreadlock );
+
+		V_BeginRead(l->size);
 
-    c = W_Read(l->wad_file, l->position, dest, l->size);
+		c = W_Read(l->wad_file, l->position, dest, l->size);
+	}
 
     if (c < l->size)
     {
@@ -430,12 +455,19 @@ void W_ReadLump(lumpindex_t lump, void *dest)
 // PU_STATIC, it should be released back using W_ReleaseLumpNum
 // when no longer needed (do not use Z_ChangeTag).
 //
+// Safe to call from any thread, as each file class serialises or
+// positions its own reads. PU_CACHE results are only safe to use off
+// the main thread while wadrenderlock is set, as that's the only time
+// the main thread isn't able to purge them.
+//
+// Every call with a non-purgable tag counts as a hold on the lump, and
+// it only drops back to PU_CACHE once each hold has been released.
+//
 
 void *W_CacheLumpNumTracked(const char* file, size_t line, lumpindex_t lumpnum, int tag)
 {
     byte *result;
     lumpinfo_t *lump;
-	doombool changed;
 
 	if ((unsigned)lumpnum >= numlumps)
 	{
@@ -446,40 +478,68 @@ void *W_CacheLumpNumTracked(const char* file, size_t line, lumpindex_t lumpnum,
 
     // Get the pointer to return.  If the lump is in a memory-mapped
     // file, we can just return a pointer to within the memory-mapped
-    // region.  If the lump is in an ordinary file, we may already
-    // have it cached; otherwise, load it into memory.
+    // region.  If the lump is in an ordinary file or is compressed, we
+    // may already have it cached; otherwise, load it into memory.
 
-    if (lump->wad_file->mapped != NULL)
+    byte* mapped = W_MapRange(lump->wad_file, lump->position, lump->size);
+    if (mapped != NULL)
     {
-        // Memory mapped file, return from the mmapped region.
+        // Memory mapped file or a stored archive entry, return
+        // straight from the mapped region.
 
-        result = lump->wad_file->mapped + lump->position;
+		++lumpcachemapped;
+        return mapped;
     }
-    else if (lump->cache != NULL)
-    {
-        // Already cached, so just switch the zone tag.
-
-        result = (byte*)lump->cache;
-        changed = Z_LowerTag(lump->cache, tag);
 
-		if( changed && wadrenderlock )
-		{
-			I_Error ( "W_CacheLumpNum: %i changed zone during render", lumpnum );
-		}
-    }
-    else
-    {
-        // Not yet loaded, so load it now
-		if( wadrenderlock )
+	// Purging clears the cache pointer with the zone locked, so checking
+	// it and switching the zone tag needs to happen under that lock too
+	auto CheckCache = [ lump, tag ]() -> byte*
+	{
+		Z_Lock();
+		byte* cached = (byte*)lump->cache;
+		if( cached != NULL )
 		{
-			I_Error ( "W_CacheLumpNum: %i requested during render", lumpnum );
+			Z_LowerTag( cached, tag );
+			if( tag < PU_PURGELEVEL )
+			{
+				++lump->holds;
+			}
+			++lumpcachehits;
 		}
+		Z_Unlock();
+		return cached;
+	};
 
-		lump->cache = Z_MallocTracked(file, line, W_LumpLength(lumpnum), tag, &lump->cache, NULL);
-		W_ReadLump (lumpnum, lump->cache);
-		result = (byte*)lump->cache;
+	result = CheckCache();
+	if( result != NULL )
+	{
+		return result;
 	}
-	
+
+	// Not yet loaded, so load it now. Anyone else after the same lump
+	// waits here and picks up the result rather than loading it twice.
+	std::lock_guard< std::mutex > lumplock( lumplocks[ lumpnum % LumpLockShards ] );
+
+	result = CheckCache();
+	if( result != NULL )
+	{
+		return result;
+	}
+
+	++lumpcachemisses;
+
+	// The block only gets its owner once the data's in, so that nobody
+	// sees a half loaded lump in the cache
+	result = (byte*)Z_MallocTracked( file, line, W_LumpLength( lumpnum ), PU_STATIC, NULL, NULL );
+	W_ReadLump( lumpnum, result );
+
+	// Holds on a block that got freed with its level went with it
+	Z_Lock();
+	Z_ChangeUser( result, &lump->cache );
+	Z_ChangeTag( result, tag );
+	lump->holds = tag < PU_PURGELEVEL ? 1 : 0;
+	Z_Unlock();
+
     return result;
 }
 
@@ -514,13 +574,27 @@ void W_ReleaseLumpNum(lumpindex_t lumpnum)
 
     lump = lumpinfo[lumpnum];
 
-    if (lump->wad_file->mapped != NULL)
+    if (W_MapRange(lump->wad_file, lump->position, lump->size) != NULL)
     {
         // Memory-mapped file, so nothing needs to be done here.
     }
     else
     {
-        Z_ChangeTag(lump->cache, PU_CACHE);
+		// Another thread can still be using it until its hold goes too
+		Z_Lock();
+		if( lump->cache != NULL )
+		{
+			if( lump->holds > 0 )
+			{
+				--lump->holds;
+			}
+
+			if( lump->holds == 0 )
+			{
+				Z_ChangeTag(lump->cache, PU_CACHE);
+			}
+		}
+		Z_Unlock();
     }
 }
 
@@ -529,6 +603,13 @@ void W_ReleaseLumpName(const char *name)
     W_ReleaseLumpNum(W_GetNumForName(name));
 }
 
+void W_GetCacheStats( lumpcachestats_t* stats )
+{
+	stats->hits = lumpcachehits.load();
+	stats->misses = lumpcachemisses.load();
+	stats->mapped = lumpcachemapped.load();
+}
+
 #if 0
 
 //
@@ -40,6 +40,10 @@ DOOM_C_API typedef struct lumpinfo_s
     wad_file_t *wad_file;
     void		*cache;
 
+	// How many non-purgable W_CacheLumpNum calls are still waiting on a
+	// W_ReleaseLumpNum. Only touched with the zone locked.
+	int32_t		holds;
+
     char		name[8];
 	int32_t		namepadding;
     int32_t		position;
@@ -66,11 +70,24 @@ filelump_e {
 	char		name[8];
 } ) filelump_t;
 
+// Fills out a WAD style directory for an archive opened through the ZIP
+// file class. Returns false if the file isn't an archive.
+DOOM_C_API doombool W_ZipDirectory( wad_file_t* wad, filelump_t** fileinfo, int32_t* numfilelumps );
+
 DOOM_C_API extern lumpinfo_t **lumpinfo;
 DOOM_C_API extern uint32_t numlumps;
 
+// Set while the renderer is running. Cached lumps won't be purged
+// while it's held, so render threads can keep PU_CACHE pointers.
 DOOM_C_API extern doombool wadrenderlock;
 
+DOOM_C_API typedef struct lumpcachestats_s
+{
+	uint64_t	hits;
+	uint64_t	misses;
+	uint64_t	mapped;
+} lumpcachestats_t;
+
 DOOM_C_API doombool W_HasAnyLumps();
 DOOM_C_API wad_file_t *W_AddFile(const char *filename);
 DOOM_C_API wad_file_t *W_AddFileWithType(const char *filename, wadtype_t type);
@@ -99,6 +116,8 @@ DOOM_C_API extern unsigned int W_LumpNameHash(const char *s);
 DOOM_C_API void W_ReleaseLumpNum(lumpindex_t lump);
 DOOM_C_API void W_ReleaseLumpName(const char *name);
 
+DOOM_C_API void W_GetCacheStats( lumpcachestats_t* stats );
+
 DOOM_C_API const char *W_WadNameForLump(const lumpinfo_t *lump);
 DOOM_C_API const char *W_WadNameForLumpNum( lumpindex_t lump );
 DOOM_C_API const char *W_WadNameForLumpName( const char* name );
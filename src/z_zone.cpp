@@ -19,11 +19,16 @@
 
 #include <string.h>
 
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "doomtype.h"
 #include "i_system.h"
 #include "m_argv.h"
 #include "m_misc.h"
 
+#include "w_wad.h"
 #include "z_zone.h"
 
 //
@@ -42,6 +47,8 @@
 #define ZONEID	0x1d4a11
 #define MAGICMARKER 0xDECEA5EDu
 
+typedef struct zonechunk_s zonechunk_t;
+
 typedef struct memblock_s
 {
 	uint32_t			magic;
@@ -54,7 +61,13 @@ typedef struct memblock_s
 	const char*			file;
 	memdestruct_t		destructor;
 	struct memblock_s*	next;
-	struct memblock_s*	prev;
+	union
+	{
+		struct memblock_s*	prev;	// Heap blocks
+		zonechunk_t*		chunk;	// Arena blocks
+	};
+	struct memblock_s*	lrunext;	// Purgable blocks only
+	struct memblock_s*	lruprev;
 } memblock_t;
 
 
@@ -69,12 +82,413 @@ typedef struct
 
 static memzone_t mainzone = {};
 
+// Everything below goes through the one lock. It's recursive as freeing
+// a block can run a destructor that frees more blocks, and purging frees
+// blocks from inside an allocation.
+static std::recursive_mutex zonelock;
+static std::thread::id zonemainthread;
+
+void Z_Lock( void )
+{
+	zonelock.lock();
+}
+
+void Z_Unlock( void )
+{
+	zonelock.unlock();
+}
+
+//
+// PURGING
+//
+// Purgable blocks live on an LRU list, and once they take up more than
+// the budget the oldest get freed the next time something is allocated.
+// Nothing gets purged while the renderer is running, as it's holding on
+// to lump pointers across threads.
+//
+
+int32_t zone_cache_budget_mb = 128;
+
+typedef struct
+{
+	memblock_t*	head;
+	memblock_t*	tail;
+	size_t		bytes;
+	int32_t		blocks;
+	uint64_t	evictions;
+	uint64_t	evictedbytes;
+} zonelru_t;
+
+static zonelru_t lru = {};
+
+static INLINE doombool Z_IsPurgable( int32_t tag )
+{
+	return tag >= PU_PURGELEVEL;
+}
+
+static void Z_LRUAdd( memblock_t* block )
+{
+	block->lrunext = nullptr;
+	block->lruprev = lru.tail;
+	if( lru.tail ) lru.tail->lrunext = block;
+	else lru.head = block;
+	lru.tail = block;
+
+	lru.bytes += block->size;
+	++lru.blocks;
+}
+
+static void Z_LRURemove( memblock_t* block )
+{
+	if( block->lruprev ) block->lruprev->lrunext = block->lrunext;
+	else lru.head = block->lrunext;
+	if( block->lrunext ) block->lrunext->lruprev = block->lruprev;
+	else lru.tail = block->lruprev;
+	block->lrunext = block->lruprev = nullptr;
+
+	lru.bytes -= block->size;
+	--lru.blocks;
+}
+
+static void Z_LRUTouch( memblock_t* block )
+{
+	if( lru.tail != block )
+	{
+		Z_LRURemove( block );
+		Z_LRUAdd( block );
+	}
+}
+
+// Keeps tag bookkeeping in sync with the LRU, call before changing a tag
+static void Z_LRURetag( memblock_t* block, int32_t newtag )
+{
+	doombool waspurgable = Z_IsPurgable( block->tag );
+	doombool ispurgable = Z_IsPurgable( newtag );
+
+	if( waspurgable && ispurgable )
+	{
+		Z_LRUTouch( block );
+	}
+	else if( waspurgable )
+	{
+		Z_LRURemove( block );
+	}
+	else if( ispurgable )
+	{
+		Z_LRUAdd( block );
+	}
+}
+
+static void Z_PurgeToBudget( void )
+{
+	// PU_CACHE pointers are good until the next allocation on the thread
+	// that asked for them. Only purging from the main thread keeps that
+	// promise for the main thread, everything else needs to cache as
+	// PU_STATIC or stay inside the render lock.
+	if( zone_cache_budget_mb <= 0 || wadrenderlock || std::this_thread::get_id() != zonemainthread )
+	{
+		return;
+	}
+
+	size_t budget = (size_t)zone_cache_budget_mb * 1024ull * 1024ull;
+	while( lru.bytes > budget && lru.head != nullptr )
+	{
+		memblock_t* block = lru.head;
+		++lru.evictions;
+		lru.evictedbytes += block->size;
+		Z_Free( (void*)( block + 1 ) );
+	}
+}
+
+void Z_GetStats( zonestats_t* stats )
+{
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
+	stats->purgablebytes	= lru.bytes;
+	stats->purgableblocks	= lru.blocks;
+	stats->evictions		= lru.evictions;
+	stats->evictedbytes		= lru.evictedbytes;
+}
+
+//
+// ZONE ARENAS
+//
+// Level lifetime tags don't get a malloc per block. Each tag has its own
+// arena that bump allocates out of large chunks, so everything allocated
+// for a level sits together in memory and tearing a level down is a case
+// of handing the chunks back.
+//
+// Blocks keep the same header as heap blocks so that everything that can
+// be done to a heap block can be done to an arena block. Anything that
+// needs per-block teardown (an owner to clear, a destructor to run, a tag
+// that's been changed since allocation) flags the chunk, and only flagged
+// chunks get walked block by block.
+//
+// Small freed blocks go on a per size free list and get handed back out
+// before bumping, which keeps mobjs and thinkers packed together over the
+// course of a level. The free lists are doubly linked through the LRU
+// pointers, which free blocks have no use for, so a chunk that gets
+// released or retired can pull out just its own blocks.
+//
+
+#define ARENAID				0x1d4a12
+#define SLABID				0x51ab1d
+#define CHUNK_ALIGN			64ull
+#define CHUNK_SIZE			( 1024ull * 1024ull )
+#define CHUNK_MAXBLOCK		( CHUNK_SIZE / 4ull )
+#define CHUNK_MAXSPARE		16
+#define SLAB_MAXSIZE		1024ull
+#define SLAB_CLASSES		( SLAB_MAXSIZE / MEM_ALIGN + 1 )
+
+typedef struct zonearena_s zonearena_t;
+
+struct zonechunk_s
+{
+	zonearena_t*		arena;
+	byte*				base;
+	size_t				used;
+	int32_t				live;
+	int32_t				slabbed;
+	int32_t				mintag;
+	int32_t				maxtag;
+	doombool			needswalk;
+	doombool			retired;
+};
+
+struct zonearena_s
+{
+	int32_t							tag;
+	std::vector< zonechunk_t* >		active;
+	std::vector< zonechunk_t* >		retired;
+	std::vector< zonechunk_t* >		spare;
+	memblock_t*						slabs[ SLAB_CLASSES ];
+};
+
+static zonearena_t levelarena		= { PU_LEVEL };
+static zonearena_t levspecarena		= { PU_LEVSPEC };
+
+static zonearena_t* arenas[] = { &levelarena, &levspecarena };
+
+static INLINE doombool Z_IsValidBlock( memblock_t* block )
+{
+	return block->id == ZONEID || block->id == ARENAID;
+}
+
+static INLINE zonearena_t* Z_ArenaForTag( int32_t tag )
+{
+	switch( tag )
+	{
+	case PU_LEVEL:
+		return &levelarena;
+	case PU_LEVSPEC:
+		return &levspecarena;
+	default:
+		return nullptr;
+	}
+}
+
+static INLINE memblock_t* Z_FirstBlock( zonechunk_t* chunk )
+{
+	return (memblock_t*)chunk->base;
+}
+
+static INLINE memblock_t* Z_EndBlock( zonechunk_t* chunk )
+{
+	return (memblock_t*)( chunk->base + chunk->used );
+}
+
+static INLINE memblock_t* Z_NextBlock( memblock_t* block )
+{
+	return (memblock_t*)( (byte*)block + block->size );
+}
+
+static void Z_RemoveChunk( std::vector< zonechunk_t* >& chunks, zonechunk_t* chunk )
+{
+	for( auto it = chunks.begin(); it != chunks.end(); ++it )
+	{
+		if( *it == chunk )
+		{
+			chunks.erase( it );
+			return;
+		}
+	}
+}
+
+static zonechunk_t* Z_NewChunk( zonearena_t* arena )
+{
+	zonechunk_t* chunk = nullptr;
+	if( !arena->spare.empty() )
+	{
+		chunk = arena->spare.back();
+		arena->spare.pop_back();
+	}
+	else
+	{
+		constexpr size_t headersize = ( sizeof( zonechunk_t ) + CHUNK_ALIGN - 1ull ) & ~( CHUNK_ALIGN - 1ull );
+		byte* memory = (byte*)_mm_malloc( headersize + CHUNK_SIZE, CHUNK_ALIGN );
+		if( memory == nullptr )
+		{
+			I_Error( "Z_Malloc: failed on allocation of %zu byte zone chunk", (size_t)CHUNK_SIZE );
+		}
+		chunk = (zonechunk_t*)memory;
+		chunk->base = memory + headersize;
+		mainzone.size += headersize + CHUNK_SIZE;
+	}
+
+	chunk->arena		= arena;
+	chunk->used			= 0;
+	chunk->live			= 0;
+	chunk->slabbed		= 0;
+	chunk->mintag		= arena->tag;
+	chunk->maxtag		= arena->tag;
+	chunk->needswalk	= false;
+	chunk->retired		= false;
+
+	arena->active.push_back( chunk );
+	return chunk;
+}
+
+static INLINE void Z_SlabPush( zonearena_t* arena, memblock_t* block )
+{
+	memblock_t*& slab = arena->slabs[ block->size / MEM_ALIGN ];
+	block->id = SLABID;
+	block->lruprev = nullptr;
+	block->next = slab;
+	if( slab != nullptr ) slab->lruprev = block;
+	slab = block;
+	++block->chunk->slabbed;
+}
+
+static INLINE void Z_SlabUnlink( zonearena_t* arena, memblock_t* block )
+{
+	if( block->lruprev != nullptr ) block->lruprev->next = block->next;
+	else arena->slabs[ block->size / MEM_ALIGN ] = block->next;
+	if( block->next != nullptr ) block->next->lruprev = block->lruprev;
+
+	block->id = 0;
+	block->next = block->lruprev = nullptr;
+	--block->chunk->slabbed;
+}
+
+// Takes this chunk's blocks off the free lists, leaving the rest of
+// the arena's free blocks where they are
+static void Z_SlabRemoveChunk( zonechunk_t* chunk )
+{
+	for( memblock_t* block = Z_FirstBlock( chunk ); chunk->slabbed > 0 && block < Z_EndBlock( chunk ); block = Z_NextBlock( block ) )
+	{
+		if( block->id == SLABID )
+		{
+			Z_SlabUnlink( chunk->arena, block );
+		}
+	}
+}
+
+static void Z_ReleaseChunk( zonechunk_t* chunk )
+{
+	zonearena_t* arena = chunk->arena;
+	Z_RemoveChunk( chunk->retired ? arena->retired : arena->active, chunk );
+	Z_SlabRemoveChunk( chunk );
+
+	if( arena->spare.size() < CHUNK_MAXSPARE )
+	{
+		arena->spare.push_back( chunk );
+	}
+	else
+	{
+		constexpr size_t headersize = ( sizeof( zonechunk_t ) + CHUNK_ALIGN - 1ull ) & ~( CHUNK_ALIGN - 1ull );
+		mainzone.size -= headersize + CHUNK_SIZE;
+		_mm_free( chunk );
+	}
+}
+
+static void Z_RetireChunk( zonechunk_t* chunk )
+{
+	zonearena_t* arena = chunk->arena;
+	Z_RemoveChunk( arena->active, chunk );
+	arena->retired.push_back( chunk );
+	chunk->retired = true;
+
+	// Retired chunks only ever drain, nothing new gets handed out of them
+	Z_SlabRemoveChunk( chunk );
+}
+
+static INLINE void Z_NoteChunkTag( zonechunk_t* chunk, int32_t tag )
+{
+	chunk->mintag = M_MIN( chunk->mintag, tag );
+	chunk->maxtag = M_MAX( chunk->maxtag, tag );
+	if( tag != chunk->arena->tag )
+	{
+		chunk->needswalk = true;
+	}
+}
+
+static memblock_t* Z_ArenaMalloc( zonearena_t* arena, size_t size )
+{
+	if( size <= SLAB_MAXSIZE )
+	{
+		memblock_t* block = arena->slabs[ size / MEM_ALIGN ];
+		if( block != nullptr )
+		{
+			Z_SlabUnlink( arena, block );
+			return block;
+		}
+	}
+
+	zonechunk_t* chunk = arena->active.empty() ? nullptr : arena->active.back();
+	if( chunk == nullptr || chunk->used + size > CHUNK_SIZE )
+	{
+		chunk = Z_NewChunk( arena );
+	}
+
+	memblock_t* block = Z_EndBlock( chunk );
+	block->size = (uint32_t)size;
+	block->chunk = chunk;
+	chunk->used += size;
+
+	return block;
+}
+
+// Frees everything an arena block owns. The memory itself stays where it
+// is, it's up to the caller to decide what happens to it.
+static void Z_KillArenaBlock( memblock_t* block )
+{
+	if( Z_IsPurgable( block->tag ) )
+	{
+		Z_LRURemove( block );
+	}
+
+	if( block->user != nullptr )
+	{
+		*block->user = 0;
+	}
+
+	if( block->destructor )
+	{
+		block->destructor( (void*)( block + 1 ), block->datasize );
+	}
+
+	block->id = 0;
+	block->user = nullptr;
+	block->destructor = nullptr;
+	--block->chunk->live;
+}
+
 //
 // Z_Init
 //
 void Z_Init (void)
 {
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
     mainzone = {};
+	zonemainthread = std::this_thread::get_id();
+	for( zonearena_t* arena : arenas )
+	{
+		arena->active.clear();
+		arena->retired.clear();
+		arena->spare.clear();
+		memset( arena->slabs, 0, sizeof( arena->slabs ) );
+	}
 }
 
 //
@@ -82,6 +496,8 @@ void Z_Init (void)
 //
 void Z_Free (void* ptr)
 {
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
 #if PARANOIA
 	Z_CheckHeap();
 #endif
@@ -91,7 +507,7 @@ void Z_Free (void* ptr)
 
     block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 
-    if (block->id != ZONEID)
+    if (!Z_IsValidBlock(block))
 	{
 		I_Error ("Z_Free: freed a pointer without ZONEID");
 	}
@@ -101,6 +517,25 @@ void Z_Free (void* ptr)
 		I_Error ("Z_Free: something has overwritten this memory's data block!");
 	}
 
+	if( block->id == ARENAID )
+	{
+		zonechunk_t* chunk = block->chunk;
+		Z_KillArenaBlock( block );
+
+		if( chunk->retired )
+		{
+			if( chunk->live == 0 )
+			{
+				Z_ReleaseChunk( chunk );
+			}
+		}
+		else if( block->size <= SLAB_MAXSIZE )
+		{
+			Z_SlabPush( chunk->arena, block );
+		}
+		return;
+	}
+
     if( block->user != nullptr )
     {
     	// clear the user's mark
@@ -112,6 +547,11 @@ void Z_Free (void* ptr)
 		block->destructor( ptr, block->datasize );
 	}
 
+	if( Z_IsPurgable( block->tag ) )
+	{
+		Z_LRURemove( block );
+	}
+
 	if( mainzone.head == block ) mainzone.head = block->next;
 	if( block->prev ) block->prev->next = block->next;
 	if( block->next ) block->next->prev = block->prev;
@@ -130,6 +570,8 @@ void Z_Free (void* ptr)
 
 void* Z_MallocTracked( const char* file, size_t line, size_t size, int32_t tag, void **ptr, memdestruct_t destructor )
 {
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
 #if PARANOIA
 	Z_CheckHeap();
 #endif
@@ -151,30 +593,58 @@ void* Z_MallocTracked( const char* file, size_t line, size_t size, int32_t tag,
     // account for size of block header
     size += sizeof(memblock_t);
 
-	// there will be a free fragment after the allocated block
-	memblock_t* newblock = (memblock_t *)_mm_malloc( size, MEM_ALIGN );
+	Z_PurgeToBudget();
+
+	zonearena_t* arena = size <= CHUNK_MAXBLOCK ? Z_ArenaForTag( tag ) : nullptr;
+
+	memblock_t* newblock = nullptr;
+	if( arena != nullptr )
+	{
+		newblock = Z_ArenaMalloc( arena, size );
+		newblock->id		= ARENAID;
+		++newblock->chunk->live;
+		if( ptr != nullptr || destructor != nullptr )
+		{
+			newblock->chunk->needswalk = true;
+		}
+	}
+	else
+	{
+		newblock = (memblock_t *)_mm_malloc( size, MEM_ALIGN );
+		if( newblock == nullptr )
+		{
+			I_Error( "Z_Malloc: failed on allocation of %zu bytes", size );
+		}
+		newblock->size		= size;
+		newblock->id		= ZONEID;
+		newblock->prev		= nullptr;
+		newblock->next		= mainzone.head;
+
+		if( mainzone.head ) mainzone.head->prev = newblock;
+		mainzone.head = newblock;
+	}
+
 	newblock->magic			= MAGICMARKER;
-	newblock->size			= size;
 	newblock->user			= ptr;
 	newblock->datasize		= datasize;
 	newblock->tag			= tag;
-	newblock->id			= ZONEID;
 	newblock->line			= line;
 	newblock->file			= file;
 	newblock->destructor	= destructor;
 	
+	newblock->lrunext		= nullptr;
+	newblock->lruprev		= nullptr;
+	if( Z_IsPurgable( tag ) )
+	{
+		Z_LRUAdd( newblock );
+	}
+	
 	void* result  = (void *)( newblock + 1 );
 	if( newblock->user )
 	{
 		*newblock->user = result;
 	}
 
-	newblock->prev = nullptr;
-	newblock->next = mainzone.head;
-
-	if( mainzone.head ) mainzone.head->prev = newblock;
-	mainzone.head = newblock;
-
 	return result;
 }
 
@@ -188,6 +658,8 @@ Z_FreeTags
 ( int		lowtag,
   int		hightag )
 {
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
 #if PARANOIA
 	Z_CheckHeap();
 #endif
@@ -209,6 +681,48 @@ Z_FreeTags
 			Z_Free ( (byte *)block+sizeof(memblock_t));
 		}
 	}
+
+	for( zonearena_t* arena : arenas )
+	{
+		for( std::vector< zonechunk_t* >* chunks : { &arena->active, &arena->retired } )
+		{
+			// Iterating over a copy, chunks get released and retired as we go
+			std::vector< zonechunk_t* > current = *chunks;
+			for( zonechunk_t* chunk : current )
+			{
+				if( chunk->maxtag < lowtag || chunk->mintag > hightag )
+				{
+					continue;
+				}
+
+				if( !chunk->needswalk && chunk->mintag >= lowtag && chunk->maxtag <= hightag )
+				{
+					Z_ReleaseChunk( chunk );
+					continue;
+				}
+
+				for( block = Z_FirstBlock( chunk ); block < Z_EndBlock( chunk ); block = Z_NextBlock( block ) )
+				{
+					if( block->id == ARENAID && block->tag >= lowtag && block->tag <= hightag )
+					{
+						Z_KillArenaBlock( block );
+					}
+				}
+
+				if( chunk->live == 0 )
+				{
+					Z_ReleaseChunk( chunk );
+				}
+				else if( !chunk->retired && arena->tag >= lowtag && arena->tag <= hightag )
+				{
+					// Something in here had its tag changed and is still
+					// alive. It can't be bumped over, so the chunk hangs
+					// around until the last of those blocks is freed.
+					Z_RetireChunk( chunk );
+				}
+			}
+		}
+	}
 }
 
 
@@ -222,6 +736,8 @@ Z_DumpHeap
 ( int		lowtag,
   int		hightag )
 {
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
     memblock_t*	block;
 	
     printf ("zone size: %zd  location: %p\n",
@@ -246,6 +762,24 @@ Z_DumpHeap
 	    printf ("ERROR: next block doesn't have proper back link\n");
 
     }
+
+	for( zonearena_t* arena : arenas )
+	{
+		for( std::vector< zonechunk_t* >* chunks : { &arena->active, &arena->retired } )
+		{
+			for( zonechunk_t* chunk : *chunks )
+			{
+				for( block = Z_FirstBlock( chunk ); block < Z_EndBlock( chunk ); block = Z_NextBlock( block ) )
+				{
+					if( block->id == ARENAID && block->tag >= lowtag && block->tag <= hightag )
+					{
+						printf ("block:%p    size:%7u    user:%p    tag:%3i    chunk:%p\n",
+							block, block->size, block->user, block->tag, chunk);
+					}
+				}
+			}
+		}
+	}
 }
 
 
@@ -254,6 +788,8 @@ Z_DumpHeap
 //
 void Z_FileDumpHeap (FILE* f)
 {
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
     memblock_t*	block;
 	
     fprintf (f,"zone size: %zd  location: %p\n",mainzone.size,mainzone);
@@ -273,6 +809,27 @@ void Z_FileDumpHeap (FILE* f)
 	    fprintf (f,"ERROR: next block doesn't have proper back link\n");
 
     }
+
+	for( zonearena_t* arena : arenas )
+	{
+		for( std::vector< zonechunk_t* >* chunks : { &arena->active, &arena->retired } )
+		{
+			for( zonechunk_t* chunk : *chunks )
+			{
+				fprintf (f,"chunk:%p    used:%7zu    live:%5i    tag:%3i%s\n",
+					chunk, chunk->used, chunk->live, arena->tag, chunk->retired ? "    retired" : "");
+
+				for( block = Z_FirstBlock( chunk ); block < Z_EndBlock( chunk ); block = Z_NextBlock( block ) )
+				{
+					if( block->id == ARENAID )
+					{
+						fprintf (f,"block:%p    size:%7u    user:%p    tag:%3i\n",
+							block, block->size, block->user, block->tag);
+					}
+				}
+			}
+		}
+	}
 }
 
 
@@ -282,6 +839,8 @@ void Z_FileDumpHeap (FILE* f)
 //
 void Z_CheckHeap (void)
 {
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
 	memblock_t* prev = NULL;
     for (memblock_t* block = mainzone.head; ; prev = block, block = block->next)
     {
@@ -299,6 +858,38 @@ void Z_CheckHeap (void)
 		if ( block->next->prev != block)
 			I_Error ("Z_CheckHeap: next block doesn't have proper back link\n");
     }
+
+	for( zonearena_t* arena : arenas )
+	{
+		for( std::vector< zonechunk_t* >* chunks : { &arena->active, &arena->retired } )
+		{
+			for( zonechunk_t* chunk : *chunks )
+			{
+				int32_t live = 0;
+				for( memblock_t* block = Z_FirstBlock( chunk ); block < Z_EndBlock( chunk ); block = Z_NextBlock( block ) )
+				{
+					if( block->chunk != chunk || block->size < sizeof( memblock_t ) )
+					{
+						I_Error ("Z_CheckHeap: arena block doesn't point back to its chunk\n");
+					}
+
+					if( block->id == ARENAID )
+					{
+						if( block->magic != MAGICMARKER )
+						{
+							I_Error ("Z_CheckHeap: something has overwritten this memory's data block!");
+						}
+						++live;
+					}
+				}
+
+				if( live != chunk->live )
+				{
+					I_Error ("Z_CheckHeap: arena chunk live count is out of sync\n");
+				}
+			}
+		}
+	}
 }
 
 
@@ -309,12 +900,14 @@ void Z_CheckHeap (void)
 //
 doombool Z_ChangeTag2(void *ptr, int tag, const char *file, int line)
 {
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
     memblock_t*	block;
 	doombool changed;
 	
     block = (memblock_t *) ((byte *)ptr - sizeof(memblock_t));
 
-    if (block->id != ZONEID)
+    if (!Z_IsValidBlock(block))
         I_Error("%s:%i: Z_ChangeTag: block without a ZONEID!",
                 file, line);
 
@@ -323,22 +916,32 @@ doombool Z_ChangeTag2(void *ptr, int tag, const char *file, int line)
                 "for purgable blocks", file, line);
 
 	changed = block->tag != tag;
+	Z_LRURetag( block, tag );
     block->tag = tag;
 
+	if( changed && block->id == ARENAID )
+	{
+		Z_NoteChunkTag( block->chunk, tag );
+	}
+
 	return changed;
 }
 
 doombool Z_LowerTagTracked( void* ptr, int32_t tag, const char* file, size_t line )
 {
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
 	memblock_t*	block = (memblock_t *) ((byte *)ptr - sizeof(memblock_t));
 
-	if (block->id != ZONEID)
+	if (!Z_IsValidBlock(block))
 	{
 		I_Error( "%s:%i: Z_LowerTag: block without a ZONEID!", file, line);
 	}
 
 	int32_t oldtag = block->tag;
-	block->tag = M_MIN( block->tag, tag );
+	int32_t newtag = M_MIN( block->tag, tag );
+	Z_LRURetag( block, newtag );
+	block->tag = newtag;
 
 	if( oldtag != block->tag )
 	{
@@ -346,6 +949,10 @@ doombool Z_LowerTagTracked( void* ptr, int32_t tag, const char* file, size_t lin
 		{
 			I_Error( "%s:%i: Z_LowerTag: an owner is required for purgable blocks", file, line );
 		}
+		if( block->id == ARENAID )
+		{
+			Z_NoteChunkTag( block->chunk, block->tag );
+		}
 		return true;
 	}
 
@@ -354,15 +961,22 @@ doombool Z_LowerTagTracked( void* ptr, int32_t tag, const char* file, size_t lin
 
 void Z_ChangeUser(void *ptr, void **user)
 {
+	std::lock_guard< std::recursive_mutex > lock( zonelock );
+
     memblock_t*	block;
 
     block = (memblock_t *) ((byte *)ptr - sizeof(memblock_t));
 
-    if (block->id != ZONEID)
+    if (!Z_IsValidBlock(block))
     {
         I_Error("Z_ChangeUser: Tried to change user for invalid block!");
     }
 
+	if( block->id == ARENAID )
+	{
+		block->chunk->needswalk = true;
+	}
+
     block->user = user;
     *user = ptr;
 }
@@ -50,6 +50,18 @@ DOOM_C_API typedef enum zonetag_e
 
 DOOM_C_API typedef void( *memdestruct_t )( void*, size_t );
 
+DOOM_C_API typedef struct zonestats_s
+{
+	size_t		purgablebytes;
+	int32_t		purgableblocks;
+	uint64_t	evictions;
+	uint64_t	evictedbytes;
+} zonestats_t;
+
+// Once purgable blocks take up more than this many megabytes, the least
+// recently used are freed. Zero or less never purges.
+DOOM_C_API extern int32_t zone_cache_budget_mb;
+
 DOOM_C_API void		Z_Init (void);
 DOOM_C_API void*	Z_MallocTracked( const char* file, size_t line, size_t size, int32_t tag, void **ptr, memdestruct_t destructor );
 DOOM_C_API void		Z_Free (void *ptr);
@@ -60,6 +72,13 @@ DOOM_C_API void		Z_CheckHeap (void);
 DOOM_C_API doombool	Z_ChangeTag2 (void *ptr, int tag, const char *file, int line);
 DOOM_C_API doombool Z_LowerTagTracked( void* ptr, int32_t tag, const char* file, size_t line );
 DOOM_C_API void		Z_ChangeUser(void *ptr, void **user);
+DOOM_C_API void		Z_GetStats( zonestats_t* stats );
+
+// Every zone function is thread safe on its own. Hold the lock to make a
+// sequence of them atomic, or to read a block owner that purging could
+// clear from another thread.
+DOOM_C_API void		Z_Lock( void );
+DOOM_C_API void		Z_Unlock( void );
 
 #define Z_Malloc( size, tag, ptr ) Z_MallocTracked( __FILE__, __LINE__, size, tag, (void**)ptr, NULL )
 